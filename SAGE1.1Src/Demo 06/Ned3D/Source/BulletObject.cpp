@@ -50,6 +50,7 @@ BulletObject::BulletObject(float range) :
 {
   m_className = "Bullet";
   m_type = ObjectTypes::BULLET;
+  m_bParallel = true;
   updateRay();
 }
 
@@ -39,6 +39,7 @@
 #include "Common/RotationMatrix.h"
 #include "CrowObject.h"
 #include "ObjectTypes.h"
+#include "Objects/CommandBuffer.h"
 #include "Particle/ParticleEngine.h"
 
 CrowObject::CrowObject(Model *m):
@@ -57,6 +58,7 @@ CrowObject::CrowObject(Model *m):
   m_type = ObjectTypes::CROW;
 
   m_dyingFeatherTrail = -1;
+  m_bParallel = true;
 }
 
 
@@ -151,7 +153,7 @@ void CrowObject::move(float dt)
       m_v3Velocity.y += gravity * dt;      
       m_v3Position[0] += m_v3Velocity * dt;           
       GameObject::move(dt);
-      gParticle.setSystemPos(m_dyingFeatherTrail, m_v3Position[0]);
+      getCommands().setParticleSystemPos(m_dyingFeatherTrail, m_v3Position[0]);
     }break;
 
 
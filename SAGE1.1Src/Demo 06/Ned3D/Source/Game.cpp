@@ -79,9 +79,10 @@ bool Game::initiate()
   // Load all sounds
   gSoundManager.parseXML("sounds.xml");  
  
-  // Change current state to the intro state
+  // Change current state to the intro state, or straight to playing when
+  // there's nobody watching
   m_state = NULL;
-  changeState(eGameStateIntro);
+  changeState(gRenderer.isHeadless() ? eGameStatePlaying : eGameStateIntro);
 
   // Let all states initiate so that they're ready to go
   m_statePlaying.initiate();
@@ -113,6 +114,13 @@ void Game::renderScreen()
 }
 
 
+void Game::sampleInput()
+{
+  if (m_state != NULL)
+    m_state->sampleInput();
+}
+
+
 void Game::process()
 {
   
@@ -138,6 +146,13 @@ void Game::process()
 
 }
 
+/// \param dt Length of the tick, in seconds
+void Game::tick(float dt)
+{
+  if (m_state != NULL)
+    m_state->tick(dt);
+}
+
  // Can be called to change the game state
 /// \param state State to change to
 void Game::changeState(EGameState state)
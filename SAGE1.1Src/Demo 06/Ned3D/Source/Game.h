@@ -45,13 +45,15 @@ enum EGameState {eGameStateNone,eGameStatePlaying, eGameStateIntro, eGameStateMe
 /// \brief The Ned Game class.
 //
 /// Controls all game logic.  Game is derived from base class GameBase.
-/// 4 Member functions are then overridden ( initiate(), shutdown(), 
-/// renderScreen(), and process() ).  Although not reccomended, main() can
+/// 5 Member functions are then overridden ( initiate(), shutdown(), 
+/// renderScreen(), process() and tick() ).  Although not reccomended, main() can
 /// be overriden for more flexibility but we don't need to for NED3D.
 /// The WindowsWrapper class will initiate the game engine and then call the 
 /// initiate function in this calss.  It will then repetitively call the Main 
 /// method (overridable) until the program terminates.  The main
-/// method in GameBase simply checks for a lost device, updates input, calls 
+/// method in GameBase simply checks for a lost device, updates input, calls
+/// sampleInput() to latch the controls for the frame, calls
+/// tick() as many times as the time since the last frame calls for, calls 
 /// process() (which is overriden here), and then calls renderScreen()
 /// (also overriden).  Upon termination, the Shutdown method will be called.
 class Game: GameBase
@@ -66,7 +68,9 @@ public:
 
 	void renderScreen(); ///< Renders entire screen
   
+  void sampleInput(); ///< Called once a frame by GameBase::Main(), before the ticks
   void process(); ///< Called once a frame by GameBase::Main()
+  void tick(float dt); ///< Called once a tick by GameBase::advance()
   void changeState(EGameState state); ///< Can be called to change the game state
   
   StatePlaying m_statePlaying;
@@ -45,7 +45,9 @@ public:
   virtual void enterState() {}; ///< Called every time the state is activated 
   virtual void exitState() {}; ///< Called when the state is being deactivated
 
+  virtual void sampleInput() {}; ///< Called once per frame, before the ticks, to latch the controls
   virtual void process(float dt) {}; ///< Called once per frame if the state is active
+  virtual void tick(float dt) {}; ///< Called once per simulation tick if the state is active
   virtual void renderScreen() {}; ///< Called once per frame.
 
 private:
@@ -93,20 +93,40 @@ void Ned3DObjectManager::clear()
 
 void Ned3DObjectManager::handleInteractions()
 {
-  for(ObjectSetIter fit = m_furniture.begin(); fit != m_furniture.end(); ++fit)
-    interactPlaneFurniture(*m_plane, **fit);
+  // Handle plane-furniture, plane-crow and crow-crow interactions.  These
+  // only do anything when the bounding boxes overlap, so the broadphase
+  // pairs are all that need checking.
+
+  findPairs(m_pairs);
+  for(int i = 0; i < (int)m_pairs.size(); i++)
+  {
+    GameObject *obj1 = m_pairs[i].first, *obj2 = m_pairs[i].second;
+    if(!obj1->isAlive() || !obj2->isAlive()) continue;
+    if(obj2 == m_plane)
+      std::swap(obj1, obj2);
+
+    if(obj1 == m_plane)
+    {
+      if(obj2->getType() == ObjectTypes::CROW)
+        interactPlaneCrow(*m_plane, (CrowObject &)*obj2);
+      else if(m_furniture.contains(obj2))
+        interactPlaneFurniture(*m_plane, *obj2);
+    }
+    else if(obj1->getType() == ObjectTypes::CROW && obj2->getType() == ObjectTypes::CROW)
+      interactCrowCrow((CrowObject &)*obj1, (CrowObject &)*obj2);
+  }
+
   for(ObjectSetIter bit = m_bullets.begin(); bit != m_bullets.end(); ++bit)
   {
     BulletObject &bullet = (BulletObject &)**bit;
     if(!bullet.isAlive()) continue;
       
-    // Check for bullets hitting stuff
-    for(ObjectSetIter cit = m_crows.begin(); cit != m_crows.end(); ++cit)
-    {
-      CrowObject &crow = (CrowObject &)**cit;
-      if(!crow.isAlive()) continue;
-      interactCrowBullet(crow, bullet);
-    }
+    // Check for bullets hitting stuff, bullets have no box of their own so
+    // ask the broadphase for crows along the bullet's path
+    findObjectsOnRay(bullet.getPosition(), bullet.m_bulletRay, m_rayObjects);
+    for(int i = 0; i < (int)m_rayObjects.size(); i++)
+      if(m_rayObjects[i]->getType() == ObjectTypes::CROW)
+        interactCrowBullet((CrowObject &)*m_rayObjects[i], bullet);
     GameObject *victim = bullet.getVictim();
     if(victim != NULL)
     {
@@ -121,23 +141,13 @@ void Ned3DObjectManager::handleInteractions()
     }
   }
   
-  // Handle crow-crow interactions (slow....) and crow-plane interactions
+  // Handle crow-terrain interactions
   
-  for(ObjectSetIter cit1 = m_crows.begin(); cit1 != m_crows.end(); ++cit1)
+  for(ObjectSetIter cit = m_crows.begin(); cit != m_crows.end(); ++cit)
   {
-    CrowObject &crow1 = (CrowObject &)**cit1;
-    if(!crow1.isAlive()) continue;
-    
-    interactPlaneCrow(*m_plane,crow1);
-    interactCrowTerrain(crow1,*m_terrain);
-    
-    ObjectSetIter cit2 = cit1;
-    for(++cit2; cit2 != m_crows.end(); ++cit2)
-    {
-      CrowObject &crow2 = (CrowObject &)**cit2;
-      if(!crow2.isAlive()) continue;
-      interactCrowCrow(crow1, crow2);
-    }
+    CrowObject &crow = (CrowObject &)**cit;
+    if(!crow.isAlive()) continue;
+    interactCrowTerrain(crow,*m_terrain);
   }
   
   // Handle plane crashes
@@ -262,12 +272,12 @@ bool Ned3DObjectManager::rayIntersectCrow(const Vector3 &position, const Vector3
 {
   
   // Check for bullets hitting crows
-  for(ObjectSetIter cit = m_crows.begin(); cit != m_crows.end(); ++cit)
+  findObjectsOnRay(position, direction, m_rayObjects);
+  for(int i = 0; i < (int)m_rayObjects.size(); i++)
   {
-    CrowObject &crow = (CrowObject &)**cit;
-    if(!crow.isAlive()) continue;
+    if(m_rayObjects[i]->getType() != ObjectTypes::CROW) continue;
     
-    float t = crow.getBoundingBox().rayIntersect(position,direction);
+    float t = m_rayObjects[i]->getBoundingBox().rayIntersect(position,direction);
     if(t <= 1.0f) return true;        
   }
 
@@ -320,8 +330,7 @@ bool Ned3DObjectManager::interactPlaneTerrain(PlaneObject &plane, TerrainObject
       || plane.isCrashing())
     { 
       plane.killPlane();
-      int partHndl = gParticle.createSystem("planeexplosion");
-      gParticle.setSystemPos(partHndl, plane.getPosition());
+      int partHndl = gParticle.createSystem("planeexplosion", plane.getPosition());
       int boomHndl = gSoundManager.requestSoundHandle("Boom.wav");
       int boomInst = gSoundManager.requestInstance(boomHndl);
       if(boomInst != SoundManager::NOINSTANCE)
@@ -369,8 +378,7 @@ bool Ned3DObjectManager::interactPlaneWater(PlaneObject &plane, WaterObject &wat
     plane.setOrientation(planeOrient);
     plane.setPosition(planePos);
     
-    int partHndl = gParticle.createSystem("planeexplosion");
-    gParticle.setSystemPos(partHndl, plane.getPosition());
+    int partHndl = gParticle.createSystem("planeexplosion", plane.getPosition());
     int boomHndl = gSoundManager.requestSoundHandle("Boom.wav");
     int boomInst = gSoundManager.requestInstance(boomHndl);
     if(boomInst != SoundManager::NOINSTANCE)
@@ -413,8 +421,7 @@ bool Ned3DObjectManager::interactCrowTerrain(CrowObject &crow, TerrainObject &te
   {
     crowPos.y = terrainHeight;
     crow.setPosition(crowPos);       
-    int tmpHndl = gParticle.createSystem("crowfeatherssplat");
-    gParticle.setSystemPos(tmpHndl, crowPos);
+    int tmpHndl = gParticle.createSystem("crowfeatherssplat", crowPos);
 
     int thumpSound = gSoundManager.requestSoundHandle("Thump.wav");
     int instance = gSoundManager.requestInstance(thumpSound);
@@ -434,9 +441,8 @@ bool Ned3DObjectManager::interactCrowTerrain(CrowObject &crow, TerrainObject &te
 
 void Ned3DObjectManager::shootCrow(CrowObject &crow)
 {
-  int tmpHndl = gParticle.createSystem("crowfeathers");
   Vector3 crowPos = crow.getPosition();
-  gParticle.setSystemPos(tmpHndl, crowPos);
+  int tmpHndl = gParticle.createSystem("crowfeathers", crowPos);
   int deathSound = gSoundManager.requestSoundHandle("crowdeath.wav");
   int deathInstance = gSoundManager.requestInstance(deathSound);
   if(deathInstance != SoundManager::NOINSTANCE)
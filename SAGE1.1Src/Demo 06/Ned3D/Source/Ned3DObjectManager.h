@@ -163,6 +163,7 @@ class Ned3DObjectManager : public GameObjectManager
     TerrainObject *m_terrain; ///> Points to the sole terrain object.  (not owned)
     WaterObject *m_water; ///> Points to the sole water object.  (not owned)
     ObjectSet m_furniture; ///> Silos, windmills, etc.
+    Broadphase::ObjectList m_rayObjects; ///> Scratch list for broadphase ray queries
 };
 
 
@@ -36,7 +36,6 @@
 #include <assert.h>
 #include "Common/MathUtil.h"
 #include "PlaneObject.h"
-#include "Input/Input.h"
 #include "ObjectTypes.h"
 #include "common/RotationMatrix.h"
 #include "Ned3DObjectManager.h"
@@ -75,7 +74,7 @@ PlaneObject::PlaneObject(Model *m):
   m_smokeID = -1;
   m_reticleLockOnUpdated = false;
 
-  m_timeSinceFired = gRenderer.getTime();
+  m_timeSinceFired = 0.0f;
 
   // load gunshot sound
   gDirectoryManager.setDirectory(eDirectorySounds);
@@ -196,57 +195,31 @@ void PlaneObject::process(float dt)
 
   // Put any non-movement logic here
 
-  // Unbuffered input (remove if handling input elsewhere)  
+  m_timeSinceFired += dt;
+
+  // fly by the controls latched for this frame
   inputStraight();
   inputLevel();
   inputStop();
  
-  if(gInput.keyDown(DIK_SPACE)) inputFire();
+  if(m_input.fire) inputFire();
  
-  if (gInput.keyDown(DIK_A))  
-    inputTurnLeft(1.0f);
-  if (gInput.keyDown(DIK_D))  
-    inputTurnRight(1.0f);
-  if (gInput.keyDown(DIK_S))  
-    inputDive(1.0f);
-  if (gInput.keyDown(DIK_W))  
-    inputClimb(1.0f);
-    
-  if (gInput.keyJustUp(DIK_EQUALS))
+  if (m_input.turnLeft > 0.0f)
+    inputTurnLeft(m_input.turnLeft);
+  if (m_input.turnRight > 0.0f)
+    inputTurnRight(m_input.turnRight);
+  if (m_input.dive > 0.0f)
+    inputDive(m_input.dive);
+  if (m_input.climb > 0.0f)
+    inputClimb(m_input.climb);
+
+  // a key press is one step, however many ticks the frame has
+  for (; m_input.speedSteps > 0; m_input.speedSteps--)
     inputSpeedUp();
-  if (gInput.keyJustUp(DIK_MINUS))
+  for (; m_input.speedSteps < 0; m_input.speedSteps++)
     inputSpeedDown();
-  if (gInput.keyDown(DIK_RETURN))
-    inputForward(1.0f);
-
-  // process all joystick input if it is disabled
-  if (gInput.joyEnabled())
-  {
-    // set plane speed based on slider
-    float speed = 1.0f;
-    if (gInput.joySlider(&speed))
-    {
-      // if there is a slider
-      inputForward(speed);    
-    }
-    else // there isn't a slider
-    {
-      // if button 1 is down then the plane flys foward
-      if (gInput.joyButtonDown(1))
-        inputForward(1.0f);         
-    }
-
-    if(gInput.joyPadPositionX() < 0.0f)  
-      inputTurnLeft(-gInput.joyPadPositionX());  
-    if(gInput.joyPadPositionX() > 0.0f)
-      inputTurnRight(gInput.joyPadPositionX());
-    if(gInput.joyPadPositionY() > 0.0f)
-      inputDive(gInput.joyPadPositionY());
-    if(gInput.joyPadPositionY() < 0.0f)
-      inputClimb(-gInput.joyPadPositionY());
-
-    if (gInput.joyButtonDown(0)) inputFire();
-  }
+  if (m_input.forward > 0.0f)
+    inputForward(m_input.forward);
 
   if (m_planeState == PS_FLYING)
     m_velocity = (getPosition() - m_oldPosition)/dt;
@@ -358,6 +331,16 @@ void PlaneObject::move(float dt)
   
 }
 
+/// Speed steps from a frame that ran no ticks are kept for the next one,
+/// so a key press is never lost.
+/// \param input The controls
+void PlaneObject::setInput(const PlaneInput &input)
+{
+  int speedSteps = m_input.speedSteps + input.speedSteps;
+  m_input = input;
+  m_input.speedSteps = speedSteps;
+}
+
 void PlaneObject::reset()
 {
   m_isPlaneAlive = true;
@@ -435,11 +418,11 @@ void PlaneObject::inputFire()
 {
   const float BulletsPerSecond = 10.0f;
   
-  int time = gRenderer.getTime();
-  if ((float)(time - m_timeSinceFired)/1000.0f < 1.0f/BulletsPerSecond)
+  // timed in ticks, so the rate of fire doesn't depend on the frame rate
+  if (m_timeSinceFired < 1.0f/BulletsPerSecond)
     return;
 
-  m_timeSinceFired = time;
+  m_timeSinceFired = 0.0f;
   
   // test terrain ray intersect
   Vector3 bulletPos = getPosition();
@@ -455,8 +438,8 @@ void PlaneObject::inputFire()
   Vector3 intersectPoint = Vector3::kZeroVector;
   
   unsigned int bulletID = gGame.m_statePlaying.m_objects->spawnBullet(gunPos,getOrientation());
-  unsigned int mfID = gParticle.createSystem("muzzlefire");
-  gParticle.setSystemPos(mfID, gGame.m_statePlaying.m_objects->getObjectPointer(bulletID)->getPosition());
+  unsigned int mfID = gParticle.createSystem("muzzlefire",
+    gGame.m_statePlaying.m_objects->getObjectPointer(bulletID)->getPosition());
 
   int gunSoundInstance = gSoundManager.requestInstance(m_gunSound);
   gSoundManager.setPosition(m_gunSound, gunSoundInstance, getPosition());
@@ -482,8 +465,7 @@ void PlaneObject::inputFire()
   {
     if(intersectPoint.y > gGame.m_statePlaying.water->getWaterHeight())
     {
-      int tmpHndl = gParticle.createSystem("bulletdust");
-      gParticle.setSystemPos(tmpHndl, intersectPoint);
+      int tmpHndl = gParticle.createSystem("bulletdust", intersectPoint);
     }
     else
     {
@@ -492,8 +474,7 @@ void PlaneObject::inputFire()
         dy *= -1.0f;
       intersectPoint = bulletPos + (bulletDir * (dy / bulletDir.y));
 
-      int tmpHndl = gParticle.createSystem("bulletspray");
-      gParticle.setSystemPos(tmpHndl, intersectPoint);
+      int tmpHndl = gParticle.createSystem("bulletspray", intersectPoint);
     }
   }
 
@@ -589,7 +570,6 @@ void PlaneObject::setTextureAndSmoke()
      gParticle.killSystem(m_smokeID);
    if (m_allParticles[smokeIndex] != "")
    {
-     m_smokeID = gParticle.createSystem(m_allParticles[smokeIndex]);
-     gParticle.setSystemPos(m_smokeID, transformObjectToInertial(m_enginePosition));
+     m_smokeID = gParticle.createSystem(m_allParticles[smokeIndex], transformObjectToInertial(m_enginePosition));
    }
 }
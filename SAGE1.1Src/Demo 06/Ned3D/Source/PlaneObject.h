@@ -39,6 +39,25 @@
 
 #include "Objects/GameObject.h"
 
+/// \brief The plane's controls for a frame.
+///
+/// They are read once a frame and held for every tick of it, so the plane
+/// flies the same however many ticks the frame runs.  Ratios are from 0
+/// to 1, 0 meaning the control isn't used.
+struct PlaneInput
+{
+  float turnLeft; ///< How hard to turn left
+  float turnRight; ///< How hard to turn right
+  float climb; ///< How hard to climb
+  float dive; ///< How hard to dive
+  float forward; ///< How fast to fly forward
+  bool fire; ///< Whether the trigger is held
+  int speedSteps; ///< Presses of speed up less presses of speed down, used by one tick only
+
+  PlaneInput() : turnLeft(0.0f), turnRight(0.0f), climb(0.0f), dive(0.0f),
+    forward(0.0f), fire(false), speedSteps(0) {}
+};
+
 /// \brief Represents a plan object.
 class PlaneObject : public GameObject
 {
@@ -63,6 +82,8 @@ public:
   virtual void move(float dt);
   virtual void reset();  // resets object to default values
 
+  void setInput(const PlaneInput &input); ///< Sets the controls the coming ticks fly by
+
   // Input-handling functions (call on keyJustDown/Up)
   
   void inputTurnLeft(float turnRatio);
@@ -132,7 +153,8 @@ protected:
   /// For instance, if m_hp is 1, m_allParticles[1] will be set
   std::vector<std::string> m_allParticles; 
   int m_smokeID; ///< Handle to the smoke particle system (-1 if there isn't one)
-  int m_timeSinceFired; ///< Enforces time between bullet firing
+  float m_timeSinceFired; ///< Simulated seconds since the last bullet, enforces time between them
+  PlaneInput m_input; ///< Controls latched for this frame's ticks
   
 
   int m_hp;
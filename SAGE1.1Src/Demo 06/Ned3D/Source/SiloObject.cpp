@@ -45,6 +45,7 @@ SiloObject::SiloObject(Model *m)
   assert(m->getPartCount() >= 1);
   m_className = "Silo";
   m_type = ObjectTypes::SILO;
+  m_bParallel = true;
 }
 
 void SiloObject::process(float dt)
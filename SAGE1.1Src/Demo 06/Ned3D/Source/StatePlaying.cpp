@@ -168,6 +168,69 @@ void StatePlaying::enterState()
   gSoundManager.play(m_windmillSound, m_windmillSoundInstance, true);
 }
 
+/// The plane's controls are read here, once a frame, and held for every
+/// tick the frame runs.
+void StatePlaying::sampleInput()
+{
+  PlaneObject *planeObject = m_objects->getPlaneObject();
+  if (planeObject == NULL)
+    return;
+
+  PlaneInput input;
+
+  if (gInput.keyDown(DIK_SPACE)) input.fire = true;
+
+  if (gInput.keyDown(DIK_A))
+    input.turnLeft = 1.0f;
+  if (gInput.keyDown(DIK_D))
+    input.turnRight = 1.0f;
+  if (gInput.keyDown(DIK_S))
+    input.dive = 1.0f;
+  if (gInput.keyDown(DIK_W))
+    input.climb = 1.0f;
+
+  if (gInput.keyJustUp(DIK_EQUALS))
+    input.speedSteps++;
+  if (gInput.keyJustUp(DIK_MINUS))
+    input.speedSteps--;
+  if (gInput.keyDown(DIK_RETURN))
+    input.forward = 1.0f;
+
+  // joystick input too, if there is one
+  if (gInput.joyEnabled())
+  {
+    // set plane speed based on slider
+    float speed = 1.0f;
+    if (gInput.joySlider(&speed))
+    {
+      // if there is a slider
+      input.forward = speed;
+    }
+    else // there isn't a slider
+    {
+      // if button 1 is down then the plane flys foward
+      if (gInput.joyButtonDown(1))
+        input.forward = 1.0f;
+    }
+
+    if(gInput.joyPadPositionX() < 0.0f)
+      input.turnLeft = -gInput.joyPadPositionX();
+    if(gInput.joyPadPositionX() > 0.0f)
+      input.turnRight = gInput.joyPadPositionX();
+    if(gInput.joyPadPositionY() > 0.0f)
+      input.dive = gInput.joyPadPositionY();
+    if(gInput.joyPadPositionY() < 0.0f)
+      input.climb = -gInput.joyPadPositionY();
+
+    if (gInput.joyButtonDown(0)) input.fire = true;
+  }
+
+  planeObject->setInput(input);
+}
+
+/// Everything that moves the world along is in tick(); this only handles
+/// what happens once a frame.
+/// \param dt Time since the last frame, in seconds
 void StatePlaying::process(float dt)
 { 
   PlaneObject *planeObject = m_objects->getPlaneObject();
@@ -178,17 +241,30 @@ void StatePlaying::process(float dt)
     
   gConsole.process();
   
-  // call process and move on all objects in the object manager
-  m_objects->update(dt); 
-    
   // process escape key and space bar
   processInput();
 
   // update location of camera
   processCamera(dt);
+}
+
+/// \param dt Length of the tick, in seconds
+void StatePlaying::tick(float dt)
+{ 
+  PlaneObject *planeObject = m_objects->getPlaneObject();
+
+  // this should never happen but if it does leave
+  if (planeObject == NULL) 
+    return; 
+    
+  // call process and move on all objects in the object manager
+  m_objects->update(dt); 
     
-  // allow water to process per frame movements
+  // allow water to process per tick movements
   water->process(dt);
+
+  // move particles along with everything else
+  gParticle.update(dt);
  
   // as soon as the plane crashes, start the timer
   if (planeObject->isPlaneAlive() == false && m_planeCrashed == false)
@@ -261,6 +337,10 @@ void StatePlaying::renderScreen()
 
 void StatePlaying::renderScene(bool asReflection)
 {
+  // Terrain, objects and particles are culled against the renderer's
+  // frustum.  As a reflection that's the reflected camera's, plus the water
+  // plane, so nothing under the water is drawn into the reflection.
+
   terrain->render(); // render the terrain   
    
   m_objects->render();
@@ -270,7 +350,7 @@ void StatePlaying::renderScene(bool asReflection)
     water->render(gGame.m_currentCam->cameraPos, gGame.m_currentCam->cameraOrient.heading);
     
    //render particles
-  gParticle.render(!asReflection);   
+  gParticle.render(false);   
 }
 
 void StatePlaying::resetGame()
@@ -59,7 +59,9 @@ public:
   void shutdown();  
   void exitState();
   void enterState();
+  void sampleInput();
   void process(float dt);
+  void tick(float dt);
   void renderScreen();
 
   void renderScene(bool asReflection = false);
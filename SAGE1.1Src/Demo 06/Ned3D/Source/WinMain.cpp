@@ -34,6 +34,9 @@
 /// Last updated June 13, 2006
 
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "WindowsWrapper/WindowsWrapper.h"
 #include "Game.h"
 
@@ -41,7 +44,9 @@
 /// Main entry point for this application.  Immediately calls gWindowsWrapper.WinMainWrap().  This isolates us from windows.
 ///  \param hInstance handle to the current instance of this application
 ///  \param hPrevInstance unused
-///  \param lpCmdLine unused 
+///  \param lpCmdLine "-headless frames [script]" runs that many frames with
+///  no window, graphics or sound, taking key presses from the script file.
+///  Anything else is ignored.
 ///  \param nCmdShow specifies how the window is to be shown
 ///  \return TRUE if application terminates correctly
 
@@ -49,6 +54,16 @@ int PASCAL WinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,LPSTR lpCmdLine,i
 
 
 	
+  // run headless if asked to
+  if (lpCmdLine != NULL && strncmp(lpCmdLine, "-headless", 9) == 0)
+  {
+    char *script;
+    int frames = (int)strtol(lpCmdLine + 9, &script, 10);
+    while (*script == ' ') ++script;
+    gWindowsWrapper.HeadlessWrap((GameBase*)&gGame, frames, *script ? script : NULL);
+    return 0;
+  }
+
 	// call the WinMain Wrapper function and pass our game object derived from the GameBase object
 	gWindowsWrapper.WinMainWrap(hInstance, (GameBase*)&gGame, "Loading.jpg", false);
 	
@@ -45,6 +45,7 @@ WindmillObject::WindmillObject(Model *m)
   assert(m->getPartCount() >= 2);
   m_className = "Windmill";
   m_type = ObjectTypes::WINDMILL;
+  m_bParallel = true;
 }
 
 void WindmillObject::process(float dt)
@@ -300,7 +300,7 @@ float   AABB3::rayIntersect(
 
 	bool inside = true;
 
-	float xt, xn;
+	float xt, xn = 0.0f;
 	if (rayOrg.x < min.x) {
 		xt = min.x - rayOrg.x;
 		if (xt > rayDelta.x) return kNoIntersection;
@@ -317,7 +317,7 @@ float   AABB3::rayIntersect(
 		xt = -1.0f;
 	}
 
-	float yt, yn;
+	float yt, yn = 0.0f;
 	if (rayOrg.y < min.y) {
 		yt = min.y - rayOrg.y;
 		if (yt > rayDelta.y) return kNoIntersection;
@@ -334,7 +334,7 @@ float   AABB3::rayIntersect(
 		yt = -1.0f;
 	}
 
-	float zt, zn;
+	float zt, zn = 0.0f;
 	if (rayOrg.z < min.z) {
 		zt = min.z - rayOrg.z;
 		if (zt > rayDelta.z) return kNoIntersection;
@@ -17,7 +17,7 @@
 #define __AABB3_H_INCLUDED__
 
 #ifndef __VECTOR3_H_INCLUDED__
-	#include "Vector3.h"
+	#include "vector3.h"
 #endif
 
 class Matrix4x3;
@@ -18,7 +18,7 @@
 
 #include "Bitmap.h"
 #include "CommonStuff.h"
-#include "common/renderer.h"
+#include "Common/Renderer.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -89,6 +89,7 @@ void	Bitmap::allocateMemory(int xs, int ys, EFormat format) {
 
 		default:
 			assert(false); // bogus pixel format
+			rowBytes = 0;
 	}
 
 	// Allocate memory
@@ -324,7 +325,6 @@ ioError:
 
 	// Read the image data, in file order
 
-	int	rowSz = head.bitsPerPixel / 8 * sizeX;
 	for (int y = 0 ; y < sizeY ; ++y) {
 
 		// Figure out which row this is in the image.
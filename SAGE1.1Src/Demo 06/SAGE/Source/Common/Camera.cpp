@@ -1,9 +1,9 @@
 /// \file Camera.cpp
 /// \brief Code for the Camera class.
 
-#include "common/Renderer.h"
-#include "camera.h"
-#include "mathutil.h"
+#include "Common/Renderer.h"
+#include "Camera.h"
+#include "MathUtil.h"
 #include "RotationMatrix.h"
 
 // constructor
@@ -16,11 +16,11 @@
 #include <string.h>
 
 #include "CommonStuff.h"
-#include "WindowsWrapper/WindowsWrapper.h"
-#include "common/renderer.h"
+#include "Common/Renderer.h"
 
 #ifdef WIN32
 	#include <windows.h>
+	#include "WindowsWrapper/WindowsWrapper.h"
 #endif
 
 const char	*abortSourceFile = "(unknown)";
@@ -144,7 +144,7 @@ void	reallyAbort(const char *fmt, ...) {
 		// this is basically useless for debugging, so you'd
 		// want to do better, especially under the debugger
 
-		printf("FATAL ERROR: %s\n", errMsg);
+		printf("FATAL ERROR: %s\n", g_errMsg);
 		exit(1);
 
 	#endif
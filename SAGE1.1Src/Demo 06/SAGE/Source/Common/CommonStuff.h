@@ -14,9 +14,10 @@
 #define __COMMONSTUFF_H_INCLUDED__
 
 #include <string>
+#include "Portable.h"
 #include "EulerAngles.h"
 #include "MathUtil.h"
-#include "Vector3.h"
+#include "vector3.h"
 
 // Debugger stuff
 
@@ -23,7 +23,7 @@
 #include "CommonStuff.h"
 #include "Matrix4x3.h"
 #include "AABB3.h"
-#include "directorymanager/DirectoryManager.h"
+#include "DirectoryManager/DirectoryManager.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -83,6 +83,129 @@ static int triCompareByMaterial(const void *va, const void *vb) {
 	return a->mark - b->mark;
 }
 
+//---------------------------------------------------------------------------
+// weldHashCell
+//
+// Hash a quantized grid cell coordinate for the spatial hash used by
+// weldVertices().  The multipliers are large primes, which scatters
+// neighboring cells across the table.
+
+static unsigned	weldHashCell(int x, int y, int z) {
+	return
+		((unsigned)x * 73856093U) ^
+		((unsigned)y * 19349663U) ^
+		((unsigned)z * 83492791U);
+}
+
+//---------------------------------------------------------------------------
+// weldCell
+//
+// Find the grid cell a coordinate is in, along one axis, for
+// weldVertices().  Converting a float outside the range of an int (or a
+// NaN) is undefined, and with the smallest cells that happens only a couple
+// of million units out, so clamp it first.  Vertices out past the clamp all
+// share the cells at the edge, which is slow but still correct, since the
+// distance is always checked.
+
+const float	kMaxWeldCell = 1.0e9f;	// Well inside an int, leaving room for the neighbors
+
+static int	weldCell(float x) {
+	if (!(x >= -kMaxWeldCell)) {	// Also catches NaN
+		return (x != x) ? 0 : (int)-kMaxWeldCell;
+	}
+	if (x > kMaxWeldCell) {
+		return (int)kMaxWeldCell;
+	}
+	return (int)floor(x);
+}
+
+//---------------------------------------------------------------------------
+// hashFloat
+//
+// Hash the bits of a float.  Negative zero is folded into positive zero
+// first, since they compare equal.
+
+static unsigned	hashFloat(float f) {
+	f += 0.0f;
+	unsigned	bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits * 2654435761U;
+}
+
+//---------------------------------------------------------------------------
+// hashPositionNormal
+//
+// Hash a vertex position and normal, for the vertex lookup table used by
+// copyUvsIntoVertices()
+
+static unsigned	hashPositionNormal(const Vector3 &p, const Vector3 &n) {
+	unsigned	h = hashFloat(p.x);
+	h = (h ^ (h >> 15)) + hashFloat(p.y);
+	h = (h ^ (h >> 15)) + hashFloat(p.z);
+	h = (h ^ (h >> 15)) + hashFloat(n.x);
+	h = (h ^ (h >> 15)) + hashFloat(n.y);
+	h = (h ^ (h >> 15)) + hashFloat(n.z);
+	return h ^ (h >> 16);
+}
+
+//---------------------------------------------------------------------------
+// Vertex cache optimization
+//
+// These constants tune the triangle reordering done by optimizeTriOrder().
+// The values are the ones suggested by Tom Forsyth in "Linear-Speed Vertex
+// Cache Optimisation."  The cache model is an LRU cache a little larger
+// than most real hardware caches, which works well for any real cache.
+
+const int	kVertexCacheModelSize = 32;	// Size of the LRU cache we model
+const float	kCacheDecayPower = 1.5f;	// Falloff of the score with cache position
+const float	kLastTriScore = 0.75f;		// Score for the vertices of the last triangle
+const float	kValenceBoostScale = 2.0f;	// Bonus for vertices with few triangles left
+const float	kValenceBoostPower = 0.5f;
+
+//---------------------------------------------------------------------------
+// vertexCacheScore
+//
+// Compute the score of a vertex for optimizeTriOrder(), from its position
+// in the modeled cache (-1 if it isn't in the cache) and the number of
+// triangles that use it that haven't been output yet.  Vertices that are
+// in the cache score higher, so that triangles using them are output
+// soon.  Vertices with few triangles left get a boost, so that we finish
+// off lone triangles instead of leaving them for later.
+
+static float	vertexCacheScore(int cachePosition, int remainingTris) {
+
+	// No triangles left?
+
+	if (remainingTris <= 0) {
+		return -1.0f;
+	}
+
+	float	score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+
+			// This vertex was used in the last triangle, so it has a
+			// fixed score, whichever of the three it's in.  Otherwise,
+			// you can get very different answers depending on whether
+			// you add the triangle 1,2,3 or 3,1,2 - which is silly.
+
+			score = kLastTriScore;
+		} else {
+
+			// Points for being high in the cache
+
+			score = 1.0f - (float)(cachePosition - 3) / (float)(kVertexCacheModelSize - 3);
+			score = pow(score, kCacheDecayPower);
+		}
+	}
+
+	// Bonus points for having a low number of triangles left
+
+	score += kValenceBoostScale * pow((float)remainingTris, -kValenceBoostPower);
+
+	return score;
+}
+
 //---------------------------------------------------------------------------
 // skipLine
 //
@@ -512,15 +635,7 @@ void	EditTriMesh::setVertexCount(int newCount) {
 			// too much memory and be wasteful.  The system
 			// shown below seems to be a good compromise.
 
-			vAlloc = newCount * 4 / 3 + 10;
-			vList = (Vertex *)::realloc(vList, vAlloc * sizeof(*vList));
-
-			// Check for out of memory.  You may need more
-			// robust error handling...
-
-			if (vList == NULL) {
-				ABORT("Out of memory");
-			}
+			reserveVertices(newCount * 4 / 3 + 10);
 		}
 
 		// Initialize the new vertices
@@ -567,6 +682,35 @@ void	EditTriMesh::setVertexCount(int newCount) {
 
 }
 
+//---------------------------------------------------------------------------
+// EditTriMesh::reserveVertices
+//
+// Make sure the vertex list has room for at least the given number of
+// vertices, without changing the vertex count.  Use this before adding
+// lots of vertices one at a time.
+
+/// \param newAlloc Number of vertices to make room for
+void	EditTriMesh::reserveVertices(int newAlloc) {
+
+	// Already have enough?
+
+	if (newAlloc <= vAlloc) {
+		return;
+	}
+
+	// Grow the list
+
+	vAlloc = newAlloc;
+	vList = (Vertex *)::realloc(vList, vAlloc * sizeof(*vList));
+
+	// Check for out of memory.  You may need more
+	// robust error handling...
+
+	if (vList == NULL) {
+		ABORT("Out of memory");
+	}
+}
+
 //---------------------------------------------------------------------------
 // EditTriMesh::setTriCount
 //
@@ -853,23 +997,18 @@ int	EditTriMesh::addVertex() {
 
 	int	r = vCount;
 
-	// Check if we have to allocate
+	// Check if we have to allocate.  Double the list, so that
+	// adding lots of vertices one at a time only reallocates
+	// a logarithmic number of times
 
 	if (vCount >= vAlloc) {
+		reserveVertices(vAlloc * 2 + 16);
+	}
 
-		// Need to actually allocate memory - use the other function
-		// to do the hard work
-
-		setVertexCount(vCount+1);
-
-	} else {
-
-		// No need for heavy duty work - we can
-		// do it quickly here
+	// Add it
 
-		++vCount;
-		vList[r].setDefaults();
-	}
+	++vCount;
+	vList[r].setDefaults();
 
 	// Return index of new vertex
 
@@ -889,24 +1028,17 @@ int	EditTriMesh::addVertex(const Vertex &v) {
 
 	int	r = vCount;
 
-	// Check if we have to allocate
+	// Check if we have to allocate.  Double the list, so that
+	// adding lots of vertices one at a time only reallocates
+	// a logarithmic number of times
 
 	if (vCount >= vAlloc) {
+		reserveVertices(vAlloc * 2 + 16);
+	}
 
-		// Need to actually allocate memory - use the other function
-		// to do the hard work
-
-		setVertexCount(vCount+1);
-
-	} else {
-
-		// No need for heavy duty work - we can
-		// do it quickly here
+	// Add it.  No need to default - we are about to assign it
 
-		++vCount;
-
-		// No need to default - we are about to assign it
-	}
+	++vCount;
 
 	// Fill it in
 
@@ -937,24 +1069,17 @@ int	EditTriMesh::dupVertex(int srcVertexIndex) {
 
 	int	r = vCount;
 
-	// Check if we have to allocate
+	// Check if we have to allocate.  Double the list, so that
+	// adding lots of vertices one at a time only reallocates
+	// a logarithmic number of times
 
 	if (vCount >= vAlloc) {
+		reserveVertices(vAlloc * 2 + 16);
+	}
 
-		// Need to actually allocate memory - use the other function
-		// to do the hard work
-
-		setVertexCount(vCount+1);
-
-	} else {
-
-		// No need for heavy duty work - we can
-		// do it quickly here
+	// Add it.  No need to default - we are about to assign it
 
-		++vCount;
-
-		// No need to default - we are about to assign it
-	}
+	++vCount;
 
 	// Make the copy
 
@@ -1802,6 +1927,72 @@ AABB3	EditTriMesh::computeBounds() const {
 	return box;
 }
 
+//---------------------------------------------------------------------------
+// EditTriMesh::computeVertexCacheStats
+//
+// Measure how well the triangle list uses a post-transform vertex cache,
+// by simulating a FIFO cache of the given size (which is how most
+// hardware caches work).  Two numbers are commonly used:
+//
+// ACMR, the average cache miss ratio, is the number of vertices that
+// must be transformed per triangle.  It ranges from 3 (nothing is ever
+// reused) down to about 0.5 for a large regular grid.
+//
+// ATVR, the average transform to vertex ratio, is the number of vertices
+// transformed per vertex used by the mesh.  1 is perfect.  This one is
+// easier to compare across meshes, since it doesn't depend on the
+// topology.
+
+/// \param cacheSize Number of vertices in the simulated FIFO cache
+/// \param returnAcmr Filled in with the average cache miss ratio
+/// \param returnAtvr Filled in with the average transform to vertex ratio
+void	EditTriMesh::computeVertexCacheStats(int cacheSize, float *returnAcmr, float *returnAtvr) const {
+
+	assert(cacheSize > 0);
+
+	int	i;
+
+	*returnAcmr = 0.0f;
+	*returnAtvr = 0.0f;
+	if (triCount() < 1) {
+		return;
+	}
+
+	// For each vertex, remember the miss count when it was last put
+	// into the cache.  In a FIFO cache, each miss pushes one vertex in,
+	// so the vertex is still there if fewer than cacheSize misses
+	// have happened since.
+
+	int	*missStamp = (int *)::malloc(vertexCount() * sizeof(int));
+	if (missStamp == NULL) {
+		ABORT("Out of memory");
+	}
+	for (i = 0 ; i < vertexCount() ; ++i) {
+		missStamp[i] = -1;
+	}
+
+	int	misses = 0;
+	int	usedVertexCount = 0;
+	for (i = 0 ; i < triCount() ; ++i) {
+		const Tri *t = &tri(i);
+		for (int j = 0 ; j < 3 ; ++j) {
+			int	v = t->v[j].index;
+			if (missStamp[v] < 0) {
+				++usedVertexCount;
+			} else if (misses - missStamp[v] < cacheSize) {
+				continue;
+			}
+			missStamp[v] = misses;
+			++misses;
+		}
+	}
+
+	::free(missStamp);
+
+	*returnAcmr = (float)misses / (float)triCount();
+	*returnAtvr = (float)misses / (float)usedVertexCount;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // EditTriMesh members - Optimization
@@ -1894,6 +2085,213 @@ void	EditTriMesh::optimizeVertexOrder(bool removeUnusedVertices) {
 	}
 }
 
+//---------------------------------------------------------------------------
+// EditTriMesh::optimizeTriOrder
+//
+// Re-order the triangle list for the post-transform vertex cache, using
+// Tom Forsyth's linear-speed algorithm.  Each vertex gets a score based on
+// where it is in a simulated LRU cache and how many triangles still use
+// it, and each triangle's score is the sum of its vertex scores.  We
+// repeatedly output the best triangle, only considering the triangles
+// that use vertices in the cache, which keeps it linear.
+//
+// This doesn't know anything about parts or materials, so you'll want
+// to do it on a mesh with a single part and material, or sort the
+// triangles by material afterwards.
+
+/// \remark This should be followed by optimizeVertexOrder(), so that the
+/// vertex list is in the same order as the triangles use them.
+void	EditTriMesh::optimizeTriOrder() {
+
+	int	i, j;
+
+	// Check if there's nothing to sort
+
+	int	nTris = triCount();
+	int	nVerts = vertexCount();
+	if (nTris < 2) {
+		return;
+	}
+
+	// Allocate working space
+
+	int	*vertTriStart = (int *)::malloc((nVerts + 1) * sizeof(int));
+	int	*vertTriCount = (int *)::malloc(nVerts * sizeof(int));
+	int	*vertTriList = (int *)::malloc(nTris * 3 * sizeof(int));
+	int	*cachePosition = (int *)::malloc(nVerts * sizeof(int));
+	float	*vertScore = (float *)::malloc(nVerts * sizeof(float));
+	float	*triScore = (float *)::malloc(nTris * sizeof(float));
+	bool	*triAdded = (bool *)::malloc(nTris * sizeof(bool));
+	int	*newOrder = (int *)::malloc(nTris * sizeof(int));
+	if (
+		vertTriStart == NULL || vertTriCount == NULL || vertTriList == NULL ||
+		cachePosition == NULL || vertScore == NULL || triScore == NULL ||
+		triAdded == NULL || newOrder == NULL
+	) {
+		ABORT("Out of memory");
+	}
+
+	// Build the list of triangles that use each vertex.  First count
+	// them, then turn the counts into offsets into one big list.
+
+	for (i = 0 ; i < nVerts ; ++i) {
+		vertTriCount[i] = 0;
+	}
+	for (i = 0 ; i < nTris ; ++i) {
+		const Tri *t = &tri(i);
+		for (j = 0 ; j < 3 ; ++j) {
+			++vertTriCount[t->v[j].index];
+		}
+	}
+	vertTriStart[0] = 0;
+	for (i = 0 ; i < nVerts ; ++i) {
+		vertTriStart[i+1] = vertTriStart[i] + vertTriCount[i];
+		vertTriCount[i] = 0;
+	}
+	for (i = 0 ; i < nTris ; ++i) {
+		const Tri *t = &tri(i);
+		for (j = 0 ; j < 3 ; ++j) {
+			int	v = t->v[j].index;
+			vertTriList[vertTriStart[v] + vertTriCount[v]] = i;
+			++vertTriCount[v];
+		}
+	}
+
+	// Compute the initial scores.  Nothing is in the cache yet
+
+	for (i = 0 ; i < nVerts ; ++i) {
+		cachePosition[i] = -1;
+		vertScore[i] = vertexCacheScore(-1, vertTriCount[i]);
+	}
+	for (i = 0 ; i < nTris ; ++i) {
+		const Tri *t = &tri(i);
+		triAdded[i] = false;
+		triScore[i] =
+			vertScore[t->v[0].index] +
+			vertScore[t->v[1].index] +
+			vertScore[t->v[2].index];
+	}
+
+	// Output the triangles, one at a time.  The cache has room for
+	// three extra vertices, since we push in a triangle's worth
+	// before we throw out the old ones.
+
+	int	cache[kVertexCacheModelSize + 3];
+	int	cacheCount = 0;
+	int	bestTri = -1;
+	int	scanIndex = 0;
+	for (int outIndex = 0 ; outIndex < nTris ; ++outIndex) {
+
+		// If we don't have a good candidate, just take the next
+		// triangle we haven't used.  This only happens at the start,
+		// and when we've finished off a disconnected piece of the mesh
+
+		if (bestTri < 0) {
+			while (triAdded[scanIndex]) {
+				++scanIndex;
+			}
+			bestTri = scanIndex;
+		}
+
+		// Output it
+
+		triAdded[bestTri] = true;
+		newOrder[outIndex] = bestTri;
+
+		// Remove it from the list of remaining triangles of
+		// each of its vertices
+
+		const Tri *t = &tri(bestTri);
+		for (j = 0 ; j < 3 ; ++j) {
+			int	v = t->v[j].index;
+			int	*list = &vertTriList[vertTriStart[v]];
+			for (int k = 0 ; k < vertTriCount[v] ; ++k) {
+				if (list[k] == bestTri) {
+					list[k] = list[vertTriCount[v] - 1];
+					--vertTriCount[v];
+					break;
+				}
+			}
+		}
+
+		// Push its vertices to the front of the cache
+
+		int	newCache[kVertexCacheModelSize + 3];
+		int	newCacheCount = 0;
+		for (j = 0 ; j < 3 ; ++j) {
+			int	v = t->v[j].index;
+			if (j > 0 && v == t->v[0].index) continue;
+			if (j > 1 && v == t->v[1].index) continue;
+			newCache[newCacheCount++] = v;
+		}
+		for (i = 0 ; i < cacheCount ; ++i) {
+			int	v = cache[i];
+			if (v != t->v[0].index && v != t->v[1].index && v != t->v[2].index) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+
+		// Update the vertex scores.  Vertices that fell off the end
+		// of the cache are updated too
+
+		for (i = 0 ; i < newCacheCount ; ++i) {
+			int	v = newCache[i];
+			cachePosition[v] = (i < kVertexCacheModelSize) ? i : -1;
+			vertScore[v] = vertexCacheScore(cachePosition[v], vertTriCount[v]);
+		}
+
+		// Update the scores of the triangles that use those vertices,
+		// and pick the best one for next time
+
+		float	bestScore = -1.0f;
+		bestTri = -1;
+		for (i = 0 ; i < newCacheCount ; ++i) {
+			int	v = newCache[i];
+			const int	*list = &vertTriList[vertTriStart[v]];
+			for (int k = 0 ; k < vertTriCount[v] ; ++k) {
+				int	triIndex = list[k];
+				const Tri *t2 = &tri(triIndex);
+				triScore[triIndex] =
+					vertScore[t2->v[0].index] +
+					vertScore[t2->v[1].index] +
+					vertScore[t2->v[2].index];
+				if (triScore[triIndex] > bestScore) {
+					bestScore = triScore[triIndex];
+					bestTri = triIndex;
+				}
+			}
+		}
+
+		// Install the new cache, dropping whatever fell off the end
+
+		cacheCount = (newCacheCount < kVertexCacheModelSize) ? newCacheCount : kVertexCacheModelSize;
+		memcpy(cache, newCache, cacheCount * sizeof(int));
+	}
+
+	// Shuffle the triangles into the new order
+
+	Tri	*newTriList = (Tri *)::malloc(tAlloc * sizeof(Tri));
+	if (newTriList == NULL) {
+		ABORT("Out of memory");
+	}
+	for (i = 0 ; i < nTris ; ++i) {
+		newTriList[i] = tList[newOrder[i]];
+	}
+	::free(tList);
+	tList = newTriList;
+
+	// Free working space
+
+	::free(vertTriStart);
+	::free(vertTriCount);
+	::free(vertTriList);
+	::free(cachePosition);
+	::free(vertScore);
+	::free(triScore);
+	::free(triAdded);
+	::free(newOrder);
+}
+
 //---------------------------------------------------------------------------
 // EditTriMesh::sortTrisByMaterial
 //
@@ -1919,14 +2317,211 @@ void	EditTriMesh::sortTrisByMaterial() {
 // EditTriMesh::weldVertices
 //
 // Weld coincident vertices.  For the moment, this disregards UVs and welds
-// all vertices that are within geometric tolerance
+// all vertices that are within geometric tolerance.  (The UVs live in the
+// triangles, so copyUvsIntoVertices() will split the vertices back apart
+// along any texture seams.)
+//
+// Vertices are bucketed into a hash grid whose cells are the size of the
+// weld tolerance, so any vertex close enough to be welded to another one
+// lies in the same cell or in one of the 26 cells adjacent to it.  Only
+// the vertices that survive the weld are inserted into the grid, so each
+// lookup only has to look at a handful of candidates, and the whole
+// thing runs in linear expected time.
 
 /// \param opt Set of optimatization parameters to use when welding
-/// \todo Implement this function
-void	EditTriMesh::weldVertices(const OptimizationParameters &opt) {
+/// \return Number of vertices removed from the vertex list
+/// \remark Triangles that become degenerate are deleted.  Vertex normals
+/// are not recomputed; call computeVertexNormals() afterwards if you need
+/// them.
+int	EditTriMesh::weldVertices(const OptimizationParameters &opt) {
+
+	int	i;
+
+	// Check if there's nothing to weld
+
+	if (vertexCount() < 2) {
+		return 0;
+	}
+
+	// Compute an "average" surface normal for each vertex, from the
+	// triangles that use it.  Two vertices that are geometrically
+	// coincident but that sit on opposite sides of a sharp edge will
+	// have very different normals, and we don't want to weld them,
+	// since that would smooth the edge away.
+
+	computeTriNormals();
+
+	Vector3	*avgNormal = (Vector3 *)::malloc(vertexCount() * sizeof(Vector3));
+	if (avgNormal == NULL) {
+		ABORT("Out of memory");
+	}
+	for (i = 0 ; i < vertexCount() ; ++i) {
+		avgNormal[i].zero();
+	}
+	for (i = 0 ; i < triCount() ; ++i) {
+		const Tri *t = &tri(i);
+		for (int j = 0 ; j < 3 ; ++j) {
+			avgNormal[t->v[j].index] += t->normal;
+		}
+	}
+	for (i = 0 ; i < vertexCount() ; ++i) {
+		avgNormal[i].normalize();
+	}
+
+	// Figure out the grid cell size.  A zero tolerance still gets a
+	// (small) nonzero cell, so exactly coincident vertices are welded.
+
+	float	tolerance = opt.coincidentVertexTolerance;
+	if (tolerance < 0.0f) {
+		tolerance = 0.0f;
+	}
+	float	toleranceSquared = tolerance * tolerance;
+	float	oneOverCellSize = 1.0f / ((tolerance > 1.0f / 1024.0f) ? tolerance : 1.0f / 1024.0f);
+
+	// Allocate the hash table.  The number of buckets is a power
+	// of two, at least twice the number of vertices, so the chains
+	// stay short.  Each vertex in the grid is linked to the next
+	// one in the same bucket through the next[] list.
+
+	int	bucketCount = 1;
+	while (bucketCount < vertexCount() * 2) {
+		bucketCount <<= 1;
+	}
+	unsigned	bucketMask = (unsigned)bucketCount - 1;
+
+	int	*bucketHead = (int *)::malloc(bucketCount * sizeof(int));
+	int	*next = (int *)::malloc(vertexCount() * sizeof(int));
+	int	*remap = (int *)::malloc(vertexCount() * sizeof(int));
+	if (bucketHead == NULL || next == NULL || remap == NULL) {
+		ABORT("Out of memory");
+	}
+	for (i = 0 ; i < bucketCount ; ++i) {
+		bucketHead[i] = -1;
+	}
+
+	// Scan the vertex list, welding each vertex to the first vertex
+	// we have already kept that is within tolerance.  If there isn't
+	// one, we keep this vertex and add it to the grid.
+
+	int	keptCount = 0;
+	for (i = 0 ; i < vertexCount() ; ++i) {
+		const Vector3 &p = vertex(i).p;
+
+		// Quantize the position to locate the grid cell
+
+		int	cx = weldCell(p.x * oneOverCellSize);
+		int	cy = weldCell(p.y * oneOverCellSize);
+		int	cz = weldCell(p.z * oneOverCellSize);
+
+		// Search this cell and all of its neighbors
+
+		int	weldTo = -1;
+		for (int dx = -1 ; dx <= 1 && weldTo < 0 ; ++dx) {
+			for (int dy = -1 ; dy <= 1 && weldTo < 0 ; ++dy) {
+				for (int dz = -1 ; dz <= 1 && weldTo < 0 ; ++dz) {
+					unsigned	bucket = weldHashCell(cx+dx, cy+dy, cz+dz) & bucketMask;
+					for (int j = bucketHead[bucket] ; j >= 0 ; j = next[j]) {
+
+						// Close enough?  (Different cells can land in the same
+						// bucket, so we must always check the distance.  Written
+						// this way round so a NaN is never close to anything.)
+
+						if (!(Vector3::distanceSquared(vertex(j).p, p) <= toleranceSquared)) {
+							continue;
+						}
+
+						// Check the edge angle.  Unused vertices don't have
+						// a normal, and can be welded to anything
+
+						if (
+							(avgNormal[i] * avgNormal[i] > 0.0f) &&
+							(avgNormal[j] * avgNormal[j] > 0.0f) &&
+							(avgNormal[i] * avgNormal[j] < opt.cosOfEdgeAngleTolerance)
+						) {
+							continue;
+						}
+
+						// Weld it
+
+						weldTo = j;
+						break;
+					}
+				}
+			}
+		}
+
+		// Did we find one?
+
+		if (weldTo >= 0) {
+			remap[i] = weldTo;
+		} else {
+
+			// Nope - keep this one, and add it to the grid
+
+			remap[i] = i;
+			unsigned	bucket = weldHashCell(cx, cy, cz) & bucketMask;
+			next[i] = bucketHead[bucket];
+			bucketHead[bucket] = i;
+			++keptCount;
+		}
+	}
+
+	// Free the grid
+
+	::free(bucketHead);
+	::free(next);
+	::free(avgNormal);
+
+	// Check if nothing got welded, then don't bother with the
+	// rest of this
+
+	int	removedCount = vertexCount() - keptCount;
+	if (removedCount == 0) {
+		::free(remap);
+		return 0;
+	}
+
+	// Compact the vertex list, and convert the remap table so that it
+	// holds the new vertex indices.  A welded vertex always maps to a
+	// vertex with a lower index, whose entry has already been converted.
+
+	int	destVertexIndex = 0;
+	for (i = 0 ; i < vertexCount() ; ++i) {
+		if (remap[i] == i) {
+			if (i != destVertexIndex) {
+				vertex(destVertexIndex) = vertex(i);
+			}
+			remap[i] = destVertexIndex;
+			++destVertexIndex;
+		} else {
+			remap[i] = remap[remap[i]];
+		}
+	}
+	assert(destVertexIndex == keptCount);
 
-	// !FIXME!
+	// Fixup indices in the face list
+
+	for (i = 0 ; i < triCount() ; ++i) {
+		Tri *t = &tri(i);
+		for (int j = 0 ; j < 3 ; ++j) {
+			t->v[j].index = remap[t->v[j].index];
+		}
+	}
+	::free(remap);
 
+	// Set the new count.  We don't call the function to
+	// do this, since it will scan for triangles that use the
+	// whacked entries.  We already took care of that.
+
+	vCount = keptCount;
+
+	// Welding tiny triangles can collapse them
+
+	deleteDegenerateTris();
+
+	// Return number of vertices we got rid of
+
+	return removedCount;
 }
 
 //---------------------------------------------------------------------------
@@ -1934,18 +2529,67 @@ void	EditTriMesh::weldVertices(const OptimizationParameters &opt) {
 //
 // Ensure that the vertex UVs are correct, possibly duplicating
 // vertices if necessary
+//
+// When a vertex has already been claimed by a face with different UVs,
+// we need to find another vertex with the same position and normal that
+// either already has our UVs or hasn't been claimed yet.  To avoid
+// searching the whole vertex list for it, all the vertices are kept in a
+// hash table keyed on position and normal.  Each chain holds only the
+// vertices that are geometrically identical (give or take a hash
+// collision), which we then check for a UV match, so each lookup takes
+// constant expected time.
 
 void	EditTriMesh::copyUvsIntoVertices() {
 
+	int	i;
+
 	// Mark all vertices indicating that their UV's are invalid
 
 	markAllVertices(0);
 
+	// Check if we don't have any faces, then bail now.
+
+	if (triCount() < 1 || vertexCount() < 1) {
+		return;
+	}
+
+	// Allocate the hash table.  The number of buckets is a power of
+	// two, at least twice the number of vertices.  The vertices
+	// in each bucket are linked through the next[] list, which has
+	// to grow as we add vertices
+
+	int	bucketCount = 1;
+	while (bucketCount < vertexCount() * 2) {
+		bucketCount <<= 1;
+	}
+	unsigned	bucketMask = (unsigned)bucketCount - 1;
+
+	int	nextAlloc = vertexCount() * 5 / 4 + 16;
+	int	*bucketHead = (int *)::malloc(bucketCount * sizeof(int));
+	int	*next = (int *)::malloc(nextAlloc * sizeof(int));
+	if (bucketHead == NULL || next == NULL) {
+		ABORT("Out of memory");
+	}
+	for (i = 0 ; i < bucketCount ; ++i) {
+		bucketHead[i] = -1;
+	}
+
+	// Insert the vertices.  We insert them in reverse order, so that
+	// the chains are in order of increasing vertex index, and the
+	// vertex we pick is the same one a linear search would find.
+
+	for (i = vertexCount() - 1 ; i >= 0 ; --i) {
+		const Vertex *v = &vertex(i);
+		unsigned	bucket = hashPositionNormal(v->p, v->normal) & bucketMask;
+		next[i] = bucketHead[bucket];
+		bucketHead[bucket] = i;
+	}
+
 	// Scan the faces, and shove in the UV's into the vertices
 
 	for (int triIndex = 0 ; triIndex < triCount() ; ++triIndex) {
 		Tri *triPtr = &tri(triIndex);
-		for (int i = 0 ; i < 3 ; ++i) {
+		for (i = 0 ; i < 3 ; ++i) {
 
 			// Locate vertex
 
@@ -1981,16 +2625,16 @@ void	EditTriMesh::copyUvsIntoVertices() {
 			}
 
 			// OK, we can't use this vertex - somebody else already has
-			// it "claimed" with different UV's.  First, we'll search
-			// for another vertex with the same position.  Yikes - 
-			// this requires a linear search through the vertex list.
-			// Luckily, this should not happen the majority of the time.
+			// it "claimed" with different UV's.  Search the vertices
+			// with the same position and normal for one we can use.
 
+			unsigned	bucket = hashPositionNormal(vPtr->p, vPtr->normal) & bucketMask;
 			bool	foundOne = false;
-			for (int newIndex = 0 ; newIndex < vertexCount() ; ++newIndex) {
+			for (int newIndex = bucketHead[bucket] ; newIndex >= 0 ; newIndex = next[newIndex]) {
 				Vertex *newPtr = &vertex(newIndex);
 
-				// Is the position and normal correct?
+				// Is the position and normal correct?  (Some other
+				// vertex may have landed in the same bucket.)
 
 				if (
 					(newPtr->p != vPtr->p) ||
@@ -2052,10 +2696,33 @@ void	EditTriMesh::copyUvsIntoVertices() {
 				newVertex.mark = 1;
 				newVertex.u = triPtr->v[i].u;
 				newVertex.v = triPtr->v[i].v;
-				triPtr->v[i].index = addVertex(newVertex);
+				int	newIndex = addVertex(newVertex);
+				triPtr->v[i].index = newIndex;
+
+				// Add it to the end of its chain, so the chain stays
+				// in vertex index order
+
+				if (newIndex >= nextAlloc) {
+					nextAlloc = nextAlloc * 2;
+					next = (int *)::realloc(next, nextAlloc * sizeof(int));
+					if (next == NULL) {
+						ABORT("Out of memory");
+					}
+				}
+				next[newIndex] = -1;
+				int	*link = &bucketHead[bucket];
+				while (*link >= 0) {
+					link = &next[*link];
+				}
+				*link = newIndex;
 			}
 		}
 	}
+
+	// Free the hash table
+
+	::free(bucketHead);
+	::free(next);
 }
 
 // Do all of the optimizations and prepare the model
@@ -2064,7 +2731,17 @@ void	EditTriMesh::copyUvsIntoVertices() {
 
 /// \remark Prepares the model for fast rendering under *most* rendering
 /// systems, with proper lighting.
-void	EditTriMesh::optimizeForRendering() {
+/// \param weld Set to true to weld coincident vertices (using the default
+/// optimization parameters) before the normals are computed.  Default
+/// value is true
+/// \warning Welding changes the vertex list depending on the vertex
+/// positions, so don't weld meshes that must keep a one-to-one vertex
+/// correspondence with other meshes (for example, animation frames)
+void	EditTriMesh::optimizeForRendering(bool weld) {
+	if (weld) {
+		OptimizationParameters opt;
+		weldVertices(opt);
+	}
 	computeVertexNormals();
 }
 
@@ -17,7 +17,7 @@
 #define __EDITTRIMESH_H_INCLUDED__
 
 #ifndef __VECTOR3_H_INCLUDED__
-	#include "Vector3.h"
+	#include "vector3.h"
 #endif
 
 class Matrix4x3;
@@ -204,6 +204,7 @@ public:
 
   
   void setVertexCount(int newCount); ///< Sets the size of the vertex list
+  void reserveVertices(int newAlloc); ///< Makes room in the vertex list without changing its size
   void setTriCount(int newCount);  ///< Sets the size of the triangle list
   void setMaterialCount(int newCount); ///< Sets the size of the material list
   void setPartCount(int newCount); ///< Sets the size of the part list
@@ -264,6 +265,7 @@ public:
   void computeTriNormals();   ///< Compute all triangle-level surface normals
   void computeVertexNormals();   ///< Compute vertex level surface normals.
   AABB3 computeBounds() const;   ///< Compute the size of the mesh
+  void computeVertexCacheStats(int cacheSize, float *returnAcmr, float *returnAtvr) const;   ///< Measure vertex cache efficiency of the triangle order
   //@}
   //-------------------------------------------------------------------------
 
@@ -271,10 +273,11 @@ public:
   /// \name Optimization
   //@{
   void optimizeVertexOrder(bool removeUnusedVertices = true);   ///< Order the vertex list in the order that they are used by the faces
+  void optimizeTriOrder();   ///< Order the triangle list for best vertex cache performance
   void	sortTrisByMaterial();   ///< Sort triangles by material
-  void	weldVertices(const OptimizationParameters &opt);   ///< Weld coincident vertices
+  int	weldVertices(const OptimizationParameters &opt);   ///< Weld coincident vertices, returning the number removed
   void copyUvsIntoVertices();   ///< Ensure that the vertex UVs are correct, possibly duplicating vertices if necessary
-  void optimizeForRendering();   ///< Do all of the optimizations
+  void optimizeForRendering(bool weld = true);   ///< Do all of the optimizations
   //@}
   //-------------------------------------------------------------------------
 
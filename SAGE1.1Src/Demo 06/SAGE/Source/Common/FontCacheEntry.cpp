@@ -6,28 +6,26 @@
 FontCacheEntry::FontCacheEntry()
 :ResourceBase(true) // register with the resource manager
 {
-  d3dFont = NULL;
+  font = NULL;
 
 }
 
 FontCacheEntry::~FontCacheEntry()
 {
-  if (d3dFont) 
-    d3dFont->Release();
-
-  d3dFont = NULL;
+  delete font;
+  font = NULL;
 }
 
 void FontCacheEntry::release()
 {
-  if (d3dFont)
-    d3dFont->OnLostDevice();
+  if (font)
+    gRenderer.getBackend()->loseFont(font);
 
 }
 
 void FontCacheEntry::restore()
 {
-  if (d3dFont)
-    d3dFont->OnResetDevice();
+  if (font)
+    gRenderer.getBackend()->resetFont(font);
 
-}
\ No newline at end of file
+}
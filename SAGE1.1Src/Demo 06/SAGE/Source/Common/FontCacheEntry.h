@@ -5,10 +5,9 @@
 #define __FONTCACHEENTRY_H_INCLUDED__
 
 #include "Resource/ResourceBase.h"
-#include <d3d9.h>
-#include <d3dx9core.h>
+#include "Graphics/RenderBackend.h"
 
-/// \brief Encapsulates the Direct3D Font class. Since this is derived
+/// \brief Encapsulates a font made by the render backend. Since this is derived
 /// from ResourceBase, managing this font is automated.
 class FontCacheEntry : ResourceBase
 {
@@ -16,7 +15,7 @@ public:
     FontCacheEntry(); ///< Constructs a FontCacheEntry object.
     ~FontCacheEntry(); ///< Destructs a FontCacheEntry object.
 
-    LPD3DXFONT d3dFont; ///< Pointer to the Direct3D font interface.
+    RenderBackend::Font *font; ///< The font, as the backend made it.
 
     void release(); ///< Releases the font resource.
     void restore(); ///< Restors the font resource.
@@ -24,4 +23,4 @@ public:
 
 
 
-#endif
\ No newline at end of file
+#endif
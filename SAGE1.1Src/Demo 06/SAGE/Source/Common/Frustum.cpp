@@ -0,0 +1,213 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// Frustum.cpp - View frustum for visibility culling
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file Frustum.cpp
+/// \brief Code for the Frustum class.
+
+#include <math.h>
+
+#include "Frustum.h"
+#include "AABB3.h"
+#include "Matrix4x3.h"
+
+Frustum::Frustum()
+{
+  m_planeMask = 0;
+}
+
+/// Uses the method of Gribb and Hartmann.  A point p is inside the view
+/// volume when -w <= x <= w, -w <= y <= w and 0 <= z <= w, where
+/// (x,y,z,w) = p * viewProj.  Each of those six inequalities is a plane in
+/// world space made up of sums and differences of the matrix columns.  The
+/// extra clip plane, if any, is kept.
+/// \param viewProj The world to clip space matrix as 16 floats, row major.
+void Frustum::setup(const float viewProj[16])
+{
+  const float *m = viewProj;
+
+  // the columns of the matrix, m[j] is x, m[j+4] is y, and so on
+
+  for(int j = 0; j < 4; j++)
+  {
+    float sign = (j & 1) ? -1.0f : 1.0f;
+    int col = (j < 2) ? 0 : 1;
+    Plane &p = m_planes[j];
+    p.a = m[3] + sign * m[col];
+    p.b = m[7] + sign * m[4 + col];
+    p.c = m[11] + sign * m[8 + col];
+    p.d = m[15] + sign * m[12 + col];
+  }
+
+  m_planes[kNear] = Plane(m[2], m[6], m[10], m[14]);
+  m_planes[kFar] = Plane(m[3] - m[2], m[7] - m[6], m[11] - m[10], m[15] - m[14]);
+
+  for(int i = 0; i < kUser; i++)
+    m_planes[i].normalize();
+
+  m_planeMask |= (1 << kUser) - 1;
+}
+
+/// \param worldToCamera The view matrix.
+/// \param proj The camera to clip space matrix as 16 floats, row major.
+void Frustum::setup(const Matrix4x3 &worldToCamera, const float proj[16])
+{
+  // The view matrix as 4x4 has a last column of (0,0,0,1)
+
+  const float view[16] =
+  {
+    worldToCamera.m11, worldToCamera.m12, worldToCamera.m13, 0.0f,
+    worldToCamera.m21, worldToCamera.m22, worldToCamera.m23, 0.0f,
+    worldToCamera.m31, worldToCamera.m32, worldToCamera.m33, 0.0f,
+    worldToCamera.tx, worldToCamera.ty, worldToCamera.tz, 1.0f
+  };
+
+  float viewProj[16];
+  for(int i = 0; i < 4; i++)
+    for(int j = 0; j < 4; j++)
+      viewProj[i*4 + j] =
+        view[i*4] * proj[j] + view[i*4 + 1] * proj[4 + j] +
+        view[i*4 + 2] * proj[8 + j] + view[i*4 + 3] * proj[12 + j];
+
+  setup(viewProj);
+}
+
+/// \param plane The plane, with points inside the frustum where
+/// ax + by + cz + d >= 0.
+void Frustum::setUserPlane(const Plane &plane)
+{
+  m_planes[kUser] = plane;
+  m_planes[kUser].normalize();
+  m_planeMask |= 1 << kUser;
+}
+
+void Frustum::clearUserPlane()
+{
+  m_planeMask &= ~(1 << kUser);
+}
+
+int Frustum::classifyBox(int i, const Vector3 &center, const Vector3 &extent) const
+{
+  const Plane &p = m_planes[i];
+
+  // distance of the center and the box's half width along the normal
+
+  float s = p.a * center.x + p.b * center.y + p.c * center.z + p.d;
+  float r = fabsf(p.a) * extent.x + fabsf(p.b) * extent.y + fabsf(p.c) * extent.z;
+
+  if(s + r < 0.0f)
+    return -1;
+  return (s - r >= 0.0f) ? 1 : 0;
+}
+
+int Frustum::classifySphere(int i, const Vector3 &center, float radius) const
+{
+  const Plane &p = m_planes[i];
+  float s = p.a * center.x + p.b * center.y + p.c * center.z + p.d;
+
+  if(s + radius < 0.0f)
+    return -1;
+  return (s - radius >= 0.0f) ? 1 : 0;
+}
+
+/// The test is conservative: a box near a corner of the frustum can be
+/// outside without being entirely behind any one plane, and is reported
+/// as visible.
+/// \param box The box in world space.  It must not be empty.
+/// \param planeMask If not NULL, on entry the planes to test and on exit
+/// those planes minus the ones the box is entirely inside of.  Left alone
+/// if the box isn't visible.
+/// \param lastPlane If not NULL, a plane to test first.  Set to the plane
+/// that rejected the box if it isn't visible.  Start it at -1.
+/// \return true if the box may be visible.
+bool Frustum::isBoxVisible(const AABB3 &box, unsigned *planeMask, int *lastPlane) const
+{
+  unsigned mask = m_planeMask;
+  if(planeMask != 0)
+    mask &= *planeMask;
+
+  Vector3 center = box.center();
+  Vector3 extent = box.max - center;
+  unsigned inside = 0; // planes the box is entirely inside of
+  unsigned untested = mask;
+
+  // Try the plane that rejected the box last time first.  Things that were
+  // out of view last frame usually still are, and usually for the same
+  // reason.
+
+  if(lastPlane != 0 && *lastPlane >= 0 && (mask & (1 << *lastPlane)))
+  {
+    int result = classifyBox(*lastPlane, center, extent);
+    if(result < 0)
+      return false;
+    if(result > 0)
+      inside |= 1 << *lastPlane;
+    untested &= ~(1 << *lastPlane);
+  }
+
+  for(int i = 0; untested != 0; i++, untested >>= 1)
+  {
+    if(!(untested & 1))
+      continue;
+    int result = classifyBox(i, center, extent);
+    if(result < 0)
+    {
+      if(lastPlane != 0)
+        *lastPlane = i;
+      return false;
+    }
+    if(result > 0)
+      inside |= 1 << i;
+  }
+
+  if(planeMask != 0)
+    *planeMask = mask & ~inside;
+  return true;
+}
+
+/// \param center The center of the sphere in world space.
+/// \param radius The radius of the sphere.
+/// \param planeMask As for isBoxVisible().
+/// \param lastPlane As for isBoxVisible().
+/// \return true if the sphere may be visible.
+bool Frustum::isSphereVisible(const Vector3 &center, float radius,
+  unsigned *planeMask, int *lastPlane) const
+{
+  unsigned mask = m_planeMask;
+  if(planeMask != 0)
+    mask &= *planeMask;
+
+  unsigned inside = 0;
+  unsigned untested = mask;
+
+  if(lastPlane != 0 && *lastPlane >= 0 && (mask & (1 << *lastPlane)))
+  {
+    int result = classifySphere(*lastPlane, center, radius);
+    if(result < 0)
+      return false;
+    if(result > 0)
+      inside |= 1 << *lastPlane;
+    untested &= ~(1 << *lastPlane);
+  }
+
+  for(int i = 0; untested != 0; i++, untested >>= 1)
+  {
+    if(!(untested & 1))
+      continue;
+    int result = classifySphere(i, center, radius);
+    if(result < 0)
+    {
+      if(lastPlane != 0)
+        *lastPlane = i;
+      return false;
+    }
+    if(result > 0)
+      inside |= 1 << i;
+  }
+
+  if(planeMask != 0)
+    *planeMask = mask & ~inside;
+  return true;
+}
@@ -0,0 +1,87 @@
+/// \file Frustum.h
+/// \brief Interface for the Frustum class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Frustum.h - View frustum for visibility culling
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FRUSTUM_H_INCLUDED__
+#define __FRUSTUM_H_INCLUDED__
+
+#include "vector3.h"
+#include "plane.h"
+
+class AABB3;
+class Matrix4x3;
+
+/// \brief The volume of world space the camera can see.
+///
+/// The planes are pulled straight out of a D3D-style (row vector)
+/// view-projection matrix, so the frustum always agrees with what the
+/// hardware clips.  Each plane is normalized with its normal pointing into
+/// the frustum, and a point p is on the inside when n.p + d >= 0, which is
+/// the same convention D3D uses for user clip planes.  An optional extra
+/// plane can be added for the water clip plane used by reflections.
+///
+/// The tests take an optional plane mask.  A bit is set for each plane that
+/// still has to be tested, and the bits of planes the volume is entirely
+/// inside of are cleared on the way out.  Passing the mask of a parent
+/// volume to its children skips planes the parent already cleared.  The
+/// tests also take an optional last plane, which remembers the plane that
+/// rejected the volume last time so it gets tried first next time.
+class Frustum
+{
+public:
+
+  /// \brief Plane indices, also the bit numbers of the plane masks.
+  enum
+  {
+    kLeft, kRight, kBottom, kTop, kNear, kFar,
+    kUser, ///< Extra clip plane, such as the water plane
+    kMaxPlanes
+  };
+
+  static const unsigned kAllPlanes = (1 << kMaxPlanes) - 1; ///< Mask that tests every plane
+
+  Frustum(); ///< Constructs a frustum that contains everything.
+
+  void setup(const float viewProj[16]); ///< Extracts the planes from a view-projection matrix.
+  void setup(const Matrix4x3 &worldToCamera, const float proj[16]); ///< Extracts the planes from view and projection matrices.
+
+  void setUserPlane(const Plane &plane); ///< Adds an extra clip plane.
+  void clearUserPlane(); ///< Removes the extra clip plane.
+
+  /// \brief Queries the frustum for one of its planes.
+  /// \param i Index of the plane, from kLeft to kUser.
+  /// \return The normalized plane.
+  const Plane &getPlane(int i) const { return m_planes[i]; }
+
+  /// \brief Queries the frustum for which planes are in use.
+  /// \return A mask with a bit set for each plane in use.
+  unsigned getPlaneMask() const { return m_planeMask; }
+
+  /// \brief Tests a box against the frustum.
+  bool isBoxVisible(const AABB3 &box, unsigned *planeMask = 0, int *lastPlane = 0) const;
+
+  /// \brief Tests a sphere against the frustum.
+  bool isSphereVisible(const Vector3 &center, float radius,
+    unsigned *planeMask = 0, int *lastPlane = 0) const;
+
+private:
+
+  /// \brief Tests a box given by its center and half size against one plane.
+  /// \return -1 if outside, 1 if entirely inside, 0 if it straddles the plane.
+  int classifyBox(int i, const Vector3 &center, const Vector3 &extent) const;
+
+  /// \brief Tests a sphere against one plane.
+  /// \return -1 if outside, 1 if entirely inside, 0 if it straddles the plane.
+  int classifySphere(int i, const Vector3 &center, float radius) const;
+
+  Plane m_planes[kMaxPlanes]; ///< Normalized planes, normals point inwards
+  unsigned m_planeMask; ///< Bit set for each plane in use
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __FRUSTUM_H_INCLUDED__
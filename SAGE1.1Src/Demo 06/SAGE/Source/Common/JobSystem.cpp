@@ -0,0 +1,422 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// JobSystem.cpp - Pool of worker threads for running loops in parallel
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file JobSystem.cpp
+/// \brief Code for the JobSystem class.
+
+#include <assert.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+  #include <semaphore.h>
+  #include <unistd.h>
+#endif
+
+#include "JobSystem.h"
+
+/// Most worker threads started, whatever the processor count
+static const int kMaxWorkers = JobSystem::kMaxThreads - 1;
+
+/// Thread local slot that hasn't been allocated
+static const unsigned long kNoTls = 0xFFFFFFFF;
+
+JobSystem gJobSystem;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// The few threading calls the job system makes, on Windows and on POSIX.
+// The header keeps its handles as void pointers so it needn't include
+// either.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+#ifdef _WIN32
+
+  int processorCount()
+  {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+  }
+
+  void *newLock()
+  {
+    CRITICAL_SECTION *lock = new CRITICAL_SECTION;
+    InitializeCriticalSection(lock);
+    return lock;
+  }
+
+  void deleteLock(void *lock)
+  {
+    DeleteCriticalSection((CRITICAL_SECTION *)lock);
+    delete (CRITICAL_SECTION *)lock;
+  }
+
+  void enterLock(void *lock) { EnterCriticalSection((CRITICAL_SECTION *)lock); }
+  void leaveLock(void *lock) { LeaveCriticalSection((CRITICAL_SECTION *)lock); }
+
+  void *newSemaphore() { return CreateSemaphore(NULL, 0, 0x7fffffff, NULL); }
+  void deleteSemaphore(void *sem) { CloseHandle((HANDLE)sem); }
+  void waitSemaphore(void *sem) { WaitForSingleObject((HANDLE)sem, INFINITE); }
+  void postSemaphore(void *sem, int count) { ReleaseSemaphore((HANDLE)sem, count, NULL); }
+
+  unsigned long newTls() { return TlsAlloc(); }
+  void deleteTls(unsigned long tls) { TlsFree(tls); }
+  void setTls(unsigned long tls, int value) { TlsSetValue(tls, (LPVOID)(INT_PTR)value); }
+  int getTls(unsigned long tls) { return (int)(INT_PTR)TlsGetValue(tls); }
+
+  void atomicSet(volatile long *x, long value) { InterlockedExchange(x, value); }
+  long atomicGet(volatile long *x) { return InterlockedCompareExchange(x, 0, 0); }
+  void atomicDecrement(volatile long *x) { InterlockedDecrement(x); }
+
+  void yieldThread() { Sleep(0); }
+
+  DWORD WINAPI threadEntry(LPVOID param);
+
+  void *startThread(void *param) { return CreateThread(NULL, 0, threadEntry, param, 0, NULL); }
+
+  void joinThreads(void **threads, int count)
+  {
+    WaitForMultipleObjects((DWORD)count, (const HANDLE *)threads, TRUE, INFINITE);
+    for(int i = 0; i < count; i++)
+      CloseHandle((HANDLE)threads[i]);
+  }
+
+#else
+
+  int processorCount() { return (int)sysconf(_SC_NPROCESSORS_ONLN); }
+
+  void *newLock()
+  {
+    pthread_mutex_t *lock = new pthread_mutex_t;
+    pthread_mutex_init(lock, NULL);
+    return lock;
+  }
+
+  void deleteLock(void *lock)
+  {
+    pthread_mutex_destroy((pthread_mutex_t *)lock);
+    delete (pthread_mutex_t *)lock;
+  }
+
+  void enterLock(void *lock) { pthread_mutex_lock((pthread_mutex_t *)lock); }
+  void leaveLock(void *lock) { pthread_mutex_unlock((pthread_mutex_t *)lock); }
+
+  void *newSemaphore()
+  {
+    sem_t *sem = new sem_t;
+    sem_init(sem, 0, 0);
+    return sem;
+  }
+
+  void deleteSemaphore(void *sem)
+  {
+    sem_destroy((sem_t *)sem);
+    delete (sem_t *)sem;
+  }
+
+  void waitSemaphore(void *sem)
+  {
+    while(sem_wait((sem_t *)sem) != 0)
+      ;
+  }
+
+  void postSemaphore(void *sem, int count)
+  {
+    for(int i = 0; i < count; i++)
+      sem_post((sem_t *)sem);
+  }
+
+  unsigned long newTls()
+  {
+    pthread_key_t key;
+    if(pthread_key_create(&key, NULL) != 0)
+      return kNoTls;
+    return (unsigned long)key;
+  }
+
+  void deleteTls(unsigned long tls) { pthread_key_delete((pthread_key_t)tls); }
+  void setTls(unsigned long tls, int value) { pthread_setspecific((pthread_key_t)tls, (void *)(size_t)value); }
+  int getTls(unsigned long tls) { return (int)(size_t)pthread_getspecific((pthread_key_t)tls); }
+
+  void atomicSet(volatile long *x, long value) { __sync_lock_test_and_set(x, value); __sync_synchronize(); }
+  long atomicGet(volatile long *x) { return __sync_fetch_and_add(x, 0); }
+  void atomicDecrement(volatile long *x) { __sync_fetch_and_sub(x, 1); }
+
+  void yieldThread() { sched_yield(); }
+
+  void *threadEntry(void *param);
+
+  void *startThread(void *param)
+  {
+    pthread_t *thread = new pthread_t;
+    if(pthread_create(thread, NULL, threadEntry, param) != 0)
+    {
+      delete thread;
+      return NULL;
+    }
+    return thread;
+  }
+
+  void joinThreads(void **threads, int count)
+  {
+    for(int i = 0; i < count; i++)
+    {
+      pthread_join(*(pthread_t *)threads[i], NULL);
+      delete (pthread_t *)threads[i];
+    }
+  }
+
+#endif
+}
+
+/// \brief Entry point of the worker threads.
+struct JobSystemThread
+{
+  JobSystem *system; ///< The job system the thread works for
+  int thread; ///< Index of the thread
+
+  static void run(void *param)
+  {
+    JobSystemThread *start = (JobSystemThread *)param;
+    JobSystem *system = start->system;
+    int thread = start->thread;
+    delete start;
+
+    setTls(system->m_tlsIndex, thread);
+    system->workerLoop(thread);
+  }
+};
+
+namespace
+{
+#ifdef _WIN32
+  DWORD WINAPI threadEntry(LPVOID param) { JobSystemThread::run(param); return 0; }
+#else
+  void *threadEntry(void *param) { JobSystemThread::run(param); return NULL; }
+#endif
+}
+
+JobSystem::JobSystem()
+{
+  m_wakeUp = NULL;
+  m_tlsIndex = kNoTls;
+  m_pending = 0;
+  m_quit = 0;
+}
+
+JobSystem::~JobSystem()
+{
+  shutdown();
+}
+
+/// Any threads already running are stopped first.
+/// \param threadCount Number of threads to run jobs on, counting the
+/// calling thread.  Zero or less means one per processor.
+void JobSystem::initiate(int threadCount)
+{
+  shutdown();
+
+  if(threadCount <= 0)
+    threadCount = processorCount();
+  if(threadCount > kMaxWorkers + 1)
+    threadCount = kMaxWorkers + 1;
+  if(threadCount < 1)
+    threadCount = 1;
+
+  m_tlsIndex = newTls();
+  m_wakeUp = newSemaphore();
+  m_quit = 0;
+  m_pending = 0;
+
+  for(int i = 0; i < threadCount; i++)
+  {
+    Queue *queue = new Queue;
+    queue->lock = newLock();
+    m_queues.push_back(queue);
+  }
+
+  for(int i = 1; i < threadCount; i++)
+  {
+    JobSystemThread *start = new JobSystemThread;
+    start->system = this;
+    start->thread = i;
+    void *thread = startThread(start);
+    if(thread == NULL)
+    {
+      delete start;
+      break;
+    }
+    m_threads.push_back(thread);
+  }
+
+  // Fewer threads than asked for if any failed to start
+
+  while((int)m_queues.size() > (int)m_threads.size() + 1)
+  {
+    deleteLock(m_queues.back()->lock);
+    delete m_queues.back();
+    m_queues.pop_back();
+  }
+}
+
+void JobSystem::shutdown()
+{
+  if(!m_threads.empty())
+  {
+    atomicSet(&m_quit, 1);
+    postSemaphore(m_wakeUp, (int)m_threads.size());
+    joinThreads(&m_threads[0], (int)m_threads.size());
+    m_threads.clear();
+  }
+
+  for(int i = 0; i < (int)m_queues.size(); i++)
+  {
+    deleteLock(m_queues[i]->lock);
+    delete m_queues[i];
+  }
+  m_queues.clear();
+
+  if(m_wakeUp != NULL)
+  {
+    deleteSemaphore(m_wakeUp);
+    m_wakeUp = NULL;
+  }
+  if(m_tlsIndex != kNoTls)
+  {
+    deleteTls(m_tlsIndex);
+    m_tlsIndex = kNoTls;
+  }
+}
+
+/// \return The index of the calling thread, 0 for the main thread (and any
+/// thread that isn't one of the workers).
+int JobSystem::getThreadIndex() const
+{
+  if(m_tlsIndex == kNoTls)
+    return 0;
+  return getTls(m_tlsIndex);
+}
+
+/// The batches are dealt out round robin, so each thread starts with an
+/// even share.  Batches from the same loop may run in any order and on any
+/// thread, so func must not depend on either, except through the thread
+/// index it is given.
+/// \param count Number of iterations.
+/// \param batchSize Number of iterations in a batch.  Smaller batches
+/// balance better, bigger ones have less overhead.
+/// \param func Loop body, called with the range of each batch.
+/// \param context Passed to func.
+void JobSystem::parallelFor(int count, int batchSize, JobFunc func, void *context)
+{
+  if(count <= 0)
+    return;
+  if(batchSize < 1)
+    batchSize = 1;
+
+  // Not worth handing out, or nobody to hand it to
+
+  if(m_threads.empty() || count <= batchSize)
+  {
+    func(context, 0, count, getThreadIndex());
+    return;
+  }
+
+  assert(getThreadIndex() == 0);
+
+  int threadCount = getThreadCount();
+  int jobCount = (count + batchSize - 1) / batchSize;
+  atomicSet(&m_pending, jobCount);
+
+  for(int t = 0; t < threadCount; t++)
+  {
+    Queue &queue = *m_queues[t];
+    enterLock(queue.lock);
+    for(int j = t; j < jobCount; j += threadCount)
+    {
+      Job job;
+      job.func = func;
+      job.context = context;
+      job.begin = j * batchSize;
+      job.end = job.begin + batchSize < count ? job.begin + batchSize : count;
+      queue.jobs.push_back(job);
+    }
+    leaveLock(queue.lock);
+  }
+
+  postSemaphore(m_wakeUp, threadCount - 1);
+
+  // Help out until every batch is finished, not just taken
+
+  Job job;
+  while(atomicGet(&m_pending) > 0)
+  {
+    if(getJob(0, job))
+      runJob(job, 0);
+    else
+      yieldThread();
+  }
+}
+
+/// \param thread Index of the thread looking for work.
+/// \param job Set to the job, if there is one.
+/// \return true if a job was found.
+bool JobSystem::getJob(int thread, Job &job)
+{
+  int threadCount = getThreadCount();
+
+  for(int i = 0; i < threadCount; i++)
+  {
+    int victim = (thread + i) % threadCount;
+    Queue &queue = *m_queues[victim];
+    enterLock(queue.lock);
+    bool found = !queue.jobs.empty();
+    if(found)
+    {
+      // Own work from the back, where it's still in cache; stolen work from
+      // the front, away from the owner
+      if(victim == thread)
+      {
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+      }
+      else
+      {
+        job = queue.jobs.front();
+        queue.jobs.pop_front();
+      }
+    }
+    leaveLock(queue.lock);
+    if(found)
+      return true;
+  }
+  return false;
+}
+
+void JobSystem::runJob(const Job &job, int thread)
+{
+  job.func(job.context, job.begin, job.end, thread);
+  atomicDecrement(&m_pending);
+}
+
+void JobSystem::workerLoop(int thread)
+{
+  for(;;)
+  {
+    waitSemaphore(m_wakeUp);
+    if(atomicGet(&m_quit) != 0)
+      return;
+
+    Job job;
+    while(getJob(thread, job))
+      runJob(job, thread);
+  }
+}
@@ -0,0 +1,97 @@
+/// \file JobSystem.h
+/// \brief Interface for the JobSystem class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// JobSystem.h - Pool of worker threads for running loops in parallel
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __JOBSYSTEM_H_INCLUDED__
+#define __JOBSYSTEM_H_INCLUDED__
+
+#include <deque>
+#include <vector>
+
+/// \brief A fixed pool of worker threads that run loops in parallel.
+///
+/// parallelFor() cuts a loop into batches and deals them out to a queue per
+/// thread.  The calling thread works through its own queue along with the
+/// workers, and a thread that runs out of work steals batches from the
+/// front of the other queues, so a few slow batches don't leave the other
+/// threads idle.  parallelFor() returns when every batch is done.
+///
+/// Thread 0 is the thread that called initiate(), normally the main thread,
+/// and only it may call parallelFor().  With no worker threads, or before
+/// initiate(), loops simply run on the calling thread.
+class JobSystem
+{
+public:
+
+  /// Most threads, the main thread included, whatever the processor count.
+  /// Anything kept per thread, indexed by getThreadIndex(), needs this many.
+  static const int kMaxThreads = 16;
+
+  /// \brief A loop body.
+  /// \param context Whatever was passed to parallelFor().
+  /// \param begin First index of the batch.
+  /// \param end One past the last index of the batch.
+  /// \param thread Index of the thread running the batch, from 0 to getThreadCount() - 1.
+  typedef void (*JobFunc)(void *context, int begin, int end, int thread);
+
+  JobSystem();  ///< Constructs a job system with no worker threads.
+  ~JobSystem(); ///< Stops the worker threads.
+
+  void initiate(int threadCount = 0); ///< Starts the worker threads.
+  void shutdown(); ///< Stops the worker threads.
+
+  /// \brief Runs a loop over [0, count) in batches on all threads.
+  void parallelFor(int count, int batchSize, JobFunc func, void *context);
+
+  /// \brief Queries the job system for the number of threads.
+  /// \return The number of threads that run jobs, including the main thread.
+  int getThreadCount() const { return (int)m_queues.size(); }
+
+  int getThreadIndex() const; ///< Queries the job system for the calling thread's index.
+
+private:
+
+  friend struct JobSystemThread;
+
+  /// \brief One batch of a loop.
+  struct Job
+  {
+    JobFunc func;  ///< Loop body
+    void *context; ///< Passed to func
+    int begin;     ///< First index
+    int end;       ///< One past the last index
+  };
+
+  /// \brief A thread's queue of jobs.
+  struct Queue
+  {
+    void *lock;  ///< Lock guarding jobs
+    std::deque<Job> jobs; ///< Jobs, the owner takes from the back and thieves from the front
+  };
+
+  // No copying, we own the threads
+
+  JobSystem(const JobSystem &);
+  JobSystem &operator=(const JobSystem &);
+
+  bool getJob(int thread, Job &job); ///< Takes a job from a thread's own queue or steals one.
+  void runJob(const Job &job, int thread); ///< Runs a job and counts it as done.
+  void workerLoop(int thread); ///< Body of a worker thread.
+
+  std::vector<Queue *> m_queues; ///< Queue for each thread, 0 is the main thread
+  std::vector<void *> m_threads; ///< Handles of the worker threads
+  void *m_wakeUp; ///< Semaphore the workers wait on
+  unsigned long m_tlsIndex; ///< Thread local slot holding each thread's index
+  volatile long m_pending; ///< Jobs of the current loop not yet finished
+  volatile long m_quit; ///< Nonzero when the workers should exit
+};
+
+extern JobSystem gJobSystem;
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __JOBSYSTEM_H_INCLUDED__
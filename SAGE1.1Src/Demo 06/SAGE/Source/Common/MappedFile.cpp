@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// MappedFile.cpp - Read-only view of a file mapped into memory
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file MappedFile.cpp
+/// \brief Code for the MappedFile class.
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+#ifndef _WIN32
+  /// There is no file handle to keep on POSIX; the descriptor is closed
+  /// once the file is mapped
+  #define INVALID_HANDLE_VALUE NULL
+#endif
+
+MappedFile::MappedFile()
+{
+  m_file = INVALID_HANDLE_VALUE;
+  m_mapping = NULL;
+  m_data = NULL;
+  m_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+/// Any file already mapped is closed first.  Empty files can't be mapped,
+/// so they fail like missing ones.
+/// \param filename Specifies the name of the file to map.
+/// \return true if the file was mapped, false otherwise.
+bool MappedFile::open(const char *filename)
+{
+  close();
+
+#ifdef _WIN32
+  m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+  if(m_file == INVALID_HANDLE_VALUE)
+    return false;
+
+  DWORD sizeHigh = 0;
+  DWORD size = GetFileSize((HANDLE)m_file, &sizeHigh);
+  if(size == INVALID_FILE_SIZE || size == 0 || sizeHigh != 0)
+  {
+    close();
+    return false;
+  }
+
+  // PAGE_WRITECOPY lets callers patch the data in place (ArticulatedModel
+  // moves vertices, for instance) without touching the file on disk
+
+  m_mapping = CreateFileMappingA((HANDLE)m_file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  if(m_mapping == NULL)
+  {
+    close();
+    return false;
+  }
+
+  m_data = MapViewOfFile((HANDLE)m_mapping, FILE_MAP_COPY, 0, 0, 0);
+  if(m_data == NULL)
+  {
+    close();
+    return false;
+  }
+
+  m_size = size;
+  return true;
+#else
+  int fd = ::open(filename, O_RDONLY);
+  if(fd < 0)
+    return false;
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size == 0 || (off_t)(unsigned)info.st_size != info.st_size)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  // a private mapping gives the same copy on write as PAGE_WRITECOPY
+
+  void *data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(data == MAP_FAILED)
+    return false;
+
+  m_data = data;
+  m_size = (unsigned)info.st_size;
+  return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+  if(m_data != NULL)
+    UnmapViewOfFile(m_data);
+  if(m_mapping != NULL)
+    CloseHandle((HANDLE)m_mapping);
+  if(m_file != INVALID_HANDLE_VALUE)
+    CloseHandle((HANDLE)m_file);
+#else
+  if(m_data != NULL)
+    munmap(m_data, m_size);
+#endif
+
+  m_file = INVALID_HANDLE_VALUE;
+  m_mapping = NULL;
+  m_data = NULL;
+  m_size = 0;
+}
@@ -0,0 +1,54 @@
+/// \file MappedFile.h
+/// \brief Interface for the MappedFile class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// MappedFile.h - Read-only view of a file mapped into memory
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MAPPEDFILE_H_INCLUDED__
+#define __MAPPEDFILE_H_INCLUDED__
+
+/// \brief A file mapped into the address space of the process.
+///
+/// The view is mapped copy-on-write, so pages are shared with any other
+/// process that maps the same file until somebody writes to them, at which
+/// point that process gets a private copy.  Nothing is ever written back to
+/// the file.
+class MappedFile
+{
+public:
+  MappedFile();   ///< Constructs an unopened mapping.
+  ~MappedFile();  ///< Unmaps the file if it is open.
+
+  bool open(const char *filename);  ///< Maps a file into memory.
+  void close();  ///< Unmaps the file.
+
+  /// \brief Queries the mapping for the start of the file.
+  /// \return A pointer to the first byte of the file, or NULL if not open.
+  void *getData() const { return m_data; }
+
+  /// \brief Queries the mapping for the size of the file.
+  /// \return The size of the file in bytes.
+  unsigned getSize() const { return m_size; }
+
+  /// \brief Queries the mapping for whether it is open.
+  /// \return true if a file is currently mapped.
+  bool isOpen() const { return m_data != 0; }
+
+private:
+
+  // No copying, we own the handles
+
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  void *m_file;     ///< Handle of the open file
+  void *m_mapping;  ///< Handle of the file mapping object
+  void *m_data;     ///< Base address of the mapped view
+  unsigned m_size;  ///< Size of the mapped view in bytes
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __MAPPEDFILE_H_INCLUDED__
@@ -14,7 +14,7 @@
 #include <math.h>
 
 #include "MathUtil.h"
-#include "Vector3.h"
+#include "vector3.h"
 
 const Vector3 Vector3::kZeroVector(0.0f, 0.0f, 0.0f);
 const Vector3 Vector3::kRightVector(1.0f, 0.0f, 0.0f);
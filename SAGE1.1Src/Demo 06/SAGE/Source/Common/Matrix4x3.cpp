@@ -16,14 +16,18 @@
 #include <assert.h>
 #include <math.h>
 
-#include "Vector3.h"
-#include "Plane.h"
+#include "vector3.h"
+#include "plane.h"
 #include "EulerAngles.h"
 #include "Quaternion.h"
 #include "RotationMatrix.h"
 #include "Matrix4x3.h"
 #include "MathUtil.h"
 
+#ifdef MATH_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Notes:
@@ -896,3 +900,237 @@ Matrix4x3 &operator*=(Matrix4x3 &a, const Matrix4x3 &b) {
 	return a;
 }
 
+//---------------------------------------------------------------------------
+// Batch operations
+//
+// Each output lane is computed with the same multiplies and adds, in the
+// same order, as operator*, so with SSE (rather than x87) scalar math the
+// results are identical to the bit.  Everything an output depends on is
+// loaded before it is stored, which is what lets output and input be the
+// same array.
+
+#ifdef MATH_SIMD_SSE2
+
+// Store the low three lanes of a register
+
+static inline void store3(float *d, __m128 v) {
+	_mm_storel_pi((__m64 *)d, v);
+	_mm_store_ss(d + 2, _mm_movehl_ps(v, v));
+}
+
+// Multiply one point (w = 1) or direction (w = 0) by the rows of a matrix
+
+static inline void transformOne(float *d, const float *p, __m128 r1, __m128 r2, __m128 r3, __m128 t, bool point) {
+	__m128	v = _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(_mm_set1_ps(p[0]), r1),
+		_mm_mul_ps(_mm_set1_ps(p[1]), r2)),
+		_mm_mul_ps(_mm_set1_ps(p[2]), r3));
+	if (point) {
+		v = _mm_add_ps(v, t);
+	}
+	store3(d, v);
+}
+
+// Transform a contiguous array of Vector3.  Four at a time, the twelve
+// floats are shuffled into x, y and z registers, transformed, and shuffled
+// back, so each register does the work for four points.
+
+static void transformArray(Vector3 *out, const Vector3 *in, int count, const Matrix4x3 &m, bool point) {
+	__m128	m11 = _mm_set1_ps(m.m11), m12 = _mm_set1_ps(m.m12), m13 = _mm_set1_ps(m.m13);
+	__m128	m21 = _mm_set1_ps(m.m21), m22 = _mm_set1_ps(m.m22), m23 = _mm_set1_ps(m.m23);
+	__m128	m31 = _mm_set1_ps(m.m31), m32 = _mm_set1_ps(m.m32), m33 = _mm_set1_ps(m.m33);
+	__m128	tx = _mm_set1_ps(m.tx), ty = _mm_set1_ps(m.ty), tz = _mm_set1_ps(m.tz);
+
+	int	i = 0;
+	for ( ; i + 4 <= count ; i += 4) {
+		const float *s = &in[i].x;
+		float *d = &out[i].x;
+
+		// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+
+		__m128	a = _mm_loadu_ps(s);
+		__m128	b = _mm_loadu_ps(s + 4);
+		__m128	c = _mm_loadu_ps(s + 8);
+
+		__m128	x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+		__m128	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+		__m128	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+
+		__m128	rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m11), _mm_mul_ps(y, m21)), _mm_mul_ps(z, m31));
+		__m128	ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m12), _mm_mul_ps(y, m22)), _mm_mul_ps(z, m32));
+		__m128	rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m13), _mm_mul_ps(y, m23)), _mm_mul_ps(z, m33));
+		if (point) {
+			rx = _mm_add_ps(rx, tx);
+			ry = _mm_add_ps(ry, ty);
+			rz = _mm_add_ps(rz, tz);
+		}
+
+		// And back the other way
+
+		_mm_storeu_ps(d, _mm_shuffle_ps(_mm_shuffle_ps(rx, ry, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(rz, rx, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(d + 4, _mm_shuffle_ps(_mm_shuffle_ps(ry, rz, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(d + 8, _mm_shuffle_ps(_mm_shuffle_ps(rz, rx, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(ry, rz, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+	}
+
+	// Leftovers, one at a time
+
+	__m128	r1 = _mm_setr_ps(m.m11, m.m12, m.m13, 0.0f);
+	__m128	r2 = _mm_setr_ps(m.m21, m.m22, m.m23, 0.0f);
+	__m128	r3 = _mm_setr_ps(m.m31, m.m32, m.m33, 0.0f);
+	__m128	t = _mm_setr_ps(m.tx, m.ty, m.tz, 0.0f);
+	for ( ; i < count ; ++i) {
+		transformOne(&out[i].x, &in[i].x, r1, r2, r3, t, point);
+	}
+}
+
+// Transform points or directions spaced out in memory
+
+static void transformStrided(char *out, int outStride, const char *in, int inStride, int count, const Matrix4x3 &m, bool point) {
+	__m128	r1 = _mm_setr_ps(m.m11, m.m12, m.m13, 0.0f);
+	__m128	r2 = _mm_setr_ps(m.m21, m.m22, m.m23, 0.0f);
+	__m128	r3 = _mm_setr_ps(m.m31, m.m32, m.m33, 0.0f);
+	__m128	t = _mm_setr_ps(m.tx, m.ty, m.tz, 0.0f);
+	for (int i = 0 ; i < count ; ++i) {
+		transformOne((float *)(out + i*outStride), (const float *)(in + i*inStride), r1, r2, r3, t, point);
+	}
+}
+
+// Concatenate one matrix with the rows of another, already loaded.  The
+// first three rows are stored four floats wide, each spilling into the
+// row after it before that row is stored.
+
+static inline void concatenateOne(Matrix4x3 &r, const Matrix4x3 &a, __m128 b1, __m128 b2, __m128 b3, __m128 bt) {
+	float	a11 = a.m11, a12 = a.m12, a13 = a.m13;
+	float	a21 = a.m21, a22 = a.m22, a23 = a.m23;
+	float	a31 = a.m31, a32 = a.m32, a33 = a.m33;
+	float	atx = a.tx, aty = a.ty, atz = a.tz;
+
+	__m128	r1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a11), b1), _mm_mul_ps(_mm_set1_ps(a12), b2)), _mm_mul_ps(_mm_set1_ps(a13), b3));
+	__m128	r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a21), b1), _mm_mul_ps(_mm_set1_ps(a22), b2)), _mm_mul_ps(_mm_set1_ps(a23), b3));
+	__m128	r3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a31), b1), _mm_mul_ps(_mm_set1_ps(a32), b2)), _mm_mul_ps(_mm_set1_ps(a33), b3));
+	__m128	rt = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(atx), b1), _mm_mul_ps(_mm_set1_ps(aty), b2)), _mm_mul_ps(_mm_set1_ps(atz), b3)), bt);
+
+	_mm_storeu_ps(&r.m11, r1);
+	_mm_storeu_ps(&r.m21, r2);
+	_mm_storeu_ps(&r.m31, r3);
+	store3(&r.tx, rt);
+}
+
+#endif // #ifdef MATH_SIMD_SSE2
+
+/// \param out Points to the array to be filled with the results.
+/// \param in Points to the array of points to be transformed.
+/// \param count Specifies the number of points.
+/// \param m Specifies the matrix multiplicator.
+void transformPoints(Vector3 *out, const Vector3 *in, int count, const Matrix4x3 &m) {
+#ifdef MATH_SIMD_SSE2
+	transformArray(out, in, count, m, true);
+#else
+	for (int i = 0 ; i < count ; ++i) {
+		out[i] = in[i] * m;
+	}
+#endif
+}
+
+/// \param out Points to the first result, a Vector3.
+/// \param outStride Specifies the number of bytes from one result to the next.
+/// \param in Points to the first point to be transformed, a Vector3.
+/// \param inStride Specifies the number of bytes from one point to the next.
+/// \param count Specifies the number of points.
+/// \param m Specifies the matrix multiplicator.
+void transformPoints(void *out, int outStride, const void *in, int inStride, int count, const Matrix4x3 &m) {
+#ifdef MATH_SIMD_SSE2
+	transformStrided((char *)out, outStride, (const char *)in, inStride, count, m, true);
+#else
+	for (int i = 0 ; i < count ; ++i) {
+		const Vector3 &p = *(const Vector3 *)((const char *)in + i*inStride);
+		*(Vector3 *)((char *)out + i*outStride) = p * m;
+	}
+#endif
+}
+
+/// The translation part of the matrix is ignored, as it should be for
+/// directions.  Normals come out right as long as the matrix has no
+/// non-uniform scale, which is true of any rigid body transform.
+/// \param out Points to the array to be filled with the results.
+/// \param in Points to the array of directions to be transformed.
+/// \param count Specifies the number of directions.
+/// \param m Specifies the matrix multiplicator.
+void transformVectors(Vector3 *out, const Vector3 *in, int count, const Matrix4x3 &m) {
+#ifdef MATH_SIMD_SSE2
+	transformArray(out, in, count, m, false);
+#else
+	for (int i = 0 ; i < count ; ++i) {
+		const Vector3 &p = in[i];
+		out[i] = Vector3(
+			p.x*m.m11 + p.y*m.m21 + p.z*m.m31,
+			p.x*m.m12 + p.y*m.m22 + p.z*m.m32,
+			p.x*m.m13 + p.y*m.m23 + p.z*m.m33
+		);
+	}
+#endif
+}
+
+/// \param out Points to the first result, a Vector3.
+/// \param outStride Specifies the number of bytes from one result to the next.
+/// \param in Points to the first direction to be transformed, a Vector3.
+/// \param inStride Specifies the number of bytes from one direction to the next.
+/// \param count Specifies the number of directions.
+/// \param m Specifies the matrix multiplicator.
+void transformVectors(void *out, int outStride, const void *in, int inStride, int count, const Matrix4x3 &m) {
+#ifdef MATH_SIMD_SSE2
+	transformStrided((char *)out, outStride, (const char *)in, inStride, count, m, false);
+#else
+	for (int i = 0 ; i < count ; ++i) {
+		const Vector3 &p = *(const Vector3 *)((const char *)in + i*inStride);
+		*(Vector3 *)((char *)out + i*outStride) = Vector3(
+			p.x*m.m11 + p.y*m.m21 + p.z*m.m31,
+			p.x*m.m12 + p.y*m.m22 + p.z*m.m32,
+			p.x*m.m13 + p.y*m.m23 + p.z*m.m33
+		);
+	}
+#endif
+}
+
+/// Sets out[i] to a[i] * b[i] for each i.
+/// \param out Points to the array to be filled with the results.
+/// \param a Points to the array of first matrices.
+/// \param b Points to the array of second matrices.
+/// \param count Specifies the number of pairs.
+void concatenate(Matrix4x3 *out, const Matrix4x3 *a, const Matrix4x3 *b, int count) {
+#ifdef MATH_SIMD_SSE2
+	for (int i = 0 ; i < count ; ++i) {
+		const Matrix4x3 &bi = b[i];
+		concatenateOne(out[i], a[i],
+			_mm_loadu_ps(&bi.m11), _mm_loadu_ps(&bi.m21), _mm_loadu_ps(&bi.m31),
+			_mm_setr_ps(bi.tx, bi.ty, bi.tz, 0.0f));
+	}
+#else
+	for (int i = 0 ; i < count ; ++i) {
+		out[i] = a[i] * b[i];
+	}
+#endif
+}
+
+/// Sets out[i] to a[i] * b for each i, which is how a list of local
+/// transforms is put into one parent space.
+/// \param out Points to the array to be filled with the results.
+/// \param a Points to the array of first matrices.
+/// \param b Specifies the second matrix.
+/// \param count Specifies the number of matrices in a.
+void concatenate(Matrix4x3 *out, const Matrix4x3 *a, const Matrix4x3 &b, int count) {
+#ifdef MATH_SIMD_SSE2
+	__m128	b1 = _mm_setr_ps(b.m11, b.m12, b.m13, 0.0f);
+	__m128	b2 = _mm_setr_ps(b.m21, b.m22, b.m23, 0.0f);
+	__m128	b3 = _mm_setr_ps(b.m31, b.m32, b.m33, 0.0f);
+	__m128	bt = _mm_setr_ps(b.tx, b.ty, b.tz, 0.0f);
+	for (int i = 0 ; i < count ; ++i) {
+		concatenateOne(out[i], a[i], b1, b2, b3, bt);
+	}
+#else
+	Matrix4x3	parent = b;
+	for (int i = 0 ; i < count ; ++i) {
+		out[i] = a[i] * parent;
+	}
+#endif
+}
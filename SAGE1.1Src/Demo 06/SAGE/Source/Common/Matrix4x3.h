@@ -159,5 +159,27 @@ Vector3		&operator*=(Vector3 &p, const Matrix4x3 &m);  ///< Multiplies a vector
 
 Matrix4x3	&operator*=(const Matrix4x3 &a, const Matrix4x3 &b);  ///< Concatenates two matrices and conserves the result.
 
+// Batch operations.  These give the same results as calling operator* in
+// a loop, but work on many points or matrices at once with SSE2.  Define
+// MATH_NO_SIMD in the project settings to build them as plain loops,
+// for a processor without SSE2 or to compare against.  Output may be the
+// same array as input.
+
+#ifndef MATH_NO_SIMD
+#define MATH_SIMD_SSE2  ///< Defined if the batch operations use SSE2.
+#endif
+
+void	transformPoints(Vector3 *out, const Vector3 *in, int count, const Matrix4x3 &m);  ///< Multiplies an array of points by a matrix.
+
+void	transformPoints(void *out, int outStride, const void *in, int inStride, int count, const Matrix4x3 &m);  ///< Multiplies points spaced out in memory (vertex positions, say) by a matrix.
+
+void	transformVectors(Vector3 *out, const Vector3 *in, int count, const Matrix4x3 &m);  ///< Multiplies an array of directions by the linear part of a matrix.
+
+void	transformVectors(void *out, int outStride, const void *in, int inStride, int count, const Matrix4x3 &m);  ///< Multiplies directions spaced out in memory (vertex normals, say) by the linear part of a matrix.
+
+void	concatenate(Matrix4x3 *out, const Matrix4x3 *a, const Matrix4x3 *b, int count);  ///< Concatenates pairs of matrices.
+
+void	concatenate(Matrix4x3 *out, const Matrix4x3 *a, const Matrix4x3 &b, int count);  ///< Concatenates an array of matrices with one matrix.
+
 /////////////////////////////////////////////////////////////////////////////
 #endif // #ifndef __ROTATIONMATRIX_H_INCLUDED__
@@ -16,12 +16,191 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "CommonStuff.h"
 #include "Model.h"
-#include "common/renderer.h"
+#include "Common/Renderer.h"
 #include "TriMesh.h"
 #include "EditTriMesh.h"
+#include "MappedFile.h"
+#include "DirectoryManager/DirectoryManager.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Compiled model format
+//
+// A compiled model (.s3c) is a header, followed by a table of parts,
+// followed by the vertex lists of all parts back to back, followed by the
+// triangle lists of all parts back to back.  Offsets are in bytes from
+// the start of the file and the two lists start on 16 byte boundaries.
+// The header records the size and modification time of the S3D the model
+// was built from, and the model is only used while they still match.
+// Vertices and triangles are stored exactly as RenderVertex and RenderTri,
+// already through the whole TriMesh::fromEditMesh pipeline, so the part
+// meshes can point straight at a mapped view of the file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static const char kCompiledModelMagic[4] = {'S', '3', 'D', 'C'};
+
+// Bump this whenever the layout below, RenderVertex, RenderTri, or the
+// way EditTriMesh optimizes meshes changes, so old files get rebuilt.
+
+static const int kCompiledModelVersion = 2;
+
+// Header flags
+
+static const int kCompiledModelWelded = 1;  // vertices were welded on import
+
+struct CompiledModelHeader
+{
+  char magic[4];
+  int version;
+  int vertexSize;     // sizeof(RenderVertex) of the writer
+  int triSize;        // sizeof(RenderTri) of the writer
+  int flags;
+  int partCount;
+  int totalVertices;
+  int totalTris;
+  int sourceSize;       // size of the S3D it was built from, -1 if unknown
+  unsigned sourceTime;  // modification time of the S3D, low 32 bits
+};
+
+struct CompiledModelPart
+{
+  char textureName[kMaxTextureNameChars];
+  int vertexOffset;
+  int vertexCount;
+  int triOffset;
+  int triCount;
+};
+
+bool Model::m_bUseCompiledCache = true;
+
+static int alignCompiledOffset(int offset)
+{
+  return (offset + 15) & ~15;
+}
+
+// Write zeros until the file reaches the given offset.
+
+static bool padCompiledFile(FILE *f, int offset)
+{
+  static const char padding[16] = {0};
+  long pos = ftell(f);
+  if (pos < 0 || pos > offset)
+    return false;
+  size_t count = (size_t)(offset - pos);
+  return fwrite(padding, 1, count, f) == count;
+}
+
+// Build the name of the compiled model that caches an S3D file by
+// swapping the extension for ".s3c".
+
+static void getCompiledFilename(const char *s3dFilename, char *compiledFilename, size_t size)
+{
+  strcpy_s(compiledFilename, size, s3dFilename);
+  char *dot = strrchr(compiledFilename, '.');
+  if (dot != NULL && strpbrk(dot, "/\\") == NULL)
+    *dot = '\0';
+  strcat_s(compiledFilename, size, ".s3c");
+}
+
+// Get the size and modification time of an S3D, to tell whether a
+// compiled model was built from it as it is now.  Comparing the times of
+// the two files isn't enough, since they only count whole seconds, and an
+// S3D saved in the second after the compiled model was written looks no
+// newer than it.
+
+static bool getSourceStamp(const char *s3dFilename, int *size, unsigned *time)
+{
+  struct _stat s3dStat;
+  if (_stat(s3dFilename, &s3dStat) != 0)
+    return false;
+  *size = (int)s3dStat.st_size;
+  *time = (unsigned)s3dStat.st_mtime;
+  return true;
+}
+
+// A compiled model is current if it exists and was built from the S3D as
+// it is now.  Shipping the compiled model without the S3D is fine.
+// importCompiled() checks the rest of the file.
+
+static bool isCompiledCurrent(const char *s3dFilename, const char *compiledFilename)
+{
+  FILE *f;
+  if (fopen_s(&f, compiledFilename, "rb") != 0)
+    return false;
+  CompiledModelHeader header;
+  bool read = fread(&header, sizeof(header), 1, f) == 1;
+  fclose(f);
+  if (!read)
+    return false;
+
+  int size;
+  unsigned time;
+  if (!getSourceStamp(s3dFilename, &size, &time))
+    return true;
+
+  return header.sourceSize == size && header.sourceTime == time;
+}
+
+// Most vertices a single part can have, since RenderTri indices are 16 bits
+
+static const int kMaxPartVertices = 65536;
+
+// Copy a run of triangles, all from the same part and material, into a
+// scratch mesh with that part and material.  Vertices are numbered in
+// order of first use.  vertexRemap maps source vertices to scratch
+// vertices; it must be all -1 coming in, and is left that way.
+// usedVertices is just scratch space.
+
+static void gatherTris(const EditTriMesh &mesh, const int *tris, int count,
+	EditTriMesh &result, std::vector<int> &vertexRemap, std::vector<int> &usedVertices)
+{
+	assert(count > 0);
+
+	const EditTriMesh::Tri &firstTri = mesh.tri(tris[0]);
+
+	// Empty out the scratch mesh, keeping its memory
+
+	result.setTriCount(0);
+	result.setVertexCount(0);
+	result.part(0) = mesh.part(firstTri.part);
+	result.material(0) = mesh.material(firstTri.material);
+
+	// Copy the faces, remapping the vertices
+
+	usedVertices.clear();
+	result.setTriCount(count);
+
+	for (int j = 0 ; j < count ; ++j) {
+		EditTriMesh::Tri &t = result.tri(j);
+		t = mesh.tri(tris[j]);
+		for (int k = 0 ; k < 3 ; ++k) {
+			int &remap = vertexRemap[t.v[k].index];
+			if (remap < 0) {
+				remap = (int)usedVertices.size();
+				usedVertices.push_back(t.v[k].index);
+			}
+			t.v[k].index = remap;
+		}
+		t.part = 0;
+		t.material = 0;
+	}
+
+	// Copy the vertices, and get the table ready for next time
+
+	int	vertexCount = (int)usedVertices.size();
+	result.setVertexCount(vertexCount);
+
+	for (int j = 0 ; j < vertexCount ; ++j) {
+		result.vertex(j) = mesh.vertex(usedVertices[j]);
+		vertexRemap[usedVertices[j]] = -1;
+	}
+}
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -42,6 +221,8 @@ Model::Model(BufferUsage bufferUsage)
   m_totalVertices = 0;
   m_totalTris = 0;
 
+  m_mappedFile = NULL;
+
   m_isValid = false;
 }
 
@@ -92,6 +273,11 @@ void	Model::freeMemory() {
   delete m_indexBuffer;
   m_indexBuffer = NULL;
 
+  // The part meshes are gone, so nothing points into the mapping anymore
+
+  delete m_mappedFile;
+  m_mappedFile = NULL;
+
 	// Reset count
 
 	m_partCount = 0;
@@ -190,10 +376,11 @@ void	Model::renderPart(int index) const {
 	gRenderer.selectTexture(m_partTextureList[index]);
 
 	// Render the part
+  int baseVertex = m_baseVertexOffsets[index];
   gRenderer.render(
     m_vertexBuffer,
-    0,
-    m_vertexBuffer->getCount(),
+    baseVertex,
+    m_vertexBuffer->getCount() - baseVertex,
     m_indexBuffer,
     m_indexOffsets[index],
     m_partMeshList[index].getTriCount());
@@ -218,10 +405,11 @@ void	Model::renderPart(int index, VertexBufferBase *vb) const {
 	gRenderer.selectTexture(m_partTextureList[index]);
 
 	// Render the part
+  int baseVertex = m_baseVertexOffsets[index];
   gRenderer.render(
     vb,
-    0,
-    vb->getCount(),
+    baseVertex,
+    vb->getCount() - baseVertex,
     m_indexBuffer,
     m_indexOffsets[index],
     m_partMeshList[index].getTriCount());
@@ -245,104 +433,157 @@ void	Model::fromEditMesh(EditTriMesh &mesh) {
 
 	// Make sure something exists in the destination mesh
 
-	if (mesh.partCount() < 1) {
+	if (mesh.partCount() < 1 || mesh.materialCount() < 1) {
 		return;
 	}
 
-	// Extract the part meshes
-
-	EditTriMesh	*partMeshes = new EditTriMesh[mesh.partCount()];
-	mesh.extractParts(partMeshes);
-
-	// Figure out how many parts we'll need.  Remember,
-	// each of our parts must have a single material,
-	// so we must duplicate parts for multiple materials.
+	// Each of our parts must have a single material, so every
+	// (part, material) pair that has any triangles becomes a part of its
+	// own.  Number them in the order that extracting each part and then
+	// each material in it would give: by source part, and within a
+	// source part by the first triangle that uses each material.  Things
+	// like ArticulatedModel refer to the parts by index, so the order
+	// matters.
+
+	int	srcPartCount = mesh.partCount();
+	int	srcMaterialCount = mesh.materialCount();
+	int	srcTriCount = mesh.triCount();
+
+	std::vector<int> pairBucket(srcPartCount * srcMaterialCount, -1);
+	std::vector<int> partFirstBucket(srcPartCount + 1, 0);
+
+	for (i = 0 ; i < srcTriCount ; ++i) {
+		const EditTriMesh::Tri &t = mesh.tri(i);
+		int &bucket = pairBucket[t.part * srcMaterialCount + t.material];
+		if (bucket < 0) {
+			bucket = partFirstBucket[t.part + 1]++;
+		}
+	}
+	for (i = 0 ; i < srcPartCount ; ++i) {
+		partFirstBucket[i + 1] += partFirstBucket[i];
+	}
+	for (i = 0 ; i < srcPartCount * srcMaterialCount ; ++i) {
+		if (pairBucket[i] >= 0) {
+			pairBucket[i] += partFirstBucket[i / srcMaterialCount];
+		}
+	}
 
-	int	numParts = 0;
-	for (i = 0 ; i < mesh.partCount() ; ++i) {
-		numParts += partMeshes[i].materialCount();
+	int	numBuckets = partFirstBucket[srcPartCount];
+	if (numBuckets < 1) {
+		return;
 	}
 
-	// Allocate
+	// Counting sort the triangles into their buckets.  This is stable,
+	// so each bucket keeps the original triangle order.
 
-	allocateMemory(numParts);
+	std::vector<int> triBucket(srcTriCount);
+	std::vector<int> bucketStart(numBuckets + 1, 0);
 
-	// Convert each part
+	for (i = 0 ; i < srcTriCount ; ++i) {
+		const EditTriMesh::Tri &t = mesh.tri(i);
+		triBucket[i] = pairBucket[t.part * srcMaterialCount + t.material];
+		++bucketStart[triBucket[i] + 1];
+	}
+	for (i = 0 ; i < numBuckets ; ++i) {
+		bucketStart[i + 1] += bucketStart[i];
+	}
 
-	int	destPartIndex = 0;
+	std::vector<int> sortedTris(srcTriCount);
+	std::vector<int> bucketFill(bucketStart.begin(), bucketStart.end() - 1);
 
-  m_totalVertices = 0;
-  m_totalTris = 0;
+	for (i = 0 ; i < srcTriCount ; ++i) {
+		sortedTris[bucketFill[triBucket[i]]++] = i;
+	}
 
-	for (i = 0 ; i < mesh.partCount() ; ++i) {
-		EditTriMesh *srcMesh = &partMeshes[i];
-		for (int j = 0 ; j < srcMesh->materialCount() ; ++j) {
+	// Plan the output parts.  Usually that's one per bucket, but a TriMesh
+	// can't have more than 65536 vertices, so bigger buckets are cut into
+	// runs of triangles that fit.  A bucket can only be too big if three
+	// times its triangle count is; only those get looked at.  The bucket is
+	// gathered into a scratch mesh that is reused for all of them, using a
+	// source-to-scratch vertex index table that is reset after each use by
+	// walking the vertices it used.
+
+	EditTriMesh	onePartOneMaterial;
+	onePartOneMaterial.setPartCount(1);
+	onePartOneMaterial.setMaterialCount(1);
+
+	std::vector<int> vertexRemap(mesh.vertexCount(), -1);
+	std::vector<int> usedVertices;
+
+	std::vector<int> chunkStart;
+	std::vector<int> chunkTriCount;
+
+	for (i = 0 ; i < numBuckets ; ++i) {
+		int	first = bucketStart[i];
+		int	end = bucketStart[i + 1];
+		while (first < end) {
+			int	count = end - first;
+			while (count * 3 > kMaxPartVertices) {
+				gatherTris(mesh, &sortedTris[first], count, onePartOneMaterial, vertexRemap, usedVertices);
+				onePartOneMaterial.copyUvsIntoVertices();
+				if (onePartOneMaterial.vertexCount() <= kMaxPartVertices) {
+					break;
+				}
+				count = (count + 1) / 2;
+			}
+			chunkStart.push_back(first);
+			chunkTriCount.push_back(count);
+			first += count;
+		}
+	}
 
-			// Get a mesh consisting of the faces
-			// in this part that use this material
+	// Allocate
 
-			EditTriMesh	onePartOneMaterial;
-			srcMesh->extractOnePartOneMaterial(0, j, &onePartOneMaterial);
+	allocateMemory((int)chunkStart.size());
 
-			// Sanity check the output mesh
+	// Convert each output part
 
-			assert(onePartOneMaterial.vertexCount() > 0);
-			assert(onePartOneMaterial.triCount() > 0);
-			assert(onePartOneMaterial.partCount() == 1);
-			assert(onePartOneMaterial.materialCount() == 1);
+  m_totalVertices = 0;
+  m_totalTris = 0;
 
-			// Convert the mesh to a trimesh
+	for (int destPartIndex = 0 ; destPartIndex < m_partCount ; ++destPartIndex) {
 
-			getPartMesh(destPartIndex)->fromEditMesh(onePartOneMaterial);
+		// Get a mesh consisting of the faces in this output part
 
-			// Convert the material
+		gatherTris(mesh, &sortedTris[chunkStart[destPartIndex]], chunkTriCount[destPartIndex],
+			onePartOneMaterial, vertexRemap, usedVertices);
 
-			setPartTextureName(destPartIndex, onePartOneMaterial.material(0).diffuseTextureName);
+		// Convert the mesh to a trimesh.  The scratch mesh gets
+		// optimized in place, there's no need to copy it again.
 
-      m_totalVertices += onePartOneMaterial.vertexCount();
-      m_totalTris += onePartOneMaterial.triCount();
+		getPartMesh(destPartIndex)->fromEditMeshInPlace(onePartOneMaterial);
 
-			// !FIXME! Need to implement part names!
+		// Convert the material
 
-			// Next destination part, please
+		setPartTextureName(destPartIndex, onePartOneMaterial.material(0).diffuseTextureName);
 
-			++destPartIndex;
-		}
+      m_totalVertices += getPartMesh(destPartIndex)->getVertexCount();
+      m_totalTris += getPartMesh(destPartIndex)->getTriCount();
+
+		// !FIXME! Need to implement part names!
 	}
-	assert(destPartIndex == getPartCount());
 
+  createBuffers();
+}
+
+/// Creates the buffers called for by the buffer usage the model was
+/// constructed with, from the part meshes that have already been set up.
+/// For StaticBuffers this also fills in the part offsets.
+void Model::createBuffers()
+{
   if(m_bufferUsage == StaticBuffers)
   {
     assert(m_vertexBuffer == NULL);
-    assert(m_indexBuffer == NULL);
-
-    int totalVc = 0;
-    int totalTc = 0;
-    for(i=0; i<m_partCount; i++)
-    {
-      totalVc += m_partMeshList[i].getVertexCount();
-      totalTc += m_partMeshList[i].getTriCount();
-    }
-
-    m_vertexBuffer = new StandardVertexBuffer(totalVc);
-    m_indexBuffer = new IndexBuffer(totalTc);
-
-    int curVc = 0;
-    int curTc = 0;
 
+    m_vertexBuffer = new StandardVertexBuffer(m_totalVertices);
     m_vertexBuffer->lock();
-    m_indexBuffer->lock();
 
-    m_vertexOffsets.resize(m_partCount);
-    m_indexOffsets.resize(m_partCount);
+    int curVc = 0;
 
-    for (i = 0 ; i < m_partCount ; ++i)
+    for (int i = 0 ; i < m_partCount ; ++i)
     {
       RenderVertex *srcV = m_partMeshList[i].getVertexList();
-      RenderTri *srcT = m_partMeshList[i].getTriList();
-
       int vc = m_partMeshList[i].getVertexCount();
-      int tc = m_partMeshList[i].getTriCount();
 
       for(int j=0; j<vc; j++)
       {
@@ -352,34 +593,80 @@ void	Model::fromEditMesh(EditTriMesh &mesh) {
         (*m_vertexBuffer)[j+curVc].v = srcV[j].v;
       }
 
-      for(int j=0; j<tc; j++)
-      {
-        (*m_indexBuffer)[j+curTc].index[0] = srcT[j].index[0] + curVc;
-        (*m_indexBuffer)[j+curTc].index[1] = srcT[j].index[1] + curVc;
-        (*m_indexBuffer)[j+curTc].index[2] = srcT[j].index[2] + curVc;
-      }
-
-      m_vertexOffsets[i] = curVc;
-      m_indexOffsets[i] = curTc;
-
       curVc += vc;
-      curTc += tc;
 	  }
 
     m_vertexBuffer->unlock();
-    m_indexBuffer->unlock();
+
+    createIndexBuffer();
   }
   else if(m_bufferUsage == StaticIndexBuffer)
   {
-    assert(m_indexBuffer == NULL);
+    createIndexBuffer();
+  }
+}
+
+/// The parts' vertices are assumed to be laid out back to back, in part
+/// order, in whatever vertex buffer the model is drawn with, and
+/// m_totalVertices and m_totalTris must already be set.  This fills in
+/// the vertex, index and base vertex offsets of each part.
+///
+/// If all the vertices can be addressed with 16 bits, the indices are
+/// offset to where each part's vertices start, which is the fast path.
+/// If not, and the device can do 32-bit indices, we do the same with a
+/// 32-bit buffer.  Otherwise we stay with 16 bits and leave each part's
+/// indices relative to the part, which is always possible because a
+/// TriMesh can't have more than 65536 vertices, and draw each part with
+/// its own base vertex.
+void Model::createIndexBuffer()
+{
+  assert(m_indexBuffer == NULL);
 
-    m_indexBuffer = new IndexBuffer(m_totalTris);
+  bool is32Bit = false;
+  bool partRelative = false;
+  if(m_totalVertices > 65536)
+  {
+    if(gRenderer.getSupports32BitIndices())
+      is32Bit = true;
+    else
+      partRelative = true;
   }
 
+  m_indexBuffer = new IndexBuffer(m_totalTris, false, is32Bit);
+
+  if(!m_indexBuffer->lock())
+    ABORT("Model failed to lock index buffer");
+
+  m_vertexOffsets.resize(m_partCount);
+  m_indexOffsets.resize(m_partCount);
+  m_baseVertexOffsets.resize(m_partCount);
+
+  int curVc = 0;
+  int curTc = 0;
+
+  for (int i = 0 ; i < m_partCount ; ++i)
+  {
+    RenderTri *srcT = m_partMeshList[i].getTriList();
+    int tc = m_partMeshList[i].getTriCount();
+    unsigned offset = partRelative ? 0 : curVc;
 
-	// Free uindividual part meshes
+    for(int j=0; j<tc; j++)
+    {
+      m_indexBuffer->setTri(j+curTc,
+        srcT[j].index[0] + offset,
+        srcT[j].index[1] + offset,
+        srcT[j].index[2] + offset);
+    }
+
+    m_vertexOffsets[i] = curVc;
+    m_indexOffsets[i] = curTc;
+    m_baseVertexOffsets[i] = partRelative ? curVc : 0;
+
+    curVc += m_partMeshList[i].getVertexCount();
+    curTc += tc;
+  }
 
-	delete [] partMeshes;
+  m_indexBuffer->unlock();
 }
 
 /// \param mesh Specifies the mesh to be replaced by this model.
@@ -392,10 +679,27 @@ void	Model::toEditMesh(EditTriMesh &mesh) const {
 /// \param s3dFilename Specifies the name of the S3D file.
 /// \param defaultDirectory wheter or not to load the model from the default
 /// model directory
-void	Model::importS3d(const char *s3dFilename, bool defaultDirectory) {
+/// \param weldVertices Whether or not to weld coincident vertices.  Turn this
+/// off if the model's vertex list must match that of another model.
+void	Model::importS3d(const char *s3dFilename, bool defaultDirectory, bool weldVertices) {
 
 	char	text[256];
 
+	// Use the compiled model if it's up to date.  It lives next to the S3D.
+
+	if (defaultDirectory)
+		gDirectoryManager.setDirectory(eDirectoryModels);
+
+	char	compiledFilename[256];
+	getCompiledFilename(s3dFilename, compiledFilename, sizeof(compiledFilename));
+
+	if (m_bUseCompiledCache && isCompiledCurrent(s3dFilename, compiledFilename)) {
+		if (importCompiled(compiledFilename, weldVertices)) {
+			m_isValid = true;
+			return;
+		}
+	}
+
 	// Load up the S3D into an EditTriMesh
 
 	EditTriMesh editMesh;
@@ -405,15 +709,230 @@ void	Model::importS3d(const char *s3dFilename, bool defaultDirectory) {
 
 	// Optimize it for rendering
 
-	editMesh.optimizeForRendering();
+	editMesh.optimizeForRendering(weldVertices);
 
 	// Convert it to renderable Model format
 
 	fromEditMesh(editMesh);
 
+	// Save the result for next time.  Failing to write it (read only
+	// media, for instance) just means we do all this again next time.
+
+	if (m_bUseCompiledCache)
+		exportCompiled(compiledFilename, weldVertices, s3dFilename);
+
   m_isValid = true;
 }
 
+/// The file is mapped into memory and the part meshes point straight at
+/// the vertex and triangle lists in it, so nothing is parsed or copied.
+/// The file stays mapped until the model is freed.
+/// \param filename Specifies the name of the compiled model file.
+/// \param weldVertices Whether the model is expected to have welded
+/// vertices.  Files that were written with the other setting are rejected.
+/// \return true if the model was loaded, false if the file is missing,
+/// out of date, or not a valid compiled model.  importS3d() falls back to
+/// the S3D, and writes a good compiled model over the bad one.
+bool	Model::importCompiled(const char *filename, bool weldVertices) {
+
+	freeMemory();
+
+	MappedFile *file = new MappedFile;
+	if (!file->open(filename)) {
+		delete file;
+		return false;
+	}
+
+	const char *data = (const char *)file->getData();
+	unsigned size = file->getSize();
+
+	// Check the header
+
+	const CompiledModelHeader *header = (const CompiledModelHeader *)data;
+	int flags = weldVertices ? kCompiledModelWelded : 0;
+
+	if (size < sizeof(CompiledModelHeader)
+		|| memcmp(header->magic, kCompiledModelMagic, sizeof(kCompiledModelMagic)) != 0
+		|| header->version != kCompiledModelVersion
+		|| header->vertexSize != sizeof(RenderVertex)
+		|| header->triSize != sizeof(RenderTri)
+		|| header->flags != flags
+		|| header->partCount < 1
+		|| (size - sizeof(CompiledModelHeader)) / sizeof(CompiledModelPart) < (unsigned)header->partCount) {
+		delete file;
+		return false;
+	}
+
+	// Check that every part lies inside the file
+
+	const CompiledModelPart *parts = (const CompiledModelPart *)(header + 1);
+	int totalVc = 0;
+	int totalTc = 0;
+	int i;
+
+	for (i = 0 ; i < header->partCount ; ++i) {
+		const CompiledModelPart &part = parts[i];
+		if (part.vertexCount < 1 || part.vertexCount > kMaxPartVertices || part.triCount < 1
+			|| part.vertexOffset < 0 || (part.vertexOffset & 3) != 0
+			|| part.triOffset < 0 || (part.triOffset & 1) != 0
+			|| (unsigned)part.vertexOffset > size
+			|| (size - part.vertexOffset) / sizeof(RenderVertex) < (unsigned)part.vertexCount
+			|| (unsigned)part.triOffset > size
+			|| (size - part.triOffset) / sizeof(RenderTri) < (unsigned)part.triCount
+			|| memchr(part.textureName, 0, sizeof(part.textureName)) == NULL) {
+			delete file;
+			return false;
+		}
+		totalVc += part.vertexCount;
+		totalTc += part.triCount;
+	}
+
+	if (totalVc != header->totalVertices || totalTc != header->totalTris) {
+		delete file;
+		return false;
+	}
+
+	// Check that every triangle only uses its own part's vertices.  The
+	// indices go straight to the card, and one out of range reads past the
+	// part, or past the end of the vertex buffer.
+
+	for (i = 0 ; i < header->partCount ; ++i) {
+		const CompiledModelPart &part = parts[i];
+		const RenderTri *tris = (const RenderTri *)(data + part.triOffset);
+		for (int j = 0 ; j < part.triCount ; ++j) {
+			const unsigned short *index = tris[j].index;
+			if (index[0] >= part.vertexCount || index[1] >= part.vertexCount || index[2] >= part.vertexCount) {
+				delete file;
+				return false;
+			}
+		}
+	}
+
+	// Point the part meshes at the file
+
+	allocateMemory(header->partCount);
+	m_mappedFile = file;
+
+	for (i = 0 ; i < m_partCount ; ++i) {
+		const CompiledModelPart &part = parts[i];
+		m_partMeshList[i].attachMemory(
+			(RenderVertex *)(data + part.vertexOffset), part.vertexCount,
+			(RenderTri *)(data + part.triOffset), part.triCount);
+		setPartTextureName(i, part.textureName);
+	}
+
+	m_totalVertices = totalVc;
+	m_totalTris = totalTc;
+
+	createBuffers();
+
+	return true;
+}
+
+/// \param filename Specifies the name of the compiled model file.
+/// \param weldVertices Whether the model's vertices were welded on import.
+/// This is recorded so importCompiled() won't hand the model to a caller
+/// that needs the other setting.
+/// \param s3dFilename Specifies the S3D the model was built from, or NULL.
+/// Its size and time are recorded, so importS3d() only uses the compiled
+/// model until the S3D changes.  Without it, importS3d() always rebuilds
+/// the compiled model if it can find the S3D.
+/// \return true if the file was written, false otherwise.  Nothing is left
+/// behind on failure.
+bool	Model::exportCompiled(const char *filename, bool weldVertices, const char *s3dFilename) const {
+
+	if (m_partCount < 1) {
+		return false;
+	}
+
+	// Lay out the file
+
+	CompiledModelHeader header;
+	memcpy(header.magic, kCompiledModelMagic, sizeof(header.magic));
+	header.version = kCompiledModelVersion;
+	header.vertexSize = sizeof(RenderVertex);
+	header.triSize = sizeof(RenderTri);
+	header.flags = weldVertices ? kCompiledModelWelded : 0;
+	header.partCount = m_partCount;
+	header.totalVertices = 0;
+	header.totalTris = 0;
+	header.sourceSize = -1;
+	header.sourceTime = 0;
+	if (s3dFilename != NULL) {
+		getSourceStamp(s3dFilename, &header.sourceSize, &header.sourceTime);
+	}
+
+	std::vector<CompiledModelPart> parts(m_partCount);
+	int i;
+
+	int vertexStart = alignCompiledOffset(sizeof(header) + m_partCount * sizeof(CompiledModelPart));
+	int offset = vertexStart;
+	for (i = 0 ; i < m_partCount ; ++i) {
+		CompiledModelPart &part = parts[i];
+		memset(part.textureName, 0, sizeof(part.textureName));
+		strcpy_s(part.textureName, sizeof(part.textureName), m_partTextureList[i].name);
+		part.vertexOffset = offset;
+		part.vertexCount = m_partMeshList[i].getVertexCount();
+		offset += part.vertexCount * sizeof(RenderVertex);
+		header.totalVertices += part.vertexCount;
+	}
+
+	int triStart = alignCompiledOffset(offset);
+	offset = triStart;
+	for (i = 0 ; i < m_partCount ; ++i) {
+		CompiledModelPart &part = parts[i];
+		part.triOffset = offset;
+		part.triCount = m_partMeshList[i].getTriCount();
+		offset += part.triCount * sizeof(RenderTri);
+		header.totalTris += part.triCount;
+	}
+
+	// Write it
+
+	FILE *f;
+	if (fopen_s(&f, filename, "wb") != 0) {
+		return false;
+	}
+
+	bool ok =
+		fwrite(&header, sizeof(header), 1, f) == 1
+		&& fwrite(&parts[0], sizeof(CompiledModelPart), m_partCount, f) == (size_t)m_partCount
+		&& padCompiledFile(f, vertexStart);
+
+	for (i = 0 ; ok && i < m_partCount ; ++i) {
+		const TriMesh &mesh = m_partMeshList[i];
+		ok = fwrite(mesh.getVertexList(), sizeof(RenderVertex), mesh.getVertexCount(), f) == (size_t)mesh.getVertexCount();
+	}
+
+	ok = ok && padCompiledFile(f, triStart);
+
+	for (i = 0 ; ok && i < m_partCount ; ++i) {
+		const TriMesh &mesh = m_partMeshList[i];
+		ok = fwrite(mesh.getTriList(), sizeof(RenderTri), mesh.getTriCount(), f) == (size_t)mesh.getTriCount();
+	}
+
+	if (fclose(f) != 0) {
+		ok = false;
+	}
+	if (!ok) {
+		remove(filename);
+	}
+
+	return ok;
+}
+
+/// \return The bounding box of the model in model space.
+AABB3 Model::getBoundingBox() const
+{
+  AABB3 bb;
+  bb.empty();
+  for(int i = 0; i < m_partCount; ++i)
+    bb.add(m_partMeshList[i].getBoundingBox());
+  return bb;
+}
+
+/// Each part's box comes from the bounds it keeps in model space, so this
+/// costs the same however many vertices the model has.
 /// \param m Specifies the transformation matrix applied to the model.
 /// \return The bounding box of the model in transformed space.
 AABB3 Model::getBoundingBox(const Matrix4x3 &m) const
@@ -14,15 +14,16 @@
 #ifndef __MODEL_H_INCLUDED__
 #define __MODEL_H_INCLUDED__
 
-#include "graphics/VertexBuffer.h"
-#include "graphics/VertexTypes.h"
-#include "graphics/IndexBuffer.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/VertexTypes.h"
+#include "Graphics/IndexBuffer.h"
 #include <vector>
 
 // Forward declarations
 
 class EditTriMesh;
 class TriMesh;
+class MappedFile;
 struct TextureReference;
 
 class Matrix4x3;
@@ -55,8 +56,10 @@ public:
     StaticBuffers
   };
 
+  static bool m_bUseCompiledCache; ///< Global flag; specifies whether importS3d() should read and write compiled (.s3c) models.
+
 	Model(BufferUsage bufferUsage = StaticBuffers);  ///< Constructs an empty model.
-	~Model();  ///< Frees allocated resources and destroys the model.
+	virtual ~Model();  ///< Frees allocated resources and destroys the model.
 
 	// Memory allocation
 
@@ -99,8 +102,15 @@ public:
 
 	// Shorthand for importing an S3D.  (Uses EditTriMesh)
 
-	void	importS3d(const char *s3dFilename, bool defaultDirectory = true);  ///< Imports a model from an S3D file (.S3D).
+	void	importS3d(const char *s3dFilename, bool defaultDirectory = true, bool weldVertices = true);  ///< Imports a model from an S3D file (.S3D).
+
+	// Compiled models.  These hold the part meshes in their final render
+	// layout, so they can be mapped straight into memory and used as is.
 
+	bool	importCompiled(const char *filename, bool weldVertices = true);  ///< Imports a model from a compiled model file (.S3C).
+	bool	exportCompiled(const char *filename, bool weldVertices = true, const char *s3dFilename = NULL) const;  ///< Writes the model to a compiled model file (.S3C).
+
+  AABB3 getBoundingBox() const;  ///< Queries a model for its bounding box in model space.
   AABB3 getBoundingBox(const Matrix4x3 &m) const;  ///< Queries a model for its bounding box.
   const AABB3 &getPartBoundingBox(int part) const;  ///< Queries a model for the bounding box of one of its parts.
   AABB3 getPartBoundingBox(int part, const Matrix4x3 &m) const;  ///< Queries a model for the bounding box of one of its parts.
@@ -120,6 +130,7 @@ protected:
 
   PartOffsetArray m_vertexOffsets;
   PartOffsetArray m_indexOffsets;
+  PartOffsetArray m_baseVertexOffsets; ///< Base vertex to draw each part with.  Zero unless the indices are part-relative.
 
   int m_totalVertices;
   int m_totalTris;
@@ -127,6 +138,14 @@ protected:
   StandardVertexBuffer *m_vertexBuffer;
   IndexBuffer *m_indexBuffer;
   BufferUsage m_bufferUsage;
+
+  MappedFile *m_mappedFile;            ///< Compiled model the part meshes point into, if any
+
+  void createIndexBuffer();  ///< Creates and fills the index buffer from the part meshes.
+
+private:
+
+  void createBuffers();  ///< Creates the buffers requested by m_bufferUsage from the part meshes.
 };
 
 /////////////////////////////////////////////////////////////////////////////
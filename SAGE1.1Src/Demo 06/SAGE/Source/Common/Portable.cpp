@@ -0,0 +1,45 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// Portable.cpp - What the engine needs that isn't the same on every compiler
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file Portable.cpp
+/// \brief Code for the clocks in Portable.h.
+
+#include "Portable.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+double getClockSeconds()
+{
+#ifdef _WIN32
+  static double period = 0.0;
+  if(period == 0.0)
+  {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    period = 1.0 / (double)frequency.QuadPart;
+  }
+  LARGE_INTEGER count;
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart * period;
+#else
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
+
+unsigned getClockMilliseconds()
+{
+#ifdef _WIN32
+  return GetTickCount();
+#else
+  return (unsigned)(getClockSeconds() * 1000.0);
+#endif
+}
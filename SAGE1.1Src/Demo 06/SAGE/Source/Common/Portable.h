@@ -0,0 +1,99 @@
+/// \file Portable.h
+/// \brief Fills in the Visual C++ library calls the engine uses, elsewhere.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Portable.h - What the engine needs that isn't the same on every compiler
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PORTABLE_H_INCLUDED__
+#define __PORTABLE_H_INCLUDED__
+
+// The engine is written for Visual C++.  Elsewhere (the Linux build of the
+// engine library and its tests) the secure CRT calls become the plain
+// ones, the checks they'd make being left out, and stdext::hash_map and
+// hash_set become the standard unordered containers.
+
+#ifdef _WIN32
+
+  #include <hash_map>
+  #include <hash_set>
+
+#else
+
+  #include <errno.h>
+  #include <stdio.h>
+  #include <string.h>
+  #include <strings.h>
+  #include <unordered_map>
+  #include <unordered_set>
+
+  #define sprintf_s snprintf
+  #define vsprintf_s vsnprintf
+  #define sscanf_s sscanf
+  #define fscanf_s fscanf
+  #define _stricmp strcasecmp
+
+  #define __forceinline inline __attribute__((always_inline))
+
+  typedef int errno_t;
+
+  #define _stat stat
+
+  inline int fopen_s(FILE **file, const char *filename, const char *mode)
+  {
+    *file = fopen(filename, mode);
+    return *file != NULL ? 0 : errno;
+  }
+
+  inline int strcpy_s(char *dest, size_t size, const char *source)
+  {
+    if(size == 0)
+      return EINVAL;
+    size_t n = strnlen(source, size - 1);
+    memcpy(dest, source, n);
+    dest[n] = '\0';
+    return 0;
+  }
+
+  inline int strncpy_s(char *dest, size_t size, const char *source, size_t count)
+  {
+    if(size == 0)
+      return EINVAL;
+    size_t n = strnlen(source, count);
+    if(n > size - 1)
+      n = size - 1;
+    memcpy(dest, source, n);
+    dest[n] = '\0';
+    return 0;
+  }
+
+  inline int strcat_s(char *dest, size_t size, const char *source)
+  {
+    size_t length = strnlen(dest, size);
+    if(length == size)
+      return EINVAL;
+    return strcpy_s(dest + length, size - length, source);
+  }
+
+  namespace stdext
+  {
+    template <class Key, class Value>
+    class hash_map : public std::unordered_map<Key, Value> {};
+
+    template <class Key>
+    class hash_set : public std::unordered_set<Key> {};
+  }
+
+#endif
+
+/// \brief Reads a high resolution clock
+/// \return Seconds from some arbitrary start
+double getClockSeconds();
+
+/// \brief Reads a coarse clock, good for seeding random numbers
+/// \return Milliseconds from some arbitrary start
+unsigned getClockMilliseconds();
+
+#endif // #ifndef __PORTABLE_H_INCLUDED__
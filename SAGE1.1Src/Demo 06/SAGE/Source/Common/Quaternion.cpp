@@ -329,7 +329,7 @@ Quaternion Quaternion::crossProduct(const Quaternion &a) const {
 /// \param q1 Specifies the final quaternion.
 /// \param t Specifies the parametric time.
 /// \return The interpolated quaternion at the given time.
-Quaternion slerp(const Quaternion &q0, const Quaternion &q1, float t) {
+Quaternion Quaternion::slerp(const Quaternion &q0, const Quaternion &q1, float t) {
 
 	// Check for out-of range parameter and return edge points if so
 
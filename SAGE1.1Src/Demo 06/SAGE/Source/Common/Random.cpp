@@ -4,9 +4,9 @@
 //Copyright Ian Parberry, 1998
 //Last updated July 3, 1998
 
-#include <windows.h>
+#include <stdlib.h>
 
-#include "common/random.h"
+#include "Common/Random.h"
 
 CRandom Random; //random number generator
 
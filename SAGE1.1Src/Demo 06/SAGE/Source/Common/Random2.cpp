@@ -13,7 +13,7 @@
 //Copyright Ian Parberry, 2004
 //Last updated February 18, 2004
 
-#include "random2.h"
+#include "Random2.h"
 
 CRandom::CRandom(){ //constructor
   m_hProv=NULL; //default
@@ -81,15 +81,14 @@
 //
 // So, the interface is completely platform independent, and much of the
 // implementation is as well.  All that said, however, eventually you have to
-// impement the interface on a particular platform.  It is possible, and
-// in many ways advantageous, to make this file sit atop different
-// lower level layers - i.e. one for DirectX, one for OpenGL, one for
-// PlayStationII, etc.  For simplicity, we have not done this.  We have
-// chosen one API (Direct3D) and made calls to it directly in this file.
-// This makes it basically impossible to support multiple platforms or
-// APIs easily without duplciating the entire contents of the file, but the
-// purpose of this code is ease of understanding the API most people are
-// most interested in learning - DirectX.
+// impement the interface on a particular platform.  This file sits atop
+// a lower level layer, a RenderBackend, that makes the actual API calls.
+// Everything the renderer remembers - the render states, the matrices,
+// the texture and font caches, the call counts - is kept here, and only
+// the device work goes through the backend.  D3D9RenderBackend draws with
+// Direct3D; NullRenderBackend draws nothing, which is how the game runs
+// headless and how the engine is built where there is no Direct3D.
+// Another API would be one more backend, leaving this file alone.
 //
 // We have also not concerned ourselved with optimization too much.  This
 // is an "engine" designed for you to look at the guts and learn how things
@@ -115,21 +114,18 @@
 #include <assert.h>
 
 #include "CommonStuff.h"
-#include "WindowsWrapper/WindowsWrapper.h"
-#include "common/renderer.h"
+#include "Common/Renderer.h"
 #include "MathUtil.h"
 #include "Bitmap.h"
-#include "directorymanager/DirectoryManager.h"
+#include "DirectoryManager/DirectoryManager.h"
 #include "AABB3.h"
-#include "graphics/VertexBufferBase.h"
-#include "graphics/IndexBuffer.h"
+#include "Graphics/VertexBufferBase.h"
+#include "Graphics/IndexBuffer.h"
 #include "TextureCacheEntry.h"
 #include "FontCacheEntry.h"
+#include "Graphics/RenderBackend.h"
 #include <vector>
-
-#include <d3d9.h> 
-
-#include <d3dx9core.h>
+#include <string.h>
 #include <stdio.h>
 
 
@@ -140,33 +136,20 @@
 //
 /////////////////////////////////////////////////////////////////////////////
 
-// Direct3D interface object
-
-static LPDIRECT3D9 		pD3D = NULL; 
-
-// Direct3D device interface
-
-LPDIRECT3DDEVICE9 pD3DDevice = NULL;
-
-static D3DPRESENT_PARAMETERS presentParms;
-
-// pointer to the original backbuffer
-static LPDIRECT3DSURFACE9 pOriginalBackBuffer;
-
-// pointer to the original depth stencil
-static LPDIRECT3DSURFACE9 pOriginalDepthStencil;
-
-// List of video modes
-
-static int		videoModeCount;
-static VideoMode	*videoModeList;
+/// \brief A 4x4 matrix, laid out the way the backend takes it
+struct Matrix4x4 {
+	float	_11, _12, _13, _14;
+	float	_21, _22, _23, _24;
+	float	_31, _32, _33, _34;
+	float	_41, _42, _43, _44;
+};
 
 // The clip matrix.  This transforms camera space points to clip
 // space, aka "canonical view volume space."  it is computed
 // by computeClipMatrix().  D3D calls this matrix the "projection"
 // matrix
 
-static D3DXMATRIX	clipMatrix;
+static Matrix4x4	clipMatrix;
 
 // Instance stack system.  This is an OpenGL-like system to manage the
 // current reference frame.  For example, by default, without instancing,
@@ -178,9 +161,6 @@ static D3DXMATRIX	clipMatrix;
 // can be performed multiple times, for example, to render a tire within a
 // car.
 
-static LPDIRECT3DINDEXBUFFER9 curIndexBuffer = NULL;
-static LPDIRECT3DVERTEXBUFFER9 curVertexBuffer = NULL;
-
 /// \brief Holds information about the current instance (world matrix).
 struct InstanceInfo {
 
@@ -198,9 +178,9 @@ static InstanceInfo	instanceStack[kMaxInstanceDepth];
 // reference frame, and transforms it to clip space.  Note that this is a
 // 4x4 matrix.  We could have our own nice 4x4 matrix class, but since they
 // are actually not used very much outside of the graphcis internals, we just
-// use D3D's here
+// use the little struct above
 
-static D3DMATRIX	modelToClipMatrix;
+static Matrix4x4	modelToClipMatrix;
 
 // The modelToClipMatrix is only used by the software vertex processing
 // routines.  it's relatively expeisive to compute.  So we won't compute
@@ -219,12 +199,6 @@ static bool	needToComputeModelToClipMatrix = true;
 
 static Matrix4x3	modelToCameraMatrix;
 
-// The current D3D "material" which controls material properties for
-// the standard local illumunation model.  We will only be using a few
-// of these values.
-
-static D3DMATERIAL9 d3dMaterial; 
-
 // Floating point projection values, for software projection
 
 static float	windowCenterX, windowCenterY;
@@ -234,10 +208,6 @@ static float	halfWindowSizeX, halfWindowSizeY;
 
 static float	farFogClipSpaceZ;
 
-// The D3D directional light
-
-static D3DLIGHT9 d3dDirectionalLight; 
-
 // The texture cache bookeeping info
 
 static std::vector<TextureCacheEntry*>	textureCacheList;
@@ -246,13 +216,11 @@ static std::vector<TextureCacheEntry*>	textureCacheList;
 
 static std::vector<FontCacheEntry*> fontCacheList;
 
-// Last clock reading.  This is zero if we haven't fetched the time yet.
+// The render states last set.  Those with a member of their own are
+// kept there as well; this is for the backend's sake, and for the
+// states that have no other home.
 
-static LARGE_INTEGER lastClockTime;
-
-// Conversion factor from timer values to seconds.
-
-static float performanceTimerFrequency;
+static unsigned	renderStates[eRenderStateCount];
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -261,93 +229,66 @@ static float performanceTimerFrequency;
 /////////////////////////////////////////////////////////////////////////////
 
 //---------------------------------------------------------------------------
-// setD3DRenderState
+// floatBits
 //
-// Basically just a thin wrapper around pD3DDevice->SetRenderState,
-// with added pointer safety check and validation of the return code,
-// for debugging.
-//
-// For speed, we could cache the states to prevent setting states
-// redundantly.  However, most of the higher level code should already be
-// doing that, and hopefully Microsoft is doing the same as well.
+// The bits of a float, the way the fog distances are passed as states
 
-static void	setD3DRenderState(D3DRENDERSTATETYPE state, unsigned value) {
+static unsigned	floatBits(float f) {
+	unsigned	u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
 
-	// Make sure device exists
+//---------------------------------------------------------------------------
+// setBackendState
+//
+// Counts a render state, remembers it and passes it on to the backend.
+// It's sent whether it changed or not - the callers that care check first.
 
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
+static void	setBackendState(ERenderState state, unsigned value) {
+	gRenderer.countCall(eRenderCallState);
+	renderStates[state] = value;
+	if (gRenderer.getBackend() != NULL) {
+		gRenderer.getBackend()->setState(state, value);
 	}
-
-	// !SPEED! We could check if the state actually changed here.
-	// Or, we could assume that the good folks in Redmond will
-	// do this for us.  Ahem.....
-
-	// Set the state
-
-	HRESULT result = pD3DDevice->SetRenderState(state, value);
-
-	// Check for error
-
-	assert(SUCCEEDED(result));
 }
 
-
 //---------------------------------------------------------------------------
-// setD3DSamplerState
-//
-// Basically just a thin wrapper around pD3DDevice->SetSamplerState,
-// with added pointer safety check and validation of the return code,
-// for debugging.
+// setTransform
 //
-// For speed, we could cache the states to prevent setting states
-// redundantly.  However, most of the higher level code should already be
-// doing that, and hopefully Microsoft is doing the same as well.
+// Passes a matrix on to the backend, if there is one yet
 
-static void	setD3DSamplerState(D3DSAMPLERSTATETYPE  state, unsigned value) {
-
-	// Make sure device exists
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
+static void	setTransform(RenderBackend::ETransform transform, const Matrix4x4 &m) {
+	if (gRenderer.getBackend() != NULL) {
+		gRenderer.getBackend()->setTransform(transform, &m._11);
 	}
-
-	// !SPEED! We could check if the state actually changed here.
-	// Or, we could assume that the good folks in Redmond will
-	// do this for us.  Ahem.....
-
-	// Set the state
-
-	HRESULT result = pD3DDevice->SetSamplerState(0, state, value);
-
-	// Check for error
-
-	assert(SUCCEEDED(result));
 }
 
 //---------------------------------------------------------------------------
-// setD3DDirectionalLight
+// toMatrix4x4
 //
-// Install the directional light into D3D render context
-
-static void	setD3DDirectionalLight() {
-
-	// Make sure device exists
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
-	}
+// Converts our 4x3 matrix to a 4x4 one
 
-	// Set light to D3D at light index 0
+static void	toMatrix4x4(const Matrix4x3 &src, Matrix4x4 *m) {
+	m->_11 = src.m11;
+	m->_12 = src.m12;
+	m->_13 = src.m13;
+	m->_14 = 0.0f;
 
-	HRESULT result = pD3DDevice->SetLight(0, &d3dDirectionalLight);
+	m->_21 = src.m21;
+	m->_22 = src.m22;
+	m->_23 = src.m23;
+	m->_24 = 0.0f;
 
-	// Check for error
+	m->_31 = src.m31;
+	m->_32 = src.m32;
+	m->_33 = src.m33;
+	m->_34 = 0.0f;
 
-	assert(SUCCEEDED(result));
+	m->_41 = src.tx;
+	m->_42 = src.ty;
+	m->_43 = src.tz;
+	m->_44 = 1.0f;
 }
 
 //---------------------------------------------------------------------------
@@ -433,9 +374,17 @@ Renderer::Renderer() {
 	constantOpacity = 1.0f;
 	zEnable = true;
 	fogEnable = false;
+	m_maxVertexIndex = 0xFFFF;
 	fogColor = MAKE_RGB(255,255,255);
 	fogNear = 0.0f;
 	fogFar = 1000.0f;
+	frustumCulling = true;
+	nObjectsDrawn = nObjectsDrawnFrame = 0;
+	nObjectsCulled = nObjectsCulledFrame = 0;
+	for (int i = 0 ; i < eRenderCallCount ; ++i) {
+		m_callCountFrame[i] = m_callCountLastFrame[i] = m_callCountTotal[i] = 0;
+	}
+	m_backend = NULL;
 	lightEnable = true;
 	ambientLightColor = MAKE_RGB(90,90,90);
 	directionalLightVector.x = .707f;
@@ -447,7 +396,8 @@ Renderer::Renderer() {
 	textureClamp = false;
 	renderTargetHandle = -1; // -1 means backbuffer
 	timeStep = 1.0f / 30.0f; // will be invalid until the first two page flips
-  pOriginalBackBuffer = NULL;
+	renderStates[eRenderStateLighting] = 1;
+	renderStates[eRenderStateVertexAlpha] = 0;
 
 	// And now set the camera, to force some stuff to be
 	// recomputed
@@ -460,160 +410,9 @@ Renderer::Renderer() {
 }
 
 //---------------------------------------------------------------------------
-/// \return Number of video modes found
+/// \return Number of video modes found, none before init()
 int	Renderer::getVideoModeCount() {
-
-	// Check if we already know
-
-	if (videoModeCount > 0) {
-		return videoModeCount;
-	}
-
-	// List has not yet been created.  Nothing should be allocated yet
-
-	assert(pD3D == NULL);
-	assert(pD3DDevice == NULL);
-	
-	// Create a Direct3D object
-
-	pD3D = Direct3DCreate9(D3D_SDK_VERSION);
-	if (pD3D == NULL) {
-		videoModeCount = 0;
-    ABORT("Unable to create D3D object.");
-		return 0;
-	}
-
-	// Enumerate the adapter modes in two passes.  On the first pass,
-	// we'll just count the number of modes.  On the second pass,
-	// we'll actually fill in the mode list
-
-	// Choose color format. Default to 24-bit color here. If you want 
-	// 16-bit color, you're going to have to work harder than this.
-	D3DFORMAT d3dFormat=D3DFMT_X8R8G8B8;
-
-	for (int pass = 0 ; pass < 2 ; ++pass) {
-
-		// Enumerate modes
-
-		int	modeIndex = 0;
-		int modeCount=pD3D->GetAdapterModeCount(D3DADAPTER_DEFAULT,d3dFormat);
-		while (modeIndex < modeCount) { 
-
-			// Enumerate the next mode.
-
-			D3DDISPLAYMODE mode;
-			HRESULT result = pD3D->EnumAdapterModes(
-				D3DADAPTER_DEFAULT,
-				d3dFormat,
-				modeIndex,
-				&mode
-			);
-			if (FAILED(result)) {
-				break;
-			}
-			++modeIndex;
-
-			// Convert D3D mode structure to our own
-
-			VideoMode ourMode;
-			ourMode.xRes = mode.Width;
-			ourMode.yRes = mode.Height;
-			ourMode.refreshHz = mode.RefreshRate;
-			switch (mode.Format) {
-				case D3DFMT_A8R8G8B8:
-					ourMode.bitsPerPixel = 32;
-					break;
-
-				case D3DFMT_R8G8B8:
-				case D3DFMT_X8R8G8B8:
-					ourMode.bitsPerPixel = 24;
-					break;
-
-				case D3DFMT_R5G6B5:
-				//case D3DFMT_X1R5G5B5:
-				//case D3DFMT_A1R5G5B5:
-				//case D3DFMT_A4R4G4B4:
-				//case D3DFMT_X4R4G4B4:
-					ourMode.bitsPerPixel = 16;
-					break;
-
-				default:
-
-					// Unknown or unrecognized mode - skip it
-
-					continue;
-			}
-
-			// Count it, or add it to the list
-
-			if (pass == 0) {
-
-				// 1st pass - just count it
-
-				++videoModeCount;
-			} else {
-
-				// 2nd pass.  Actually add it to the list.
-				// First, we check for duplicates
-
-				bool	dup = false;
-				for (int i = 0 ; i < videoModeCount ; ++i) {
-					VideoMode *v = &videoModeList[i];
-					if (
-						(v->xRes == ourMode.xRes) &&
-						(v->yRes == ourMode.yRes) &&
-						(v->bitsPerPixel == ourMode.bitsPerPixel) &&
-						(v->refreshHz == ourMode.refreshHz)
-					) {
-						dup = true;
-						break;
-					}
-				}
-
-				// Add it, if not a dup
-
-				if (!dup) {
-					videoModeList[videoModeCount] = ourMode;
-					++videoModeCount;
-				}
-			}
-
-			// Keep enumerating video modes
-		}
-
-		// Any valid modes found?
-
-		if (videoModeCount == 0) {
-
-			// Nope - clean up and report failure.
-
-			pD3D->Release();
-      ABORT("Unable to enumerate D3D devices.");
-			pD3D = NULL;
-			return 0;
-		}
-
-		// End of first pass?
-
-		if (pass == 0) {
-
-			// Yep.  Allocate list.  Notice that we are
-			// possibly allocating more memory than we
-			// will need, because there might be duplicates.
-			// We don't care about minor differences in
-			// pixel formats with the same bit depth
-
-			videoModeList = new VideoMode[videoModeCount];
-
-			// Reset count for next pass
-
-			videoModeCount = 0;
-		}
-	}
-
-	// Return number of modes
-
-	return videoModeCount;
+	return m_backend != NULL ? m_backend->getVideoModeCount() : 0;
 }
 
 // \brief Returns a specific video mode
@@ -649,208 +448,21 @@ int	Renderer::getVideoModeCount() {
 //-------------------------------------------------------------------------
 
 
-#include "RotationMatrix.h"
+/// \param backend What to draw with.  The renderer owns it from now on,
+/// and deletes it at shutdown().
 /// \param mode Desired video mode for the app
-/// \param shaderDebug True iff shader debuggins is desired
-/// \param windowed Whether the app should run windowed, or full screen. The
-/// default is full screen
 ///
 /// \remarks The engine must be initialized before any other 3D calls are made
-void	Renderer::init(const VideoMode &mode, bool shaderDebug, bool windowed) {
-	
-  D3DXPLANE dxPlane;  
-  Plane myPlane(0.0f,1.0f,0.0f,0.0f);
-
-  EulerAngles view(0.0f, 3.1415f / 4,0.0f);
-  EulerAngles angles = myPlane.reflectOrientation(view);
-
-  Vector3 look(0.0f, 0.0f,1.0f);
-  RotationMatrix mat;
-  mat.setup(EulerAngles(3.14f,3.1415f/4.0f,0.0f));
-  Vector3 outLook = mat.objectToInertial(look);
-   
-  
-  HRESULT	result;
-  D3DDEVTYPE deviceType;
-  DWORD vertexRendering = 0;
-
-  // device must be reference for shader debugging
-  m_shaderDebug = m_deviceReference = shaderDebug;
-
-  if (m_deviceReference)
-  {
-    deviceType = D3DDEVTYPE_REF;
-    vertexRendering = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
-
-  }
-  else
-  {
-    deviceType = D3DDEVTYPE_HAL;
-    vertexRendering = D3DCREATE_HARDWARE_VERTEXPROCESSING;
-  }
-  
-	// Make sure Direct3D interface is created
-
-	getVideoModeCount();
-
-	// We should have a D3D object, but not a D3D device
+void	Renderer::init(RenderBackend *backend, const VideoMode &mode) {
 
-	assert(pD3D != NULL);
-	assert(pD3DDevice == NULL);
-
-	// Figure out actual pixel format to use for desired bit depth
-
-	int		modeIndex = 0;
-	D3DDISPLAYMODE	d3dMode;
-	for (;;) {
-
-		// Get the mode
-
-		result = pD3D->EnumAdapterModes(D3DADAPTER_DEFAULT,D3DFMT_X8R8G8B8,modeIndex,&d3dMode);
-		++modeIndex;
-
-		// No more modes?  Then we couldn't find an appropriate mode
-
-		if (FAILED(result)) {
-			ABORT("Can't find valid video mode for %dx%dx%dbpp", mode.xRes, mode.yRes, mode.bitsPerPixel);
-		}
+	assert(backend != NULL);
+	assert(m_backend == NULL);
 
-		// Will this mode do for what they want?
+	// Make the device
 
-		if (d3dMode.Width != mode.xRes) continue;
-		if (d3dMode.Height != mode.yRes) continue;
-		if (mode.bitsPerPixel == 16) {
-
-			if (d3dMode.Format == D3DFMT_R5G6B5) {
-				break;
-			}
-
-		} else if (mode.bitsPerPixel == 24) {
-
-			if (d3dMode.Format == D3DFMT_R8G8B8) {
-				break;
-			}
-			if (d3dMode.Format == D3DFMT_X8R8G8B8) {
-				break;
-			}
-
-		} else if (mode.bitsPerPixel == 32) {
-
-			if (d3dMode.Format == D3DFMT_A8R8G8B8) {
-				break;
-			}
-
-		} else {
-
-			// Huh?  You are asking for an invalid bit depth
-
-			assert(false);
-		}
-	}
-
-	// Figure out Z buffer format.  We'll start by assuming
-	// a 16-bit depth buffer
-
-	D3DFORMAT depthBufferFormat = D3DFMT_D16;
-
-	// If in higher bit depth, we'll shoot for the depth buffer
-	// with the most resolution possible
-
-	if (mode.bitsPerPixel > 16) {
-
-		// First, try a full 32-bit z-buffer.
-		// if that doesn't work, we'll try a 24-bit
-		// z-buffer
-
-		if (SUCCEEDED(pD3D->CheckDeviceFormat(
-			D3DADAPTER_DEFAULT,
-			deviceType,
-			d3dMode.Format,
-			D3DUSAGE_DEPTHSTENCIL,
-			D3DRTYPE_SURFACE,
-			D3DFMT_D32
-		))) {
-			depthBufferFormat = D3DFMT_D32;
-		} else if (SUCCEEDED(pD3D->CheckDeviceFormat(
-			D3DADAPTER_DEFAULT,
-			deviceType,
-			d3dMode.Format,
-			D3DUSAGE_DEPTHSTENCIL,
-			D3DRTYPE_SURFACE,
-			D3DFMT_D24S8
-		))) {
-			depthBufferFormat = D3DFMT_D24S8;
-		}
-	}
-
-	// Fill in the "present" parameters
-
-	presentParms.BackBufferWidth = mode.xRes;
-	presentParms.BackBufferHeight = mode.yRes;
-	presentParms.Windowed = 0;
-	presentParms.BackBufferFormat = d3dMode.Format;
-	presentParms.MultiSampleType = D3DMULTISAMPLE_NONE;
-	presentParms.MultiSampleQuality = 0;
-	presentParms.EnableAutoDepthStencil = TRUE;
-	presentParms.AutoDepthStencilFormat = depthBufferFormat;
-	presentParms.Flags = 0;
-	presentParms.hDeviceWindow = gWindowsWrapper.getHandle();
-	presentParms.BackBufferCount = 2;
-	presentParms.SwapEffect = D3DSWAPEFFECT_FLIP;
-	if (mode.refreshHz == kRefreshRateDefault) {
-		presentParms.FullScreen_RefreshRateInHz = D3DPRESENT_RATE_DEFAULT;
-	} else if (mode.refreshHz == kRefreshRateFastest) {
-		presentParms.FullScreen_RefreshRateInHz = D3DPRESENT_RATE_DEFAULT; //??????
-	} else {
-		assert(mode.refreshHz > 0);
-		presentParms.FullScreen_RefreshRateInHz = mode.refreshHz;
-	}
-	presentParms.PresentationInterval = D3DPRESENT_INTERVAL_ONE;
-
-	if (windowed) {
-		presentParms.Windowed = 1;
-		presentParms.BackBufferCount = 1;
-		presentParms.SwapEffect = D3DSWAPEFFECT_COPY;
-		presentParms.FullScreen_RefreshRateInHz = 0;
-		//presentParms.FullScreen_PresentationInterval = 0;
-		::SetWindowPos(
-			gWindowsWrapper.getHandle(),
-			NULL,
-			0,
-			0,
-			mode.xRes,
-			mode.yRes,
-			SWP_NOZORDER | SWP_SHOWWINDOW
-		);
-	}
-
-	// Create hardware transform device, hopefully with vertex and
-	// pixel shader support.
-
-	result = pD3D->CreateDevice(
-		D3DADAPTER_DEFAULT,
-		deviceType,
-		gWindowsWrapper.getHandle(),
-		D3DCREATE_FPU_PRESERVE | vertexRendering,
-		&presentParms,
-		&pD3DDevice
-	);
-	if (!SUCCEEDED(result)) {
-
-		// Nope - try falling back on software vertex processing
-
-		result = pD3D->CreateDevice(
-			D3DADAPTER_DEFAULT,
-			deviceType,
-			gWindowsWrapper.getHandle(),
-			D3DCREATE_FPU_PRESERVE | D3DCREATE_SOFTWARE_VERTEXPROCESSING,
-			&presentParms,
-			&pD3DDevice
-		);
-		if (!SUCCEEDED(result)) {
-			ABORT("Can't set video mode to %dx%dx%dbpp", mode.xRes, mode.yRes, mode.bitsPerPixel);
-		}
-	}
+	m_backend = backend;
+	m_backend->init(mode);
+	m_maxVertexIndex = m_backend->getMaxVertexIndex();
 
 	// Remember resolution
 
@@ -861,7 +473,6 @@ void	Renderer::init(const VideoMode &mode, bool shaderDebug, bool windowed) {
 
 	setFullScreenWindow();
 
-	
 	// Clear out any garbage on the screen
 
 	for (int i = 0 ; i < 4 ; ++i) {
@@ -871,44 +482,36 @@ void	Renderer::init(const VideoMode &mode, bool shaderDebug, bool windowed) {
 		flipPages();
 	}
 
-	// clear out font array	
-  fontCacheList.clear();
-	
+	// clear out font array
+	fontCacheList.clear();
+
 	// add a default font in slot 0
 	addFont("Arial", 10,15,true);
 
-	   
+	//// Set a default render state
 
-  pD3DDevice->GetRenderTarget(0, &pOriginalBackBuffer);
-  pD3DDevice->GetDepthStencilSurface(&pOriginalDepthStencil);
-  
-
-  //// Set a default render state
-
-  depthBufferRead = true;
-  depthBufferWrite = true;
-  blendEnable = true;
-  sourceBlendMode = eSourceBlendModeSrcAlpha;
-  destBlendMode = eDestBlendModeInvSrcAlpha;
+	depthBufferRead = true;
+	depthBufferWrite = true;
+	blendEnable = true;
+	sourceBlendMode = eSourceBlendModeSrcAlpha;
+	destBlendMode = eDestBlendModeInvSrcAlpha;
 
-  constantOpacity = 1.0f;
-  zEnable = true;
-  fogEnable = false;
+	constantOpacity = 1.0f;
+	zEnable = true;
+	fogEnable = false;
 
-  restoreRenderStates();
+	restoreRenderStates();
 
-	
 	// Prepare the texture cache
 
 	resetTextureCache();
+}
 
-	// Fetch timer frequency
+//---------------------------------------------------------------------------
+/// \return True if the backend draws nothing, or there isn't one yet
 
-	LARGE_INTEGER perfFreq;
-	if (!SUCCEEDED(::QueryPerformanceFrequency(&perfFreq))) {
-		ABORT("QueryPerformanceFrequency failed");
-	}
-	performanceTimerFrequency = (float)perfFreq.QuadPart;
+bool	Renderer::isHeadless() const {
+	return m_backend == NULL || m_backend->isHeadless();
 }
 
 //---------------------------------------------------------------------------
@@ -922,37 +525,14 @@ void	Renderer::shutdown() {
 	// Delete Font Objects
 
 	freeAllFonts();
-	
-	// release aquired back buffer
-  if (pOriginalBackBuffer)
-    pOriginalBackBuffer->Release();
-  pOriginalBackBuffer = NULL;
-  	
-  // release aquired depth stencil buffer
-  if (pOriginalDepthStencil)
-    pOriginalDepthStencil->Release();
-  pOriginalDepthStencil = NULL;
-
-
-	// Delete Direct3D device object
-
-	if (pD3DDevice != NULL) {
-		pD3DDevice->Release();
-		pD3DDevice = NULL;
-	}
 
-	// Delete Direct3D interface
+	// Delete the device, and the backend with it
 
-	if (pD3D != NULL) {
-		pD3D->Release();
-		pD3D = NULL;
+	if (m_backend != NULL) {
+		m_backend->shutdown();
+		delete m_backend;
+		m_backend = NULL;
 	}
-
-	// Delete list of video modes
-
-	delete [] videoModeList;
-	videoModeList = NULL;
-	videoModeCount = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -964,54 +544,26 @@ void	Renderer::flipPages() {
 
 	// Make sure we have a device
 
-	if (pD3DDevice != NULL) {
-
-		// Toggle it
-
-		HRESULT result = pD3DDevice->Present(NULL,NULL,NULL,NULL);
-
-		// We could lose the surface - we'll ignore this error
-
-		assert((result == D3DERR_DEVICELOST) || SUCCEEDED(result));
-	}
-
-	// Perform frame-time processing
-	
-
-	// Fetch current time
-
-	LARGE_INTEGER clock;
-	if (!SUCCEEDED(QueryPerformanceCounter(&clock))) {
-		ABORT("QueryPerformanceCounter failed");
+	if (m_backend == NULL) {
+		return;
 	}
 
-	// Make sure this isn't the first clock reading
-
-	if (lastClockTime.QuadPart != 0) {
+	// Toggle it
 
-		// Compute elapsed time
+	m_backend->present();
 
-		LONGLONG diff = clock.QuadPart - lastClockTime.QuadPart;
+	// Perform frame-time processing.  The backend says how long the frame
+	// took, unless this is its first reading or the clock hiccuped
 
-		// If time is running in reverse, then ignore it.
-		// Let's protect our program against hiccups in
-		// the clock.
+	float	t;
+	if (m_backend->readFrameTime(&t)) {
 
-		if (diff >= 0) {
+		// Limit to max, just to protect our app
+		// from blowing up.  If we have a *really* horrible
+		// frame rate, then nothing we do will make it
+		// behave well...
 
-			// Convert to seconds
-
-			timeStep = (float)diff / performanceTimerFrequency;
-
-			// Limit to max, just to protect our app
-			// from blowing up.  If we have a *really* horrible
-			// frame rate, then nothing we do will make it
-			// behave well...
-
-			if (timeStep > 1.0f) {
-				timeStep = 1.0f;
-			}
-		}
+		timeStep = t > 1.0f ? 1.0f : t;
 	}
 
   // add the number of triangles rendered in the last frame to
@@ -1021,12 +573,18 @@ void	Renderer::flipPages() {
   // reset number of triangles rendered
   nTriangleFrameCount = 0;
 
-  	// Remember for next time around
-	
-	lastClockTime = clock;
+  // same for the frustum culling counts
+  nObjectsDrawn += nObjectsDrawnFrame;
+  nObjectsCulled += nObjectsCulledFrame;
+  nObjectsDrawnFrame = nObjectsCulledFrame = 0;
 
-  curIndexBuffer = NULL;
-  curVertexBuffer = NULL;
+  // and the device call counts
+  for (int i = 0 ; i < eRenderCallCount ; ++i)
+  {
+    m_callCountTotal[i] += m_callCountFrame[i];
+    m_callCountLastFrame[i] = m_callCountFrame[i];
+    m_callCountFrame[i] = 0;
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -1036,51 +594,10 @@ void	Renderer::flipPages() {
 
 void Renderer::validateDevice()
 {
-  // exit if device is invalid
-  assert (pD3DDevice);
-  
-  HRESULT hr = pD3DDevice->TestCooperativeLevel();
-
-
-  if (hr == D3DERR_DEVICELOST)
-  {
-    // loop until the device is ready to be reset
-    while (1)
-    {      
-      // let windows process
-      gWindowsWrapper.idle();
-      
-      // check device to see if it is ready
-      hr = pD3DDevice->TestCooperativeLevel();
-      if (hr == D3DERR_DEVICENOTRESET) 
-      {
-        int hello = 0;
-        break;
-      }
-    }
-    
-    // device is ready! restore all non managed resources
-
-    gResourceManager.releaseAll();
-
-    // release pointer to buffers b/c these are not in the resource manager
-    if (pOriginalBackBuffer)
-      pOriginalBackBuffer->Release();
-    if (pOriginalDepthStencil)
-      pOriginalDepthStencil->Release();
-
-    pD3DDevice->Reset(&presentParms);
-
-    // get pointers to depth buffer and back buffer
-    pD3DDevice->GetRenderTarget(0, &pOriginalBackBuffer);
-    pD3DDevice->GetDepthStencilSurface(&pOriginalDepthStencil);
-      
-    gResourceManager.restoreAll();
-
-    restoreRenderStates();  
-  }
-  
-  return;
+  // the backend waits out a lost device and resets it; the render
+  // states are ours to send again
+  if (m_backend != NULL && m_backend->validateDevice())
+    restoreRenderStates();
 }
 
 //---------------------------------------------------------------------------
@@ -1090,17 +607,8 @@ void Renderer::validateDevice()
 // rendering primitives.
 
 void	Renderer::beginScene() {
-
-	// Make sure we have a device
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-	} else {
-
-		// Do it
-
-		HRESULT result = pD3DDevice->BeginScene();
-		assert(SUCCEEDED(result));
+	if (m_backend != NULL) {
+		m_backend->beginScene();
 	}
 }
 
@@ -1111,95 +619,52 @@ void	Renderer::beginScene() {
 // primitives have been rendered.
 
 void	Renderer::endScene() {
-
-	// Make sure we have a device
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-	} else {
-
-		// Do it
-
-		HRESULT result = pD3DDevice->EndScene();
-		assert(SUCCEEDED(result));
+	if (m_backend != NULL) {
+		m_backend->endScene();
 	}
 }
 
 //---------------------------------------------------------------------------
 // Renderer::setDefaultRenderStates
 //
-// Restores all renderstates to default.
+// Restores all renderstates to what the renderer believes them to be, for
+// a new or reset device.
 
 void  Renderer::restoreRenderStates()
 {
-  // Set a default render state
-  setD3DRenderState(D3DRS_ZENABLE, zEnable);
-  setD3DRenderState(D3DRS_ZWRITEENABLE, TRUE);
-  setD3DRenderState(D3DRS_ZFUNC, D3DCMP_LESSEQUAL);
-  setD3DRenderState(D3DRS_ALPHABLENDENABLE, blendEnable);
-  setD3DRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-  setD3DRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-  setD3DRenderState(D3DRS_AMBIENT, ambientLightColor);
-  setD3DRenderState(D3DRS_FOGENABLE, fogEnable);
-  setD3DRenderState(D3DRS_FOGCOLOR, fogColor);
-  setD3DRenderState(D3DRS_FOGTABLEMODE, D3DFOG_LINEAR);
-  setD3DRenderState(D3DRS_RANGEFOGENABLE, TRUE);
-  setD3DRenderState(D3DRS_FOGSTART, *(DWORD*)(&fogNear));
-  setD3DRenderState(D3DRS_FOGEND, *(DWORD*)(&fogFar));
-  setBackfaceMode(backfaceMode);
-  
-  setWireframe(wireframeOn);
-
-  //set a default sampler state
-
-  //setD3DSamplerState(D3DSAMP_MAXANISOTROPY, 16);
-  setD3DSamplerState(D3DSAMP_MINFILTER, D3DTEXF_ANISOTROPIC);
-  setD3DSamplerState(D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
-  setD3DSamplerState(D3DSAMP_MIPFILTER, D3DTEXF_LINEAR);
-
-	// Set texture wrapping mode
-	setD3DSamplerState(D3DSAMP_ADDRESSU , D3DTADDRESS_WRAP );
-  setD3DSamplerState(D3DSAMP_ADDRESSV , D3DTADDRESS_WRAP );
-
-	// Setup the material with the properties that we want
-	memset(&d3dMaterial, 0, sizeof(d3dMaterial));
-	d3dMaterial.Diffuse.r = 1.0f;
-	d3dMaterial.Diffuse.g = 1.0f;
-	d3dMaterial.Diffuse.b = 1.0f;
-	d3dMaterial.Diffuse.a = 1.0f;
-	d3dMaterial.Ambient = d3dMaterial.Diffuse;
-	d3dMaterial.Specular = d3dMaterial.Diffuse;
-	d3dMaterial.Power = 50.0f; // arbitrary
-
-	// Force upload of the D3D material
+  setBackendState(eRenderStateDepthEnable, zEnable);
+  setBackendState(eRenderStateDepthWrite, depthBufferWrite);
+  setBackendState(eRenderStateDepthRead, depthBufferRead);
+  setBackendState(eRenderStateBlendEnable, blendEnable);
+  setBackendState(eRenderStateSourceBlend, sourceBlendMode);
+  setBackendState(eRenderStateDestBlend, destBlendMode);
+  setBackendState(eRenderStateAmbient, ambientLightColor);
+  setBackendState(eRenderStateFogEnable, fogEnable);
+  setBackendState(eRenderStateFogColor, fogColor);
+  setBackendState(eRenderStateFogStart, floatBits(fogNear));
+  setBackendState(eRenderStateFogEnd, floatBits(fogFar));
+  setBackendState(eRenderStateCullMode, backfaceMode);
+  setBackendState(eRenderStateWireframe, wireframeOn);
+  setBackendState(eRenderStateLighting, renderStates[eRenderStateLighting]);
+  setBackendState(eRenderStateVertexAlpha, renderStates[eRenderStateVertexAlpha]);
+
+  // fog mode, texture filtering and wrapping, and the light switched on
+
+  countCall(eRenderCallState);
+  if (m_backend != NULL)
+    m_backend->setDefaultStates();
+
+	// Force upload of the material
 
 	constantARGB ^= 0xff000000; // force alpha portion to change
 	setOpacity(constantOpacity);
 
 	// Setup directional light
 
-	memset(&d3dDirectionalLight, 0, sizeof(d3dDirectionalLight));
-	d3dDirectionalLight.Type = D3DLIGHT_DIRECTIONAL;
-	d3dDirectionalLight.Diffuse.r = GET_R(directionalLightColor) / 255.0f;
-	d3dDirectionalLight.Diffuse.g = GET_G(directionalLightColor) / 255.0f;
-	d3dDirectionalLight.Diffuse.b = GET_B(directionalLightColor) / 255.0f;
-	d3dDirectionalLight.Diffuse.a = 0.0f;
-	d3dDirectionalLight.Specular = d3dDirectionalLight.Diffuse;
-	d3dDirectionalLight.Ambient.r = 0.0f;
-	d3dDirectionalLight.Ambient.g = 0.0f;
-	d3dDirectionalLight.Ambient.b = 0.0f;
-	d3dDirectionalLight.Ambient.a = 0.0f;
-	d3dDirectionalLight.Direction.x = directionalLightVector.x;
-	d3dDirectionalLight.Direction.y = directionalLightVector.y;
-	d3dDirectionalLight.Direction.z = directionalLightVector.z;
-	d3dDirectionalLight.Falloff = 1.0f;
-	d3dDirectionalLight.Theta = kPi;
-	d3dDirectionalLight.Phi = kPi;
-	setD3DDirectionalLight();
-
-	// Enable it
-	HRESULT result = pD3DDevice->LightEnable(0, TRUE);
-	assert(SUCCEEDED(result));
+	countCall(eRenderCallState);
+	if (m_backend != NULL) {
+		m_backend->setDirectionalLight(directionalLightVector, directionalLightColor);
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1225,40 +690,17 @@ void	Renderer::setCamera(const Vector3 &pos, const EulerAngles &orient) {
 
 	// Upload this to the rendering API, if we have been initted
 
-	if (pD3DDevice != NULL) {
-
-		// Convert our 4x3 matrix to D3D-style 4x4 matrix
-
-		D3DMATRIX	m;
-		m._11 = worldToCameraMatrix.m11;
-		m._12 = worldToCameraMatrix.m12;
-		m._13 = worldToCameraMatrix.m13;
-		m._14 = 0.0f;
-
-		m._21 = worldToCameraMatrix.m21;
-		m._22 = worldToCameraMatrix.m22;
-		m._23 = worldToCameraMatrix.m23;
-		m._24 = 0.0f;
-
-		m._31 = worldToCameraMatrix.m31;
-		m._32 = worldToCameraMatrix.m32;
-		m._33 = worldToCameraMatrix.m33;
-		m._34 = 0.0f;
-
-		m._41 = worldToCameraMatrix.tx;
-		m._42 = worldToCameraMatrix.ty;
-		m._43 = worldToCameraMatrix.tz;
-		m._44 = 1.0f;
-
-		// Tell D3D about it
-
-		HRESULT result = pD3DDevice->SetTransform(D3DTS_VIEW, &m);
-		assert(SUCCEEDED(result));
-	}
+	Matrix4x4	m;
+	toMatrix4x4(worldToCameraMatrix, &m);
+	setTransform(RenderBackend::eTransformView, m);
 
 	// The model->clip matrix must be recomputed, next time we need it
 
 	needToComputeModelToClipMatrix = true;
+
+	// So must the frustum
+
+	updateFrustum();
 }
 
 //---------------------------------------------------------------------------
@@ -1345,18 +787,10 @@ void	Renderer::setWindow(int x1, int y1, int xSize, int ySize) {
 	windowCenterX = (float)windowX1 + halfWindowSizeX;
 	windowCenterY = (float)windowY1 + halfWindowSizeY;
 
-	// Upload to the direct3D device, if we are ready
-
-	if (pD3DDevice != NULL) {
-		D3DVIEWPORT9 viewData;
-		viewData.X = x1;
-		viewData.Y = y1;
-		viewData.Width  = xSize;
-		viewData.Height = ySize;
-		viewData.MinZ = 0.0F;
-		viewData.MaxZ = 1.0F;
-		HRESULT result = pD3DDevice->SetViewport(&viewData);
-		assert(SUCCEEDED(result));
+	// Upload to the device, if we are ready
+
+	if (m_backend != NULL) {
+		m_backend->setViewport(x1, y1, xSize, ySize);
 	}
 
 	// Since the window proportions may have changed, the clip
@@ -1513,6 +947,32 @@ void	Renderer::instancePop() {
 //
 /////////////////////////////////////////////////////////////////////////////
 
+//---------------------------------------------------------------------------
+// Renderer::setRenderState
+// Renderer::getRenderState
+//
+// Sets or gets one of the render states by its enum.  This is for states
+// that have no setter of their own, like the lighting and vertex alpha
+// that the particles change for a while and put back.  A state is only
+// sent to the device if it changes.  The states with setters of their own
+// should go through those, which keep their members up to date.
+
+/// \param state The state
+/// \param value Its value, see ERenderState for what each takes
+void	Renderer::setRenderState(ERenderState state, unsigned value) {
+	assert(state >= 0 && state < eRenderStateCount);
+	if (renderStates[state] != value) {
+		setBackendState(state, value);
+	}
+}
+
+/// \param state The state
+/// \return The value last set
+unsigned	Renderer::getRenderState(ERenderState state) const {
+	assert(state >= 0 && state < eRenderStateCount);
+	return renderStates[state];
+}
+
 //---------------------------------------------------------------------------
 // Renderer::setDepthBufferMode
 //
@@ -1540,14 +1000,14 @@ void	Renderer::setDepthBufferMode(bool readEnabled, bool writeEnabled) {
 
 	if (depthBufferRead != readEnabled) {
 		depthBufferRead = readEnabled;
-		setD3DRenderState(D3DRS_ZFUNC, readEnabled ? D3DCMP_LESSEQUAL : D3DCMP_ALWAYS);
+		setBackendState(eRenderStateDepthRead, readEnabled);
 	}
 
 	// Check if write mode changing
 
 	if (depthBufferWrite != writeEnabled) {
 		depthBufferWrite = writeEnabled;
-		setD3DRenderState(D3DRS_ZWRITEENABLE, writeEnabled);
+		setBackendState(eRenderStateDepthWrite, writeEnabled);
 	}
 }
 
@@ -1576,9 +1036,9 @@ void	Renderer::setBlendEnable(bool blend) {
 
 		blendEnable = blend;
 
-		// Set state to D3D
+		// Set state to the device
 
-		setD3DRenderState(D3DRS_ALPHABLENDENABLE, blend);
+		setBackendState(eRenderStateBlendEnable, blend);
 	}
 }
 
@@ -1655,26 +1115,9 @@ void	Renderer::setSourceBlendMode(ESourceBlendMode mode) {
 
 		sourceBlendMode = mode;
 
-		// Map our enum to D3D enum
-
-		D3DBLEND b;
-		switch (mode) {
-			default:
-				assert(false);
-			case eSourceBlendModeSrcAlpha:
-				b = D3DBLEND_SRCALPHA;
-				break;
-			case eSourceBlendModeOne:
-				b = D3DBLEND_ONE;
-				break;
-			case eSourceBlendModeZero:
-				b = D3DBLEND_ZERO;
-				break;
-		}
-
-		// Set state to D3D
+		// Set state to the device, which maps our enum to its own
 
-		setD3DRenderState(D3DRS_SRCBLEND, b);
+		setBackendState(eRenderStateSourceBlend, mode);
 	}
 }
 
@@ -1689,29 +1132,9 @@ void	Renderer::setDestBlendMode(EDestBlendMode mode) {
 
 		destBlendMode = mode;
 
-		// Map our enum to D3D enum
-
-		D3DBLEND b;
-		switch (mode) {
-			default:
-				assert(false);
-			case eDestBlendModeInvSrcAlpha:
-				b = D3DBLEND_INVSRCALPHA;
-				break;
-			case eDestBlendModeOne:
-				b = D3DBLEND_ONE;
-				break;
-			case eDestBlendModeZero:
-				b = D3DBLEND_ZERO;
-				break;
-			case eDestBlendModeSrcColor:
-				b = D3DBLEND_SRCCOLOR;
-				break;
-		}
-
-		// Set state to D3D
+		// Set state to the device, which maps our enum to its own
 
-		setD3DRenderState(D3DRS_DESTBLEND, b);
+		setBackendState(eRenderStateDestBlend, mode);
 	}
 }
 
@@ -1787,20 +1210,12 @@ void	Renderer::setOpacity(float a) {
 	constantOpacity = (float)newAlpha / 255.0f;
 	constantARGB = (newAlpha << 24) | (constantARGB & 0x00ffffff);
 
-	// Set the alpha values in the D3D Material
-
-	d3dMaterial.Diffuse.a = constantOpacity;
-	d3dMaterial.Ambient.a = constantOpacity;
-	d3dMaterial.Specular.a = constantOpacity;
-
-	// Tell D3D
+	// Set the alpha of the material
 
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
+	countCall(eRenderCallState);
+	if (m_backend != NULL) {
+		m_backend->setMaterialOpacity(constantOpacity);
 	}
-	HRESULT result = pD3DDevice->SetMaterial(&d3dMaterial);
-	assert(SUCCEEDED(result));
 }
 
 //---------------------------------------------------------------------------
@@ -1819,9 +1234,13 @@ void	Renderer::setFogEnable(bool flag) {
 
 		fogEnable = flag;
 
-		// Set state to D3D
+		// Set state to the device
+
+		setBackendState(eRenderStateFogEnable, flag);
+
+		// Fog moves the far plane of the frustum
 
-		setD3DRenderState(D3DRS_FOGENABLE, flag);
+		updateFrustum();
 	}
 
 }
@@ -1850,9 +1269,9 @@ void	Renderer::setFogColor(unsigned rgb) {
 
 		fogColor = rgb;
 
-		// Set state to D3D
+		// Set state to the device
 
-		setD3DRenderState(D3DRS_FOGCOLOR, rgb);
+		setBackendState(eRenderStateFogColor, rgb);
 	}
 }
 
@@ -1878,9 +1297,9 @@ void	Renderer::setFogDistance(float nearFog, float farFog) {
 
 		fogNear = nearFog;
 
-		// Update to D3D
+		// Update to the device
 
-		setD3DRenderState(D3DRS_FOGSTART, *(DWORD*)(&nearFog));
+		setBackendState(eRenderStateFogStart, floatBits(nearFog));
 	}
 
 	// Check if far value changing
@@ -1891,9 +1310,9 @@ void	Renderer::setFogDistance(float nearFog, float farFog) {
 
 		fogFar = farFog;
 
-		// Update to D3D
+		// Update to the device
 
-		setD3DRenderState(D3DRS_FOGEND, *(DWORD*)(&farFog));
+		setBackendState(eRenderStateFogEnd, floatBits(farFog));
 
 		// Re-compute the clip matrix.  We pre-compute
 		// the far value in clip coordinates for outcode
@@ -1930,9 +1349,9 @@ void	Renderer::setAmbientLightColor(unsigned rgb) {
 
 		ambientLightColor = rgb;
 
-		// Set state to D3D
+		// Set state to the device
 
-		setD3DRenderState(D3DRS_AMBIENT, rgb);
+		setBackendState(eRenderStateAmbient, rgb);
 	}
 }
 
@@ -1967,15 +1386,12 @@ void	Renderer::setDirectionalLightVector(const Vector3 &v) {
 
 		directionalLightVector = v;
 
-		// Set light vector in D3D light struct
+		// Set it to the device
 
-		d3dDirectionalLight.Direction.x = directionalLightVector.x;
-		d3dDirectionalLight.Direction.y = directionalLightVector.y;
-		d3dDirectionalLight.Direction.z = directionalLightVector.z;
-
-		// Set it to D3D
-
-		setD3DDirectionalLight();
+		countCall(eRenderCallState);
+		if (m_backend != NULL) {
+			m_backend->setDirectionalLight(directionalLightVector, directionalLightColor);
+		}
 	}
 }
 
@@ -2002,17 +1418,12 @@ void	Renderer::setDirectionalLightColor(unsigned rgb) {
 
 		directionalLightColor = rgb;
 
-		// Put color into diffuse and specular channels of
-		// D3D light struct
-
-		d3dDirectionalLight.Diffuse.r = GET_R(directionalLightColor) / 255.0f;
-		d3dDirectionalLight.Diffuse.g = GET_G(directionalLightColor) / 255.0f;
-		d3dDirectionalLight.Diffuse.b = GET_B(directionalLightColor) / 255.0f;
-		d3dDirectionalLight.Specular = d3dDirectionalLight.Diffuse;
+		// Set it to the device
 
-		// Set it to D3D
-
-		setD3DDirectionalLight();
+		countCall(eRenderCallState);
+		if (m_backend != NULL) {
+			m_backend->setDirectionalLight(directionalLightVector, directionalLightColor);
+		}
 	}
 }
 
@@ -2041,7 +1452,7 @@ void	Renderer::setLightEnable(bool flag) {
 
 	lightEnable = flag;
 
-	// Note: we not apply this state directly to D3D.
+	// Note: we not apply this state directly to the device.
 	// For some reason, D3D allows you to "enable" lighting,
 	// even if your vertices are already prelit and don't
 	// have a normal.  Sort of stupid.  So we must manually
@@ -2060,7 +1471,7 @@ void	Renderer::setLightEnable(bool flag) {
 void	Renderer::setZBufferEnable(bool flag)
 {
 	zEnable = flag;
-	setD3DRenderState(D3DRS_ZENABLE, flag);
+	setBackendState(eRenderStateDepthEnable, flag);
 
 
 	return;
@@ -2094,26 +1505,9 @@ void	Renderer::setBackfaceMode(EBackfaceMode mode) {
 
 		backfaceMode = mode;
 
-		// Map our enum to D3D enum
-
-		D3DCULL c;
-		switch (mode) {
-			default:
-				assert(false);
-			case eBackfaceModeCCW:
-				c = D3DCULL_CCW;
-				break;
-			case eBackfaceModeCW:
-				c = D3DCULL_CW;
-				break;
-			case eBackfaceModeDisable:
-				c = D3DCULL_NONE;
-				break;
-		}
-
-		// Set state to D3D
+		// Set state to the device, which maps our enum to its own
 
-		setD3DRenderState(D3DRS_CULLMODE, c);
+		setBackendState(eRenderStateCullMode, mode);
 	}
 
 }
@@ -2133,11 +1527,12 @@ void	Renderer::selectTexture(int handle, int stage) {
   if (handle < 0 || handle >= (int)textureCacheList.size()) 
   {  
 
-    if (stage >= 0 && stage < 8)
-		pD3DDevice->SetTexture(stage, NULL);
+    countCall(eRenderCallTexture);
+    if (stage >= 0 && stage < 8 && m_backend != NULL)
+      m_backend->selectTexture(stage, NULL);
 
-		return;
-	}
+    return;
+  }
 
 	// Check if state is changing
 
@@ -2150,7 +1545,7 @@ void	Renderer::selectTexture(int handle, int stage) {
 
 		// Make sure texture exists
 
-		if (t->d3dTexture == NULL) {
+		if (t->texture == NULL) {
 			assert(false);
 			return;
 		}
@@ -2159,11 +1554,10 @@ void	Renderer::selectTexture(int handle, int stage) {
 
 		currentTextureHandle = handle;
 
-		// Select it in D3D
+		// Select it
 
-		assert(pD3DDevice != NULL);
-		HRESULT result = pD3DDevice->SetTexture(stage, t->d3dTexture);
-		assert(SUCCEEDED(result));
+		countCall(eRenderCallTexture);
+		m_backend->selectTexture(stage, t->texture);
 	}
 }
 
@@ -2202,11 +1596,14 @@ void	Renderer::selectTexture(TextureReference &texture) {
 /// \param plane array of 4 floats that represent a plane
 void Renderer::setClipPlane(const Plane &plane)
 {
-  pD3DDevice->SetRenderState(D3DRS_CLIPPING, true);
-  pD3DDevice->SetRenderState(D3DRS_CLIPPLANEENABLE, D3DCLIPPLANE0);
-
   clipPlane = plane;
-  pD3DDevice->SetClipPlane(0,clipPlane);
+
+  countCall(eRenderCallState, 3);
+  if (m_backend != NULL)
+    m_backend->setClipPlane(&clipPlane);
+
+  // nothing on the far side of the plane can be seen either
+  frustum.setUserPlane(clipPlane);
 
   
   
@@ -2231,9 +1628,11 @@ void Renderer::getClipPlane(Plane* plane)
 // disables the clipping plane
 void Renderer::disableClipPlane()
 {
-  pD3DDevice->SetRenderState(D3DRS_CLIPPING, false);
-  pD3DDevice->SetRenderState(D3DRS_CLIPPLANEENABLE, 0);// D3DCLIPPLANE0);
+  countCall(eRenderCallState, 2);
+  if (m_backend != NULL)
+    m_backend->setClipPlane(NULL);
   clipPlaneEnable = false;
+  frustum.clearUserPlane();
 }
 
 //---------------------------------------------------------------------------
@@ -2248,33 +1647,10 @@ void Renderer::disableClipPlane()
 void	Renderer::setTextureClamp(bool flag) {
 	
 
-	// Safety check - make sure we have a device
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
-	}
-
-	// Check if state changing
-
-	if (textureClamp != flag) {
-
-		// Remember new state
-
-		textureClamp = flag;
-
-		// Figure out D3D addressing mode to use
-
-		D3DTEXTUREADDRESS m = flag ? D3DTADDRESS_CLAMP : D3DTADDRESS_WRAP;
-
-		// Set state to D3D for both U and V
+	// Remember new state.  Clamping was never sent to the device
 
     //TODO: Update to DirectX 9 from DirectX 8
-		//result = pD3DDevice->SetTextureStageState(0, D3DTSS_ADDRESSU, m);
-		//assert(SUCCEEDED(result));
-		//result = pD3DDevice->SetTextureStageState(0, D3DTSS_ADDRESSV, m);
-		//assert(SUCCEEDED(result));
-	}
+	textureClamp = flag;
 }
 
 //---------------------------------------------------------------------------
@@ -2287,11 +1663,12 @@ void	Renderer::setTextureClamp(bool flag) {
 void Renderer::setRenderTarget(int textureHandle)
 {
 	TextureCacheEntry *tr;
-		
+
+	countCall(eRenderCallState);
 	if (textureHandle == -1) // set to starting render target
 	{
-    pD3DDevice->SetRenderTarget(0, pOriginalBackBuffer);      
-    pD3DDevice->SetDepthStencilSurface(pOriginalDepthStencil);
+    if (m_backend != NULL)
+      m_backend->setRenderTarget(NULL);
 		renderTargetHandle = -1;      	
     return;
 	}
@@ -2308,21 +1685,9 @@ void Renderer::setRenderTarget(int textureHandle)
 
   if (tr == NULL) return;
 	
-  // if there isn't a surface object for the texture, get one.
-  if (tr->d3dLockedSurface == NULL)
-	  tr->d3dTexture->GetSurfaceLevel(0,&tr->d3dLockedSurface);
-
-  // set the depth stencil if there is one
-  if (tr->d3dDepthBuffer != NULL)
-    pD3DDevice->SetDepthStencilSurface(tr->d3dDepthBuffer);
-  else
-    pD3DDevice->SetDepthStencilSurface(pOriginalDepthStencil);
-	
-	//Set the render target to the texture		
-	HRESULT hr = pD3DDevice->SetRenderTarget(0, tr->d3dLockedSurface);
-
-	// assert if setting the target failed
-	assert(SUCCEEDED(hr));
+	//Set the render target to the texture, and its depth buffer if it
+	//has one
+	m_backend->setRenderTarget(tr->texture);
 
 	// save what the render target is set to
 	renderTargetHandle = textureHandle;
@@ -2348,10 +1713,10 @@ void Renderer::setRenderTarget(int textureHandle)
 /// \see kClearFrameBuffer, kClearDepthBuffer, kClearToConstantColor, kClearToFogColor
 void	Renderer::clear(int options) {
 
-	// Make sure we have a device
+	// Count it, and make sure we have a device
 
-	if (pD3DDevice == NULL) {
-		assert(false);
+	countCall(eRenderCallDraw);
+	if (m_backend == NULL) {
 		return;
 	}
 
@@ -2379,27 +1744,13 @@ void	Renderer::clear(int options) {
 
 	frameBufferARGB &= 0x00ffffff;
 
-	// Figure out what to clear
-
-	DWORD	clearWhat = 0;
-	if (options & kClearFrameBuffer) {
-		clearWhat |= D3DCLEAR_TARGET;
-	}
-	if (options & kClearDepthBuffer) {
-		clearWhat |= D3DCLEAR_ZBUFFER;
-	}
-
 	// Clear it
 
-	HRESULT result = pD3DDevice->Clear(
-		0,
-		NULL,
-		clearWhat,
-		frameBufferARGB,
-		1.0F,
-		0
+	m_backend->clear(
+		(options & kClearFrameBuffer) != 0,
+		(options & kClearDepthBuffer) != 0,
+		frameBufferARGB
 	);
-	assert(SUCCEEDED(result));
 }
 
 //---------------------------------------------------------------------------
@@ -2430,7 +1781,6 @@ void	Renderer::clear(int options) {
 /// \param triList Array of triangles to draw
 /// \param triCount The number of triangles in the list
 void	Renderer::renderTriMesh(const RenderVertex *vertexList, int vertexCount, const RenderTri *triList, int triCount) {
-	HRESULT result;
 
 	// Make sure we have something to render
 
@@ -2438,39 +1788,32 @@ void	Renderer::renderTriMesh(const RenderVertex *vertexList, int vertexCount, co
 		return;
 	}
 
-	// Make sure we have a device
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
-	}
-  
   // Count triangles rendered
 
   nTriangleFrameCount += triCount;
+  countCall(eRenderCallDraw);
 
 	// Enable lighting, if user has enabled it
 
-	setD3DRenderState(D3DRS_LIGHTING, lightEnable);
+	setBackendState(eRenderStateLighting, lightEnable);
 
-	// Set the vertex shader using a flexible vertex format
+	// Make sure we have a device
 
-	result = pD3DDevice->SetFVF(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1);
-	assert(SUCCEEDED(result));
+	if (m_backend == NULL) {
+		return;
+	}
 
 	// Render it using "user pointer" data
 
-	result = pD3DDevice->DrawIndexedPrimitiveUP(
-		D3DPT_TRIANGLELIST,
-		0,
-		vertexCount,
-		triCount,
-		triList,
-		D3DFMT_INDEX16,
+	m_backend->drawUser(
+		RenderBackend::ePrimitiveTriangleList,
+		RenderVertex::FVF,
 		vertexList,
-		sizeof(vertexList[0])
+		vertexCount,
+		sizeof(vertexList[0]),
+		&triList[0].index[0],
+		triCount
 	);
-	assert(SUCCEEDED(result));
 }
 
 
@@ -2480,7 +1823,6 @@ void	Renderer::renderTriMesh(const RenderVertex *vertexList, int vertexCount, co
 /// \param triList Array of triangles to draw
 /// \param triCount The number of triangles in the list
 void	Renderer::renderTriMesh(const RenderVertexL *vertexList, int vertexCount, const RenderTri *triList, int triCount) {
-	HRESULT result;
 
 	// Make sure we have something to render
 
@@ -2488,45 +1830,40 @@ void	Renderer::renderTriMesh(const RenderVertexL *vertexList, int vertexCount, c
 		return;
 	}
 
-	// Make sure we have a device
-
-	if (pD3DDevice == NULL) {
-		assert(false);
-		return;
-	}
-
   // Count triangles rendered
 
   nTriangleFrameCount += triCount;
+  countCall(eRenderCallDraw);
 
-	// These are pre-lit vertices.  Disable D3D lighting
+	// These are pre-lit vertices.  Disable lighting
 
-	setD3DRenderState(D3DRS_LIGHTING, FALSE);
+	setBackendState(eRenderStateLighting, false);
 
-	// Set the vertex shader using a flexible vertex format
+	// Make sure we have a device
 
-	result = pD3DDevice->SetFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1);
-	assert(SUCCEEDED(result));
+	if (m_backend == NULL) {
+		return;
+	}
 
 	// Render it using "user pointer" data
 
-	result = pD3DDevice->DrawIndexedPrimitiveUP(
-		D3DPT_TRIANGLELIST,
-		0,
-		vertexCount,
-		triCount,
-		triList,
-		D3DFMT_INDEX16,
+	m_backend->drawUser(
+		RenderBackend::ePrimitiveTriangleList,
+		RenderVertexL::FVF,
 		vertexList,
-		sizeof(vertexList[0])
+		vertexCount,
+		sizeof(vertexList[0]),
+		&triList[0].index[0],
+		triCount
 	);
-	assert(SUCCEEDED(result));
 }
 
 /// \param box Specifies the box to be rendered.
 void Renderer::renderBoundingBox(const AABB3 &box)
 {
-  assert(pD3DDevice != NULL);
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
   static const unsigned short indices[] = {0,1,1,2,2,3,3,0,4,5,5,6,6,7,7,4,0,4,1,5,2,6,3,7};
   RenderVertex0L vertices[8];
@@ -2541,49 +1878,33 @@ void Renderer::renderBoundingBox(const AABB3 &box)
   for(int i = 0; i < 8; ++i)
     vertices[i].argb = constantARGB;
 
-  setD3DRenderState(D3DRS_LIGHTING, FALSE);
-  HRESULT result = pD3DDevice->SetFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE);
-  assert(SUCCEEDED(result));
-  result = pD3DDevice->DrawIndexedPrimitiveUP(
-    D3DPT_LINELIST,
-    0,
+  setBackendState(eRenderStateLighting, false);
+  m_backend->drawUser(
+    RenderBackend::ePrimitiveLineList,
+    kVertexFormatXYZ | kVertexFormatDiffuse,
+    vertices,
     8,
-    12,
+    sizeof(vertices[0]),
     indices,
-    D3DFMT_INDEX16,
-    vertices,
-    sizeof(vertices[0]));
-  assert(SUCCEEDED(result));
-  setD3DRenderState(D3DRS_LIGHTING, TRUE);
+    12);
+  setBackendState(eRenderStateLighting, true);
 }
 
 void Renderer::render(VertexBufferBase *vb, IndexBuffer *ib)
 {
   // record number of triangles that are rendered
   nTriangleFrameCount += ib->m_count;
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
-  HRESULT hres;
-  // give DX our indices
-  if(ib->m_dxBuffer != curIndexBuffer)
-  {
-    hres = pD3DDevice->SetIndices(ib->m_dxBuffer);
-    curIndexBuffer = ib->m_dxBuffer;
-  }
-
-  // give DX our vertices
-  if(vb->m_dxBuffer != curVertexBuffer)
-  {
-    hres = pD3DDevice->SetStreamSource(0, vb->m_dxBuffer, 0, vb->m_vertexStride);
-    curVertexBuffer = vb->m_dxBuffer;
-  }
-
-  // tell DX our desired vertex format
-  hres = pD3DDevice->SetFVF(vb->m_FVF);
-
-  // draw our geometry
-  hres = pD3DDevice->DrawIndexedPrimitive(
-    D3DPT_TRIANGLELIST,
-    0,
+  // draw our geometry; the backend only hands the device buffers it
+  // doesn't already have
+  m_backend->drawIndexed(
+    vb->m_buffer,
+    vb->m_FVF,
+    vb->m_vertexStride,
+    ib->m_buffer,
     0,
     vb->m_count,
     0,
@@ -2594,29 +1915,17 @@ void Renderer::render(VertexBufferBase *vb, int vertCount, IndexBuffer *ib, int
 {
   // record number of triangles that are rendered
   nTriangleFrameCount += triCount;
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
-  HRESULT hres;
-  // give DX our indices
-  if(ib->m_dxBuffer != curIndexBuffer)
-  {
-    hres = pD3DDevice->SetIndices(ib->m_dxBuffer);
-    curIndexBuffer = ib->m_dxBuffer;
-  }
-
-  // give DX our vertices
-  if(vb->m_dxBuffer != curVertexBuffer)
-  {
-    hres = pD3DDevice->SetStreamSource(0, vb->m_dxBuffer, 0, vb->m_vertexStride);
-    curVertexBuffer = vb->m_dxBuffer;
-  }
-
-  // tell DX our desired vertex format
-  hres = pD3DDevice->SetFVF(vb->m_FVF);
-
-  // draw our geometry
-  hres = pD3DDevice->DrawIndexedPrimitive(
-    D3DPT_TRIANGLELIST,
-    0,
+  // draw our geometry; the backend only hands the device buffers it
+  // doesn't already have
+  m_backend->drawIndexed(
+    vb->m_buffer,
+    vb->m_FVF,
+    vb->m_vertexStride,
+    ib->m_buffer,
     0,
     vertCount,
     0,
@@ -2627,30 +1936,18 @@ void Renderer::render(VertexBufferBase *vb, int vertStart, int vertCount, IndexB
 {
   // record number of triangles that are rendered
   nTriangleFrameCount += triCount;
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
-  HRESULT hres;
-  // give DX our indices
-  if(ib->m_dxBuffer != curIndexBuffer)
-  {
-    hres = pD3DDevice->SetIndices(ib->m_dxBuffer);
-    curIndexBuffer = ib->m_dxBuffer;
-  }
-
-  // give DX our vertices
-  if(vb->m_dxBuffer != curVertexBuffer)
-  {
-    hres = pD3DDevice->SetStreamSource(0, vb->m_dxBuffer, 0, vb->m_vertexStride);
-    curVertexBuffer = vb->m_dxBuffer;
-  }
-
-  // tell DX our desired vertex format
-  hres = pD3DDevice->SetFVF(vb->m_FVF);
-
-  // draw our geometry
-  hres = pD3DDevice->DrawIndexedPrimitive(
-    D3DPT_TRIANGLELIST,
+  // draw our geometry; the backend only hands the device buffers it
+  // doesn't already have
+  m_backend->drawIndexed(
+    vb->m_buffer,
+    vb->m_FVF,
+    vb->m_vertexStride,
+    ib->m_buffer,
     vertStart,
-    0,
     vertCount,
     triStart * 3,
     triCount);
@@ -2660,21 +1957,15 @@ void Renderer::render(VertexBufferBase *vb)
 {
   // record number of triangles that are rendered
   nTriangleFrameCount += vb->m_count / 3;
-
-  HRESULT hres;
-  // give DX our vertices
-  if(vb->m_dxBuffer != curVertexBuffer)
-  {
-    hres = pD3DDevice->SetStreamSource(0, vb->m_dxBuffer, 0, vb->m_vertexStride);
-    curVertexBuffer = vb->m_dxBuffer;
-  }
-
-  // tell DX our desired vertex format
-  hres = pD3DDevice->SetFVF(vb->m_FVF);
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
   // draw our geometry
-  hres = pD3DDevice->DrawPrimitive(
-    D3DPT_TRIANGLELIST,
+  m_backend->draw(
+    vb->m_buffer,
+    vb->m_FVF,
+    vb->m_vertexStride,
     0,
     vb->m_count / 3);
 }
@@ -2683,21 +1974,15 @@ void Renderer::render(VertexBufferBase *vb, int vertCount)
 {
   // record number of triangles that are rendered
   nTriangleFrameCount += vertCount / 3;
-
-  HRESULT hres;
-  // give DX our vertices
-  if(vb->m_dxBuffer != curVertexBuffer)
-  {
-    hres = pD3DDevice->SetStreamSource(0, vb->m_dxBuffer, 0, vb->m_vertexStride);
-    curVertexBuffer = vb->m_dxBuffer;
-  }
-
-  // tell DX our desired vertex format
-  hres = pD3DDevice->SetFVF(vb->m_FVF);
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
   // draw our geometry
-  hres = pD3DDevice->DrawPrimitive(
-    D3DPT_TRIANGLELIST,
+  m_backend->draw(
+    vb->m_buffer,
+    vb->m_FVF,
+    vb->m_vertexStride,
     0,
     vertCount / 3);
 }
@@ -2706,21 +1991,15 @@ void Renderer::render(VertexBufferBase *vb, int vertStart, int vertCount)
 {
   // record number of triangles that are rendered
   nTriangleFrameCount += vertCount / 3;
-
-  HRESULT hres;
-  // give DX our vertices
-  if(vb->m_dxBuffer != curVertexBuffer)
-  {
-    hres = pD3DDevice->SetStreamSource(0, vb->m_dxBuffer, 0, vb->m_vertexStride);
-    curVertexBuffer = vb->m_dxBuffer;
-  }
-
-  // tell DX our desired vertex format
-  hres = pD3DDevice->SetFVF(vb->m_FVF);
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
 
   // draw our geometry
-  hres = pD3DDevice->DrawPrimitive(
-    D3DPT_TRIANGLELIST,
+  m_backend->draw(
+    vb->m_buffer,
+    vb->m_FVF,
+    vb->m_vertexStride,
     vertStart,
     vertCount / 3);
 }
@@ -2740,6 +2019,30 @@ int Renderer::GetTrianglesRenderedLastScene()
 
 }
 
+/// \return The number of objects drawn since the app started
+int Renderer::GetObjectsDrawn()
+{
+  return nObjectsDrawn;
+}
+
+/// \return The number of objects drawn since last page flip
+int Renderer::GetObjectsDrawnLastScene()
+{
+  return nObjectsDrawnFrame;
+}
+
+/// \return The number of objects culled since the app started
+int Renderer::GetObjectsCulled()
+{
+  return nObjectsCulled;
+}
+
+/// \return The number of objects culled since last page flip
+int Renderer::GetObjectsCulledLastScene()
+{
+  return nObjectsCulledFrame;
+}
+
 /// \param vertexList Array of vertices that form the geometry
 /// \param vertexCount The number of vertices in the array
 /// \param triList Array of triangles to draw
@@ -2747,7 +2050,6 @@ int Renderer::GetTrianglesRenderedLastScene()
 void	Renderer::renderTriMesh(const RenderVertexTL *vertexList, int vertexCount, const RenderTri *triList, int triCount) 
 {
   bool oldLight;
-	HRESULT result;
 
 	// Make sure we have something to render
 
@@ -2755,38 +2057,31 @@ void	Renderer::renderTriMesh(const RenderVertexTL *vertexList, int vertexCount,
 		return;
 	}
 
+  // Count triangles rendered
+  nTriangleFrameCount += triCount;
+  countCall(eRenderCallDraw);
+
 	// Make sure we have a device
 
-	if (pD3DDevice == NULL) {
-		assert(false);
+	if (m_backend == NULL) {
 		return;
 	}
 
-  // Count triangles rendered
-  nTriangleFrameCount += triCount;
-
   
-  // These are pre-lit vertices.  Disable D3D lighting
+  // These are pre-lit vertices.  Disable lighting
 	oldLight = getLightEnable();
   setLightEnable(false);
 
-	// Set the vertex shader using a flexible vertex format
-
-	result = pD3DDevice->SetFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
-	assert(SUCCEEDED(result));
-
 	// Render it using "user pointer" data
-	result = pD3DDevice->DrawIndexedPrimitiveUP(
-		D3DPT_TRIANGLELIST,
-		0,
-		vertexCount,
-		triCount,
-		triList,
-		D3DFMT_INDEX16,
+	m_backend->drawUser(
+		RenderBackend::ePrimitiveTriangleList,
+		RenderVertexTL::FVF,
 		vertexList,
-		sizeof(vertexList[0])
+		vertexCount,
+		sizeof(vertexList[0]),
+		&triList[0].index[0],
+		triCount
 	);
-	assert(SUCCEEDED(result));
 
   setLightEnable(oldLight);
 }
@@ -2801,7 +2096,6 @@ void	Renderer::renderTriMesh(const RenderVertexTL *vertexList, int vertexCount,
 void	Renderer::renderSprite(float width, float height)
 {
   
-	HRESULT result;
 	float sx, sy;
   bool oldLight;
 	
@@ -2809,25 +2103,21 @@ void	Renderer::renderSprite(float width, float height)
 	sx = width / 2.0f;
 	sy = height / 2.0f;
 
+	// add 2 triangles to the count
+	nTriangleFrameCount += 2;
+	countCall(eRenderCallDraw);
+
 	// Make sure we have a device
 
-	if (pD3DDevice == NULL) {
-		assert(false);
+	if (m_backend == NULL) {
 		return;
 	}
 
-	// add 2 triangles to the count
-	nTriangleFrameCount += 2;
-
   oldLight = getLightEnable();
   setLightEnable(false);
   
-	// Set the vertex shader using a flexible vertex format
-	result = pD3DDevice->SetFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
-	assert(SUCCEEDED(result));
-
 	RenderVertexTL VertexList[4];
-	short triList[6] = {0,1,2,0,2,3};
+	unsigned short triList[6] = {0,1,2,0,2,3};
 	
 	VertexList[0].p = Vector3(-sx,-sy,1.0f);	
 	VertexList[0].u = 0.0f;
@@ -2856,17 +2146,15 @@ void	Renderer::renderSprite(float width, float height)
 	}
 
 	// Render it using "user pointer" data
-	result = pD3DDevice->DrawIndexedPrimitiveUP(
-		D3DPT_TRIANGLELIST,
-		0,
+	m_backend->drawUser(
+		RenderBackend::ePrimitiveTriangleList,
+		RenderVertexTL::FVF,
+		VertexList,
 		4,
-		2,
+		sizeof(VertexList[0]),
 		triList,
-		D3DFMT_INDEX16,
-		VertexList,
-		sizeof(VertexList[0])
+		2
 	);
-	assert(SUCCEEDED(result));
 
   setLightEnable(oldLight);
   
@@ -2879,7 +2167,6 @@ void	Renderer::renderSprite(float width, float height)
 /// \param VertexList Array of vertices describing the corners of the sprite
 void	Renderer::renderSprite(RenderVertexTL* VertexList)
 {  
-	HRESULT result;
   bool oldLight;
 
 	if (!VertexList) 
@@ -2888,25 +2175,21 @@ void	Renderer::renderSprite(RenderVertexTL* VertexList)
 		return;
 	}
 	
+	// add 2 triangles to the count
+	nTriangleFrameCount += 2;
+	countCall(eRenderCallDraw);
+
 	// Make sure we have a device
 
-	if (pD3DDevice == NULL) {
-		assert(false);
+	if (m_backend == NULL) {
 		return;
 	}
 
-	// add 2 triangles to the count
-	nTriangleFrameCount += 2;
-
 	oldLight = getLightEnable();
   setLightEnable(false);
 
 
-	// Set the vertex shader using a flexible vertex format
-	result = pD3DDevice->SetFVF(D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1);
-	assert(SUCCEEDED(result));
-
-	short triList[6] = {0,1,2,0,2,3};
+	unsigned short triList[6] = {0,1,2,0,2,3};
 	
 	for (int a= 0; a < 4; a++)
 	{
@@ -2915,17 +2198,15 @@ void	Renderer::renderSprite(RenderVertexTL* VertexList)
 	}
 
 	// Render it using "user pointer" data
-	result = pD3DDevice->DrawIndexedPrimitiveUP(
-		D3DPT_TRIANGLELIST,
-		0,
+	m_backend->drawUser(
+		RenderBackend::ePrimitiveTriangleList,
+		RenderVertexTL::FVF,
+		VertexList,
 		4,
-		2,
+		sizeof(VertexList[0]),
 		triList,
-		D3DFMT_INDEX16,
-		VertexList,
-		sizeof(VertexList[0])
+		2
 	);
-	assert(SUCCEEDED(result));
   
   setLightEnable(oldLight);
 }
@@ -2949,23 +2230,21 @@ void Renderer::renderTextureOverScreen()
 void Renderer::renderQuad(RenderVertexL *quad)
 {
   assert(quad != NULL);
-  assert(pD3DDevice != NULL);
-  setD3DRenderState(D3DRS_LIGHTING, FALSE);
-  HRESULT result = pD3DDevice->SetFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1);
-  assert(SUCCEEDED(result));
-  static const short triList[6] = {0,1,2,2,3,0};
-  result = pD3DDevice->DrawIndexedPrimitiveUP(
-    D3DPT_TRIANGLELIST,
-    0,
+  countCall(eRenderCallDraw);
+  if (m_backend == NULL)
+    return;
+  setBackendState(eRenderStateLighting, false);
+  static const unsigned short triList[6] = {0,1,2,2,3,0};
+  m_backend->drawUser(
+    RenderBackend::ePrimitiveTriangleList,
+    RenderVertexL::FVF,
+    quad,
     4,
-    2,
+    sizeof(quad[0]),
     triList,
-    D3DFMT_INDEX16,
-    quad,
-    sizeof(quad[0])
+    2
   );  
-  assert(SUCCEEDED(result));
-  setD3DRenderState(D3DRS_LIGHTING, TRUE);
+  setBackendState(eRenderStateLighting, true);
 }
 
 //---------------------------------------------------------------------------
@@ -3063,16 +2342,16 @@ int	Renderer::calculateTextHeight(const char* text, int width, int fontHandle)
   FontCacheEntry* font = fontCacheList[fontHandle];
 	
 	// make sure all of our pointers are good
-	if (!font || !text) return 0;
-
+	if (!font || !text || font->font == NULL) return 0;
 
-	RECT boundRect;
+	IRectangle boundRect;
 	boundRect.left = 0; boundRect.top = 0;
 	boundRect.right = width;
 	boundRect.bottom = 0;	
 	
 	// calculate the rect and return
-	return font->d3dFont->DrawTextA(NULL,text,-1,&boundRect,DT_CALCRECT| DT_WORDBREAK,NULL);
+	return m_backend->drawText(font->font, text, boundRect,
+		RenderBackend::kTextMeasure | RenderBackend::kTextWrap, 0);
 }
 
 
@@ -3092,33 +2371,25 @@ void	Renderer::drawText(const char* text, IRectangle* boundary, ETextAlignMode a
 	// make sure all of our pointers are good
 	if (!font || !text || !boundary) return;
 
+	countCall(eRenderCallDraw);
+	if (font->font == NULL) return;
 
-	DWORD alignFormat;
-	D3DCOLOR color;
-	RECT boundRect;
+
+	unsigned alignFormat = RenderBackend::kTextLeft;
 
 	// figure out what type of alignment we want
 	switch (alignment)
 	{
-		case eTextAlignModeLeft:	{alignFormat = DT_LEFT;	}break;
-		case eTextAlignModeRight:	{alignFormat = DT_RIGHT;	}break;
-		case eTextAlignModeCenter:	{alignFormat = DT_CENTER;	}break;
-		case eTextAlignModeBottom: 	{alignFormat = DT_BOTTOM;	}break;
+		case eTextAlignModeLeft:	{alignFormat = RenderBackend::kTextLeft;	}break;
+		case eTextAlignModeRight:	{alignFormat = RenderBackend::kTextRight;	}break;
+		case eTextAlignModeCenter:	{alignFormat = RenderBackend::kTextCenter;	}break;
+		case eTextAlignModeBottom: 	{alignFormat = RenderBackend::kTextBottom;	}break;
 	};
 
-	// figure out the color
-	color = D3DCOLOR_ARGB(255,255,255,255);
-
-	// set up the bounding rectangle
-	boundRect.left = boundary->left ;
-	boundRect.right = boundary->right;
-	boundRect.top = boundary->top;
-	boundRect.bottom = boundary->bottom;
-
 	if (wrapText)
-		alignFormat = alignFormat | DT_WORDBREAK;
+		alignFormat = alignFormat | RenderBackend::kTextWrap;
 	
-  font->d3dFont->DrawTextA(NULL,text,-1,&boundRect,alignFormat,color);
+  m_backend->drawText(font->font, text, *boundary, alignFormat, MAKE_ARGB(255,255,255,255));
 	return;
 }
 
@@ -3136,12 +2407,11 @@ void Renderer::drawText(const char* text, int x, int y, int fontHandle)
 	
 	if (!font) return;
 
+	countCall(eRenderCallDraw);
+	if (font->font == NULL) return;
+
 	
-	D3DCOLOR color;
-	RECT boundRect;
-  	
-	// figure out the color
-	color = D3DCOLOR_ARGB(255,255,255,255);
+	IRectangle boundRect;
 
 	// set up the bounding rectangle
 	boundRect.left = x ;
@@ -3149,7 +2419,7 @@ void Renderer::drawText(const char* text, int x, int y, int fontHandle)
 	boundRect.top = y;
 	boundRect.bottom = 0;
 	
-  font->d3dFont->DrawTextA(NULL,text,-1,&boundRect,DT_NOCLIP | DT_LEFT,getARGB());
+  m_backend->drawText(font->font, text, boundRect, RenderBackend::kTextNoClip | RenderBackend::kTextLeft, getARGB());
   return;
 }
 
@@ -3162,7 +2432,6 @@ void Renderer::drawText(const char* text, int x, int y, int fontHandle)
 int Renderer::addFont(const char* fontName, int fontWidth, int fontHeight, bool antialiased)
 {
 	int index = 0;
-	HRESULT result;
   FontCacheEntry* font = NULL;
 
   int length = (int)fontCacheList.size();
@@ -3183,27 +2452,14 @@ int Renderer::addFont(const char* fontName, int fontWidth, int fontHeight, bool
     fontCacheList.resize(length + 1, font);
     index = length;
   }
+
+  // without a device the slot stays empty
+  countCall(eRenderCallCreate);
+  if (m_backend == NULL)
+    return index;
   
-	// First fill out a font description
-	D3DXFONT_DESC FontDesc ;   
-    memset( &FontDesc , 0 , sizeof(D3DXFONT_DESC) );
-
-	//SECURITY-UPDATE:2/3/07
-    //strcpy( FontDesc.FaceName , fontName);
-	strcpy_s( FontDesc.FaceName ,sizeof(FontDesc.FaceName), fontName);
-    FontDesc.Width  = fontWidth;
-    FontDesc.Height = fontHeight;   
-	FontDesc.OutputPrecision = 2;
-	FontDesc.PitchAndFamily = VARIABLE_PITCH;
-	
-	if (antialiased)
-		FontDesc.Quality = ANTIALIASED_QUALITY;
-	else
-		FontDesc.Quality = NONANTIALIASED_QUALITY;
-	FontDesc.Weight  = FW_BLACK;
-	
-  result = D3DXCreateFontIndirect(pD3DDevice , &FontDesc ,&font->d3dFont);
-	if (!SUCCEEDED(result)) {
+  font->font = m_backend->createFont(fontName, fontWidth, fontHeight, antialiased);
+	if (font->font == NULL) {
 			ABORT("Could not create font object");
 		}
 
@@ -3236,13 +2492,8 @@ void	Renderer::videoSave()
 
 void	Renderer::videoRestore()
 {
-  if(pD3DDevice != NULL)
-  {
-    if( FAILED(pD3DDevice->Reset(&presentParms)) )
-    {
-      ABORT("Failed to reset D3D device");
-    }
-  }
+  if (m_backend != NULL)
+    m_backend->resetDevice();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -3392,6 +2643,10 @@ int	Renderer::findTexture(const char *name) {
   return -1;
 }
 
+/// Largest width or height allocTexture() takes.  It's only checked in
+/// debug builds.
+static const int kMaxTextureSz = 4096;
+
 //---------------------------------------------------------------------------
 // Renderer::allocTexture
 //
@@ -3432,10 +2687,9 @@ int	Renderer::allocTexture(const char *name, int xSize, int ySize, bool renderTa
   
 
 	// Can't do this without a device
-	assert(pD3DDevice != NULL);
+	assert(m_backend != NULL);
 
 	// Verify texture size.  We require a power of two,
-	const DWORD kMaxTextureSz = 4096;
 	assert(xSize > 0);
 	assert(xSize <= kMaxTextureSz);
 	assert((xSize & (xSize-1)) == 0); // make sure it's a power of two
@@ -3454,7 +2708,7 @@ int	Renderer::allocTexture(const char *name, int xSize, int ySize, bool renderTa
 		t = textureCacheList[slot];
 		    
     // if the texture is there and the size is correct return the handle
-		if (t->d3dTexture != NULL && (t->xSize == xSize) && (t->ySize == ySize))
+		if ((t->texture != NULL) && (t->xSize == xSize) && (t->ySize == ySize))
     	return slot;
   }
 
@@ -3487,70 +2741,20 @@ int	Renderer::allocTexture(const char *name, int xSize, int ySize, bool renderTa
 	if (name != NULL) t->name = name;
 	t->xSize = xSize;
 	t->ySize = ySize;
-  t->d3dLockedSurface = NULL;
-
-	// compute usage
-	DWORD usage = D3DUSAGE_AUTOGENMIPMAP;
-	D3DPOOL pool = D3DPOOL_MANAGED;
-  UINT levels = 0;
+	t->renderTarget = renderTarget;
+	t->depthStencil = createDepthStencil;
 
-	if (renderTarget) 
-	{
-		usage = usage | D3DUSAGE_RENDERTARGET;
-		pool = D3DPOOL_DEFAULT;
-    levels = 1;
-    t->renderTarget = true;
-	}
+	// Allocate the texture, and its depth buffer if requested
 
-	// Allocate D3D texture
-	HRESULT result = pD3DDevice->CreateTexture(
-		xSize,			// width
-		ySize,			// height
-		levels,			// number of miplevels - zero for automatic mip-map generation
-		usage,	// usage - autogen mipmaps and maybe rendertarget
-		D3DFMT_A8R8G8B8,	// pixel format - we will only use 32-bit
-		pool,	// memory pool - we'll let D3D manage the textures so we don't have to "restore."
-		&t->d3dTexture,		// return pointer to texture interface object here
-		NULL // this parameter must be NULL
-	);
+	countCall(eRenderCallCreate);
+	t->texture = m_backend->createTexture(xSize, ySize, renderTarget, createDepthStencil);
   
 	// Check for failure.  We won't handle errors gracefully.
 
-	if (FAILED(result)) {
+	if (t->texture == NULL) {
 		ABORT("Can't allocate %dx%d 32-bit texture", xSize, ySize);
 	}
 
-  // Create a depth stencil if requested
-  if (createDepthStencil)
-  {
-    t->depthStencil = true;
-    // acceptable formats in order of preference
-    D3DFORMAT formats[] = {D3DFMT_D32, D3DFMT_D16};
-
-    for (int a = 0; a < 2; a++)
-    {  
-      result = 
-      pD3DDevice->CreateDepthStencilSurface(
-        xSize,
-        ySize,
-        formats[1],
-        D3DMULTISAMPLE_NONE,
-        NULL,
-        true,
-        &t->d3dDepthBuffer,
-        NULL
-        );
-
-      // leave if a buffer was successfully created
-      if (SUCCEEDED(result)) break;
-      
-    }
-    if (FAILED(result)) // if a depth buffer could not be created
-    {
-      ABORT("Can't create a depth buffer", xSize, ySize);
-    }
-  }
-
 	// Return "handle" to texture, which is simply the index into the list
 
 	return slot;
@@ -3603,7 +2807,6 @@ void Renderer::freeTexture(int handle)
 /// \param handle Handle to the texture to modify
 /// \param image Image data to store in the texture
 void	Renderer::setTextureImage(int handle, const unsigned *image) {
-	HRESULT result;
 
 	// Sanity check handle validity
 
@@ -3616,48 +2819,17 @@ void	Renderer::setTextureImage(int handle, const unsigned *image) {
 	TextureCacheEntry *t = textureCacheList[handle];
 
   // Make sure we have something allocated
-  if (t == NULL) assert(false);
-  if (t->d3dTexture == NULL) assert(false);
-		
-  // Lock the texture
-
-  D3DLOCKED_RECT	r;
-  result = t->d3dTexture->LockRect(
-    0,    // level
-    &r,   // resulting info is placed here
-    NULL, // rectangle to lock - we want the whole thing
-    0     // flags
-  );
-
-  // Check if we can't do it
-  if (FAILED(result)) 
+  if (t == NULL || t->texture == NULL)
   {
     assert(false);
     return;
   }
-		
-  // Copy in the data a row at a time
-
-  const unsigned char *srcPtr = (const unsigned char *)image;
-  unsigned char *destPtr = (unsigned char *)r.pBits;
-  int srcStride = t->xSize*4;
-  int destStride = r.Pitch;
-  for (int y = 0 ; y < t->ySize ; ++y)
-  {
-    // Copy the row
-
-    memcpy(destPtr, srcPtr, t->xSize*4);
-
-    // Advance pointers
-
-    srcPtr += srcStride;
-    destPtr += destStride;
-  }
 
-  // Unlock the surface
+  // Lock the texture, copy in the data and unlock it
 
-  result = t->d3dTexture->UnlockRect(0);
-  assert(SUCCEEDED(result));
+  countCall(eRenderCallLock);
+  if (!m_backend->setTextureImage(t->texture, image, t->xSize, t->ySize))
+    assert(false);
 }
 
 //---------------------------------------------------------------------------
@@ -3722,19 +2894,19 @@ int	Renderer::cacheTexture(const char *filename, bool defaultDirectory)
 
   // Auto generate mip levels
 
-  if ( !D3DCAPS2_CANAUTOGENMIPMAP || FAILED (pD3D -> CheckDeviceFormat ( 
-    D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, D3DFMT_X8R8G8B8, 
-    D3DUSAGE_AUTOGENMIPMAP, D3DRTYPE_TEXTURE, D3DFMT_X8R8G8B8)))
-      ABORT ( "Cannot create mipmap chain");
-
-  textureCacheList[slot]->d3dTexture->GenerateMipSubLevels();
+  m_backend->generateMipmaps(textureCacheList[slot]->texture);
 
 	// Return handle
 
 	return slot;
 }
 
-int Renderer::cacheTextureDX(const char *filename, bool defaultDirectory)
+/// \param filename Name of the file to cache, in any format the backend reads
+/// \param defaultDirectory wheter or not to load the texture from the
+/// default texture directory
+/// \param mipmaps False to load the top level only
+/// \return Handle to the texture cached, or -1 if it couldn't be loaded
+int Renderer::cacheTextureDX(const char *filename, bool defaultDirectory, bool mipmaps)
 {
   // Check if texture already loaded
   
@@ -3749,10 +2921,16 @@ int Renderer::cacheTextureDX(const char *filename, bool defaultDirectory)
   // TODO: fix this sketch
   // Fake allocate it
 	slot = allocTexture(filename, 1, 1);
-	// Replace with D3DX-loaded texture
-	textureCacheList[slot]->d3dTexture->Release();
-	HRESULT hresult = D3DXCreateTextureFromFile(pD3DDevice, filename, &(textureCacheList[slot]->d3dTexture));
-	assert(SUCCEEDED(hresult));
+
+	// Replace with the texture loaded from the file
+	TextureCacheEntry *t = textureCacheList[slot];
+	delete t->texture;
+	countCall(eRenderCallCreate);
+	t->texture = m_backend->loadTexture(filename, mipmaps);
+	if (t->texture == NULL) {
+		freeTexture(slot);
+		return -1;
+	}
 	return slot;
 }
 
@@ -3777,8 +2955,9 @@ void	Renderer::cacheTexture(TextureReference &texture) {
 		// Make sure the name is correct and the texture exists
 
 		if (
+      t != NULL &&
       (_stricmp(t->name.c_str(), texture.name) == 0) && 
-			(t->d3dTexture != NULL)
+			(t->texture != NULL)
 		) {
 
 			// Cache hit.  After textures are cached, this should
@@ -3868,6 +3047,47 @@ int	Renderer::computeOutCode(const Vector3 &p) {
 	return code;
 }
 
+//---------------------------------------------------------------------------
+// Renderer::isBoxVisible
+//
+// Test a box against the view frustum, and count it as drawn or culled.
+// See Frustum::isBoxVisible() for the plane mask and last plane.
+
+/// \param box Box in world space
+/// \param planeMask Planes left to test, see Frustum::isBoxVisible()
+/// \param lastPlane Plane to test first, see Frustum::isBoxVisible()
+/// \return True if the box may be visible or culling is disabled
+
+bool	Renderer::isBoxVisible(const AABB3 &box, unsigned *planeMask, int *lastPlane) {
+	if (frustumCulling && !frustum.isBoxVisible(box, planeMask, lastPlane)) {
+		++nObjectsCulledFrame;
+		return false;
+	}
+	++nObjectsDrawnFrame;
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// Renderer::isSphereVisible
+//
+// Same as isBoxVisible(), for a sphere
+
+/// \param center Center of the sphere in world space
+/// \param radius Radius of the sphere
+/// \param planeMask Planes left to test, see Frustum::isBoxVisible()
+/// \param lastPlane Plane to test first, see Frustum::isBoxVisible()
+/// \return True if the sphere may be visible or culling is disabled
+
+bool	Renderer::isSphereVisible(const Vector3 &center, float radius,
+	unsigned *planeMask, int *lastPlane) {
+	if (frustumCulling && !frustum.isSphereVisible(center, radius, planeMask, lastPlane)) {
+		++nObjectsCulledFrame;
+		return false;
+	}
+	++nObjectsDrawnFrame;
+	return true;
+}
+
 //---------------------------------------------------------------------------
 // Renderer::projectPoint
 //
@@ -3959,7 +3179,7 @@ int	Renderer::projectPoint(const Vector3 &p, Vector3 *result) {
 
 long Renderer::getTime()
 {
-  return GetTickCount();
+  return m_backend != NULL ? m_backend->getTime() : 0;
 
 }
 
@@ -4060,61 +3280,44 @@ void	Renderer::computeClipMatrix() {
 
 	farFogClipSpaceZ = fogFar * clipMatrix._33 + clipMatrix._43;
 
-	// Upload it to D3D, if we are initted
+	// Upload it to the device, if we are initted
   
-  //D3DXMatrixPerspectiveLH(&clipMatrix, (float)windowSizeX, (float)windowSizeY,nearClipPlane,farClipPlane);
-
-	if (pD3DDevice != NULL) {
-		HRESULT result = pD3DDevice->SetTransform(D3DTS_PROJECTION, &clipMatrix);
-		assert(SUCCEEDED(result));
-	}
+	setTransform(RenderBackend::eTransformProjection, clipMatrix);
 
 	// The model->clip matrix must be recomputed, next time we need it
 
 	needToComputeModelToClipMatrix = true;
-}
-
-// Called with the reference frame changes (the model->world matrix)
 
-void	Renderer::updateModelToWorldMatrix() {
-
-	// Upload this to the rendering API, if we have been initted
-
-	if (pD3DDevice != NULL) {
+	// So must the frustum
 
-		// Get shortcut to model->world matrix, depending on
-		// current nesting level
-
-		const Matrix4x3 *srcMatrix = &instanceStack[instanceStackPtr].modelToWorldMatrix;
-
-		// Convert our 4x3 matrix to D3D-style 4x4 matrix
+	updateFrustum();
+}
 
-		D3DMATRIX	m;
-		m._11 = srcMatrix->m11;
-		m._12 = srcMatrix->m12;
-		m._13 = srcMatrix->m13;
-		m._14 = 0.0f;
+//---------------------------------------------------------------------------
+// Renderer::updateFrustum
+//
+// Called when the camera, clip matrix or fog changes, to extract the view
+// frustum planes again.  Nothing beyond the far fog distance can be seen,
+// so with fog on the far plane is pulled in to match.
 
-		m._21 = srcMatrix->m21;
-		m._22 = srcMatrix->m22;
-		m._23 = srcMatrix->m23;
-		m._24 = 0.0f;
+void	Renderer::updateFrustum() {
+	Matrix4x4	m = clipMatrix;
+	if (fogEnable && fogFar < farClipPlane) {
+		m._33 = fogFar / (fogFar - nearClipPlane);
+		m._43 = nearClipPlane * fogFar / (nearClipPlane - fogFar);
+	}
+	frustum.setup(worldToCameraMatrix, &m._11);
+}
 
-		m._31 = srcMatrix->m31;
-		m._32 = srcMatrix->m32;
-		m._33 = srcMatrix->m33;
-		m._34 = 0.0f;
+// Called with the reference frame changes (the model->world matrix)
 
-		m._41 = srcMatrix->tx;
-		m._42 = srcMatrix->ty;
-		m._43 = srcMatrix->tz;
-		m._44 = 1.0f;
+void	Renderer::updateModelToWorldMatrix() {
 
-		// Tell D3D about it
+	// Upload this to the rendering API, if we have been initted
 
-		HRESULT result = pD3DDevice->SetTransform(D3DTS_WORLDMATRIX(0), &m);
-		assert(SUCCEEDED(result));
-	}
+	Matrix4x4	m;
+	toMatrix4x4(instanceStack[instanceStackPtr].modelToWorldMatrix, &m);
+	setTransform(RenderBackend::eTransformWorld, m);
 
 	// The model->clip matrix must be recomputed, next time we need it
 
@@ -4157,8 +3360,8 @@ void Renderer::freeAllTextures() {
 
 	// Make sure and deselect any texture
 
-	if (pD3DDevice != NULL)
-		pD3DDevice->SetTexture(0, NULL);
+	if (m_backend != NULL)
+		m_backend->selectTexture(0, NULL);
 	
 	currentTextureHandle = -1;
 
@@ -4177,10 +3380,7 @@ void Renderer::freeAllTextures() {
 void Renderer::setWireframe(bool On) {
 	wireframeOn = On;
   
-  if(wireframeOn)
-	  setD3DRenderState(D3DRS_FILLMODE,D3DFILL_WIREFRAME);
-  else 
-	  setD3DRenderState(D3DRS_FILLMODE,D3DFILL_SOLID);
+  setBackendState(eRenderStateWireframe, wireframeOn);
 }
 
 
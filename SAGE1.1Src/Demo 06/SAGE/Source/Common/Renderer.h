@@ -12,16 +12,17 @@
 #ifndef __RENDERER_H_INCLUDED__
 #define __RENDERER_H_INCLUDED__
 
-#include <d3d9.h>
 #include "vector3.h"
 #include "EulerAngles.h"
 #include "Matrix4x3.h"
 #include "Rectangle.h"
-#include "Plane.h"
+#include "plane.h"
+#include "Frustum.h"
 
 class AABB3;
 class VertexBufferBase;
 class IndexBuffer;
+class RenderBackend;
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -102,6 +103,59 @@ const int kRefreshRateFastest = -2; ///< Refresh as fast as possible (don't wait
 //@}
 //---------------------------------------------------------------------------
 
+/// Kinds of call the renderer counts.  See Renderer::getCallCount()
+enum ERenderCall
+{
+  eRenderCallDraw,    ///< Draw calls, including clears
+  eRenderCallState,   ///< Render and sampler state changes
+  eRenderCallTexture, ///< Texture selections
+  eRenderCallLock,    ///< Vertex buffer, index buffer and texture locks
+  eRenderCallCreate,  ///< Textures, fonts and buffers created
+  eRenderCallCount    ///< Number of kinds of call
+};
+
+/// \brief Render states the renderer keeps.  See Renderer::setRenderState()
+///
+/// Most of these are set through their own functions, such as
+/// setBlendEnable(), which is the better way; the rest are only needed by
+/// code drawing with its own states, like the particle batcher.  Booleans are
+/// 0 or 1, colors are 0xRRGGBB, distances are the bits of a float and the
+/// modes are the values of the renderer's own enums.
+enum ERenderState
+{
+  eRenderStateDepthEnable,  ///< Depth buffering at all
+  eRenderStateDepthRead,    ///< Depth test, or always pass
+  eRenderStateDepthWrite,   ///< Depth writes
+  eRenderStateBlendEnable,  ///< Alpha blending
+  eRenderStateSourceBlend,  ///< An ESourceBlendMode
+  eRenderStateDestBlend,    ///< An EDestBlendMode
+  eRenderStateAmbient,      ///< Ambient light color
+  eRenderStateFogEnable,    ///< Fog
+  eRenderStateFogColor,     ///< Fog color
+  eRenderStateFogStart,     ///< Fog near distance
+  eRenderStateFogEnd,       ///< Fog far distance
+  eRenderStateCullMode,     ///< An EBackfaceMode
+  eRenderStateWireframe,    ///< Wireframe rather than solid
+  eRenderStateLighting,     ///< Lighting of vertices with normals
+  eRenderStateVertexAlpha,  ///< Texture alpha times vertex alpha, rather than texture alpha alone
+  eRenderStateCount         ///< Number of render states
+};
+
+//---------------------------------------------------------------------------
+/// \name Vertex format flags
+/// What a vertex holds, in this order.  See the FVF of the vertex structs.
+/// These have the values of the Direct3D flags, so they can be passed
+/// straight on.
+//@{
+const unsigned kVertexFormatXYZ = 0x002;      ///< Untransformed position
+const unsigned kVertexFormatXYZRHW = 0x004;   ///< Screen position and one over w
+const unsigned kVertexFormatNormal = 0x010;   ///< Normal
+const unsigned kVertexFormatDiffuse = 0x040;  ///< Diffuse color
+const unsigned kVertexFormatSpecular = 0x080; ///< Specular color
+const unsigned kVertexFormatTex1 = 0x100;     ///< One set of texture coordinates
+//@}
+//---------------------------------------------------------------------------
+
 /// \brief Reserved texture handle
 //
 /// Special texture handle that is always reserved for the "white texture,"
@@ -190,7 +244,7 @@ struct RenderVertex
   Vector3	n;  ///< Normal
   float	u;    ///< Texture mapping coordinate
   float v;    ///< Texture mapping coordinate
-  static const DWORD FVF = D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1;
+  static const unsigned FVF = kVertexFormatXYZ | kVertexFormatNormal | kVertexFormatTex1;
 };
 
 /// \struct RenderVertexL
@@ -201,7 +255,7 @@ struct RenderVertexL
   unsigned argb;  ///< Prelit diffuse color
   float u;        ///< Texture mapping coordinate
   float v;        ///< Texture mapping coordinate
-  static const DWORD FVF = D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1;
+  static const unsigned FVF = kVertexFormatXYZ | kVertexFormatDiffuse | kVertexFormatTex1;
 };
 
 /// \struct RenderVertexTL
@@ -213,7 +267,7 @@ struct RenderVertexTL
   unsigned argb;  ///< Prelit diffuse color (8 bits per component - 0xAARRGGBB)
   float u;        ///< Texture mapping coordinate
   float v;        ///< Texture mapping coordinate
-  static const DWORD FVF = D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1;
+  static const unsigned FVF = kVertexFormatXYZRHW | kVertexFormatDiffuse | kVertexFormatTex1;
 };
 
 /// \struct RenderVertex0L
@@ -246,6 +300,16 @@ struct RenderTri
 {
   unsigned short index[3]; ///< Array of vertex indices forming the triangle
 };
+
+/// \struct RenderTri32
+/// \brief A single triangle for rendering, with 32-bit indices.
+///
+/// Only used for index buffers of models with too many vertices to address
+/// with RenderTri.  Meshes themselves always use RenderTri.
+struct RenderTri32
+{
+  unsigned int index[3]; ///< Array of vertex indices forming the triangle
+};
 //---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
@@ -276,7 +340,14 @@ public:
   //@{
 
   /// \brief Initializes the engine. Must be called once at program startup
-  void init(const VideoMode &mode, bool shaderDebug, bool windowed);
+  void init(RenderBackend *backend, const VideoMode &mode);
+
+  /// \brief Returns true if nothing is drawn, and there's no display
+  bool isHeadless() const;
+
+  /// \brief Gets the backend passed to init()
+  /// \return The backend, NULL before init() or after shutdown()
+  RenderBackend *getBackend() { return m_backend; }
   
   /// \brief Shuts down the engine. Must be called once at program shutdown
   void shutdown();
@@ -320,6 +391,33 @@ public:
   /// \brief Gets number of triangles rendered so far this frame
   int GetTrianglesRenderedLastScene();
 
+  /// \brief Gets number of objects that passed the frustum test
+  int GetObjectsDrawn();
+
+  /// \brief Gets number of objects that passed the frustum test this frame
+  int GetObjectsDrawnLastScene();
+
+  /// \brief Gets number of objects rejected by the frustum test
+  int GetObjectsCulled();
+
+  /// \brief Gets number of objects rejected by the frustum test this frame
+  int GetObjectsCulledLastScene();
+
+  /// \brief Counts calls made to the device, or that would have been
+  /// \param call The kind of call
+  /// \param n Number of calls
+  void countCall(ERenderCall call, int n = 1) { m_callCountFrame[call] += n; }
+
+  /// \brief Gets the number of calls of a kind made in the last frame
+  /// \param call The kind of call
+  /// \return Calls made between the last two page flips
+  int getCallCount(ERenderCall call) const { return m_callCountLastFrame[call]; }
+
+  /// \brief Gets the number of calls of a kind made since the app started
+  /// \param call The kind of call
+  /// \return Calls made up to the last page flip
+  int getCallTotal(ERenderCall call) const { return m_callCountTotal[call]; }
+
 
   //-------------------------------------------------------------------------
   /// \name Camera specifications
@@ -423,7 +521,7 @@ public:
   int cacheTexture(const char *filename, bool defaultDirectory = true);
   
   /// \brief Cache a texture
-  int cacheTextureDX(const char *filename, bool defaultDirectory = true);
+  int cacheTextureDX(const char *filename, bool defaultDirectory = true, bool mipmaps = true);
 
   /// \brief Slightly simpler texture cache access through the TextureReference class.  
   void	cacheTexture(TextureReference &texture);
@@ -434,12 +532,14 @@ public:
   /// \name Rendering context management functions
   //@{
 
-  /// \brief Returns true if shader debugging is on
-  /// \return True if shader debugging is on
-  bool getShaderDebug() {return m_shaderDebug;}
+  /// \brief Returns true if the device can draw with 32-bit indices
+  bool getSupports32BitIndices() const {return m_maxVertexIndex > 0xFFFF;}
+
+  /// \brief Set a render state
+  void setRenderState(ERenderState state, unsigned value);
 
-  /// \brief Returns true if the device was created in reference
-  bool getDeviceReference() {return m_deviceReference;}
+  /// \brief Get a render state
+  unsigned getRenderState(ERenderState state) const;
 
   /// \brief Set the depth buffer mode  
   void setDepthBufferMode(bool readEnabled, bool writeEnabled);
@@ -716,6 +816,25 @@ public:
 
   /// \brief Compute outcode and project point onto screen space, if possible  
   int projectPoint(const Vector3 &p, Vector3 *result);
+
+  /// \brief Get the view frustum in world space
+  /// \return The frustum of the current camera, fog and clipping plane
+  const Frustum &getFrustum() const { return frustum; }
+
+  /// \brief Test a box in world space against the view frustum
+  bool isBoxVisible(const AABB3 &box, unsigned *planeMask = NULL, int *lastPlane = NULL);
+
+  /// \brief Test a sphere in world space against the view frustum
+  bool isSphereVisible(const Vector3 &center, float radius,
+    unsigned *planeMask = NULL, int *lastPlane = NULL);
+
+  /// \brief Enable or disable frustum culling
+  /// \param flag If false, isBoxVisible() and isSphereVisible() always pass
+  void setFrustumCulling(bool flag) { frustumCulling = flag; }
+
+  /// \brief Get whether frustum culling is enabled
+  /// \return True if frustum culling is enabled
+  bool getFrustumCulling() const { return frustumCulling; }
   //@}
   //-------------------------------------------------------------------------
 
@@ -748,18 +867,27 @@ protected:
   //to count number of triangles rendered per frame
   int nTriangleFrameCount;
 
+  //to count objects drawn and culled, in total and per frame
+  int nObjectsDrawn;
+  int nObjectsDrawnFrame;
+  int nObjectsCulled;
+  int nObjectsCulledFrame;
+
+  //to count device calls, this frame, last frame and in total
+  int m_callCountFrame[eRenderCallCount];
+  int m_callCountLastFrame[eRenderCallCount];
+  int m_callCountTotal[eRenderCallCount];
+
+  /// What draws, NULL until init()
+  RenderBackend *m_backend;
+
 	// Full screen resolution
 
 	int	screenX;
 	int	screenY;
 
-  /// True means that shaders are created for debugging.  If this is true,
-  /// m_deviceReference must also be true because you can only debug a shader
-  /// that is created in software.
-  bool m_shaderDebug;
-
-  /// True means the device has been created in reference
-  bool m_deviceReference;
+  /// Largest vertex index the device can draw with
+  unsigned long m_maxVertexIndex;
 
 	// Camera specification
 
@@ -839,6 +967,11 @@ protected:
   bool clipPlaneEnable; ///< True if a clipping plane is enabled
   Plane clipPlane; ///< The clipping plane if there is one
 
+  // view frustum, kept in step with the camera, clip matrix, fog
+  // and clipping plane
+  Frustum frustum;
+  bool frustumCulling; ///< False to draw everything
+
 	// Current visual timestep, in seconds
 
 	float	timeStep;
@@ -852,6 +985,7 @@ protected:
 
 	void	updateModelToWorldMatrix();
 	void	computeClipMatrix();
+	void	updateFrustum();
 	void	getModelToClipMatrix();
 	void	freeAllTextures();
 };
@@ -860,10 +994,6 @@ protected:
 
 extern Renderer	gRenderer;
 
-// The global device, used to extend Renderer (defined in Renderer.cpp)
-
-extern LPDIRECT3DDEVICE9 pD3DDevice;
-
 /////////////////////////////////////////////////////////////////////////////
 #endif // #ifndef __RENDERER_H_INCLUDED__
 
@@ -3,16 +3,13 @@
 
 #include "TextureCacheEntry.h"
 #include "CommonStuff.h"
-extern LPDIRECT3DDEVICE9 pD3DDevice;
 
 TextureCacheEntry::TextureCacheEntry(bool isManaged)
 :ResourceBase(!isManaged)
 {
-  d3dTexture = NULL;
-  d3dLockedSurface = NULL;
-  renderTarget = NULL;
-  d3dDepthBuffer = NULL;
-  depthStencil = 0;
+  texture = NULL;
+  renderTarget = false;
+  depthStencil = false;
 
 }
 TextureCacheEntry::~TextureCacheEntry()
@@ -20,90 +17,22 @@ TextureCacheEntry::~TextureCacheEntry()
   release();
 }
 
+/// The size and flags are kept, so restore() can make it again.
 void TextureCacheEntry::release()
 {
-  if (d3dTexture)
-    d3dTexture->Release();
-
-  if (d3dLockedSurface)
-    d3dLockedSurface->Release();
-
-  if (d3dDepthBuffer)
-    d3dDepthBuffer->Release();
-
-  depthStencil = 0;
-  d3dDepthBuffer = NULL;
-  d3dTexture = NULL;
-  d3dLockedSurface = NULL;
-
-
+  delete texture;
+  texture = NULL;
 }
 
 void TextureCacheEntry::restore()
 {
+	// Allocate the texture, and its depth buffer if it had one
 
-	// compute usage
-	DWORD usage = D3DUSAGE_AUTOGENMIPMAP;
-	D3DPOOL pool = D3DPOOL_MANAGED;
-  UINT levels = 0;
-
-	if (renderTarget) 
-	{
-		usage = usage | D3DUSAGE_RENDERTARGET;
-		pool = D3DPOOL_DEFAULT;
-    levels = 1;   
-	}
-
-	// Allocate D3D texture
-	HRESULT result = pD3DDevice->CreateTexture(
-		xSize,			// width
-		ySize,			// height
-		levels,			// number of miplevels - zero for automatic mip-map generation
-		usage,	// usage - autogen mipmaps and maybe rendertarget
-		D3DFMT_A8R8G8B8,	// pixel format - we will only use 32-bit
-		pool,	// memory pool - we'll let D3D manage the textures so we don't have to "restore."
-		&d3dTexture,		// return pointer to texture interface object here
-		NULL // this parameter must be NULL
-	);
+	texture = gRenderer.getBackend()->createTexture(xSize, ySize, renderTarget, depthStencil);
 
 	// Check for failure.  We won't handle errors gracefully.
 
-	if (FAILED(result)) {
+	if (texture == NULL) {
 		ABORT("Can't allocate %dx%d 32-bit texture", xSize, ySize);
 	}
-
-
-
-  // Create a depth stencil if requested
-  if (depthStencil)
-  {
-    // acceptable formats in order of preference
-    D3DFORMAT formats[] = {D3DFMT_D32, D3DFMT_D16};
-
-    for (int a = 0; a < 2; a++)
-    {  
-      result = 
-      pD3DDevice->CreateDepthStencilSurface(
-        xSize,
-        ySize,
-        formats[1],
-        D3DMULTISAMPLE_NONE,
-        NULL,
-        true,
-        &d3dDepthBuffer,
-        NULL
-        );
-
-      // leave if a buffer was successfully created
-      if (SUCCEEDED(result)) break;
-      
-    }
-    if (FAILED(result)) // if a depth buffer could not be created
-    {
-      ABORT("Can't create a depth buffer", xSize, ySize);
-    }
-  }
-
-
-
-}
\ No newline at end of file
+}
@@ -4,8 +4,9 @@
 #ifndef __TEXTURECACHEENTRY_H_INCLUDED__
 #define __TEXTURECACHEENTRY_H_INCLUDED__
 
-#include <d3d9.h>
-#include "resource/ResourceBase.h"
+#include <string>
+#include "Graphics/RenderBackend.h"
+#include "Resource/ResourceBase.h"
 
 /// \brief Texture cache variables.  See the notes on Renderer::resetTextureCache()
 /// for more details.
@@ -23,21 +24,10 @@ public:
 
 	int	xSize, ySize;
 
-	// Direct3D interface object.  We're going to let D3D manage
-	// the memory
-
-	LPDIRECT3DTEXTURE9	d3dTexture; 
-
-  /// When using a texture as a render target, you must aquire a surface object from
-  /// the texture object.  You can then set the render target to that surface.
-  /// After rendering, you must release the surface object.  d3dLockedSurface
-  /// holds the surface object.  If it is NULL, the surface is not locked.
-  LPDIRECT3DSURFACE9 d3dLockedSurface;
-
-  /// If the texture is a rendertarget, a depth stencil may accompany it.  This
-  /// surface will act as a Z-Buffer for the rendertarget.
-  LPDIRECT3DSURFACE9 d3dDepthBuffer;
+	// The texture, as the backend made it.  Unless it's a render target,
+	// the device manages its memory
 
+	RenderBackend::Texture	*texture; 
 
   void release();
   void restore();
@@ -48,4 +38,4 @@ public:
 };
 
 
-#endif
\ No newline at end of file
+#endif
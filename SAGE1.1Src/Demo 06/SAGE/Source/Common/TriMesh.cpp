@@ -14,11 +14,216 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <vector>
 
 #include "CommonStuff.h"
 #include "TriMesh.h"
-#include "common/renderer.h"
+#include "Common/Renderer.h"
 #include "EditTriMesh.h"
+#include "Matrix4x3.h"
+
+/// Meshes whose convex hull has more vertices than this keep only their
+/// bounding box, so transformed bounds never cost more than this many
+/// vertex transforms.
+const int kMaxHullPoints = 64;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local helpers
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \brief One triangle of a convex hull under construction.
+struct HullFace {
+	int	v[3];      ///< Indices of the corners
+	Vector3	n;     ///< Outward unit normal
+	float	d;       ///< Plane distance, n * p for a point p on the plane
+};
+
+/// \brief Picks a coordinate of a vector by number, 0 for x through 2 for z.
+static float axisValue(const Vector3 &v, int axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+/// \brief Sets up a hull face, turned to face away from a point inside the hull.
+static HullFace makeHullFace(const RenderVertex *vList, int a, int b, int c, const Vector3 &inside) {
+	HullFace f;
+	f.v[0] = a; f.v[1] = b; f.v[2] = c;
+	f.n = Vector3::crossProduct(vList[b].p - vList[a].p, vList[c].p - vList[a].p);
+	f.n.normalize();
+	f.d = f.n * vList[a].p;
+	if (f.n * inside > f.d) {
+		f.v[1] = c; f.v[2] = b;
+		f.n = -f.n;
+		f.d = -f.d;
+	}
+	return f;
+}
+
+//---------------------------------------------------------------------------
+// findConvexHull
+//
+// Find the vertices of the convex hull of a vertex list, by the usual
+// incremental method: start with a tetrahedron, and for each point
+// outside the hull so far, replace the faces it can see with a fan from
+// the point to the edge of that region.  Runs once per mesh when its
+// bounding box is computed, so it doesn't have to be fast.
+//
+// Gives up if the mesh is flat, or if the hull has too many vertices to
+// be worth keeping.  Also checks its own answer, since a hull that leaves
+// out a vertex would give bounding boxes that are too small.
+
+/// \param vList Specifies the vertices.
+/// \param nVertexCount Specifies the number of vertices.
+/// \param box Specifies the bounding box of the vertices.
+/// \param hull Is filled with the indices of the hull vertices.
+/// \return true if the hull was found, false otherwise.
+static bool findConvexHull(const RenderVertex *vList, int nVertexCount,
+	const AABB3 &box, std::vector<int> &hull) {
+
+	hull.clear();
+	if (nVertexCount < 4) {
+		return false;
+	}
+
+	// Tolerance for "in front of a face," relative to the size of the mesh
+
+	Vector3	size = box.size();
+	float	eps = 1e-5f * (fabs(size.x) + fabs(size.y) + fabs(size.z));
+	if (eps <= 0.0f) {
+		return false;
+	}
+
+	// Start with the two vertices farthest apart along an axis
+
+	int	i0 = 0, i1 = 0;
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		int	lo = 0, hi = 0;
+		for (int i = 1 ; i < nVertexCount ; ++i) {
+			float	x = axisValue(vList[i].p, axis);
+			if (x < axisValue(vList[lo].p, axis)) lo = i;
+			if (x > axisValue(vList[hi].p, axis)) hi = i;
+		}
+		if (Vector3::distanceSquared(vList[lo].p, vList[hi].p) > Vector3::distanceSquared(vList[i0].p, vList[i1].p)) {
+			i0 = lo;
+			i1 = hi;
+		}
+	}
+
+	// Then the vertex farthest from the line through them, and the vertex
+	// farthest from the plane through all three
+
+	Vector3	dir = vList[i1].p - vList[i0].p;
+	dir.normalize();
+	int	i2 = i0;
+	float	best = 0.0f;
+	for (int i = 0 ; i < nVertexCount ; ++i) {
+		float	dist = Vector3::crossProduct(vList[i].p - vList[i0].p, dir).magnitude();
+		if (dist > best) { best = dist; i2 = i; }
+	}
+	if (best <= eps) {
+		return false;
+	}
+
+	Vector3	n = Vector3::crossProduct(vList[i1].p - vList[i0].p, vList[i2].p - vList[i0].p);
+	n.normalize();
+	int	i3 = i0;
+	best = 0.0f;
+	for (int i = 0 ; i < nVertexCount ; ++i) {
+		float	dist = fabs(n * (vList[i].p - vList[i0].p));
+		if (dist > best) { best = dist; i3 = i; }
+	}
+	if (best <= eps) {
+		return false;
+	}
+
+	// The middle of the tetrahedron stays inside the hull from here on,
+	// which settles which way each face points
+
+	Vector3	inside = (vList[i0].p + vList[i1].p + vList[i2].p + vList[i3].p) * 0.25f;
+
+	std::vector<HullFace>	faces;
+	faces.push_back(makeHullFace(vList, i0, i1, i2, inside));
+	faces.push_back(makeHullFace(vList, i0, i1, i3, inside));
+	faces.push_back(makeHullFace(vList, i0, i2, i3, inside));
+	faces.push_back(makeHullFace(vList, i1, i2, i3, inside));
+
+	// Add the rest of the vertices one at a time
+
+	std::vector<int>	edges; // pairs of indices
+	for (int i = 0 ; i < nVertexCount ; ++i) {
+		const Vector3	&p = vList[i].p;
+
+		// Pull out the faces this vertex can see, keeping their edges
+
+		edges.clear();
+		for (int f = 0 ; f < (int)faces.size() ; ) {
+			if (faces[f].n * p - faces[f].d > eps) {
+				for (int e = 0 ; e < 3 ; ++e) {
+					edges.push_back(faces[f].v[e]);
+					edges.push_back(faces[f].v[(e + 1) % 3]);
+				}
+				faces[f] = faces.back();
+				faces.pop_back();
+			} else {
+				++f;
+			}
+		}
+
+		// An edge is on the horizon if the face on its other side stays.
+		// That face would have listed it the other way round
+
+		for (int e = 0 ; e < (int)edges.size() ; e += 2) {
+			bool	shared = false;
+			for (int o = 0 ; o < (int)edges.size() ; o += 2) {
+				if (edges[o] == edges[e + 1] && edges[o + 1] == edges[e]) {
+					shared = true;
+					break;
+				}
+			}
+			if (!shared) {
+				faces.push_back(makeHullFace(vList, edges[e], edges[e + 1], i, inside));
+			}
+		}
+
+		// A hull this big along the way rarely gets back under the limit,
+		// and big meshes would take a long time to finish
+
+		if ((int)faces.size() > 8 * kMaxHullPoints) {
+			return false;
+		}
+	}
+
+	// Make sure every vertex really is inside, allowing a little more slop
+	// than the construction did
+
+	for (int i = 0 ; i < nVertexCount ; ++i) {
+		for (int f = 0 ; f < (int)faces.size() ; ++f) {
+			if (faces[f].n * vList[i].p - faces[f].d > 4.0f * eps) {
+				return false;
+			}
+		}
+	}
+
+	// Collect the corners of the faces
+
+	std::vector<bool>	used(nVertexCount, false);
+	for (int f = 0 ; f < (int)faces.size() ; ++f) {
+		for (int e = 0 ; e < 3 ; ++e) {
+			int	v = faces[f].v[e];
+			if (!used[v]) {
+				used[v] = true;
+				hull.push_back(v);
+				if ((int)hull.size() > kMaxHullPoints) {
+					hull.clear();
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -36,7 +241,10 @@ TriMesh::TriMesh() {
 	vertexList = NULL;
 	triCount = 0;
 	triList = NULL;
+	ownsMemory = true;
 	boundingBox.empty();
+	hullList = NULL;
+	hullCount = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -77,6 +285,31 @@ void	TriMesh::allocateMemory(int nVertexCount, int nTriCount) {
 
 	triCount = nTriCount;
 	triList = new RenderTri[triCount];
+	ownsMemory = true;
+}
+
+//---------------------------------------------------------------------------
+// TriMesh::attachMemory
+//
+// Point the mesh at lists that live somewhere else, such as a compiled
+// model file mapped into memory.  Nothing is copied, and the lists are not
+// deleted when the mesh is freed, so they must outlive it.
+
+/// \param vList Points to the vertex data.
+/// \param nVertexCount Specifies the number of vertices.
+/// \param tList Points to the triangle data.
+/// \param nTriCount Specifies the number of triangles.
+void	TriMesh::attachMemory(RenderVertex *vList, int nVertexCount, RenderTri *tList, int nTriCount) {
+
+	freeMemory();
+
+	vertexCount = nVertexCount;
+	vertexList = vList;
+	triCount = nTriCount;
+	triList = tList;
+	ownsMemory = false;
+
+	computeBoundingBox();
 }
 
 //---------------------------------------------------------------------------
@@ -86,17 +319,24 @@ void	TriMesh::allocateMemory(int nVertexCount, int nTriCount) {
 
 void	TriMesh::freeMemory() {
 
-	// Free lists
+	// Free lists, unless they belong to someone else
+
+	if (ownsMemory) {
+		delete [] vertexList;
+		delete [] triList;
+	}
 
-	delete [] vertexList;
-	delete [] triList;
+	delete [] hullList;
 
 	// Reset variables
 
+	hullList = NULL;
+	hullCount = 0;
 	vertexList = NULL;
 	triList = NULL;
 	vertexCount = 0;
 	triCount = 0;
+	ownsMemory = true;
 }
 
 //---------------------------------------------------------------------------
@@ -111,7 +351,8 @@ void	TriMesh::render() const {
 //---------------------------------------------------------------------------
 // TriMesh::computeBoundingBox
 //
-// Compute axially aligned bounding box from vertex list
+// Compute axially aligned bounding box from vertex list, and the convex
+// hull used to get tight bounds under a transformation
 
 void	TriMesh::computeBoundingBox() {
 
@@ -124,16 +365,42 @@ void	TriMesh::computeBoundingBox() {
 	for (int i = 0 ; i < vertexCount ; ++i) {
 		boundingBox.add(vertexList[i].p);
 	}
+
+	// Keep the hull vertices, if there aren't too many
+
+	delete [] hullList;
+	hullList = NULL;
+	hullCount = 0;
+
+	std::vector<int>	hull;
+	if (findConvexHull(vertexList, vertexCount, boundingBox, hull)) {
+		hullCount = (int)hull.size();
+		hullList = new Vector3[hullCount];
+		for (int i = 0 ; i < hullCount ; ++i) {
+			hullList[i] = vertexList[hull[i]].p;
+		}
+	}
 }
 
+/// The box of a transformed mesh is the box of its transformed convex
+/// hull, so when the mesh has a hull this is exact.  Otherwise it's the
+/// box around the transformed bounding box, which can be a bit bigger.
+/// Either way it doesn't depend on the number of vertices.
 /// \param m Specifies the transformation matrix to be applied.
 /// \return The bounding box for the mesh under m.
 AABB3 TriMesh::getBoundingBox(const Matrix4x3 &m) const
 {
   AABB3 bb;
-  bb.empty();
-  for (int i = 0; i < vertexCount; ++i)
-    bb.add(vertexList[i].p * m);
+  if (hullCount > 0)
+  {
+    Vector3 p[kMaxHullPoints];
+    transformPoints(p, hullList, hullCount, m);
+    bb.empty();
+    for (int i = 0; i < hullCount; ++i)
+      bb.add(p[i]);
+  }
+  else
+    bb.setToTransformedBox(boundingBox, m);
   return bb;
 }
 
@@ -143,7 +410,8 @@ AABB3 TriMesh::getBoundingBox(const Matrix4x3 &m) const
 // Convert an EditTriMesh to a TriMesh.  Note that this function may need
 // to make many logical changes to the mesh, such as ordering of vertices.
 // Vertices may need to be duplictaed to place UV's at the vertex level.
-// Unused vertices are discarded and the vertex list order is optimized.
+// Unused vertices are discarded and the triangle and vertex list orders
+// are optimized.
 // However, the actual mesh geometry will not be modified as far as number
 // of faces, vertex positions, vertex normals, etc.
 //
@@ -155,16 +423,35 @@ AABB3 TriMesh::getBoundingBox(const Matrix4x3 &m) const
 /// \param mesh Specifies the edit mesh to be converted.
 /// \note Any part and material information is lost in the conversion.
 void	TriMesh::fromEditMesh(const EditTriMesh &mesh) {
-	int	i;
 
-	// Make a copy of the mesh
+	// Make a copy of the mesh, and do the work on that
 
 	EditTriMesh tempMesh(mesh);
+	fromEditMeshInPlace(tempMesh);
+}
+
+//---------------------------------------------------------------------------
+// TriMesh::fromEditMeshInPlace
+//
+// Same as fromEditMesh, but the optimizations are done to the edit mesh
+// passed in rather than to a copy of it.  Use this when the edit mesh is
+// scratch space anyway, to save copying it.
+
+/// \param tempMesh Specifies the edit mesh to be converted.  On return it
+/// holds the optimized mesh.
+/// \note Any part and material information is lost in the conversion.
+void	TriMesh::fromEditMeshInPlace(EditTriMesh &tempMesh) {
+	int	i;
 
 	// Make sure UV's are perperly set at the vertex level
 
 	tempMesh.copyUvsIntoVertices();
 
+	// Order the triangles so that the vertices they share are still
+	// in the post-transform cache when they're used again
+
+	tempMesh.optimizeTriOrder();
+
 	// Optimize the order of the vertices for best cache performance.
 	// This also discards unused vertices
 
@@ -226,4 +513,13 @@ void TriMesh::moveVertices(Vector3 v){ //move all vertices by this amount
   for(int i = 0; i<vertexCount; i++){
     vertexList[i].p += v;
   }
+
+  // The bounds move with them
+  if(!boundingBox.isEmpty()){
+    boundingBox.min += v;
+    boundingBox.max += v;
+  }
+  for(int i = 0; i<hullCount; i++){
+    hullList[i] += v;
+  }
 }
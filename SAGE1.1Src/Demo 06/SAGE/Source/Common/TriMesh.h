@@ -45,6 +45,7 @@ public:
 
 	void	allocateMemory(int nVertexCount, int nTriCount);  ///< Allocates space for vertices and triangles.
 	void	freeMemory();	///< Frees resources, deleting any mesh data.
+	void	attachMemory(RenderVertex *vList, int nVertexCount, RenderTri *tList, int nTriCount);  ///< Uses vertex and triangle lists owned by someone else.
 
 	// Mesh accessors
 
@@ -78,11 +79,17 @@ public:
 
   AABB3 getBoundingBox(const Matrix4x3 &m) const;  ///< Queries the mesh for its bounding box, given a transformation matrix.
 
+	/// \brief Queries the mesh for the number of points kept from its convex hull.
+	/// \return The number of hull points, or 0 if the mesh's bounds under a
+	/// transformation come from its bounding box alone.
+	int		getHullCount() const { return hullCount; }
+
 	// Conversion to/from an "edit" mesh.  Note that this class
 	// doesn't know anything about parts or materials, so the
 	// conversion is not an exact translation.
 
 	void	fromEditMesh(const EditTriMesh &mesh);  ///< Sets this mesh to the equivalent of an edit mesh.
+	void	fromEditMeshInPlace(EditTriMesh &mesh);  ///< Sets this mesh to the equivalent of an edit mesh, optimizing the edit mesh itself along the way.
 	void	toEditMesh(EditTriMesh &mesh) const;	///< Converts this mesh to an edit mesh.
 
   void moveVertices(Vector3 v); ///< Directly translates the vertices in the mesh by a given displacement vector.
@@ -95,10 +102,15 @@ protected:
 	RenderVertex	*vertexList;  ///< Contains the vertex data.
 	int		triCount;             ///< Specifies the number of triangles.
 	RenderTri	*triList;         ///< Contains the triangle data.
+	bool	ownsMemory;           ///< True if the lists were allocated by
+	                            ///< this mesh and must be deleted by it.
 	
 	AABB3	boundingBox;          ///< Stores the last computed bounding box.
 	                            ///< Must be recomputed if the vertex list
 	                            ///< is modified.
+	Vector3	*hullList;          ///< Vertices of the convex hull, computed
+	                            ///< along with the bounding box, or NULL.
+	int		hullCount;            ///< Specifies the number of hull vertices.
 };
 
 /////////////////////////////////////////////////////////////////////////////
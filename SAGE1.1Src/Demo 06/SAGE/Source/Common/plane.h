@@ -2,7 +2,7 @@
 /// \brief Interface for the Plane class.
 
 #include "vector3.h"
-#include "eulerAngles.h"
+#include "EulerAngles.h"
 #ifndef __PLANE_H_INCLUDED__
 #define __PLANE_H_INCLUDED__
 
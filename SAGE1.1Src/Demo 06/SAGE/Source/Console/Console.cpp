@@ -31,15 +31,15 @@
 /// \brief Code for the Console class.
 
 #include "Console.h"
-#include "textparser.h"
-#include "common/Renderer.h"
+#include "textParser.h"
+#include "Common/Renderer.h"
 #include <string>
 #include <iostream>
-#include "input/input.h"
+#include "Input/Input.h"
 #include "windows.h"
-#include "directorymanager/DirectoryManager.h"
+#include "DirectoryManager/DirectoryManager.h"
 #include <iostream>
-#include "tinyxml/tinyxml.h"
+#include "TinyXML/tinyxml.h"
 #include "ConsoleCommentEntry.h"
 
 using namespace std;
@@ -33,9 +33,9 @@
 #ifndef __CONSOLE_H_INCLUDED__
 #define __CONSOLE_H_INCLUDED__
 
-#include "common/vector3.h"
-#include "common/eulerangles.h"
-#include "common/rectangle.h"
+#include "Common/vector3.h"
+#include "Common/EulerAngles.h"
+#include "Common/Rectangle.h"
 #include "ConsoleFunctionEntry.h"
 #include <string>
 #include <iostream>
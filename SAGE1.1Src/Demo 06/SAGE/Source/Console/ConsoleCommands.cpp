@@ -31,8 +31,8 @@
 /// \brief Commands that the in-game console supports.
 
 #include "Console.h"
-#include "common/Renderer.h"
-#include "Game/gamebase.h"
+#include "Common/Renderer.h"
+#include "Game/GameBase.h"
 #include "Input/Input.h"
 #include "DerivedModels/AnimatedModel.h"
 #include "Terrain/Terrain.h"
@@ -73,6 +73,14 @@ bool consoleFogEnable (ParameterList* params,std::string* errorMessage)
 	return 1;
 }
 
+bool consoleFrustumCulling (ParameterList* params,std::string* errorMessage)
+{
+	// switches frustum culling to whatever is specified
+	gRenderer.setFrustumCulling(params->Bools[0]);
+	
+	return 1;
+}
+
 
 bool consoleCameraFree (ParameterList* params,std::string* errorMessage)
 {	
@@ -110,6 +118,24 @@ bool consoleInfoEnable (ParameterList* params,std::string* errorMessage)
 	return 1;
 }
 
+// sets the simulation tick rate
+bool consoleTickRate (ParameterList* params,std::string* errorMessage)
+{
+  if (!gGameBase)
+    return 0;
+
+  if (params->Floats[0] <= 0.0f)
+  {
+    *errorMessage = "Tick rate must be positive.";
+    return 0;
+  }
+
+  gGameBase->setTickRate(params->Floats[0]);
+  gGameBase->setMaxTicksPerFrame(params->Ints[0]);
+
+  return 1;
+}
+
 // turns information on and off
 bool consoleJoystickEnable (ParameterList* params,std::string* errorMessage)
 {	
@@ -131,6 +157,39 @@ bool consoleModelLerp (ParameterList* params, std::string* errorMessage)
   return 1;
 }
 
+bool consoleModelCache (ParameterList* params, std::string* errorMessage)
+{
+  AnimatedModel::m_fFrameCacheStep = params->Floats[0];
+  return 1;
+}
+
+bool consoleAnimationLOD (ParameterList* params, std::string* errorMessage)
+{
+  GameObjectManager::animationLOD = params->Bools[0];
+  return 1;
+}
+
+bool consoleAnimationLODFar (ParameterList* params, std::string* errorMessage)
+{
+  GameObjectManager::animationLODDistance = params->Floats[0];
+  GameObjectManager::animationLODInterval = params->Ints[0];
+  GameObjectManager::animationLODLerp = params->Bools[0];
+  return 1;
+}
+
+bool consoleBroadphase (ParameterList* params, std::string* errorMessage)
+{
+  GameObjectManager::broadphase = params->Ints[0];
+  GameObjectManager::broadphaseCellSize = params->Floats[0];
+  return 1;
+}
+
+bool consoleParallelUpdate (ParameterList* params, std::string* errorMessage)
+{
+  GameObjectManager::parallelUpdate = params->Bools[0];
+  return 1;
+}
+
 bool consoleAmbient (ParameterList* params, std::string* errorMessage)
 {
   gRenderer.setAmbientLightColor(
@@ -184,6 +243,7 @@ void AddEngineConsoleCommands()
   gConsole.addFunction("problems", "b",consoleProblems);	
   gConsole.addFunction("wireframe", "b",consoleWireframe);
   gConsole.addFunction("fog", "b",consoleFogEnable);
+  gConsole.addFunction("cull", "b",consoleFrustumCulling);
   gConsole.addFunction("camerafree", "",consoleCameraFree);
   gConsole.addFunction("cameraspeed", "f",consoleCameraFreeSpeed);  
   gConsole.addFunction("info", "b",consoleInfoEnable);
@@ -193,6 +253,12 @@ void AddEngineConsoleCommands()
   gConsole.addFunction("joystick", "b", consoleJoystickEnable);
   gConsole.addFunction("boundingbox", "b", consoleBoundingBox);
   gConsole.addFunction("modellerp", "b", consoleModelLerp);
+  gConsole.addFunction("modelcache", "f", consoleModelCache);
+  gConsole.addFunction("animlod", "b", consoleAnimationLOD);
+  gConsole.addFunction("animlodfar", "fib", consoleAnimationLODFar);
+  gConsole.addFunction("broadphase", "if", consoleBroadphase);
+  gConsole.addFunction("parallel", "b", consoleParallelUpdate);
+  gConsole.addFunction("tickrate", "fi", consoleTickRate);
   gConsole.addFunction("terraindistort", "b", consoleTerrainDistort);
   gConsole.addFunction("lod", "i", consoleTerrainLOD);
   gConsole.addFunction("reflection", "b", consoleWaterReflection);
@@ -33,7 +33,7 @@
 #include "ConsoleCommentEntry.h"
 #include "TinyXML/tinyxml.h"
 #include <iostream>
-#include "console.h"
+#include "Console.h"
 using namespace std;
 
 
@@ -31,7 +31,7 @@
 /// \brief Code for the ConsoleFunctionEntry class.
 
 #include "ConsoleFunctionEntry.h"
-#include "console.h"
+#include "Console.h"
 
 using namespace std;
 
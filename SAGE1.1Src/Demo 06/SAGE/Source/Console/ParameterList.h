@@ -33,7 +33,7 @@
 #ifndef __H_PARAMETERLIST_INCLUDED__
 #define __H_PARAMETERLIST_INCLUDED__
 
-#include "common/Vector3.h"
+#include "Common/vector3.h"
 
 /// \brief Maximum amount of parameter allowed in a single command
 #define MAX_PARAMETERS 20
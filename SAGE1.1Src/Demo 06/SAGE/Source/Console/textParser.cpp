@@ -30,7 +30,7 @@
 /// \file TextParser.cpp
 /// \brief Code for the TextParser class.
 
-#include "TextParser.h"
+#include "textParser.h"
 #include <queue>
 #include "ParameterList.h"
 using namespace std;
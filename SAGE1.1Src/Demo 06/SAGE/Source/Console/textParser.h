@@ -35,7 +35,7 @@
 #define __H_TEXTPARSER_INCLUDED__
 
 #include <string>
-#include "common/vector3.h"
+#include "Common/vector3.h"
 #include "ConsoleDefines.h"
 #include "ParameterList.h"
 
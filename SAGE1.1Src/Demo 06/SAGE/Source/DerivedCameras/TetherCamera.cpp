@@ -40,11 +40,11 @@
 //
 /////////////////////////////////////////////////////////////////////////////
 
-#include "common/renderer.h"
-#include "common/RotationMatrix.h"
-#include "DerivedCameras/tethercamera.h"
-#include "objects/gameobjectmanager.h"
-#include "objects/gameobject.h"
+#include "Common/Renderer.h"
+#include "Common/RotationMatrix.h"
+#include "DerivedCameras/TetherCamera.h"
+#include "Objects/GameObjectManager.h"
+#include "Objects/GameObject.h"
 #include "assert.h"
 
 /// \param objectManager Pointer to the object manager.  This is needed
@@ -101,8 +101,10 @@ void TetherCamera::process(float elapsed)
   assert(m_objects); // check object manager  
   GameObject* obj = m_objects->getObjectPointer(m_targetObjectID);
   assert(obj); // check object
-  targetHeading = obj->getOrientation().heading;
-  target = obj->getPosition();
+
+  // follow the object where it's drawn, between ticks
+  targetHeading = obj->getRenderOrientation().heading;
+  target = obj->getRenderPosition();
 
   target.y += 3.0f;
 
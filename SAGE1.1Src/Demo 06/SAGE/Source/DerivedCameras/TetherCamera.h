@@ -33,8 +33,8 @@
 #ifndef __TETHERCAMERA_H_INCLUDED__
 #define __TETHERCAMERA_H_INCLUDED__
 
-#include "common/EulerAngles.h"
-#include "common/camera.h"
+#include "Common/EulerAngles.h"
+#include "Common/Camera.h"
 
 class GameObjectManager;
 
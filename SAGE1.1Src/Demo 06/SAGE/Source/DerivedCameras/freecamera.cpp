@@ -31,10 +31,15 @@
 /// \brief Code for the FreeCamera class.
 
 #include "freecamera.h"
-#include "input/input.h"
-#include "common/mathutil.h"
-#include "common/matrix4x3.h"
-#include "common/vector3.h"
+#include "Common/MathUtil.h"
+#include "Common/Matrix4x3.h"
+#include "Common/vector3.h"
+
+// Without Windows there are no input devices, so the camera stays put
+
+#ifdef _WIN32
+  #include "Input/Input.h"
+#endif
 
 // processes movement and input
 /// \param elapsed time in seconds since the last call to this function
@@ -43,7 +48,9 @@ void FreeCamera::process(float elapsed)
   Matrix4x3 view;
 
   Vector3 movement = Vector3(0.0f,0.0f,0.0f);
+  float lx = 0.0f, ly = 0.0f;
 
+#ifdef _WIN32
   if (gInput.keyDown(DIK_UPARROW))
     movement.z = 1.0f;
   
@@ -64,8 +71,9 @@ void FreeCamera::process(float elapsed)
 
 
   // get mouse movement from input manager
-  float lx = gInput.getMouseLX();
-  float ly = gInput.getMouseLY();
+  lx = gInput.getMouseLX();
+  ly = gInput.getMouseLY();
+#endif
   
   m_cameraOrientMoving.pitch += ly / 100.0f;
   m_cameraOrientMoving.heading += lx / 100.0f;  
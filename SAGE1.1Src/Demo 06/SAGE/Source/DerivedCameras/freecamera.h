@@ -32,7 +32,7 @@
 
 #ifndef __FREECAMERA_H_INCLUDED__
 #define __FREECAMERA_H_INCLUDED__
-#include "common/camera.h"
+#include "Common/Camera.h"
 
 /// \brief Camera that is not tied to a particular object.
 class FreeCamera : public Camera // Tether camera
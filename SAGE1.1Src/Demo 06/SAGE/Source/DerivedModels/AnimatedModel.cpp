@@ -14,14 +14,214 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
+#include <emmintrin.h>
 
-#include "animatedmodel.h"
-#include "common/TriMesh.h"
-#include "common/EditTriMesh.h"
-#include "common/renderer.h"
-#include "common/CommonStuff.h"
+#include "AnimatedModel.h"
+#include "Common/TriMesh.h"
+#include "Common/EditTriMesh.h"
+#include "Common/Renderer.h"
+#include "Common/CommonStuff.h"
+#include "Common/AABB3.h"
 
 bool AnimatedModel::m_bModelLerp = true; //true for linear interpolation of model frames
+bool AnimatedModel::m_bCompressFrames = true; //true to keep key frames quantized to 16 bits
+float AnimatedModel::m_fFrameCacheStep = 0.0f; //frame cache off by default
+int AnimatedModel::m_nFrameCacheHits = 0;
+int AnimatedModel::m_nFrameCacheMisses = 0;
+
+/// Interpolates between two lists of vertices, two vertices at a time with
+/// SSE.  Each RenderVertex is eight floats: position and normal are lerped,
+/// and the texture coordinates are taken from the first list (their
+/// weight is zero, so a + 0*(b - a) gives a back exactly).
+/// \param dest Specifies where to put the interpolated vertices.
+/// \param srcV1 Specifies the vertices at fraction 0.
+/// \param srcV2 Specifies the vertices at fraction 1.
+/// \param count Specifies the number of vertices.
+/// \param fraction Specifies the fraction of the way from srcV1 to srcV2.
+static void lerpVertices(RenderVertex *dest, const RenderVertex *srcV1,
+  const RenderVertex *srcV2, int count, float fraction)
+{
+  const float *a = (const float*)srcV1;
+  const float *b = (const float*)srcV2;
+  float *d = (float*)dest;
+
+  const __m128 weightLo = _mm_set1_ps(fraction); //px py pz nx
+  const __m128 weightHi = _mm_set_ps(0.0f, 0.0f, fraction, fraction); //ny nz u v
+
+  int j = 0;
+  for(; j+2 <= count; j+=2, a+=16, b+=16, d+=16)
+  {
+    __m128 a0 = _mm_loadu_ps(a);
+    __m128 a1 = _mm_loadu_ps(a+4);
+    __m128 a2 = _mm_loadu_ps(a+8);
+    __m128 a3 = _mm_loadu_ps(a+12);
+    _mm_storeu_ps(d,    _mm_add_ps(a0, _mm_mul_ps(weightLo, _mm_sub_ps(_mm_loadu_ps(b),    a0))));
+    _mm_storeu_ps(d+4,  _mm_add_ps(a1, _mm_mul_ps(weightHi, _mm_sub_ps(_mm_loadu_ps(b+4),  a1))));
+    _mm_storeu_ps(d+8,  _mm_add_ps(a2, _mm_mul_ps(weightLo, _mm_sub_ps(_mm_loadu_ps(b+8),  a2))));
+    _mm_storeu_ps(d+12, _mm_add_ps(a3, _mm_mul_ps(weightHi, _mm_sub_ps(_mm_loadu_ps(b+12), a3))));
+  }
+  if(j < count) //odd one out
+  {
+    __m128 a0 = _mm_loadu_ps(a);
+    __m128 a1 = _mm_loadu_ps(a+4);
+    _mm_storeu_ps(d,   _mm_add_ps(a0, _mm_mul_ps(weightLo, _mm_sub_ps(_mm_loadu_ps(b),   a0))));
+    _mm_storeu_ps(d+4, _mm_add_ps(a1, _mm_mul_ps(weightHi, _mm_sub_ps(_mm_loadu_ps(b+4), a1))));
+  }
+}
+
+/// Quantized streams of a compressed key frame, each with a short per
+/// vertex.
+enum CompressedStream
+{
+  kStreamPX, kStreamPY, kStreamPZ, kStreamNX, kStreamNY, kStreamNZ, kStreamCount
+};
+
+/// Size of one quantized unit of a normal component.
+const float kNormalStep = 1.0f / 32767.0f;
+
+/// \param x Specifies the value to quantize, in units.
+/// \return x rounded to the nearest short.
+static short quantize(float x)
+{
+  if(x > 32767.0f) x = 32767.0f;
+  if(x < -32767.0f) x = -32767.0f;
+  return (short)floorf(x + 0.5f);
+}
+
+/// Turns the weights of the two quantized values in a lerp into shorts for
+/// _mm_madd_epi16(), with a float scale to apply to the result.  The bigger
+/// weight becomes 32767, so rounding the other one costs at most half a
+/// step of the bigger one's frame.
+/// \param a1 Specifies the weight of the value at fraction 0.
+/// \param a2 Specifies the weight of the value at fraction 1.
+/// \param scale Returns the scale.
+/// \return The two weights packed for _mm_madd_epi16(), a1's in the low half.
+static __m128i maddWeights(float a1, float a2, __m128 &scale)
+{
+  float biggest = fabsf(a1) > fabsf(a2) ? fabsf(a1) : fabsf(a2);
+  if(biggest <= 0.0f)
+  {
+    scale = _mm_setzero_ps();
+    return _mm_setzero_si128();
+  }
+  float k = biggest / 32767.0f;
+  scale = _mm_set1_ps(k);
+  int w1 = quantize(a1 / k), w2 = quantize(a2 / k);
+  return _mm_set1_epi32((int)(((unsigned)w2 << 16) | ((unsigned)w1 & 0xffff)));
+}
+
+/// Lerps eight vertices' worth of one quantized stream.
+/// \param q1 Specifies the stream at fraction 0.
+/// \param q2 Specifies the stream at fraction 1.
+/// \param weights Specifies the weights from maddWeights().
+/// \param scale Specifies the scale from maddWeights().
+/// \param result Returns the eight values, four to a register, before any
+///     offset is added.
+static inline void lerpStream(const short *q1, const short *q2, __m128i weights, __m128 scale,
+  __m128 result[2])
+{
+  __m128i a = _mm_loadu_si128((const __m128i*)q1);
+  __m128i b = _mm_loadu_si128((const __m128i*)q2);
+  result[0] = _mm_mul_ps(scale, _mm_cvtepi32_ps(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights)));
+  result[1] = _mm_mul_ps(scale, _mm_cvtepi32_ps(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights)));
+}
+
+/// Puts four interpolated vertices back together, a vertex at a time: px
+/// py pz nx, then ny nz u v.
+static inline void storeVertices(float *d, const float *uvs, __m128 px, __m128 py, __m128 pz,
+  __m128 nx, __m128 ny, __m128 nz)
+{
+  __m128 lo = _mm_unpacklo_ps(px, py); //px0 py0 px1 py1
+  __m128 hi = _mm_unpacklo_ps(pz, nx); //pz0 nx0 pz1 nx1
+  _mm_storeu_ps(d,    _mm_movelh_ps(lo, hi));
+  _mm_storeu_ps(d+8,  _mm_movehl_ps(hi, lo));
+  lo = _mm_unpackhi_ps(px, py);
+  hi = _mm_unpackhi_ps(pz, nx);
+  _mm_storeu_ps(d+16, _mm_movelh_ps(lo, hi));
+  _mm_storeu_ps(d+24, _mm_movehl_ps(hi, lo));
+
+  __m128 n = _mm_unpacklo_ps(ny, nz); //ny0 nz0 ny1 nz1
+  __m128 uv = _mm_loadu_ps(uvs); //u0 v0 u1 v1
+  _mm_storeu_ps(d+4,  _mm_movelh_ps(n, uv));
+  _mm_storeu_ps(d+12, _mm_movehl_ps(uv, n));
+  n = _mm_unpackhi_ps(ny, nz);
+  uv = _mm_loadu_ps(uvs+4);
+  _mm_storeu_ps(d+20, _mm_movelh_ps(n, uv));
+  _mm_storeu_ps(d+28, _mm_movehl_ps(uv, n));
+}
+
+/// Interpolates between two compressed frames, decoding as it goes.  Each
+/// frame keeps a stream of shorts per component, so eight vertices' worth
+/// of a component is one load, and the two frames are weighted and added
+/// in one multiply-add on the shorts.  Normals are lerped and not
+/// normalized, the same as lerpVertices().
+/// \param dest Specifies where to put the interpolated vertices.
+/// \param uvs Specifies the texture coordinates, u and v for each vertex.
+/// \param srcV1 Specifies the streams of the frame at fraction 0.
+/// \param origin1 Specifies the origin of the frame at fraction 0.
+/// \param step1 Specifies the position step of the frame at fraction 0.
+/// \param srcV2 Specifies the streams of the frame at fraction 1.
+/// \param origin2 Specifies the origin of the frame at fraction 1.
+/// \param step2 Specifies the position step of the frame at fraction 1.
+/// \param count Specifies the number of vertices, which is also the length
+///     of each stream.
+/// \param fraction Specifies the fraction of the way from srcV1 to srcV2.
+static void lerpCompressedVertices(RenderVertex *dest, const float *uvs,
+  const short *srcV1, const Vector3 &origin1, const Vector3 &step1,
+  const short *srcV2, const Vector3 &origin2, const Vector3 &step2,
+  int count, float fraction)
+{
+  // Fold the lerp weights into the steps
+
+  Vector3 a1 = (1.0f - fraction) * step1;
+  Vector3 a2 = fraction * step2;
+  Vector3 origin = (1.0f - fraction) * origin1 + fraction * origin2;
+  float n1 = (1.0f - fraction) * kNormalStep, n2 = fraction * kNormalStep;
+
+  __m128 scaleX, scaleY, scaleZ, scaleN;
+  const __m128i weightX = maddWeights(a1.x, a2.x, scaleX);
+  const __m128i weightY = maddWeights(a1.y, a2.y, scaleY);
+  const __m128i weightZ = maddWeights(a1.z, a2.z, scaleZ);
+  const __m128i weightN = maddWeights(n1, n2, scaleN);
+  const __m128 originX = _mm_set1_ps(origin.x), originY = _mm_set1_ps(origin.y), originZ = _mm_set1_ps(origin.z);
+
+  const short *px1 = srcV1 + kStreamPX * count, *px2 = srcV2 + kStreamPX * count;
+  const short *py1 = srcV1 + kStreamPY * count, *py2 = srcV2 + kStreamPY * count;
+  const short *pz1 = srcV1 + kStreamPZ * count, *pz2 = srcV2 + kStreamPZ * count;
+  const short *nx1 = srcV1 + kStreamNX * count, *nx2 = srcV2 + kStreamNX * count;
+  const short *ny1 = srcV1 + kStreamNY * count, *ny2 = srcV2 + kStreamNY * count;
+  const short *nz1 = srcV1 + kStreamNZ * count, *nz2 = srcV2 + kStreamNZ * count;
+
+  int j = 0;
+  for(; j+8 <= count; j+=8)
+  {
+    __m128 px[2], py[2], pz[2], nx[2], ny[2], nz[2];
+    lerpStream(px1 + j, px2 + j, weightX, scaleX, px);
+    lerpStream(py1 + j, py2 + j, weightY, scaleY, py);
+    lerpStream(pz1 + j, pz2 + j, weightZ, scaleZ, pz);
+    lerpStream(nx1 + j, nx2 + j, weightN, scaleN, nx);
+    lerpStream(ny1 + j, ny2 + j, weightN, scaleN, ny);
+    lerpStream(nz1 + j, nz2 + j, weightN, scaleN, nz);
+
+    for(int k = 0; k < 2; k++)
+      storeVertices((float*)&dest[j + k*4], uvs + (j + k*4)*2,
+        _mm_add_ps(originX, px[k]), _mm_add_ps(originY, py[k]), _mm_add_ps(originZ, pz[k]),
+        nx[k], ny[k], nz[k]);
+  }
+
+  for(; j<count; j++) //leftovers
+  {
+    dest[j].p.x = origin.x + a1.x * px1[j] + a2.x * px2[j];
+    dest[j].p.y = origin.y + a1.y * py1[j] + a2.y * py2[j];
+    dest[j].p.z = origin.z + a1.z * pz1[j] + a2.z * pz2[j];
+    dest[j].n.x = n1 * nx1[j] + n2 * nx2[j];
+    dest[j].n.y = n1 * ny1[j] + n2 * ny2[j];
+    dest[j].n.z = n1 * nz1[j] + n2 * nz2[j];
+    dest[j].u = uvs[j*2];
+    dest[j].v = uvs[j*2 + 1];
+  }
+}
 
 /// \param framecount Specifies the number of submodels.
 /// \param animationcount Specifies the number of animation sequences.
@@ -34,6 +234,7 @@ AnimatedModel::AnimatedModel(int framecount, int animationcount)
   m_pModelArray = new Model*[m_nFrameCount];
   for(int i = 0; i < m_nFrameCount; i++)
     m_pModelArray[i] = new Model(NoBuffers);
+  m_frameBoundingBoxes = new AABB3[m_nFrameCount];
 
   //create animation sequences
   if(animationcount<=0){ //default animation sequence
@@ -62,14 +263,26 @@ AnimatedModel::AnimatedModel(int framecount, int animationcount)
   }
   m_animation = 0;
   m_frame = 0.0f;
+  m_fCachedFrameStep = 0.0f;
+  m_compressedFrames = NULL;
+  m_compressedUvs = NULL;
+  m_frameOrigin = NULL;
+  m_frameStep = NULL;
 }
 
 AnimatedModel::~AnimatedModel(){
 
+  clearFrameCache();
+
   //delete models
   for(int i = 0; i < m_nFrameCount; i++)
     delete m_pModelArray[i];
   delete [] m_pModelArray;
+  delete [] m_frameBoundingBoxes;
+  delete [] m_compressedFrames;
+  delete [] m_compressedUvs;
+  delete [] m_frameOrigin;
+  delete [] m_frameStep;
 
   //delete animation frame sequences
   delete[] m_nAnimationFrameCount;
@@ -91,8 +304,9 @@ void AnimatedModel::importS3d(const char *s3dFilename, bool defaultDirectory) {
 	  //SECURITY-UPDATE:2/3/07
 	  //sprintf(text, "%s%c%c.s3d", s3dFilename, i/10 + '0', i%10 + '0'); //assumes at most 100 frames
 	  sprintf_s(text,sizeof(text), "%s%c%c.s3d", s3dFilename, i/10 + '0', i%10 + '0'); //assumes at most 100 frames
-	  m_pModelArray[i]->importS3d(text, defaultDirectory);
+	  m_pModelArray[i]->importS3d(text, defaultDirectory, false); //no welding, frames must match vertex for vertex
   }
+  computeFrameBoundingBoxes();
 
   //copy first model over to local model for rendering
 
@@ -130,6 +344,8 @@ void AnimatedModel::importS3d(const char *s3dFilename, bool defaultDirectory) {
 
 	  m_partTextureList[i] = m_pModelArray[0]->m_partTextureList[i];
   }
+
+  compressFrames();
 }
 
 /// \param s3dFilenames Contains the names of the S3D files, starting at frame 0.
@@ -141,9 +357,10 @@ void AnimatedModel::importS3d(const std::list<const char *> &s3dFilenames, bool
   std::list<const char *>::const_iterator it = s3dFilenames.begin();
   for(int i = 0; i < m_nFrameCount; ++i)
   {
-    m_pModelArray[i]->importS3d(*it, defaultDirectory);
+    m_pModelArray[i]->importS3d(*it, defaultDirectory, false); //no welding, frames must match vertex for vertex
     ++it;
   }
+  computeFrameBoundingBoxes();
   m_totalTris = m_pModelArray[0]->m_totalTris;
 
   // verify consistent models
@@ -160,8 +377,6 @@ void AnimatedModel::importS3d(const std::list<const char *> &s3dFilenames, bool
   }
 
   m_isValid = true;
-  assert(m_indexBuffer == NULL);
-  m_indexBuffer = new IndexBuffer(m_totalTris);
 
   //copy first model over to local model for rendering
 
@@ -169,13 +384,7 @@ void AnimatedModel::importS3d(const std::list<const char *> &s3dFilenames, bool
 	m_partMeshList = new TriMesh[m_partCount];
 	m_partTextureList = new TextureReference[m_partCount];
 
-  int totalTc = 0;
   int totalVc = 0;
-  m_vertexOffsets.clear();
-  m_indexOffsets.clear();
-
-  if(!m_indexBuffer->lock())
-    ABORT("AnimatedModel failed to lock index buffer");
 
   for(int i = 0; i < m_partCount; i++){ //for each part, do a deep copy of trimesh
 
@@ -194,18 +403,13 @@ void AnimatedModel::importS3d(const std::list<const char *> &s3dFilenames, bool
       destV[j] = srcV[j]; //copy vertex
 
     //copy triangle list
+
+    RenderTri *destT = m_partMeshList[i].getTriList(); //destination for copy
     RenderTri *srcT = m_pModelArray[0]->m_partMeshList[i].getTriList(); //source for copy
 
     for(int j=0; j<tc; j++) //for each triangle
-    {
-      (*m_indexBuffer)[j+totalTc].index[0] = srcT[j].index[0] + totalVc; //copy triangle
-      (*m_indexBuffer)[j+totalTc].index[1] = srcT[j].index[1] + totalVc; //copy triangle
-      (*m_indexBuffer)[j+totalTc].index[2] = srcT[j].index[2] + totalVc; //copy triangle
-    }
+      destT[j] = srcT[j]; //copy triangle
 
-    m_vertexOffsets.push_back(totalVc);
-    m_indexOffsets.push_back(totalTc);
-    totalTc += tc;
     totalVc += vc;
 
     //copy texture list
@@ -215,7 +419,11 @@ void AnimatedModel::importS3d(const std::list<const char *> &s3dFilenames, bool
   
   m_totalVertices = totalVc;
 
-  m_indexBuffer->unlock();
+  //build index buffer, with 32-bit or part-relative indices if there are too many vertices for 16 bits
+
+  createIndexBuffer();
+
+  compressFrames();
 }
 
 /// \param vb Vertex buffer to be rendered.
@@ -278,58 +486,299 @@ void AnimatedModel::selectAnimationFrame(float frame, int animation, StandardVer
 /// \param world If non-NULL, specifies the world (or other parent) transform of the model.
 void AnimatedModel::selectAnimationFrame(float frame, int animation, StandardVertexBuffer &vb, AABB3 *boundingBox, const Matrix4x3 *world)
 {
+  //set vertex positions and normals from model frames, lerping if necessary
+
+  int prevFrame, nextFrame;
+  float fraction;
+  findFrames(frame, animation, prevFrame, nextFrame, fraction);
+
+  lerpFrames(prevFrame, nextFrame, fraction, vb);
+
   if(boundingBox != NULL)
   {
     assert(world != NULL);
-    boundingBox->empty();
-  }    
+    lerpBoundingBox(prevFrame, nextFrame, fraction, *boundingBox, *world);
+  }
+}
 
-  //set vertex positions and normals from model frames, lerping if necessary
+/// If the frame cache is on (m_fFrameCacheStep > 0), the frame is rounded
+/// to the nearest multiple of the step, and the interpolated vertices for
+/// that (animation, frame) pair are kept in a vertex buffer owned by the
+/// model.  Every object that lands on the same pair after that draws from
+/// the same buffer, without interpolating anything.  The key frames never
+/// change, so neither do the cached buffers, except when the device is
+/// lost and they have to be filled again.  If the cache is off, this is
+/// the same as selectAnimationFrame().
+/// \param frame Specifies the frame number as a fractional value for interpolation.
+/// \param animation Specifies the animation sequence to be run.
+/// \param vb Specifies the object's own vertex buffer, filled with interpolated
+///     data only if the frame cache is off.
+/// \param boundingBox Specifies the bounding box to be updated.
+/// \param world Specifies the world (or other parent) transform of the model.
+/// \return The vertex buffer to render the model with, which is either vb or
+///     a cached buffer belonging to the model.
+StandardVertexBuffer *AnimatedModel::selectAnimationFrameCached(float frame, int animation,
+  StandardVertexBuffer &vb, AABB3 &boundingBox, const Matrix4x3 &world)
+{
+  if(m_fFrameCacheStep <= 0.0f)
+  {
+    selectAnimationFrame(frame, animation, vb, &boundingBox, &world);
+    return &vb;
+  }
+
+  if(m_fCachedFrameStep != m_fFrameCacheStep)
+    buildFrameCache();
 
   if(animation < 0) animation = 0;
   if(animation >= m_nNumAnimations) animation = m_nNumAnimations-1;
 
   if (!m_bModelLerp) frame = (float) ((int)frame); //cancel out lerping
 
+  // Round to the nearest slot, wrapping around the end of the animation
+
+  int frameCount = m_nAnimationFrameCount[animation];
+  int slotCount = m_frameCacheStart[animation + 1] - m_frameCacheStart[animation];
+  float frameInAnimation = fmodf(frame, (float)frameCount);
+  if(frameInAnimation < 0.0f) frameInAnimation += (float)frameCount;
+  int slot = (int)(frameInAnimation / m_fCachedFrameStep + 0.5f);
+  if(slot >= slotCount) slot = 0;
+  float quantizedFrame = slot * m_fCachedFrameStep;
+
+  int prevFrame, nextFrame;
+  float fraction;
+  findFrames(quantizedFrame, animation, prevFrame, nextFrame, fraction);
+
+  StandardVertexBuffer *&cached = m_frameCache[m_frameCacheStart[animation] + slot];
+  if(cached == NULL)
+    cached = new StandardVertexBuffer(m_totalVertices, true);
+
+  if(cached->isEmpty()) //new, or lost with the device
+  {
+    lerpFrames(prevFrame, nextFrame, fraction, *cached);
+    ++m_nFrameCacheMisses;
+  }
+  else
+    ++m_nFrameCacheHits;
+
+  lerpBoundingBox(prevFrame, nextFrame, fraction, boundingBox, world);
+
+  return cached;
+}
+
+/// This gives the same box as selectAnimationFrame(), from the precomputed
+/// key frame boxes, so it's cheap enough to call for objects that aren't
+/// being drawn.
+/// \param frame Specifies the frame number as a fractional value for interpolation.
+/// \param animation Specifies the animation sequence to be run.
+/// \param boundingBox Specifies the bounding box to be updated.
+/// \param world Specifies the world (or other parent) transform of the model.
+void AnimatedModel::selectBoundingBox(float frame, int animation, AABB3 &boundingBox, const Matrix4x3 &world)
+{
+  int prevFrame, nextFrame;
+  float fraction;
+  findFrames(frame, animation, prevFrame, nextFrame, fraction);
+  lerpBoundingBox(prevFrame, nextFrame, fraction, boundingBox, world);
+}
+
+/// \param frame Specifies the frame number as a fractional value for interpolation.
+/// \param animation Specifies the animation sequence to be run.  It is clamped
+///     to the range of animation sequences.
+/// \param prevFrame Returns the key frame before the frame.
+/// \param nextFrame Returns the key frame after the frame.
+/// \param fraction Returns the fraction of the way from prevFrame to nextFrame.
+void AnimatedModel::findFrames(float frame, int &animation, int &prevFrame, int &nextFrame, float &fraction)
+{
+  if(animation < 0) animation = 0;
+  if(animation >= m_nNumAnimations) animation = m_nNumAnimations-1;
+
+  if (!m_bModelLerp) frame = (float) ((int)frame); //cancel out lerping
+
   int prevFrameIndex = (int)frame; //integer part of previous frame index
-  float fraction = frame - (float)prevFrameIndex; //fraction between frames
-  int prevFrame = m_nAnimationFrame[animation][ prevFrameIndex % m_nAnimationFrameCount[animation]]; //previous frame
-  int nextFrame = m_nAnimationFrame[animation][
+  fraction = frame - (float)prevFrameIndex; //fraction between frames
+  prevFrame = m_nAnimationFrame[animation][ prevFrameIndex % m_nAnimationFrameCount[animation]]; //previous frame
+  nextFrame = m_nAnimationFrame[animation][
     ( prevFrameIndex + 1 ) % m_nAnimationFrameCount[animation]]; //next frame 
 
+  m_animation = animation;
+  m_frame = frame;
+}
+
+/// \param prevFrame Specifies the key frame at fraction 0.
+/// \param nextFrame Specifies the key frame at fraction 1.
+/// \param fraction Specifies the fraction of the way from prevFrame to nextFrame.
+/// \param vb Specifies the vertex buffer to be filled with interpolated data.
+void AnimatedModel::lerpFrames(int prevFrame, int nextFrame, float fraction, StandardVertexBuffer &vb)
+{
   if(!vb.lock())
     ABORT("AnimatedModel failed to lock vertex buffer");
 
+  if(m_compressedFrames != NULL) //all the parts at once
+  {
+    int frameSize = kStreamCount * m_totalVertices;
+    lerpCompressedVertices(&vb[0], m_compressedUvs,
+      &m_compressedFrames[prevFrame * frameSize], m_frameOrigin[prevFrame], m_frameStep[prevFrame],
+      &m_compressedFrames[nextFrame * frameSize], m_frameOrigin[nextFrame], m_frameStep[nextFrame],
+      m_totalVertices, fraction);
+    vb.unlock();
+    return;
+  }
+
   int totalVc = 0;
   
-  for(int i = 0; i < m_partCount; i++){ //for each part, do a deep copy of trimesh
+  for(int i = 0; i < m_partCount; i++){ //for each part, compute weighted average of vertices
     
     int vc = m_partMeshList[i].getVertexCount(); //vertex count
-  
+
     RenderVertex *srcV1 = m_pModelArray[prevFrame]->m_partMeshList[i].getVertexList(); //source 1
     RenderVertex *srcV2 = m_pModelArray[nextFrame]->m_partMeshList[i].getVertexList(); //source 2
 
-     //compute weighted average of vertex positions
-    for(int j=0; j<vc; j++)
-    { //for each vertex
-      Vector3 pos = (1.0f - fraction) * srcV1[j].p + fraction * srcV2[j].p;
-      vb[j+totalVc].p = pos;
-      vb[j+totalVc].n = (1.0f - fraction) * srcV1[j].n + fraction * srcV2[j].n;
-      vb[j+totalVc].u = srcV1[j].u;
-      vb[j+totalVc].v = srcV1[j].v;
-      
-      // Update bounding box
-      
-      if(boundingBox != NULL)
-        boundingBox->add(pos * (*world));
-    }
+    lerpVertices(&vb[totalVc], srcV1, srcV2, vc, fraction);
     totalVc += vc;
   }
 
   vb.unlock();
+}
 
-  m_animation = animation;
-  m_frame = frame;
+/// Every interpolated vertex lies between a point in the previous frame's
+/// box and a point in the next frame's box, so it's inside the box we get
+/// by lerping the corners of the two.
+/// \param prevFrame Specifies the key frame at fraction 0.
+/// \param nextFrame Specifies the key frame at fraction 1.
+/// \param fraction Specifies the fraction of the way from prevFrame to nextFrame.
+/// \param boundingBox Specifies the bounding box to be set.
+/// \param world Specifies the world (or other parent) transform of the model.
+void AnimatedModel::lerpBoundingBox(int prevFrame, int nextFrame, float fraction,
+  AABB3 &boundingBox, const Matrix4x3 &world) const
+{
+  const AABB3 &box1 = m_frameBoundingBoxes[prevFrame];
+  const AABB3 &box2 = m_frameBoundingBoxes[nextFrame];
+  AABB3 localBox;
+  localBox.min = (1.0f - fraction) * box1.min + fraction * box2.min;
+  localBox.max = (1.0f - fraction) * box1.max + fraction * box2.max;
+  boundingBox.setToTransformedBox(localBox, world);
+}
+
+/// Sets up an empty slot for every multiple of m_fFrameCacheStep in every
+/// animation, throwing away anything cached with the old step.
+void AnimatedModel::buildFrameCache()
+{
+  clearFrameCache();
+
+  m_fCachedFrameStep = m_fFrameCacheStep;
+  m_frameCacheStart.resize(m_nNumAnimations + 1);
+  m_frameCacheStart[0] = 0;
+  for(int i = 0; i < m_nNumAnimations; i++)
+  {
+    int slots = (int)ceilf(m_nAnimationFrameCount[i] / m_fCachedFrameStep);
+    if(slots < 1) slots = 1;
+    m_frameCacheStart[i + 1] = m_frameCacheStart[i] + slots;
+  }
+  m_frameCache.assign(m_frameCacheStart[m_nNumAnimations], (StandardVertexBuffer*)NULL);
+}
+
+/// Replaces the key frame models with quantized copies of their vertices.
+/// Each key frame keeps its positions at 16 bits per axis, as steps from
+/// the middle of the frame's box, and its normals at 16 bits per axis.
+/// They're kept as a stream of shorts per component, so the interpolation
+/// never has to gather, and the texture coordinates are copied out of the
+/// base (m_partMeshList, which is a copy of frame 0) into a stream of their
+/// own.  Triangles are shared with the base, so the frame models are freed.  A frame's vertices take 12 bytes each instead of a
+/// RenderVertex's 32.  Does nothing if m_bCompressFrames is off, or if the
+/// frames don't match the base part for part and vertex for vertex.
+void AnimatedModel::compressFrames()
+{
+  if(!m_bCompressFrames || m_compressedFrames != NULL)
+    return;
+
+  // Check the frames all line up with the base
+
+  int totalVc = 0;
+  for(int i = 0; i < m_partCount; i++)
+    totalVc += m_partMeshList[i].getVertexCount();
+
+  for(int f = 0; f < m_nFrameCount; f++)
+  {
+    if(m_pModelArray[f]->m_partCount != m_partCount)
+      return;
+    for(int i = 0; i < m_partCount; i++)
+      if(m_pModelArray[f]->m_partMeshList[i].getVertexCount() != m_partMeshList[i].getVertexCount())
+        return;
+  }
+
+  m_totalVertices = totalVc;
+  m_compressedFrames = new short[m_nFrameCount * kStreamCount * totalVc];
+  m_compressedUvs = new float[totalVc * 2];
+  m_frameOrigin = new Vector3[m_nFrameCount];
+  m_frameStep = new Vector3[m_nFrameCount];
+
+  float *uv = m_compressedUvs;
+  for(int i = 0; i < m_partCount; i++)
+  {
+    const RenderVertex *baseV = m_partMeshList[i].getVertexList();
+    for(int j = 0; j < m_partMeshList[i].getVertexCount(); j++, uv+=2)
+    {
+      uv[0] = baseV[j].u;
+      uv[1] = baseV[j].v;
+    }
+  }
+
+  for(int f = 0; f < m_nFrameCount; f++)
+  {
+    // The middle of the frame's box is the origin, and the half size on
+    // each axis sets the step
+
+    AABB3 box;
+    box.empty();
+    for(int i = 0; i < m_partCount; i++)
+    {
+      const RenderVertex *srcV = m_pModelArray[f]->m_partMeshList[i].getVertexList();
+      for(int j = 0; j < m_partMeshList[i].getVertexCount(); j++)
+        box.add(srcV[j].p);
+    }
+    if(totalVc == 0)
+      box.min = box.max = Vector3(0.0f, 0.0f, 0.0f);
+
+    Vector3 &origin = m_frameOrigin[f];
+    Vector3 &step = m_frameStep[f];
+    origin = box.center();
+    step = (box.max - box.min) / (2.0f * 32767.0f);
+    Vector3 invStep(
+      step.x > 0.0f ? 1.0f / step.x : 0.0f,
+      step.y > 0.0f ? 1.0f / step.y : 0.0f,
+      step.z > 0.0f ? 1.0f / step.z : 0.0f);
+
+    // Quantize
+
+    short *dest = &m_compressedFrames[f * kStreamCount * totalVc];
+    for(int i = 0; i < m_partCount; i++)
+    {
+      const RenderVertex *srcV = m_pModelArray[f]->m_partMeshList[i].getVertexList();
+      for(int j = 0; j < m_partMeshList[i].getVertexCount(); j++, dest++)
+      {
+        Vector3 p = srcV[j].p - origin;
+        dest[kStreamPX * totalVc] = quantize(p.x * invStep.x);
+        dest[kStreamPY * totalVc] = quantize(p.y * invStep.y);
+        dest[kStreamPZ * totalVc] = quantize(p.z * invStep.z);
+        dest[kStreamNX * totalVc] = quantize(srcV[j].n.x / kNormalStep);
+        dest[kStreamNY * totalVc] = quantize(srcV[j].n.y / kNormalStep);
+        dest[kStreamNZ * totalVc] = quantize(srcV[j].n.z / kNormalStep);
+      }
+    }
+
+    // Don't need the full frame anymore
+
+    m_pModelArray[f]->freeMemory();
+  }
+}
+
+/// Frees the vertex buffers in the frame cache.
+void AnimatedModel::clearFrameCache()
+{
+  for(int i = 0; i < (int)m_frameCache.size(); i++)
+    delete m_frameCache[i];
+  m_frameCache.clear();
+  m_frameCacheStart.clear();
+  m_fCachedFrameStep = 0.0f;
 }
 
 /// \return The number of frames in the current animation.  
@@ -338,6 +787,27 @@ int AnimatedModel::numFramesInAnimation() const
   return m_nAnimationFrameCount[m_animation];
 }
 
+/// \param frame Specifies the frame number (not an index into an animation sequence).
+/// \return The bounding box of the frame in model space.
+const AABB3 &AnimatedModel::getFrameBoundingBox(int frame) const
+{
+  assert(frame >= 0 && frame < m_nFrameCount);
+  return m_frameBoundingBoxes[frame];
+}
+
+/// Computes each frame's bounding box from the bounding boxes of its parts,
+/// so selectAnimationFrame() doesn't have to look at every vertex to get
+/// one.
+void AnimatedModel::computeFrameBoundingBoxes()
+{
+  for(int i = 0; i < m_nFrameCount; i++)
+  {
+    m_frameBoundingBoxes[i].empty();
+    for(int j = 0; j < m_pModelArray[i]->m_partCount; j++)
+      m_frameBoundingBoxes[i].add(m_pModelArray[i]->m_partMeshList[j].getBoundingBox());
+  }
+}
+
 /// \note The caller will be responsible for deleting the allocated vertex buffer
 /// \return A new dynamic vertex buffer of the proper size
 StandardVertexBuffer *AnimatedModel::getNewVertexBuffer()
@@ -14,12 +14,14 @@
 #pragma once
 
 #include <list>
-#include "graphics/VertexTypes.h"
-#include "common/model.h"
-#include "common/vector3.h"
+#include <vector>
+#include "Graphics/VertexTypes.h"
+#include "Common/Model.h"
+#include "Common/vector3.h"
 
 class EditTriMesh;
 class TriMesh;
+class AABB3;
 
 /// \brief An encapsulation of a model with multiple frames.
 ///
@@ -31,6 +33,10 @@ class AnimatedModel : public Model {
 
 public:
   static bool m_bModelLerp; ///< Global flag; specifies whether models should be linearly interpolated.
+  static bool m_bCompressFrames; ///< Global flag; specifies whether key frames imported from now on are stored compressed, as streams of 16 bit values.
+  static float m_fFrameCacheStep; ///< Global setting; frames are rounded to multiples of this and shared by selectAnimationFrameCached().  Zero or less turns the cache off.
+  static int m_nFrameCacheHits; ///< Number of times selectAnimationFrameCached() found the frame already interpolated.
+  static int m_nFrameCacheMisses; ///< Number of times selectAnimationFrameCached() had to interpolate the frame.
   
   /// \brief Constructs a model with the given number of submodels.
   AnimatedModel(int framecount, int animationcount=0);
@@ -59,21 +65,55 @@ public:
   /// \brief Select the current animation sequence and frame, updating a supplied vertex buffer and bounding box.
   void selectAnimationFrame(float frame, int animation, StandardVertexBuffer &vb, AABB3 &boundingBox, const Matrix4x3 &world);
 
+  /// \brief Select the current animation sequence and frame, sharing interpolated frames between objects.
+  StandardVertexBuffer *selectAnimationFrameCached(float frame, int animation, StandardVertexBuffer &vb, AABB3 &boundingBox, const Matrix4x3 &world);
+
+  /// \brief Updates a bounding box for the current animation sequence and frame, without touching any vertices.
+  void selectBoundingBox(float frame, int animation, AABB3 &boundingBox, const Matrix4x3 &world);
+
   /// \brief Queries the model for the number of frames in the current animation.
   int numFramesInAnimation() const;
 
   /// \brief Creates a dynamic vertex buffer of the proper size.
   StandardVertexBuffer *getNewVertexBuffer();
 
+  /// \brief Queries the model for the bounding box of one of its frames.
+  const AABB3 &getFrameBoundingBox(int frame) const;
+
 private:
   /// \brief Utility function.
   void selectAnimationFrame(float frame, int animation, StandardVertexBuffer &vb, AABB3 *boundingBox, const Matrix4x3 *world);
 
+  /// \brief Computes the bounding box of each frame.
+  void computeFrameBoundingBoxes();
+
+  /// \brief Finds the key frames on either side of a frame.
+  void findFrames(float frame, int &animation, int &prevFrame, int &nextFrame, float &fraction);
+
+  /// \brief Fills a vertex buffer with vertices interpolated between two key frames.
+  void lerpFrames(int prevFrame, int nextFrame, float fraction, StandardVertexBuffer &vb);
+
+  /// \brief Computes a world bounding box interpolated between two key frames.
+  void lerpBoundingBox(int prevFrame, int nextFrame, float fraction, AABB3 &boundingBox, const Matrix4x3 &world) const;
+
+  void compressFrames(); ///< Replaces the key frame models with compressed streams.
+  void buildFrameCache(); ///< Sets up the frame cache for the current step.
+  void clearFrameCache(); ///< Frees the frame cache.
+
   Model** m_pModelArray; ///< Array of pointers to models for frames.
+  AABB3* m_frameBoundingBoxes; ///< Bounding box of each frame, in model space.
+  short* m_compressedFrames; ///< Compressed key frames, each six streams of m_totalVertices shorts (position x, y, z, then normal x, y, z), or NULL if the frame models are kept.
+  float* m_compressedUvs; ///< Texture coordinates of the compressed key frames, u and v for each of m_totalVertices.
+  Vector3* m_frameOrigin; ///< Position a quantized zero stands for in each compressed key frame.
+  Vector3* m_frameStep; ///< Size of one quantized unit of position in each compressed key frame.
   int m_nNumAnimations; ///< Number of animations.
   int** m_nAnimationFrame; ///< Animation frames for each behaviour.
   int* m_nAnimationFrameCount; ///< Number of frames in each animation.
   int m_animation;  ///< Specifies currently selected animation sequence.
   float m_frame; ///< Specifies current animation frame.
 
+  std::vector<StandardVertexBuffer*> m_frameCache; ///< Shared interpolated frames, by animation then slot.  NULL until used.
+  std::vector<int> m_frameCacheStart; ///< Index of each animation's first slot in m_frameCache, plus the total at the end.
+  float m_fCachedFrameStep; ///< Step m_frameCache was built with, zero if not built.
+
 };
@@ -14,9 +14,9 @@
 #include <assert.h>
 #include <stdlib.h>
 
-#include "articulatedmodel.h"
-#include "common/TriMesh.h"
-#include "common/EditTriMesh.h"
+#include "ArticulatedModel.h"
+#include "Common/TriMesh.h"
+#include "Common/EditTriMesh.h"
 
 /// \param count Specifies the number of submodels.
 ArticulatedModel::ArticulatedModel(int count)
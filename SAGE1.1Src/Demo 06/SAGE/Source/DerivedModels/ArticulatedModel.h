@@ -13,8 +13,8 @@
 
 #pragma once
 
-#include "common/model.h"
-#include "common/vector3.h"
+#include "Common/Model.h"
+#include "Common/vector3.h"
 
 class EditTriMesh;
 class TriMesh;
@@ -32,8 +32,15 @@
 
 
 #include "DirectoryManager.h"
-#include "tinyxml/tinyxml.h"
-#include "windows.h"
+#include "TinyXML/tinyxml.h"
+
+#ifdef _WIN32
+  #include "windows.h"
+#else
+  #include <unistd.h>
+  #define SetCurrentDirectory chdir
+  #define GetCurrentDirectory(size, buffer) getcwd(buffer, size)
+#endif
 
 /// The global instance of DirectoryManager.  This is initated in the windows wrapper.
 /// It can be used anywhere.
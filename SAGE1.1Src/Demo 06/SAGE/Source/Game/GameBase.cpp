@@ -30,13 +30,21 @@
 ----o0o=================================================================o0o----
 */
 
+#include <assert.h>
 #include "GameBase.h"
-#include "console/console.h"
-#include "input/input.h"
-#include "common/Renderer.h"
+#include "Common/Portable.h"
+#include "Common/Renderer.h"
 #include "Graphics/ModelManager.h"
 #include "Objects/GameObjectManager.h"
-#include "WindowsWrapper/WindowsWrapper.h"
+
+// Without Windows (the engine library's Linux build) there is no console,
+// window or input device, so a frame only runs the ticks and draws
+
+#ifdef _WIN32
+  #include "Console/Console.h"
+  #include "Input/Input.h"
+  #include "WindowsWrapper/WindowsWrapper.h"
+#endif
 
 // set pointer to null
 GameBase* gGameBase = 0;
@@ -47,12 +55,66 @@ GameBase::GameBase()
   m_renderInfo = true;
   m_fpsTime = 0.0f;
   m_fps = 0;   
+
+  m_fTickLength = 1.0f / 60.0f;
+  m_nMaxTicksPerFrame = 5;
+  m_fAccumulator = 0.0f;
+  m_fInterpolation = 0.0f;
+  m_nTickCount = 0;
+  m_nTicksLastFrame = 0;
+  m_nTicksDropped = 0;
+}
+
+/// \param ticksPerSecond Specifies the tick rate.  Time not yet simulated
+/// carries over.
+void GameBase::setTickRate(float ticksPerSecond)
+{
+  assert(ticksPerSecond > 0.0f);
+  m_fTickLength = 1.0f / ticksPerSecond;
+}
+
+/// The simulation always steps by getTickLength(), so it comes out the same
+/// whatever the frame rate.  Time left over carries on to the next call, and
+/// objects are drawn that fraction of the way through the next tick (see
+/// GameObjectManager::renderInterpolation).  Nothing here touches the
+/// renderer, so a game can be stepped without a window.
+/// \param elapsed Specifies the time since the last call, in seconds.
+/// \return The number of ticks run.
+int GameBase::advance(float elapsed)
+{
+  m_fAccumulator += elapsed;
+
+  int ticks = 0;
+  while(m_fAccumulator >= m_fTickLength && ticks < m_nMaxTicksPerFrame)
+  {
+    tick(m_fTickLength);
+    m_fAccumulator -= m_fTickLength;
+    ++ticks;
+    ++m_nTickCount;
+  }
+
+  // Too far behind to catch up; drop whole ticks so the next frame isn't
+  // slower still, but keep the fraction so the interpolation stays smooth
+
+  if(m_fAccumulator >= m_fTickLength)
+  {
+    int dropped = (int)(m_fAccumulator / m_fTickLength);
+    m_fAccumulator -= dropped * m_fTickLength;
+    m_nTicksDropped += dropped;
+  }
+
+  m_fInterpolation = m_fAccumulator / m_fTickLength;
+  GameObjectManager::renderInterpolation = m_fInterpolation;
+  m_nTicksLastFrame = ticks;
+  return ticks;
 }
 
 // renders the console and frames per second to the screen
 void GameBase::renderConsoleAndFPS()
 {
+#ifdef _WIN32
    gConsole.render();
+#endif
 
   // render FPS information
   if (m_renderInfo)
@@ -65,15 +127,25 @@ bool GameBase::main()
   // This makes sure the device is valid.
   gRenderer.validateDevice();
 
+#ifdef _WIN32
   // Update Input
   gInput.updateInput();
+#endif
+
+  // latch the controls for this frame's ticks
+  sampleInput();
+
+  // run the simulation in fixed ticks, however long the frame took
+  advance(gRenderer.getTimeStep());
 
-  // process game logic
+  // process per-frame logic
   process();
  
+#ifdef _WIN32
   // return if quit flag was set
   if (gWindowsWrapper.isQuiting())
     return true;
+#endif
 
   // draw the screen
   gRenderer.beginScene();
@@ -105,12 +177,23 @@ void GameBase::renderInfo()
   }
 
   int tri = gRenderer.GetTrianglesRenderedLastScene();
+  int drawn = gRenderer.GetObjectsDrawnLastScene();
+  int culled = gRenderer.GetObjectsCulledLastScene();
+  int full = GameObjectManager::animatedFull;
+  int reduced = GameObjectManager::animatedReduced;
+  int hidden = GameObjectManager::animatedHidden;
+  int pairs = GameObjectManager::broadphasePairs;
+  int tickRate = (int)(1.0f / m_fTickLength + 0.5f);
+  int draws = gRenderer.getCallCount(eRenderCallDraw);
+  int states = gRenderer.getCallCount(eRenderCallState);
+  int textures = gRenderer.getCallCount(eRenderCallTexture);
 
   // calculate string
   char text[1024];      
   //SECURITY-UPDATE:2/3/07
   //sprintf(text, "FPS: %d\nTriangles Per Frame: %d", m_fps, tri, 2);
-  sprintf_s(text,sizeof(text), "FPS: %d\nTriangles Per Frame: %d", m_fps, tri, 2);
+  sprintf_s(text,sizeof(text), "FPS: %d\nTriangles Per Frame: %d\nFrustum Tests: %d drawn, %d culled\nAnimated Objects: %d full, %d reduced, %d hidden\nBroadphase Pairs: %d\nTicks: %d Hz, %d this frame, %d dropped\nCalls: %d draw, %d state, %d texture",
+    m_fps, tri, drawn, culled, full, reduced, hidden, pairs, tickRate, m_nTicksLastFrame, m_nTicksDropped, draws, states, textures);
   
   // draw the text
   gRenderer.drawText(text, 10,10);
@@ -34,7 +34,7 @@
 #define __GAMEBASE_H_INCLUDED__
 
 #include <stdio.h>
-#include "common/camera.h"
+#include "Common/Camera.h"
 #include "DerivedCameras/freecamera.h"
 
 class GameObjectManager;
@@ -71,6 +71,41 @@ public:
   /// \brief Processes per-frame logic.
   virtual void process() {}
 
+  /// \brief Reads the controls, once a frame before its ticks run.
+  ///
+  /// Keys that were only just pressed or released show up in one frame,
+  /// however many ticks it runs, so tick() must never read the input
+  /// itself; the game latches what it needs here and hands it to the
+  /// ticks.
+  virtual void sampleInput() {}
+
+  /// \brief Advances the simulation by one fixed tick.
+  /// \param dt Specifies the length of the tick in seconds, always
+  /// getTickLength().
+  virtual void tick(float dt) {}
+
+  int advance(float elapsed);  ///< Runs as many ticks as the elapsed time calls for.
+
+  void setTickRate(float ticksPerSecond);  ///< Sets how many ticks the simulation runs per second.
+
+  /// \brief Sets the most ticks advance() runs at once.
+  /// \param maxTicks Specifies the number of ticks.  Time beyond that is
+  /// dropped, so a slow frame can't make the next one slower still.
+  void setMaxTicksPerFrame(int maxTicks) 
+    {m_nMaxTicksPerFrame = maxTicks < 1 ? 1 : maxTicks;}
+
+  /// \brief Queries the game for the length of a tick.
+  /// \return The length of a tick, in seconds.
+  float getTickLength() const {return m_fTickLength;}
+
+  /// \brief Queries the game for how far it is into the next tick.
+  /// \return The time not yet simulated, as a fraction of a tick.
+  float getInterpolation() const {return m_fInterpolation;}
+
+  /// \brief Queries the game for the number of ticks run.
+  /// \return The number of ticks run since the game was constructed.
+  unsigned int getTickCount() const {return m_nTickCount;}
+
   /// \brief Sets the current camera to the free camera.
   void setFreeCamera() {m_currentCam = &m_freeCamera;}
 
@@ -107,6 +142,17 @@ protected:
   /// frame
   float m_fpsTime; 
   int m_fps; ///< Frames Per Second as currently being displayed
+
+  /// \name Simulation members
+  //@{ 
+  float m_fTickLength; ///< Length of a tick, in seconds
+  int m_nMaxTicksPerFrame; ///< Most ticks advance() runs at once
+  float m_fAccumulator; ///< Time not yet simulated, in seconds
+  float m_fInterpolation; ///< m_fAccumulator as a fraction of a tick
+  unsigned int m_nTickCount; ///< Number of ticks run
+  int m_nTicksLastFrame; ///< Number of ticks the last advance() ran
+  int m_nTicksDropped; ///< Number of ticks dropped to keep up
+  //@} 
 };
 
 // extern a global pointer to the game object
@@ -33,7 +33,7 @@
 #ifndef __IDGENERATOR_H_INCLUDED__
 #define __IDGENERATOR_H_INCLUDED__
 
-#include <hash_set>
+#include "Common/Portable.h"
 
 /// \brief Generates unique ids in the form of unsigned ints.  Useful for resource factories/managers.
 class IDGenerator
@@ -33,8 +33,7 @@
 #ifndef __NAMEGENERATOR_H_INCLUDED__
 #define __NAMEGENERATOR_H_INCLUDED__
 
-#include <hash_map>
-#include <hash_set>
+#include "Common/Portable.h"
 #include <string>
 
 /// \brief Generates and tracks unique names (strings). These names can be
@@ -0,0 +1,1063 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// D3D9RenderBackend.cpp - Draws with Direct3D 9
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file D3D9RenderBackend.cpp
+/// \brief Code for the D3D9RenderBackend class.
+///
+/// This is the Direct3D half of what used to be Renderer.cpp.  The renderer
+/// decides what to draw and keeps the state; everything here only passes
+/// it on to the device.
+
+#include <assert.h>
+#include <string.h>
+#include <d3dx9core.h>
+
+#include "D3D9RenderBackend.h"
+#include "Common/CommonStuff.h"
+#include "Common/MathUtil.h"
+#include "Resource/ResourceManager.h"
+#include "WindowsWrapper/WindowsWrapper.h"
+
+// The vertex format flags are passed to the device as they are
+
+typedef char VertexFormatsMatchFVF[
+  kVertexFormatXYZ == D3DFVF_XYZ && kVertexFormatXYZRHW == D3DFVF_XYZRHW &&
+  kVertexFormatNormal == D3DFVF_NORMAL && kVertexFormatDiffuse == D3DFVF_DIFFUSE &&
+  kVertexFormatSpecular == D3DFVF_SPECULAR && kVertexFormatTex1 == D3DFVF_TEX1 ? 1 : -1];
+
+// Direct3D device interface
+
+LPDIRECT3DDEVICE9 pD3DDevice = NULL;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Direct3D objects behind the handles
+//
+/////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  /// \brief A texture, with the surfaces it needs as a render target
+  struct D3D9Texture : public RenderBackend::Texture
+  {
+    LPDIRECT3DTEXTURE9 texture; ///< The texture
+    LPDIRECT3DSURFACE9 surface; ///< Its top level, got the first time it's rendered to
+    LPDIRECT3DSURFACE9 depthBuffer; ///< Its own depth buffer, if it has one
+
+    D3D9Texture() : texture(NULL), surface(NULL), depthBuffer(NULL) {}
+    ~D3D9Texture()
+    {
+      if(surface != NULL) surface->Release();
+      if(depthBuffer != NULL) depthBuffer->Release();
+      if(texture != NULL) texture->Release();
+    }
+  };
+
+  /// \brief A font
+  struct D3D9Font : public RenderBackend::Font
+  {
+    LPD3DXFONT font; ///< The font
+
+    D3D9Font() : font(NULL) {}
+    ~D3D9Font() { if(font != NULL) font->Release(); }
+  };
+
+  /// \brief A vertex or index buffer.  Only one of the two is set.
+  struct D3D9Buffer : public RenderBackend::Buffer
+  {
+    LPDIRECT3DVERTEXBUFFER9 vertices; ///< The vertex buffer, if it's one
+    LPDIRECT3DINDEXBUFFER9 indices; ///< The index buffer, if it's one
+
+    D3D9Buffer() : vertices(NULL), indices(NULL) {}
+    ~D3D9Buffer()
+    {
+      if(vertices != NULL) vertices->Release();
+      if(indices != NULL) indices->Release();
+    }
+  };
+
+  D3D9Texture *d3d9(RenderBackend::Texture *t) { return static_cast<D3D9Texture*>(t); }
+  D3D9Font *d3d9(RenderBackend::Font *f) { return static_cast<D3D9Font*>(f); }
+  D3D9Buffer *d3d9(RenderBackend::Buffer *b) { return static_cast<D3D9Buffer*>(b); }
+
+  /// \brief Sets a render state, checking the result in a debug build
+  void setD3DRenderState(D3DRENDERSTATETYPE state, DWORD value)
+  {
+    HRESULT result = pD3DDevice->SetRenderState(state, value);
+    assert(SUCCEEDED(result));
+  }
+
+  /// \brief Sets a sampler state of stage 0, checking the result in a debug build
+  void setD3DSamplerState(D3DSAMPLERSTATETYPE state, DWORD value)
+  {
+    HRESULT result = pD3DDevice->SetSamplerState(0, state, value);
+    assert(SUCCEEDED(result));
+  }
+
+  /// \brief Sets a texture stage state of stage 0
+  void setD3DStageState(D3DTEXTURESTAGESTATETYPE state, DWORD value)
+  {
+    HRESULT result = pD3DDevice->SetTextureStageState(0, state, value);
+    assert(SUCCEEDED(result));
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Device
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \param shaderDebug True to make a reference device, so that shaders
+/// can be debugged
+/// \param windowed True to run in a window rather than full screen
+D3D9RenderBackend::D3D9RenderBackend(bool shaderDebug, bool windowed)
+{
+  // device must be reference for shader debugging
+  m_shaderDebug = m_deviceReference = shaderDebug;
+  m_windowed = windowed;
+
+  m_d3d = NULL;
+  memset(&m_presentParms, 0, sizeof(m_presentParms));
+  m_backBuffer = NULL;
+  m_depthStencil = NULL;
+  m_maxVertexIndex = 0xFFFF;
+  m_videoModeCount = 0;
+  m_videoModeList = NULL;
+  memset(&m_material, 0, sizeof(m_material));
+  memset(&m_light, 0, sizeof(m_light));
+  m_lastClock.QuadPart = 0;
+  m_timerFrequency = 1.0f;
+  m_curIndexBuffer = NULL;
+  m_curVertexBuffer = NULL;
+}
+
+D3D9RenderBackend::~D3D9RenderBackend()
+{
+  shutdown();
+}
+
+/// Enumerates the modes the first time it's called.
+/// \return Number of video modes found
+int D3D9RenderBackend::getVideoModeCount()
+{
+  // Check if we already know
+
+  if (m_videoModeCount > 0)
+    return m_videoModeCount;
+
+  // List has not yet been created.  Nothing should be allocated yet
+
+  assert(m_d3d == NULL);
+  assert(pD3DDevice == NULL);
+
+  // Create a Direct3D object
+
+  m_d3d = Direct3DCreate9(D3D_SDK_VERSION);
+  if (m_d3d == NULL)
+  {
+    ABORT("Unable to create D3D object.");
+    return 0;
+  }
+
+  // Enumerate the adapter modes in two passes.  On the first pass,
+  // we'll just count the number of modes.  On the second pass,
+  // we'll actually fill in the mode list
+
+  // Choose color format. Default to 24-bit color here. If you want
+  // 16-bit color, you're going to have to work harder than this.
+  D3DFORMAT d3dFormat = D3DFMT_X8R8G8B8;
+
+  for (int pass = 0 ; pass < 2 ; ++pass)
+  {
+    int modeIndex = 0;
+    int modeCount = m_d3d->GetAdapterModeCount(D3DADAPTER_DEFAULT, d3dFormat);
+    while (modeIndex < modeCount)
+    {
+      // Enumerate the next mode.
+
+      D3DDISPLAYMODE mode;
+      HRESULT result = m_d3d->EnumAdapterModes(D3DADAPTER_DEFAULT, d3dFormat, modeIndex, &mode);
+      if (FAILED(result))
+        break;
+      ++modeIndex;
+
+      // Convert D3D mode structure to our own
+
+      VideoMode ourMode;
+      ourMode.xRes = mode.Width;
+      ourMode.yRes = mode.Height;
+      ourMode.refreshHz = mode.RefreshRate;
+      switch (mode.Format)
+      {
+        case D3DFMT_A8R8G8B8:
+          ourMode.bitsPerPixel = 32;
+          break;
+
+        case D3DFMT_R8G8B8:
+        case D3DFMT_X8R8G8B8:
+          ourMode.bitsPerPixel = 24;
+          break;
+
+        case D3DFMT_R5G6B5:
+          ourMode.bitsPerPixel = 16;
+          break;
+
+        default:
+
+          // Unknown or unrecognized mode - skip it
+
+          continue;
+      }
+
+      // Count it, or add it to the list, skipping duplicates
+
+      if (pass == 0)
+      {
+        ++m_videoModeCount;
+      }
+      else
+      {
+        bool dup = false;
+        for (int i = 0 ; i < m_videoModeCount ; ++i)
+        {
+          VideoMode *v = &m_videoModeList[i];
+          if (v->xRes == ourMode.xRes && v->yRes == ourMode.yRes &&
+            v->bitsPerPixel == ourMode.bitsPerPixel && v->refreshHz == ourMode.refreshHz)
+          {
+            dup = true;
+            break;
+          }
+        }
+        if (!dup)
+          m_videoModeList[m_videoModeCount++] = ourMode;
+      }
+    }
+
+    // Any valid modes found?
+
+    if (m_videoModeCount == 0)
+    {
+      m_d3d->Release();
+      m_d3d = NULL;
+      ABORT("Unable to enumerate D3D devices.");
+      return 0;
+    }
+
+    // End of first pass?  Then allocate the list, possibly longer than
+    // needed, since there might be duplicates
+
+    if (pass == 0)
+    {
+      m_videoModeList = new VideoMode[m_videoModeCount];
+      m_videoModeCount = 0;
+    }
+  }
+
+  return m_videoModeCount;
+}
+
+/// \param mode Desired video mode for the app
+void D3D9RenderBackend::init(const VideoMode &mode)
+{
+  HRESULT result;
+  D3DDEVTYPE deviceType;
+  DWORD vertexRendering = 0;
+
+  if (m_deviceReference)
+  {
+    deviceType = D3DDEVTYPE_REF;
+    vertexRendering = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
+  }
+  else
+  {
+    deviceType = D3DDEVTYPE_HAL;
+    vertexRendering = D3DCREATE_HARDWARE_VERTEXPROCESSING;
+  }
+
+  // Make sure Direct3D interface is created
+
+  getVideoModeCount();
+
+  // We should have a D3D object, but not a D3D device
+
+  assert(m_d3d != NULL);
+  assert(pD3DDevice == NULL);
+
+  // Figure out actual pixel format to use for desired bit depth
+
+  int modeIndex = 0;
+  D3DDISPLAYMODE d3dMode;
+  for (;;)
+  {
+    // Get the mode
+
+    result = m_d3d->EnumAdapterModes(D3DADAPTER_DEFAULT, D3DFMT_X8R8G8B8, modeIndex, &d3dMode);
+    ++modeIndex;
+
+    // No more modes?  Then we couldn't find an appropriate mode
+
+    if (FAILED(result))
+      ABORT("Can't find valid video mode for %dx%dx%dbpp", mode.xRes, mode.yRes, mode.bitsPerPixel);
+
+    // Will this mode do for what they want?
+
+    if (d3dMode.Width != mode.xRes) continue;
+    if (d3dMode.Height != mode.yRes) continue;
+    if (mode.bitsPerPixel == 16)
+    {
+      if (d3dMode.Format == D3DFMT_R5G6B5)
+        break;
+    }
+    else if (mode.bitsPerPixel == 24)
+    {
+      if (d3dMode.Format == D3DFMT_R8G8B8 || d3dMode.Format == D3DFMT_X8R8G8B8)
+        break;
+    }
+    else if (mode.bitsPerPixel == 32)
+    {
+      if (d3dMode.Format == D3DFMT_A8R8G8B8)
+        break;
+    }
+    else
+    {
+      // Huh?  You are asking for an invalid bit depth
+
+      assert(false);
+    }
+  }
+
+  // Figure out Z buffer format.  We'll start by assuming a 16-bit depth
+  // buffer, and in higher bit depths shoot for the most resolution possible
+
+  D3DFORMAT depthBufferFormat = D3DFMT_D16;
+  if (mode.bitsPerPixel > 16)
+  {
+    if (SUCCEEDED(m_d3d->CheckDeviceFormat(D3DADAPTER_DEFAULT, deviceType, d3dMode.Format,
+      D3DUSAGE_DEPTHSTENCIL, D3DRTYPE_SURFACE, D3DFMT_D32)))
+    {
+      depthBufferFormat = D3DFMT_D32;
+    }
+    else if (SUCCEEDED(m_d3d->CheckDeviceFormat(D3DADAPTER_DEFAULT, deviceType, d3dMode.Format,
+      D3DUSAGE_DEPTHSTENCIL, D3DRTYPE_SURFACE, D3DFMT_D24S8)))
+    {
+      depthBufferFormat = D3DFMT_D24S8;
+    }
+  }
+
+  // Fill in the "present" parameters
+
+  m_presentParms.BackBufferWidth = mode.xRes;
+  m_presentParms.BackBufferHeight = mode.yRes;
+  m_presentParms.Windowed = 0;
+  m_presentParms.BackBufferFormat = d3dMode.Format;
+  m_presentParms.MultiSampleType = D3DMULTISAMPLE_NONE;
+  m_presentParms.MultiSampleQuality = 0;
+  m_presentParms.EnableAutoDepthStencil = TRUE;
+  m_presentParms.AutoDepthStencilFormat = depthBufferFormat;
+  m_presentParms.Flags = 0;
+  m_presentParms.hDeviceWindow = gWindowsWrapper.getHandle();
+  m_presentParms.BackBufferCount = 2;
+  m_presentParms.SwapEffect = D3DSWAPEFFECT_FLIP;
+  if (mode.refreshHz == kRefreshRateDefault || mode.refreshHz == kRefreshRateFastest)
+  {
+    m_presentParms.FullScreen_RefreshRateInHz = D3DPRESENT_RATE_DEFAULT;
+  }
+  else
+  {
+    assert(mode.refreshHz > 0);
+    m_presentParms.FullScreen_RefreshRateInHz = mode.refreshHz;
+  }
+  m_presentParms.PresentationInterval = D3DPRESENT_INTERVAL_ONE;
+
+  if (m_windowed)
+  {
+    m_presentParms.Windowed = 1;
+    m_presentParms.BackBufferCount = 1;
+    m_presentParms.SwapEffect = D3DSWAPEFFECT_COPY;
+    m_presentParms.FullScreen_RefreshRateInHz = 0;
+    ::SetWindowPos(gWindowsWrapper.getHandle(), NULL, 0, 0, mode.xRes, mode.yRes,
+      SWP_NOZORDER | SWP_SHOWWINDOW);
+  }
+
+  // Create hardware transform device, hopefully with vertex and
+  // pixel shader support, falling back on software vertex processing
+
+  result = m_d3d->CreateDevice(D3DADAPTER_DEFAULT, deviceType, gWindowsWrapper.getHandle(),
+    D3DCREATE_FPU_PRESERVE | vertexRendering, &m_presentParms, &pD3DDevice);
+  if (!SUCCEEDED(result))
+  {
+    result = m_d3d->CreateDevice(D3DADAPTER_DEFAULT, deviceType, gWindowsWrapper.getHandle(),
+      D3DCREATE_FPU_PRESERVE | D3DCREATE_SOFTWARE_VERTEXPROCESSING, &m_presentParms, &pD3DDevice);
+    if (!SUCCEEDED(result))
+      ABORT("Can't set video mode to %dx%dx%dbpp", mode.xRes, mode.yRes, mode.bitsPerPixel);
+  }
+
+  // Find out how big an index the device will take, so models know
+  // whether they can use 32-bit index buffers
+
+  D3DCAPS9 caps;
+  if (SUCCEEDED(pD3DDevice->GetDeviceCaps(&caps)))
+    m_maxVertexIndex = caps.MaxVertexIndex;
+
+  getSurfaces();
+
+  // Fetch timer frequency
+
+  LARGE_INTEGER perfFreq;
+  if (!SUCCEEDED(::QueryPerformanceFrequency(&perfFreq)))
+    ABORT("QueryPerformanceFrequency failed");
+  m_timerFrequency = (float)perfFreq.QuadPart;
+}
+
+void D3D9RenderBackend::shutdown()
+{
+  releaseSurfaces();
+
+  if (pD3DDevice != NULL)
+  {
+    pD3DDevice->Release();
+    pD3DDevice = NULL;
+  }
+
+  if (m_d3d != NULL)
+  {
+    m_d3d->Release();
+    m_d3d = NULL;
+  }
+
+  delete [] m_videoModeList;
+  m_videoModeList = NULL;
+  m_videoModeCount = 0;
+}
+
+/// If the device is lost, this waits until it can be reset, letting windows
+/// process meanwhile, then releases everything not managed by Direct3D,
+/// resets the device and makes it all again.
+/// \return True if the device was reset
+bool D3D9RenderBackend::validateDevice()
+{
+  if (pD3DDevice == NULL || pD3DDevice->TestCooperativeLevel() != D3DERR_DEVICELOST)
+    return false;
+
+  // loop until the device is ready to be reset
+  while (pD3DDevice->TestCooperativeLevel() != D3DERR_DEVICENOTRESET)
+    gWindowsWrapper.idle();
+
+  // device is ready! restore all non managed resources, and the back and
+  // depth buffers, which aren't in the resource manager
+  gResourceManager.releaseAll();
+  releaseSurfaces();
+
+  pD3DDevice->Reset(&m_presentParms);
+  m_curIndexBuffer = NULL;
+  m_curVertexBuffer = NULL;
+
+  getSurfaces();
+  gResourceManager.restoreAll();
+  return true;
+}
+
+void D3D9RenderBackend::resetDevice()
+{
+  if (pD3DDevice != NULL && FAILED(pD3DDevice->Reset(&m_presentParms)))
+    ABORT("Failed to reset D3D device");
+  m_curIndexBuffer = NULL;
+  m_curVertexBuffer = NULL;
+}
+
+void D3D9RenderBackend::beginScene()
+{
+  HRESULT result = pD3DDevice->BeginScene();
+  assert(SUCCEEDED(result));
+}
+
+void D3D9RenderBackend::endScene()
+{
+  HRESULT result = pD3DDevice->EndScene();
+  assert(SUCCEEDED(result));
+}
+
+void D3D9RenderBackend::present()
+{
+  HRESULT result = pD3DDevice->Present(NULL, NULL, NULL, NULL);
+
+  // We could lose the surface - we'll ignore this error
+
+  assert((result == D3DERR_DEVICELOST) || SUCCEEDED(result));
+
+  m_curIndexBuffer = NULL;
+  m_curVertexBuffer = NULL;
+}
+
+/// \param seconds Address of a float to store the time since the last
+/// reading, in seconds
+/// \return False on the first reading, or if time ran backwards
+bool D3D9RenderBackend::readFrameTime(float *seconds)
+{
+  LARGE_INTEGER clock;
+  if (!SUCCEEDED(QueryPerformanceCounter(&clock)))
+    ABORT("QueryPerformanceCounter failed");
+
+  // Make sure this isn't the first clock reading, and protect against
+  // hiccups in the clock
+
+  LONGLONG diff = clock.QuadPart - m_lastClock.QuadPart;
+  bool valid = m_lastClock.QuadPart != 0 && diff >= 0;
+  if (valid)
+    *seconds = (float)diff / m_timerFrequency;
+
+  m_lastClock = clock;
+  return valid;
+}
+
+/// \return Time in milliseconds since the system started
+long D3D9RenderBackend::getTime()
+{
+  return GetTickCount();
+}
+
+void D3D9RenderBackend::getSurfaces()
+{
+  pD3DDevice->GetRenderTarget(0, &m_backBuffer);
+  pD3DDevice->GetDepthStencilSurface(&m_depthStencil);
+}
+
+void D3D9RenderBackend::releaseSurfaces()
+{
+  if (m_backBuffer != NULL)
+    m_backBuffer->Release();
+  m_backBuffer = NULL;
+
+  if (m_depthStencil != NULL)
+    m_depthStencil->Release();
+  m_depthStencil = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// State
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \param state The state
+/// \param value Its value, see ERenderState
+void D3D9RenderBackend::setState(ERenderState state, unsigned value)
+{
+  switch (state)
+  {
+    case eRenderStateDepthEnable:
+      setD3DRenderState(D3DRS_ZENABLE, value);
+      break;
+
+    case eRenderStateDepthRead:
+      setD3DRenderState(D3DRS_ZFUNC, value ? D3DCMP_LESSEQUAL : D3DCMP_ALWAYS);
+      break;
+
+    case eRenderStateDepthWrite:
+      setD3DRenderState(D3DRS_ZWRITEENABLE, value);
+      break;
+
+    case eRenderStateBlendEnable:
+      setD3DRenderState(D3DRS_ALPHABLENDENABLE, value);
+      break;
+
+    case eRenderStateSourceBlend:
+    {
+      D3DBLEND b;
+      switch (value)
+      {
+        default:
+          assert(false);
+        case eSourceBlendModeSrcAlpha: b = D3DBLEND_SRCALPHA; break;
+        case eSourceBlendModeOne:      b = D3DBLEND_ONE; break;
+        case eSourceBlendModeZero:     b = D3DBLEND_ZERO; break;
+      }
+      setD3DRenderState(D3DRS_SRCBLEND, b);
+      break;
+    }
+
+    case eRenderStateDestBlend:
+    {
+      D3DBLEND b;
+      switch (value)
+      {
+        default:
+          assert(false);
+        case eDestBlendModeInvSrcAlpha: b = D3DBLEND_INVSRCALPHA; break;
+        case eDestBlendModeOne:         b = D3DBLEND_ONE; break;
+        case eDestBlendModeZero:        b = D3DBLEND_ZERO; break;
+        case eDestBlendModeSrcColor:    b = D3DBLEND_SRCCOLOR; break;
+      }
+      setD3DRenderState(D3DRS_DESTBLEND, b);
+      break;
+    }
+
+    case eRenderStateAmbient:
+      setD3DRenderState(D3DRS_AMBIENT, value);
+      break;
+
+    case eRenderStateFogEnable:
+      setD3DRenderState(D3DRS_FOGENABLE, value);
+      break;
+
+    case eRenderStateFogColor:
+      setD3DRenderState(D3DRS_FOGCOLOR, value);
+      break;
+
+    case eRenderStateFogStart:
+      setD3DRenderState(D3DRS_FOGSTART, value);
+      break;
+
+    case eRenderStateFogEnd:
+      setD3DRenderState(D3DRS_FOGEND, value);
+      break;
+
+    case eRenderStateCullMode:
+    {
+      D3DCULL c;
+      switch (value)
+      {
+        default:
+          assert(false);
+        case eBackfaceModeCCW:     c = D3DCULL_CCW; break;
+        case eBackfaceModeCW:      c = D3DCULL_CW; break;
+        case eBackfaceModeDisable: c = D3DCULL_NONE; break;
+      }
+      setD3DRenderState(D3DRS_CULLMODE, c);
+      break;
+    }
+
+    case eRenderStateWireframe:
+      setD3DRenderState(D3DRS_FILLMODE, value ? D3DFILL_WIREFRAME : D3DFILL_SOLID);
+      break;
+
+    case eRenderStateLighting:
+      setD3DRenderState(D3DRS_LIGHTING, value);
+      break;
+
+    case eRenderStateVertexAlpha:
+
+      // the color is always the texture color times the diffuse color;
+      // alpha is the texture alpha alone unless this is on
+
+      setD3DStageState(D3DTSS_COLOROP, D3DTOP_MODULATE);
+      setD3DStageState(D3DTSS_COLORARG1, D3DTA_TEXTURE);
+      setD3DStageState(D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+      setD3DStageState(D3DTSS_ALPHAOP, value ? D3DTOP_MODULATE : D3DTOP_SELECTARG1);
+      setD3DStageState(D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+      setD3DStageState(D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+      break;
+
+    default:
+      assert(false);
+  }
+}
+
+void D3D9RenderBackend::setDefaultStates()
+{
+  setD3DRenderState(D3DRS_FOGTABLEMODE, D3DFOG_LINEAR);
+  setD3DRenderState(D3DRS_RANGEFOGENABLE, TRUE);
+
+  setD3DSamplerState(D3DSAMP_MINFILTER, D3DTEXF_ANISOTROPIC);
+  setD3DSamplerState(D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
+  setD3DSamplerState(D3DSAMP_MIPFILTER, D3DTEXF_LINEAR);
+  setD3DSamplerState(D3DSAMP_ADDRESSU, D3DTADDRESS_WRAP);
+  setD3DSamplerState(D3DSAMP_ADDRESSV, D3DTADDRESS_WRAP);
+
+  HRESULT result = pD3DDevice->LightEnable(0, TRUE);
+  assert(SUCCEEDED(result));
+}
+
+/// \param opacity Alpha of the material
+void D3D9RenderBackend::setMaterialOpacity(float opacity)
+{
+  m_material.Diffuse.r = 1.0f;
+  m_material.Diffuse.g = 1.0f;
+  m_material.Diffuse.b = 1.0f;
+  m_material.Diffuse.a = opacity;
+  m_material.Ambient = m_material.Diffuse;
+  m_material.Specular = m_material.Diffuse;
+  m_material.Power = 50.0f; // arbitrary
+
+  HRESULT result = pD3DDevice->SetMaterial(&m_material);
+  assert(SUCCEEDED(result));
+}
+
+/// \param direction Unit vector the light shines along
+/// \param rgb Color of the light
+void D3D9RenderBackend::setDirectionalLight(const Vector3 &direction, unsigned rgb)
+{
+  m_light.Type = D3DLIGHT_DIRECTIONAL;
+  m_light.Diffuse.r = GET_R(rgb) / 255.0f;
+  m_light.Diffuse.g = GET_G(rgb) / 255.0f;
+  m_light.Diffuse.b = GET_B(rgb) / 255.0f;
+  m_light.Diffuse.a = 0.0f;
+  m_light.Specular = m_light.Diffuse;
+  m_light.Direction.x = direction.x;
+  m_light.Direction.y = direction.y;
+  m_light.Direction.z = direction.z;
+  m_light.Falloff = 1.0f;
+  m_light.Theta = kPi;
+  m_light.Phi = kPi;
+
+  HRESULT result = pD3DDevice->SetLight(0, &m_light);
+  assert(SUCCEEDED(result));
+}
+
+/// \param transform Which matrix
+/// \param m 4x4 matrix, row by row
+void D3D9RenderBackend::setTransform(ETransform transform, const float *m)
+{
+  D3DTRANSFORMSTATETYPE type = D3DTS_WORLDMATRIX(0);
+  if (transform == eTransformView)
+    type = D3DTS_VIEW;
+  else if (transform == eTransformProjection)
+    type = D3DTS_PROJECTION;
+
+  HRESULT result = pD3DDevice->SetTransform(type, (const D3DMATRIX*)m);
+  assert(SUCCEEDED(result));
+}
+
+void D3D9RenderBackend::setViewport(int x, int y, int xSize, int ySize)
+{
+  D3DVIEWPORT9 viewData;
+  viewData.X = x;
+  viewData.Y = y;
+  viewData.Width = xSize;
+  viewData.Height = ySize;
+  viewData.MinZ = 0.0F;
+  viewData.MaxZ = 1.0F;
+  HRESULT result = pD3DDevice->SetViewport(&viewData);
+  assert(SUCCEEDED(result));
+}
+
+/// \param plane The plane, or NULL for none
+void D3D9RenderBackend::setClipPlane(const Plane *plane)
+{
+  if (plane != NULL)
+  {
+    setD3DRenderState(D3DRS_CLIPPING, TRUE);
+    setD3DRenderState(D3DRS_CLIPPLANEENABLE, D3DCLIPPLANE0);
+    pD3DDevice->SetClipPlane(0, &plane->a);
+  }
+  else
+  {
+    setD3DRenderState(D3DRS_CLIPPING, FALSE);
+    setD3DRenderState(D3DRS_CLIPPLANEENABLE, 0);
+  }
+}
+
+void D3D9RenderBackend::clear(bool frameBuffer, bool depthBuffer, unsigned argb)
+{
+  DWORD clearWhat = 0;
+  if (frameBuffer)
+    clearWhat |= D3DCLEAR_TARGET;
+  if (depthBuffer)
+    clearWhat |= D3DCLEAR_ZBUFFER;
+
+  HRESULT result = pD3DDevice->Clear(0, NULL, clearWhat, argb, 1.0F, 0);
+  assert(SUCCEEDED(result));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Textures
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// Ordinary textures are managed by Direct3D, so they survive a lost
+/// device.  Render targets can't be, and must be made again.
+RenderBackend::Texture *D3D9RenderBackend::createTexture(int xSize, int ySize, bool renderTarget, bool depthStencil)
+{
+  DWORD usage = D3DUSAGE_AUTOGENMIPMAP;
+  D3DPOOL pool = D3DPOOL_MANAGED;
+  UINT levels = 0; // zero for automatic mip-map generation
+
+  if (renderTarget)
+  {
+    usage |= D3DUSAGE_RENDERTARGET;
+    pool = D3DPOOL_DEFAULT;
+    levels = 1;
+  }
+
+  D3D9Texture *t = new D3D9Texture;
+  if (FAILED(pD3DDevice->CreateTexture(xSize, ySize, levels, usage, D3DFMT_A8R8G8B8, pool, &t->texture, NULL)))
+  {
+    delete t;
+    return NULL;
+  }
+
+  if (depthStencil && FAILED(pD3DDevice->CreateDepthStencilSurface(xSize, ySize, D3DFMT_D16,
+    D3DMULTISAMPLE_NONE, 0, TRUE, &t->depthBuffer, NULL)))
+  {
+    delete t;
+    return NULL;
+  }
+
+  return t;
+}
+
+/// Any format D3DX reads will do.
+RenderBackend::Texture *D3D9RenderBackend::loadTexture(const char *filename, bool mipmaps)
+{
+  D3D9Texture *t = new D3D9Texture;
+  HRESULT result;
+  if (mipmaps)
+  {
+    result = D3DXCreateTextureFromFile(pD3DDevice, filename, &t->texture);
+  }
+  else
+  {
+    result = D3DXCreateTextureFromFileEx(pD3DDevice, filename,
+      0, 0, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, D3DX_FILTER_NONE,
+      D3DX_DEFAULT, 0, NULL, NULL, &t->texture);
+  }
+
+  if (FAILED(result))
+  {
+    delete t;
+    return NULL;
+  }
+  return t;
+}
+
+bool D3D9RenderBackend::setTextureImage(Texture *texture, const unsigned *image, int xSize, int ySize)
+{
+  LPDIRECT3DTEXTURE9 d3dTexture = d3d9(texture)->texture;
+
+  // Lock the whole top level
+
+  D3DLOCKED_RECT r;
+  if (FAILED(d3dTexture->LockRect(0, &r, NULL, 0)))
+    return false;
+
+  // Copy in the data a row at a time
+
+  const unsigned char *srcPtr = (const unsigned char *)image;
+  unsigned char *destPtr = (unsigned char *)r.pBits;
+  for (int y = 0 ; y < ySize ; ++y)
+  {
+    memcpy(destPtr, srcPtr, xSize*4);
+    srcPtr += xSize*4;
+    destPtr += r.Pitch;
+  }
+
+  HRESULT result = d3dTexture->UnlockRect(0);
+  assert(SUCCEEDED(result));
+  return true;
+}
+
+void D3D9RenderBackend::generateMipmaps(Texture *texture)
+{
+  if (!D3DCAPS2_CANAUTOGENMIPMAP || FAILED(m_d3d->CheckDeviceFormat(
+    D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, D3DFMT_X8R8G8B8,
+    D3DUSAGE_AUTOGENMIPMAP, D3DRTYPE_TEXTURE, D3DFMT_X8R8G8B8)))
+  {
+    ABORT("Cannot create mipmap chain");
+  }
+
+  d3d9(texture)->texture->GenerateMipSubLevels();
+}
+
+void D3D9RenderBackend::selectTexture(int stage, Texture *texture)
+{
+  HRESULT result = pD3DDevice->SetTexture(stage, texture != NULL ? d3d9(texture)->texture : NULL);
+  assert(SUCCEEDED(result));
+}
+
+/// A texture with no depth buffer of its own uses the original one.
+void D3D9RenderBackend::setRenderTarget(Texture *texture)
+{
+  if (texture == NULL)
+  {
+    pD3DDevice->SetRenderTarget(0, m_backBuffer);
+    pD3DDevice->SetDepthStencilSurface(m_depthStencil);
+    return;
+  }
+
+  D3D9Texture *t = d3d9(texture);
+
+  // if there isn't a surface object for the texture, get one.
+  if (t->surface == NULL)
+    t->texture->GetSurfaceLevel(0, &t->surface);
+
+  pD3DDevice->SetDepthStencilSurface(t->depthBuffer != NULL ? t->depthBuffer : m_depthStencil);
+
+  HRESULT result = pD3DDevice->SetRenderTarget(0, t->surface);
+  assert(SUCCEEDED(result));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Fonts
+//
+/////////////////////////////////////////////////////////////////////////////
+
+RenderBackend::Font *D3D9RenderBackend::createFont(const char *name, int width, int height, bool antialiased)
+{
+  D3DXFONT_DESC desc;
+  memset(&desc, 0, sizeof(desc));
+  strcpy_s(desc.FaceName, sizeof(desc.FaceName), name);
+  desc.Width = width;
+  desc.Height = height;
+  desc.OutputPrecision = 2;
+  desc.PitchAndFamily = VARIABLE_PITCH;
+  desc.Quality = antialiased ? ANTIALIASED_QUALITY : NONANTIALIASED_QUALITY;
+  desc.Weight = FW_BLACK;
+
+  D3D9Font *f = new D3D9Font;
+  if (FAILED(D3DXCreateFontIndirect(pD3DDevice, &desc, &f->font)))
+  {
+    delete f;
+    return NULL;
+  }
+  return f;
+}
+
+int D3D9RenderBackend::drawText(Font *font, const char *text, const IRectangle &box, unsigned flags, unsigned argb)
+{
+  DWORD format = 0;
+  if (flags & kTextCenter) format |= DT_CENTER;
+  if (flags & kTextRight) format |= DT_RIGHT;
+  if (flags & kTextBottom) format |= DT_BOTTOM;
+  if (flags & kTextWrap) format |= DT_WORDBREAK;
+  if (flags & kTextNoClip) format |= DT_NOCLIP;
+  if (flags & kTextMeasure) format |= DT_CALCRECT;
+
+  RECT rect;
+  rect.left = box.left;
+  rect.top = box.top;
+  rect.right = box.right;
+  rect.bottom = box.bottom;
+
+  return d3d9(font)->font->DrawTextA(NULL, text, -1, &rect, format, argb);
+}
+
+void D3D9RenderBackend::loseFont(Font *font)
+{
+  d3d9(font)->font->OnLostDevice();
+}
+
+void D3D9RenderBackend::resetFont(Font *font)
+{
+  d3d9(font)->font->OnResetDevice();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Buffers
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// Dynamic buffers go in default memory, where they're lost with the
+/// device; the others are managed by Direct3D.
+RenderBackend::Buffer *D3D9RenderBackend::createVertexBuffer(int bytes, unsigned format, bool dynamic)
+{
+  D3D9Buffer *b = new D3D9Buffer;
+  if (FAILED(pD3DDevice->CreateVertexBuffer(bytes,
+    dynamic ? D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY : 0, format,
+    dynamic ? D3DPOOL_DEFAULT : D3DPOOL_MANAGED, &b->vertices, NULL)))
+  {
+    delete b;
+    return NULL;
+  }
+  return b;
+}
+
+/// A reference device for debugging shaders only takes dynamic index buffers.
+RenderBackend::Buffer *D3D9RenderBackend::createIndexBuffer(int bytes, bool is32Bit, bool dynamic)
+{
+  dynamic = dynamic || m_deviceReference;
+
+  D3D9Buffer *b = new D3D9Buffer;
+  if (FAILED(pD3DDevice->CreateIndexBuffer(bytes,
+    dynamic ? D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY : 0,
+    is32Bit ? D3DFMT_INDEX32 : D3DFMT_INDEX16,
+    dynamic ? D3DPOOL_DEFAULT : D3DPOOL_MANAGED, &b->indices, NULL)))
+  {
+    delete b;
+    return NULL;
+  }
+  return b;
+}
+
+void *D3D9RenderBackend::lockBuffer(Buffer *buffer, int offset, int bytes, ELock lock)
+{
+  DWORD flags = 0;
+  if (lock == eLockDiscard)
+    flags = D3DLOCK_DISCARD;
+  else if (lock == eLockNoOverwrite)
+    flags = D3DLOCK_NOOVERWRITE;
+
+  D3D9Buffer *b = d3d9(buffer);
+  void *data = NULL;
+  HRESULT result = b->vertices != NULL ?
+    b->vertices->Lock(offset, bytes, &data, flags) :
+    b->indices->Lock(offset, bytes, &data, flags);
+  return SUCCEEDED(result) ? data : NULL;
+}
+
+bool D3D9RenderBackend::unlockBuffer(Buffer *buffer)
+{
+  D3D9Buffer *b = d3d9(buffer);
+  HRESULT result = b->vertices != NULL ? b->vertices->Unlock() : b->indices->Unlock();
+  return SUCCEEDED(result);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Drawing
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void D3D9RenderBackend::drawUser(EPrimitive primitive, unsigned format, const void *vertices, int vertexCount, int stride,
+  const unsigned short *indices, int primitiveCount)
+{
+  HRESULT result = pD3DDevice->SetFVF(format);
+  assert(SUCCEEDED(result));
+
+  result = pD3DDevice->DrawIndexedPrimitiveUP(
+    primitive == ePrimitiveLineList ? D3DPT_LINELIST : D3DPT_TRIANGLELIST,
+    0, vertexCount, primitiveCount, indices, D3DFMT_INDEX16, vertices, stride);
+  assert(SUCCEEDED(result));
+}
+
+/// The buffers are only given to the device if they aren't the ones it
+/// already has.
+void D3D9RenderBackend::drawIndexed(Buffer *vertices, unsigned format, int stride, Buffer *indices,
+  int baseVertex, int vertexCount, int startIndex, int triCount)
+{
+  LPDIRECT3DINDEXBUFFER9 ib = indices != NULL ? d3d9(indices)->indices : NULL;
+  if (ib != m_curIndexBuffer)
+  {
+    pD3DDevice->SetIndices(ib);
+    m_curIndexBuffer = ib;
+  }
+
+  LPDIRECT3DVERTEXBUFFER9 vb = vertices != NULL ? d3d9(vertices)->vertices : NULL;
+  if (vb != m_curVertexBuffer)
+  {
+    pD3DDevice->SetStreamSource(0, vb, 0, stride);
+    m_curVertexBuffer = vb;
+  }
+
+  pD3DDevice->SetFVF(format);
+  pD3DDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, baseVertex, 0, vertexCount, startIndex, triCount);
+}
+
+void D3D9RenderBackend::draw(Buffer *vertices, unsigned format, int stride, int startVertex, int triCount)
+{
+  LPDIRECT3DVERTEXBUFFER9 vb = vertices != NULL ? d3d9(vertices)->vertices : NULL;
+  if (vb != m_curVertexBuffer)
+  {
+    pD3DDevice->SetStreamSource(0, vb, 0, stride);
+    m_curVertexBuffer = vb;
+  }
+
+  pD3DDevice->SetFVF(format);
+  pD3DDevice->DrawPrimitive(D3DPT_TRIANGLELIST, startVertex, triCount);
+}
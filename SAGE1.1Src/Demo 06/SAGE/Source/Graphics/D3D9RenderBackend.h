@@ -0,0 +1,111 @@
+/// \file D3D9RenderBackend.h
+/// \brief Interface for the D3D9RenderBackend class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// D3D9RenderBackend.h - Draws with Direct3D 9
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __D3D9RENDERBACKEND_H_INCLUDED__
+#define __D3D9RENDERBACKEND_H_INCLUDED__
+
+#include <d3d9.h>
+#include "RenderBackend.h"
+
+//-----------------------------------------------------------------------------
+/// \brief Draws with Direct3D 9, in a window made by the WindowsWrapper.
+///
+/// All the Direct3D the renderer uses is in here.  The device is also kept
+/// in the global pD3DDevice, for the shader effects, which still use it
+/// directly.
+class D3D9RenderBackend : public RenderBackend
+{
+public:
+
+  /// \brief Constructor.  Nothing is made until init().
+  /// \param shaderDebug True to make a reference device, so that shaders
+  /// can be debugged
+  /// \param windowed True to run in a window rather than full screen
+  D3D9RenderBackend(bool shaderDebug, bool windowed);
+  ~D3D9RenderBackend(); ///< Calls shutdown()
+
+  /// \brief Returns true if shader debugging is on
+  bool getShaderDebug() const { return m_shaderDebug; }
+
+  void init(const VideoMode &mode);
+  void shutdown();
+  int getVideoModeCount();
+  unsigned long getMaxVertexIndex() { return m_maxVertexIndex; }
+  bool validateDevice();
+  void resetDevice();
+  void beginScene();
+  void endScene();
+  void present();
+  bool readFrameTime(float *seconds);
+  long getTime();
+
+  void setState(ERenderState state, unsigned value);
+  void setDefaultStates();
+  void setMaterialOpacity(float opacity);
+  void setDirectionalLight(const Vector3 &direction, unsigned rgb);
+  void setTransform(ETransform transform, const float *m);
+  void setViewport(int x, int y, int xSize, int ySize);
+  void setClipPlane(const Plane *plane);
+  void clear(bool frameBuffer, bool depthBuffer, unsigned argb);
+
+  Texture *createTexture(int xSize, int ySize, bool renderTarget, bool depthStencil);
+  Texture *loadTexture(const char *filename, bool mipmaps);
+  bool setTextureImage(Texture *texture, const unsigned *image, int xSize, int ySize);
+  void generateMipmaps(Texture *texture);
+  void selectTexture(int stage, Texture *texture);
+  void setRenderTarget(Texture *texture);
+
+  Font *createFont(const char *name, int width, int height, bool antialiased);
+  int drawText(Font *font, const char *text, const IRectangle &box, unsigned flags, unsigned argb);
+  void loseFont(Font *font);
+  void resetFont(Font *font);
+
+  Buffer *createVertexBuffer(int bytes, unsigned format, bool dynamic);
+  Buffer *createIndexBuffer(int bytes, bool is32Bit, bool dynamic);
+  void *lockBuffer(Buffer *buffer, int offset, int bytes, ELock lock);
+  bool unlockBuffer(Buffer *buffer);
+
+  void drawUser(EPrimitive primitive, unsigned format, const void *vertices, int vertexCount, int stride,
+    const unsigned short *indices, int primitiveCount);
+  void drawIndexed(Buffer *vertices, unsigned format, int stride, Buffer *indices,
+    int baseVertex, int vertexCount, int startIndex, int triCount);
+  void draw(Buffer *vertices, unsigned format, int stride, int startVertex, int triCount);
+
+private:
+  bool m_shaderDebug; ///< True to make shaders for debugging, which needs a reference device
+  bool m_deviceReference; ///< True if the device is a reference device
+  bool m_windowed; ///< True to run in a window
+
+  LPDIRECT3D9 m_d3d; ///< Direct3D interface object
+  D3DPRESENT_PARAMETERS m_presentParms; ///< How the device was made, for resetting it
+  LPDIRECT3DSURFACE9 m_backBuffer; ///< The original back buffer
+  LPDIRECT3DSURFACE9 m_depthStencil; ///< The original depth buffer
+  unsigned long m_maxVertexIndex; ///< Largest vertex index the device can draw with
+
+  int m_videoModeCount; ///< Number of video modes, 0 until they're enumerated
+  VideoMode *m_videoModeList; ///< The video modes
+
+  D3DMATERIAL9 m_material; ///< The one material
+  D3DLIGHT9 m_light; ///< The directional light
+
+  LARGE_INTEGER m_lastClock; ///< Last clock reading, zero if there hasn't been one
+  float m_timerFrequency; ///< Clock ticks a second
+
+  LPDIRECT3DINDEXBUFFER9 m_curIndexBuffer; ///< Index buffer last set, so it isn't set again
+  LPDIRECT3DVERTEXBUFFER9 m_curVertexBuffer; ///< Vertex buffer last set, so it isn't set again
+
+  void getSurfaces(); ///< Gets the original back and depth buffers
+  void releaseSurfaces(); ///< Releases the original back and depth buffers
+};
+//-----------------------------------------------------------------------------
+
+/// The device, for the code that still uses Direct3D directly
+extern LPDIRECT3DDEVICE9 pD3DDevice;
+
+#endif // #ifndef __D3D9RENDERBACKEND_H_INCLUDED__
@@ -34,11 +34,9 @@
 #include "Effect.h"
 #include <fstream>
 #include <string>
-#include "directorymanager/directorymanager.h"
-#include "common/Renderer.h"
-
-// get the directX device
-extern LPDIRECT3DDEVICE9 pD3DDevice;
+#include "DirectoryManager/DirectoryManager.h"
+#include "Common/Renderer.h"
+#include "D3D9RenderBackend.h"
 
 /// Loads an effect file into memory
 /// \param fileName Name of effect file
@@ -50,12 +48,19 @@ Effect::Effect(std::string fileName, bool isDynamic,bool defaultDirectory)
 : ResourceBase(isDynamic),
 m_clipPlaneChanged(false)
 {
+  // Without a device there's nothing to load the effect into, and every
+  // other call does nothing without one
+  if (gRenderer.isHeadless())
+  {
+    m_pEffect = NULL;
+    return;
+  }
   
 	ID3DXBuffer* cErrors; // holds errors returned if effect file was invalid
   DWORD shaderFlags;
 
   // set the shaderFlags accordingly for 
-  if (gRenderer.getShaderDebug())
+  if (static_cast<D3D9RenderBackend*>(gRenderer.getBackend())->getShaderDebug())
     shaderFlags = D3DXSHADER_DEBUG | D3DXSHADER_SKIPOPTIMIZATION;   
   else
     shaderFlags = D3DXSHADER_NO_PRESHADER;
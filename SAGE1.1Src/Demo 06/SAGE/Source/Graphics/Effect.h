@@ -33,13 +33,13 @@
 #ifndef __EFFECT_H_INCLUDED__
 #define __EFFECT_H_INCLUDED__
 
-#include "resource/ResourceBase.h"
+#include "Resource/ResourceBase.h"
 #include <d3dx9effect.h>
 #include <string>
-#include "common/Matrix4x3.h"
-#include "common/vector3.h"
-#include "common/vector2.h"
-#include "common/plane.h"
+#include "Common/Matrix4x3.h"
+#include "Common/vector3.h"
+#include "Common/vector2.h"
+#include "Common/plane.h"
 
 
 //-----------------------------------------------------------------------------
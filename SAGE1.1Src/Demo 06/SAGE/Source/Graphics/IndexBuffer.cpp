@@ -32,19 +32,20 @@
 
 #include "IndexBuffer.h"
 
-extern LPDIRECT3DDEVICE9 pD3DDevice;
-
-
 /// \param triCount Number of triangles the index buffer should hold.
 /// \param isDynamic Whether the buffer should be dynamic, default is false
+/// \param is32Bit Whether the buffer holds 32-bit indices, default is false.
+/// Only use this if the renderer says the device supports them.
 /// \remark triCount is the number of triangles, not the number of vertex
 /// indices, the index buffer should hold. For example, to store a quad
 /// (two triangles, four vertices), triCount should be two, not six.
-IndexBuffer::IndexBuffer(int triCount, bool isDynamic)
+IndexBuffer::IndexBuffer(int triCount, bool isDynamic, bool is32Bit)
 : ResourceBase(isDynamic),
   m_count(triCount),
   m_bufferLocked(false),
-  m_isDynamic(isDynamic)
+  m_isDynamic(isDynamic),
+  m_is32Bit(is32Bit),
+  m_buffer(NULL)
 {
   restore();
 }
@@ -74,13 +75,15 @@ IndexBuffer::~IndexBuffer()
 /// \return True if the lock was successful, false otherwise
 bool IndexBuffer::lock()
 {
-  if(m_dxBuffer == NULL || m_bufferLocked)
+  if(m_buffer == NULL || m_bufferLocked)
   {
     return false;
   }
 
-  if( FAILED( m_dxBuffer->Lock(
-    0, 0, (void**)(&m_data), m_isDynamic ? D3DLOCK_DISCARD : 0) ) )
+  gRenderer.countCall(eRenderCallLock);
+  m_data = (unsigned char*)gRenderer.getBackend()->lockBuffer(m_buffer, 0, 0,
+    m_isDynamic ? RenderBackend::eLockDiscard : RenderBackend::eLockNormal);
+  if(m_data == NULL)
   {
     // you may want to abort here
     return false;
@@ -93,12 +96,12 @@ bool IndexBuffer::lock()
 
 bool IndexBuffer::unlock()
 {
-  if(m_dxBuffer == NULL || !m_bufferLocked)
+  if(m_buffer == NULL || !m_bufferLocked)
   {
     return false;
   }
 
-  if( FAILED( m_dxBuffer->Unlock() ) )
+  if(!gRenderer.getBackend()->unlockBuffer(m_buffer))
   {
     return false;
   }
@@ -109,42 +112,17 @@ bool IndexBuffer::unlock()
 
 void IndexBuffer::release()
 {
-  if(m_dxBuffer != NULL)
-  {
-    m_dxBuffer->Release();
-    m_dxBuffer = NULL;
-  }
+  delete m_buffer;
+  m_buffer = NULL;
 }
 
 void IndexBuffer::restore()
 {
-  // if dynamic is requested or if we are in reference mode for debugging shaders
-  if(m_isDynamic || gRenderer.getDeviceReference())
-  {
-    if( FAILED( pD3DDevice->CreateIndexBuffer(
-      m_count * sizeof(RenderTri),
-      D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
-      D3DFMT_INDEX16,
-      D3DPOOL_DEFAULT,
-      &m_dxBuffer,
-      NULL) ) )
-    {
-      m_dxBuffer = NULL;
-    }
-  }
-  else
-  {
-    if( FAILED( pD3DDevice->CreateIndexBuffer(
-      m_count * sizeof(RenderTri),
-      0,
-      D3DFMT_INDEX16,
-      D3DPOOL_MANAGED,
-      &m_dxBuffer,
-      NULL) ) )
-    {
-      m_dxBuffer = NULL;
-    }
-  }
+  int triSize = m_is32Bit ? sizeof(RenderTri32) : sizeof(RenderTri);
+
+  // a failure leaves the buffer NULL, and it can't be locked
+  gRenderer.countCall(eRenderCallCreate);
+  m_buffer = gRenderer.getBackend()->createIndexBuffer(m_count * triSize, m_is32Bit, m_isDynamic);
 
   m_bufferLocked = false;
   m_dataEmpty = true;
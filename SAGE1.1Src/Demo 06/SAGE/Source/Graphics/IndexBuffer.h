@@ -33,15 +33,15 @@
 #ifndef __INDEXBUFFER_H_INCLUDED__
 #define __INDEXBUFFER_H_INCLUDED__
 
-#include "resource/ResourceBase.h"
-#include "common/Renderer.h"
-#include <d3d9.h>
+#include "Resource/ResourceBase.h"
+#include "Common/Renderer.h"
+#include "RenderBackend.h"
 
 //-----------------------------------------------------------------------------
 /// \class IndexBuffer
-/// \brief Wrapper over the DirectX index buffer.
+/// \brief Wrapper over the backend's index buffer.
 ///
-/// Wraps the DirectX index buffer for common usuage.
+/// Wraps the index buffer for common usuage.
 ///
 /// \remarks The buffer is dynamic, which will allow you to change the data if
 /// needed.
@@ -50,7 +50,7 @@ class IndexBuffer : public ResourceBase
   friend class Renderer;
 
 public:
-  IndexBuffer(int triCount, bool isDynamic = false); ///< Basic constructor
+  IndexBuffer(int triCount, bool isDynamic = false, bool is32Bit = false); ///< Basic constructor
   ~IndexBuffer(); ///< Basic destructor
 
   /// \brief Locks the index buffer, allowing you to write to it
@@ -68,7 +68,8 @@ public:
   /// Make sure the value of i is between 0 and the number of triangles
   /// stored by this buffer. \n \n
   /// Also, the operation does not check to see if the buffer is currently
-  /// locked. Make sure the buffer is locked while writing to it.
+  /// locked. Make sure the buffer is locked while writing to it. \n \n
+  /// Only valid for 16-bit buffers.  Use setTri for either kind.
   /// \see lock
   RenderTri &operator[] (int i) { return ((RenderTri*)m_data)[i]; }
 
@@ -83,21 +84,48 @@ public:
   /// \see lock
   const RenderTri &operator[] (int i) const { return ((RenderTri*)m_data)[i]; }
 
+  /// \brief Writes a triangle, whatever the index size of the buffer
+  /// \param i Index of the triangle to write to
+  /// \param a First vertex index
+  /// \param b Second vertex index
+  /// \param c Third vertex index
+  /// \warning Like operator[], this doesn't do bounds checking or check
+  /// that the buffer is locked. \n \n
+  /// For a 16-bit buffer the indices must fit in an unsigned short.
+  void setTri(int i, unsigned a, unsigned b, unsigned c)
+  {
+    if(m_is32Bit)
+    {
+      RenderTri32 &t = ((RenderTri32*)m_data)[i];
+      t.index[0] = a; t.index[1] = b; t.index[2] = c;
+    }
+    else
+    {
+      RenderTri &t = ((RenderTri*)m_data)[i];
+      t.index[0] = (unsigned short)a; t.index[1] = (unsigned short)b; t.index[2] = (unsigned short)c;
+    }
+  }
+
   /// \brief Get the number of triangles the buffer holds
   /// \return The number of triangles the buffer holds
   int getCount() { return m_count; }
 
+  /// \brief Get whether the buffer holds 32-bit indices
+  /// \return True for 32-bit indices, false for 16-bit
+  bool is32Bit() const { return m_is32Bit; }
+
   /// \brief Get whether the buffer is currently locked
   /// \return True if the buffer is currently locked, false otherwise
   bool isLocked() { return m_bufferLocked; }
 
 private:
   int m_count; ///< Number of triangles stored
-  BYTE *m_data; ///< Pointer to the buffer while locked
+  unsigned char *m_data; ///< Pointer to the buffer while locked
   bool m_bufferLocked; ///< Whether the buffer is locked
   bool m_dataEmpty; ///< Whether the buffer has been filled (locked) since the last restore()
   bool m_isDynamic;
-  LPDIRECT3DINDEXBUFFER9 m_dxBuffer; ///< Pointer to the DX index buffer interface
+  bool m_is32Bit; ///< Whether the indices are 32-bit rather than 16-bit
+  RenderBackend::Buffer *m_buffer; ///< The buffer, as the backend made it
 
   void release();
   void restore();
@@ -33,7 +33,7 @@
 #include <list>
 #include "DerivedModels/AnimatedModel.h"
 #include "DerivedModels/ArticulatedModel.h"
-#include "directorymanager/DirectoryManager.h"
+#include "DirectoryManager/DirectoryManager.h"
 #include "Common/EulerAngles.h"
 #include "ModelManager.h"
 
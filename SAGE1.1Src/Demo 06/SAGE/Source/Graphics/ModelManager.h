@@ -35,10 +35,10 @@
 #ifndef __MODELMANAGER_H_INCLUDED__
 #define __MODELMANAGER_H_INCLUDED__
 
-#include <hash_map>
+#include "Common/Portable.h"
 #include <string>
 #include "TinyXML/tinyxml.h"
-#include "generators/IDGenerator.h"
+#include "Generators/IDGenerator.h"
 
 class EulerAngles;
 class Model;
@@ -0,0 +1,101 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// NullRenderBackend.cpp - Draws nothing, for running without a display
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file NullRenderBackend.cpp
+/// \brief Code for the NullRenderBackend class.
+
+#include <stdio.h>
+#include "NullRenderBackend.h"
+
+namespace
+{
+  /// \brief A buffer in memory
+  struct NullBuffer : public RenderBackend::Buffer
+  {
+    char *data; ///< The bytes
+
+    NullBuffer(int bytes) : data(new char[bytes]) {}
+    ~NullBuffer() { delete [] data; }
+  };
+}
+
+/// \param frameTime Seconds each frame is taken to last
+NullRenderBackend::NullRenderBackend(float frameTime)
+{
+  m_frameTime = frameTime;
+  m_frames = 0;
+  m_mode.xRes = 0;
+  m_mode.yRes = 0;
+  m_mode.bitsPerPixel = 0;
+  m_mode.refreshHz = 0;
+}
+
+/// Any mode will do; it becomes the only one there is.
+void NullRenderBackend::init(const VideoMode &mode)
+{
+  m_mode = mode;
+  m_frames = 0;
+}
+
+int NullRenderBackend::getVideoModeCount()
+{
+  return m_mode.xRes > 0 ? 1 : 0;
+}
+
+void NullRenderBackend::present()
+{
+  ++m_frames;
+}
+
+/// \param seconds Address of a float to store the frame time
+/// \return Always true
+bool NullRenderBackend::readFrameTime(float *seconds)
+{
+  *seconds = m_frameTime;
+  return true;
+}
+
+/// \return Time in milliseconds of the frames presented so far
+long NullRenderBackend::getTime()
+{
+  return (long)(m_frames * m_frameTime * 1000.0f);
+}
+
+RenderBackend::Texture *NullRenderBackend::createTexture(int, int, bool, bool)
+{
+  return new Texture;
+}
+
+/// The file must still be there, so that a missing one fails the same as
+/// it would with a device.
+RenderBackend::Texture *NullRenderBackend::loadTexture(const char *filename, bool)
+{
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL)
+    return NULL;
+  fclose(f);
+  return new Texture;
+}
+
+RenderBackend::Font *NullRenderBackend::createFont(const char *, int, int, bool)
+{
+  return new Font;
+}
+
+RenderBackend::Buffer *NullRenderBackend::createVertexBuffer(int bytes, unsigned, bool)
+{
+  return new NullBuffer(bytes);
+}
+
+RenderBackend::Buffer *NullRenderBackend::createIndexBuffer(int bytes, bool, bool)
+{
+  return new NullBuffer(bytes);
+}
+
+void *NullRenderBackend::lockBuffer(Buffer *buffer, int offset, int, ELock)
+{
+  return static_cast<NullBuffer*>(buffer)->data + offset;
+}
@@ -0,0 +1,84 @@
+/// \file NullRenderBackend.h
+/// \brief Interface for the NullRenderBackend class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// NullRenderBackend.h - Draws nothing, for running without a display
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NULLRENDERBACKEND_H_INCLUDED__
+#define __NULLRENDERBACKEND_H_INCLUDED__
+
+#include "RenderBackend.h"
+
+//-----------------------------------------------------------------------------
+/// \brief A backend with no device, that draws nothing.
+///
+/// Buffers are kept in memory, so they can still be locked and written,
+/// and textures and fonts are empty placeholders.  The clock runs a fixed
+/// time a frame, so a headless run steps the same every time.  It needs
+/// neither Windows nor Direct3D, which is what the engine is built and
+/// tested with elsewhere.
+///
+/// Everything is virtual, so a test can derive from it to see the calls
+/// the renderer makes.
+class NullRenderBackend : public RenderBackend
+{
+public:
+
+  /// \brief Constructor
+  /// \param frameTime Seconds each frame is taken to last
+  NullRenderBackend(float frameTime);
+
+  void init(const VideoMode &mode);
+  void shutdown() {}
+  bool isHeadless() const { return true; }
+  int getVideoModeCount();
+  unsigned long getMaxVertexIndex() { return 0xFFFFFFFF; }
+  bool validateDevice() { return false; }
+  void resetDevice() {}
+  void beginScene() {}
+  void endScene() {}
+  void present();
+  bool readFrameTime(float *seconds);
+  long getTime();
+
+  void setState(ERenderState, unsigned) {}
+  void setDefaultStates() {}
+  void setMaterialOpacity(float) {}
+  void setDirectionalLight(const Vector3 &, unsigned) {}
+  void setTransform(ETransform, const float *) {}
+  void setViewport(int, int, int, int) {}
+  void setClipPlane(const Plane *) {}
+  void clear(bool, bool, unsigned) {}
+
+  Texture *createTexture(int xSize, int ySize, bool renderTarget, bool depthStencil);
+  Texture *loadTexture(const char *filename, bool mipmaps);
+  bool setTextureImage(Texture *, const unsigned *, int, int) { return true; }
+  void generateMipmaps(Texture *) {}
+  void selectTexture(int, Texture *) {}
+  void setRenderTarget(Texture *) {}
+
+  Font *createFont(const char *name, int width, int height, bool antialiased);
+  int drawText(Font *, const char *, const IRectangle &, unsigned, unsigned) { return 0; }
+  void loseFont(Font *) {}
+  void resetFont(Font *) {}
+
+  Buffer *createVertexBuffer(int bytes, unsigned format, bool dynamic);
+  Buffer *createIndexBuffer(int bytes, bool is32Bit, bool dynamic);
+  void *lockBuffer(Buffer *buffer, int offset, int bytes, ELock lock);
+  bool unlockBuffer(Buffer *) { return true; }
+
+  void drawUser(EPrimitive, unsigned, const void *, int, int, const unsigned short *, int) {}
+  void drawIndexed(Buffer *, unsigned, int, Buffer *, int, int, int, int) {}
+  void draw(Buffer *, unsigned, int, int, int) {}
+
+private:
+  float m_frameTime; ///< Seconds each frame is taken to last
+  long m_frames; ///< Frames presented
+  VideoMode m_mode; ///< The one video mode, the one asked for
+};
+//-----------------------------------------------------------------------------
+
+#endif // #ifndef __NULLRENDERBACKEND_H_INCLUDED__
@@ -0,0 +1,286 @@
+/// \file RenderBackend.h
+/// \brief Interface for the RenderBackend class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// RenderBackend.h - What the renderer needs from a graphics API
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __RENDERBACKEND_H_INCLUDED__
+#define __RENDERBACKEND_H_INCLUDED__
+
+#include "Common/Renderer.h"
+
+class Vector3;
+
+//-----------------------------------------------------------------------------
+/// \brief The calls the renderer makes on a graphics API.
+///
+/// Renderer keeps all the state, the counting and the math, and passes the
+/// device work through one of these, so nothing above it ever sees the API.
+/// D3D9RenderBackend draws with Direct3D 9; NullRenderBackend draws nothing
+/// and needs no window, which is how the game runs headless and how the
+/// engine is built and tested where there is no Direct3D at all.
+///
+/// Textures, fonts and buffers are handed out as pointers to the small
+/// structs below, which each backend derives from to hold its own objects.
+/// Deleting one frees it.
+///
+/// The renderer remembers every state it sets, so a backend never has to
+/// read one back.  A failure to create something returns NULL and is left
+/// to the caller to report.
+class RenderBackend
+{
+public:
+
+  /// \brief A texture made by the backend
+  struct Texture { virtual ~Texture() {} };
+
+  /// \brief A font made by the backend
+  struct Font { virtual ~Font() {} };
+
+  /// \brief A vertex or index buffer made by the backend
+  struct Buffer { virtual ~Buffer() {} };
+
+  /// Matrices set with setTransform()
+  enum ETransform
+  {
+    eTransformWorld,      ///< Model to world
+    eTransformView,       ///< World to camera
+    eTransformProjection  ///< Camera to clip
+  };
+
+  /// Ways of locking a buffer
+  enum ELock
+  {
+    eLockNormal,      ///< Waits for any draw still using the buffer
+    eLockDiscard,     ///< Throws the old contents away, dynamic buffers only
+    eLockNoOverwrite  ///< Promises not to touch anything being drawn, dynamic buffers only
+  };
+
+  /// Kinds of primitive drawn with drawUser()
+  enum EPrimitive
+  {
+    ePrimitiveTriangleList, ///< Three indices a triangle
+    ePrimitiveLineList      ///< Two indices a line
+  };
+
+  /// \name Text flags
+  /// Bitfield of options to drawText()
+  //@{
+  enum
+  {
+    kTextLeft = 0,      ///< Align to the left of the box
+    kTextCenter = 1,    ///< Center in the box
+    kTextRight = 2,     ///< Align to the right of the box
+    kTextBottom = 4,    ///< Align to the bottom of the box
+    kTextWrap = 8,      ///< Break lines between words to fit the box
+    kTextNoClip = 16,   ///< Don't clip to the box
+    kTextMeasure = 32   ///< Only work out the height, draw nothing
+  };
+  //@}
+
+  virtual ~RenderBackend() {}
+
+  /// \name Device
+  //@{
+
+  /// \brief Makes the device.  Aborts if it can't.
+  /// \param mode Video mode to set
+  virtual void init(const VideoMode &mode) = 0;
+
+  /// \brief Frees the device and anything else the backend made
+  virtual void shutdown() = 0;
+
+  /// \brief Returns true if nothing is drawn and there's no display
+  virtual bool isHeadless() const { return false; }
+
+  /// \brief Returns the number of video modes available
+  virtual int getVideoModeCount() = 0;
+
+  /// \brief Returns the largest vertex index the device can draw with
+  virtual unsigned long getMaxVertexIndex() = 0;
+
+  /// \brief Waits out a lost device and resets it
+  /// \return True if the device was reset, and the render states must be
+  /// set again
+  virtual bool validateDevice() = 0;
+
+  /// \brief Resets the device when the app comes back to the foreground
+  virtual void resetDevice() = 0;
+
+  virtual void beginScene() = 0; ///< Begins the scene
+  virtual void endScene() = 0; ///< Ends the scene
+  virtual void present() = 0; ///< Shows the back buffer
+
+  /// \brief Reads the clock, at a page flip
+  /// \param seconds Address of a float to store the time since the last
+  /// reading, in seconds
+  /// \return False if there is no earlier reading to measure from, leaving
+  /// seconds alone
+  virtual bool readFrameTime(float *seconds) = 0;
+
+  /// \brief Returns the time in milliseconds, from some arbitrary start
+  virtual long getTime() = 0;
+  //@}
+
+  /// \name State
+  //@{
+
+  /// \brief Sets one of the states the renderer keeps
+  /// \param state The state
+  /// \param value Its value, see ERenderState for what each takes
+  virtual void setState(ERenderState state, unsigned value) = 0;
+
+  /// \brief Sets the states the renderer never changes: fog mode, texture
+  /// filtering and wrapping, and turning on the directional light
+  virtual void setDefaultStates() = 0;
+
+  /// \brief Sets the material, which is white with the given opacity
+  virtual void setMaterialOpacity(float opacity) = 0;
+
+  /// \brief Sets the directional light
+  /// \param direction Unit vector the light shines along
+  /// \param rgb Color of the light
+  virtual void setDirectionalLight(const Vector3 &direction, unsigned rgb) = 0;
+
+  /// \brief Sets a matrix
+  /// \param transform Which matrix
+  /// \param m 4x4 matrix, row by row, for row vectors
+  virtual void setTransform(ETransform transform, const float *m) = 0;
+
+  /// \brief Sets the part of the render target drawn to
+  virtual void setViewport(int x, int y, int xSize, int ySize) = 0;
+
+  /// \brief Sets a user clipping plane, in world space
+  /// \param plane The plane, or NULL for none
+  virtual void setClipPlane(const Plane *plane) = 0;
+
+  /// \brief Clears the viewport
+  /// \param frameBuffer True to clear the frame buffer
+  /// \param depthBuffer True to clear the depth buffer
+  /// \param argb Color to clear the frame buffer to
+  virtual void clear(bool frameBuffer, bool depthBuffer, unsigned argb) = 0;
+  //@}
+
+  /// \name Textures
+  //@{
+
+  /// \brief Makes a 32-bit texture, mipmapped unless it's a render target
+  /// \param xSize Width, a power of two
+  /// \param ySize Height, a power of two
+  /// \param renderTarget True if it's to be rendered to
+  /// \param depthStencil True to give a render target its own depth buffer
+  /// \return The texture, NULL if it couldn't be made
+  virtual Texture *createTexture(int xSize, int ySize, bool renderTarget, bool depthStencil) = 0;
+
+  /// \brief Loads a texture from an image file in the current directory
+  /// \param filename Name of the file
+  /// \param mipmaps False for the top level only
+  /// \return The texture, NULL if it couldn't be loaded
+  virtual Texture *loadTexture(const char *filename, bool mipmaps) = 0;
+
+  /// \brief Copies a 32-bit 0xAARRGGBB image into the top level of a texture
+  /// \return True if it was copied
+  virtual bool setTextureImage(Texture *texture, const unsigned *image, int xSize, int ySize) = 0;
+
+  /// \brief Makes the lower levels of a texture from the top one
+  virtual void generateMipmaps(Texture *texture) = 0;
+
+  /// \brief Selects a texture, or NULL for none, into a texture stage
+  virtual void selectTexture(int stage, Texture *texture) = 0;
+
+  /// \brief Renders to a texture, or NULL to go back to the back buffer
+  virtual void setRenderTarget(Texture *texture) = 0;
+  //@}
+
+  /// \name Fonts
+  //@{
+
+  /// \brief Makes a font
+  /// \return The font, NULL if it couldn't be made
+  virtual Font *createFont(const char *name, int width, int height, bool antialiased) = 0;
+
+  /// \brief Draws text, or measures it with kTextMeasure
+  /// \param font The font
+  /// \param text The text
+  /// \param box Box to put the text in.  Only the left and top matter with
+  /// kTextNoClip; with kTextMeasure, only the width.
+  /// \param flags Bitfield of the kTextXxx constants
+  /// \param argb Color of the text
+  /// \return Height of the text in pixels
+  virtual int drawText(Font *font, const char *text, const IRectangle &box, unsigned flags, unsigned argb) = 0;
+
+  virtual void loseFont(Font *font) = 0; ///< Lets go of the device before it's reset
+  virtual void resetFont(Font *font) = 0; ///< Picks the device up again after it's reset
+  //@}
+
+  /// \name Buffers
+  //@{
+
+  /// \brief Makes a vertex buffer
+  /// \param bytes Size of the buffer
+  /// \param format Bitfield of the kVertexFormatXxx constants
+  /// \param dynamic True if it's to be filled again and again
+  /// \return The buffer, NULL if it couldn't be made
+  virtual Buffer *createVertexBuffer(int bytes, unsigned format, bool dynamic) = 0;
+
+  /// \brief Makes an index buffer
+  /// \param bytes Size of the buffer
+  /// \param is32Bit True for 32-bit indices, false for 16-bit
+  /// \param dynamic True if it's to be filled again and again
+  /// \return The buffer, NULL if it couldn't be made
+  virtual Buffer *createIndexBuffer(int bytes, bool is32Bit, bool dynamic) = 0;
+
+  /// \brief Locks part of a buffer for writing
+  /// \param buffer The buffer
+  /// \param offset First byte to lock
+  /// \param bytes Number of bytes to lock, 0 for all of them
+  /// \param lock How to lock it
+  /// \return Address of the first byte locked, NULL if it couldn't be locked
+  virtual void *lockBuffer(Buffer *buffer, int offset, int bytes, ELock lock) = 0;
+
+  /// \brief Unlocks a buffer
+  /// \return True if it was unlocked
+  virtual bool unlockBuffer(Buffer *buffer) = 0;
+  //@}
+
+  /// \name Drawing
+  //@{
+
+  /// \brief Draws indexed primitives from memory
+  /// \param primitive Kind of primitive
+  /// \param format Bitfield of the kVertexFormatXxx constants
+  /// \param vertices The vertices
+  /// \param vertexCount Number of vertices
+  /// \param stride Size of a vertex
+  /// \param indices 16-bit indices of the primitives' vertices
+  /// \param primitiveCount Number of primitives
+  virtual void drawUser(EPrimitive primitive, unsigned format, const void *vertices, int vertexCount, int stride,
+    const unsigned short *indices, int primitiveCount) = 0;
+
+  /// \brief Draws an indexed triangle list from buffers
+  /// \param vertices The vertex buffer
+  /// \param format Bitfield of the kVertexFormatXxx constants
+  /// \param stride Size of a vertex
+  /// \param indices The index buffer
+  /// \param baseVertex Vertex that index 0 refers to
+  /// \param vertexCount Number of vertices used, from baseVertex on
+  /// \param startIndex First index to draw from
+  /// \param triCount Number of triangles
+  virtual void drawIndexed(Buffer *vertices, unsigned format, int stride, Buffer *indices,
+    int baseVertex, int vertexCount, int startIndex, int triCount) = 0;
+
+  /// \brief Draws a triangle list from a vertex buffer
+  /// \param vertices The vertex buffer
+  /// \param format Bitfield of the kVertexFormatXxx constants
+  /// \param stride Size of a vertex
+  /// \param startVertex First vertex to draw
+  /// \param triCount Number of triangles
+  virtual void draw(Buffer *vertices, unsigned format, int stride, int startVertex, int triCount) = 0;
+  //@}
+};
+//-----------------------------------------------------------------------------
+
+#endif // #ifndef __RENDERBACKEND_H_INCLUDED__
@@ -34,7 +34,7 @@
 #define __VERTEXBUFFER_H_INCLUDED__
 
 #include "VertexBufferBase.h"
-#include "common/Renderer.h"
+#include "Common/Renderer.h"
 
 /// \class VertexBuffer
 /// \brief Vertex buffer using RenderVertex struct to define the vertex format
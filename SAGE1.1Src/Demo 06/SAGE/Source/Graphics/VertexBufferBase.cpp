@@ -31,17 +31,17 @@
 /// \brief Code for the VertexBufferBase class.
 
 #include "VertexBufferBase.h"
-#include "common/CommonStuff.h"
+#include "Common/CommonStuff.h"
+#include "Common/Renderer.h"
 
-extern LPDIRECT3DDEVICE9 pD3DDevice;
-
-VertexBufferBase::VertexBufferBase(int count, bool isDynamic, DWORD fvf, int vertexStride)
+VertexBufferBase::VertexBufferBase(int count, bool isDynamic, unsigned fvf, int vertexStride)
 : ResourceBase(isDynamic),
   m_count(count),
+  m_FVF(fvf),
+  m_vertexStride(vertexStride),
   m_bufferLocked(false),
   m_isDynamic(isDynamic),
-  m_FVF(fvf),
-  m_vertexStride(vertexStride)
+  m_buffer(NULL)
 {
 }
 
@@ -52,13 +52,15 @@ VertexBufferBase::~VertexBufferBase()
 
 bool VertexBufferBase::lock()
 {
-  if(m_dxBuffer == NULL || m_bufferLocked)
+  if(m_buffer == NULL || m_bufferLocked)
   {
     return false;
   }
 
-  if( FAILED( m_dxBuffer->Lock(
-    0, 0, (void**)(&m_data), m_isDynamic ? D3DLOCK_DISCARD : 0) ) )
+  gRenderer.countCall(eRenderCallLock);
+  m_data = (unsigned char*)gRenderer.getBackend()->lockBuffer(m_buffer, 0, 0,
+    m_isDynamic ? RenderBackend::eLockDiscard : RenderBackend::eLockNormal);
+  if(m_data == NULL)
   {
     // you may want to abort here
     return false;
@@ -69,14 +71,48 @@ bool VertexBufferBase::lock()
   return true;
 }
 
+/// A dynamic buffer can be used as a ring, appending vertices after the
+/// ones already drawn this frame.  Locking from the start discards the old
+/// contents, so the driver can hand over fresh memory instead of waiting
+/// for the draws still using it; locking anywhere else promises not to
+/// touch the vertices before start, so it doesn't have to wait either.
+/// \param start First vertex to lock
+/// \param count Number of vertices to lock
+/// \return True if the buffer was locked
+/// \remark While locked this way, element 0 is vertex start.
+bool VertexBufferBase::lock(int start, int count)
+{
+  if(m_buffer == NULL || m_bufferLocked ||
+    start < 0 || count <= 0 || start + count > m_count)
+  {
+    return false;
+  }
+
+  RenderBackend::ELock lock = RenderBackend::eLockNormal;
+  if(m_isDynamic)
+    lock = start == 0 ? RenderBackend::eLockDiscard : RenderBackend::eLockNoOverwrite;
+
+  gRenderer.countCall(eRenderCallLock);
+  m_data = (unsigned char*)gRenderer.getBackend()->lockBuffer(m_buffer,
+    start * m_vertexStride, count * m_vertexStride, lock);
+  if(m_data == NULL)
+  {
+    return false;
+  }
+
+  m_bufferLocked = true;
+  m_dataEmpty = false;
+  return true;
+}
+
 bool VertexBufferBase::unlock()
 {
-  if(m_dxBuffer == NULL || !m_bufferLocked)
+  if(m_buffer == NULL || !m_bufferLocked)
   {
     return false;
   }
 
-  if( FAILED( m_dxBuffer->Unlock() ) )
+  if(!gRenderer.getBackend()->unlockBuffer(m_buffer))
   {
     return false;
   }
@@ -87,49 +123,26 @@ bool VertexBufferBase::unlock()
 
 void VertexBufferBase::release()
 {
-  if(m_dxBuffer != NULL)
-  {
-    m_dxBuffer->Release();
-    m_dxBuffer = NULL;
-  }
+  delete m_buffer;
+  m_buffer = NULL;
 }
 
 void VertexBufferBase::restore()
 {
-  if(pD3DDevice == NULL)
+  if(gRenderer.getBackend() == NULL)
   {
-    ABORT("VertexBufferBase::restore() failed since pD3DDevice was NULL");
+    ABORT("VertexBufferBase::restore() failed since there is no device");
   }
 
-  if(m_isDynamic)
+  // dynamic buffers are lost with the device, the rest are managed by it
+  gRenderer.countCall(eRenderCallCreate);
+  m_buffer = gRenderer.getBackend()->createVertexBuffer(
+    m_vertexStride * m_count, m_FVF, m_isDynamic);
+  if(m_buffer == NULL)
   {
-    if( FAILED( pD3DDevice->CreateVertexBuffer(
-      m_vertexStride * m_count,
-      D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
-      m_FVF,
-      D3DPOOL_DEFAULT,
-      &m_dxBuffer,
-      NULL) ) )
-    {
-      m_dxBuffer = NULL;
-      ABORT("VertexBufferBase::restore() failed to create DirectX vertex buffer");
-    }
-  }
-  else
-  {
-    if( FAILED( pD3DDevice->CreateVertexBuffer(
-      m_vertexStride * m_count,
-      0,
-      m_FVF,
-      D3DPOOL_MANAGED,
-      &m_dxBuffer,
-      NULL) ) )
-    {
-      m_dxBuffer = NULL;
-      ABORT("VertexBufferBase::restore() failed to create DirectX vertex buffer");
-    }
+    ABORT("VertexBufferBase::restore() failed to create vertex buffer");
   }
 
   m_bufferLocked = false;
   m_dataEmpty = true;
-}
\ No newline at end of file
+}
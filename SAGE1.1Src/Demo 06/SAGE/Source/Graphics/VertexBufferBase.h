@@ -33,14 +33,14 @@
 #ifndef __VERTEXBUFFERBASE_H_INCLUDED__
 #define __VERTEXBUFFERBASE_H_INCLUDED__
 
-#include "resource/ResourceBase.h"
-#include <d3d9.h>
+#include "Resource/ResourceBase.h"
+#include "RenderBackend.h"
 
 //-----------------------------------------------------------------------------
 /// \class VertexBufferBase
 /// \brief Base class for any vertex buffer
 ///
-/// This is the base class for any vertex buffer. It handles the DirectX calls
+/// This is the base class for any vertex buffer. It handles the backend calls
 /// for creating, releasing, locking, and unlocking the buffer. The benefits of
 /// using this class are simplified usuage and strong-typed buffers (once you
 /// derive)
@@ -49,10 +49,11 @@ class VertexBufferBase : public ResourceBase
   friend class Renderer;
 
 public:
-  VertexBufferBase(int count, bool isDynamic, DWORD fvf, int vertexStride);
+  VertexBufferBase(int count, bool isDynamic, unsigned fvf, int vertexStride);
   ~VertexBufferBase();
 
   bool lock();
+  bool lock(int start, int count); ///< Locks part of the buffer, for appending to a dynamic buffer
   bool unlock();
 
   int getCount() { return m_count; }
@@ -61,13 +62,13 @@ public:
 
 protected:
   int m_count;
-  const DWORD m_FVF;
+  const unsigned m_FVF;
   const int m_vertexStride;
-  BYTE *m_data;
+  unsigned char *m_data;
   bool m_bufferLocked;
   bool m_dataEmpty; ///< Whether the buffer has been filled (locked) since the last restore()
   bool m_isDynamic;
-  LPDIRECT3DVERTEXBUFFER9 m_dxBuffer;
+  RenderBackend::Buffer *m_buffer; ///< The buffer, as the backend made it
 
   void release();
   void restore();
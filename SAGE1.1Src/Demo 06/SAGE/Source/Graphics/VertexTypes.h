@@ -33,7 +33,7 @@
 #ifndef __VERTEXTYPES_H_INCLUDED__
 #define __VERTEXTYPES_H_INCLUDED__
 
-#include "common/Renderer.h"
+#include "Common/Renderer.h"
 #include "VertexBuffer.h"
 
 typedef VertexBuffer<RenderVertex> StandardVertexBuffer;
@@ -35,8 +35,10 @@
 
 #include <objbase.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#include "input.h"
+#include "Input.h"
 
 InputManager gInput;
 
@@ -57,6 +59,10 @@ InputManager::InputManager()
 
   m_leftMouseDown = FALSE;
   m_rightMouseDown = FALSE;
+
+  m_scripted = false;
+  m_scriptPos = 0;
+  m_scriptFrame = 0;
 }
 
 InputManager::~InputManager()
@@ -89,6 +95,59 @@ void InputManager::initiate(HINSTANCE hInstance, HWND hwnd)
 	return;
 }
 
+/// Initiates input from a script rather than the keyboard, mouse and
+/// joystick, so the game can be driven with no devices at all, the same
+/// way every run.  The script is a text file with one key event per line:
+/// the update it happens on (counting from 0), the DirectInput keycode
+/// (decimal, or hex with 0x) and 1 for down or 0 for up.  Anything after
+/// a '#' is a comment.  For example
+/// \code
+/// # hold space (DIK_SPACE) for a second at 60 updates a second
+/// 30  0x39 1
+/// 90  0x39 0
+/// \endcode
+/// \param filename Name of the script file
+/// \return false if the file couldn't be read.  Input is still scripted,
+/// just with no events.
+bool InputManager::initiateScripted(const char* filename)
+{
+  shutdown();
+  m_scripted = true;
+  m_script.clear();
+  m_scriptPos = 0;
+  m_scriptFrame = 0;
+
+  FILE *f;
+  if (filename == NULL || fopen_s(&f, filename, "rt") != 0)
+    return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char *comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+
+    char *p = line, *end;
+    ScriptedKey key;
+    key.frame = (int)strtol(p, &end, 10);
+    if (end == p) continue; // blank line
+    p = end;
+    key.keyCode = (DWORD)strtoul(p, &end, 0);
+    if (end == p || key.keyCode >= DI_NUM_KEYBOARD_CODES) continue;
+    p = end;
+    key.down = strtol(p, &end, 10) != 0;
+    if (end == p) continue;
+
+    // keep events in frame order, and lines for the same frame in file order
+    std::vector<ScriptedKey>::iterator i = m_script.end();
+    while (i != m_script.begin() && (i - 1)->frame > key.frame) --i;
+    m_script.insert(i, key);
+  }
+
+  fclose(f);
+  return true;
+}
+
 
 /// Release input objects
 void InputManager::shutdown()
@@ -305,6 +364,11 @@ bool InputManager::joySlider(float* slideValue)
 // Queries directInput devices
 void InputManager::updateInput()
 {
+  if (m_scripted)
+  {
+    ProcessScriptedInput();
+    return;
+  }
 
 	ProcessKeyboardInput();
 	ProcessMouseInput();
@@ -581,6 +645,30 @@ void InputManager::ProcessKeyboardInput()
 
 
 
+/// Keys stay as they were unless the script says otherwise, so holding a
+/// key takes one event to press it and one to let it go.
+void InputManager::ProcessScriptedInput()
+{
+  // save backup of previous key presses
+  memcpy(m_keeptrack, m_down, sizeof(BOOL) * DI_NUM_KEYBOARD_CODES);
+
+  for (; m_scriptPos < (int)m_script.size() &&
+    m_script[m_scriptPos].frame <= m_scriptFrame; ++m_scriptPos)
+  {
+    const ScriptedKey &key = m_script[m_scriptPos];
+    m_down[key.keyCode] = key.down ? 0x80 : 0;
+    if (key.down)
+      AddCodeToBuffer(key.keyCode);
+  }
+  ++m_scriptFrame;
+
+  // the mouse and joystick never move
+  m_mouseLX = 0.0f;
+  m_mouseLY = 0.0f;
+  m_joystickStateLast = m_joystickStateCurrent;
+  ZeroMemory(&m_joystickStateCurrent, sizeof (m_joystickStateCurrent));
+}
+
 /// \param keystroke DirectInput keycode to add
 void InputManager::AddCodeToBuffer(DWORD keystroke)
 {
@@ -39,6 +39,7 @@
 
 #include <windows.h>
 #include <dinput.h> //DirectInput
+#include <vector>
 
 #define DI_BUFSIZE 16 ///< Buffer size for DirectInput events from devices
 #define DI_NUM_KEYBOARD_CODES 256 ///< Number of keyboard codes supported
@@ -55,6 +56,7 @@ public:
   ~InputManager(); ///< Destructor.
 
   void initiate(HINSTANCE hInstance, HWND hwnd); ///< Initiates input
+  bool initiateScripted(const char* filename); ///< Initiates input from a script instead of devices
   void shutdown(); ///< Release input objects
 	
   /// \name Keyboard Queries 
@@ -109,7 +111,29 @@ public:
 
   void updateInput(); ///< updates directInput devices
 
+  /// \brief Returns true if input comes from a script
+  /// \return true if initiateScripted() was used
+  bool isScripted() { return m_scripted; }
+
+  /// \brief Returns true if every event in the script has happened
+  /// \return true once the last event of the script has been applied
+  bool scriptFinished() { return m_scriptPos >= (int)m_script.size(); }
+
 private:
+
+  /// \brief A key event read from an input script
+  struct ScriptedKey
+  {
+    int frame; ///< Update on which the event happens, counting from 0
+    DWORD keyCode; ///< DirectInput keycode
+    bool down; ///< True if the key goes down, false if it comes up
+  };
+
+  bool m_scripted; ///< True if input comes from m_script rather than devices
+  std::vector<ScriptedKey> m_script; ///< Script events, in order of frame
+  int m_scriptPos; ///< Next event of m_script to apply
+  int m_scriptFrame; ///< Number of updates since the script started
+
   LPDIRECTINPUT8 m_lpDirectInput; ///< DirectInput object.
     
   LPDIRECTINPUTDEVICE8 m_pKeyboard; ///< Keyboard device.    
@@ -162,6 +186,7 @@ private:
   void ProcessKeyboardInput(); ///< Process buffered keyboard events.
   BOOL ProcessMouseInput(); ///< Process buffered mouse events.
   BOOL ProcessJoystickInput(); ///< Process polled joystick events.
+  void ProcessScriptedInput(); ///< Apply this update's script events.
 
 
   //setup functions
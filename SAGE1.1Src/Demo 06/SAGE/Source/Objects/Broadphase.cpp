@@ -0,0 +1,508 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// Broadphase.cpp - Finding pairs of objects whose bounding boxes overlap
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file Broadphase.cpp
+/// \brief Code for the Broadphase classes.
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "Broadphase.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Broadphase
+//
+/////////////////////////////////////////////////////////////////////////////
+
+Broadphase::Broadphase()
+{
+}
+
+Broadphase::~Broadphase()
+{
+}
+
+/// \param a One box.
+/// \param b The other box.
+/// \return true if the boxes overlap or touch.
+bool Broadphase::overlap(const AABB3 &a, const AABB3 &b)
+{
+  return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+    a.min.y <= b.max.y && b.min.y <= a.max.y &&
+    a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+/// \param object The object.
+/// \param box The object's bounding box.
+/// \return A handle to the object's proxy, for moveProxy() and removeProxy().
+int Broadphase::addProxy(GameObject *object, const AABB3 &box)
+{
+  assert(object != NULL);
+
+  Proxy p;
+  p.object = object;
+  p.box = box;
+
+  int proxy;
+  if(m_freeProxies.empty())
+  {
+    proxy = (int)m_proxies.size();
+    m_proxies.push_back(p);
+  }
+  else
+  {
+    proxy = m_freeProxies.back();
+    m_freeProxies.pop_back();
+    m_proxies[proxy] = p;
+  }
+  return proxy;
+}
+
+/// \param proxy Handle returned by addProxy().
+/// \param box The object's new bounding box.
+void Broadphase::moveProxy(int proxy, const AABB3 &box)
+{
+  assert(m_proxies[proxy].object != NULL);
+  m_proxies[proxy].box = box;
+}
+
+/// \param proxy Handle returned by addProxy().  It's invalid afterwards.
+void Broadphase::removeProxy(int proxy)
+{
+  assert(m_proxies[proxy].object != NULL);
+  m_proxies[proxy].object = NULL;
+  m_freeProxies.push_back(proxy);
+}
+
+/// Each pair is listed once, in no particular order.
+/// \param pairs The pairs are added to the end of this list.
+void Broadphase::findPairs(PairList &pairs)
+{
+  int n = (int)m_proxies.size();
+  for(int a = 0; a < n; a++)
+  {
+    if(m_proxies[a].object == NULL)
+      continue;
+    for(int b = a + 1; b < n; b++)
+      if(m_proxies[b].object != NULL && overlap(m_proxies[a].box, m_proxies[b].box))
+      {
+        Pair pair = { m_proxies[a].object, m_proxies[b].object };
+        pairs.push_back(pair);
+      }
+  }
+}
+
+/// The list may include objects the segment misses, but never leaves out
+/// one it hits.  Each object is listed once.
+/// \param origin Start of the segment.
+/// \param delta Vector from the start of the segment to its end.
+/// \param objects The objects are added to the end of this list.
+void Broadphase::findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+  ObjectList &objects)
+{
+  AABB3 rayBox;
+  rayBox.empty();
+  rayBox.add(origin);
+  rayBox.add(origin + delta);
+
+  for(int p = 0; p < (int)m_proxies.size(); p++)
+    if(m_proxies[p].object != NULL && overlap(rayBox, m_proxies[p].box))
+      objects.push_back(m_proxies[p].object);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// HashGridBroadphase
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// Boxes covering more cells than this go in the large proxy list
+static const int kMaxProxyCells = 64;
+
+/// Rays crossing more cells than this test every object instead
+static const float kMaxRayCells = 65536.0f;
+
+/// Cells are numbered from -kMaxCell to kMaxCell, well inside an int
+static const float kMaxCell = 1.0e9f;
+
+/// \brief Finds the cell a coordinate is in, along one axis.
+///
+/// Converting a float outside the range of an int, or a NaN, is undefined,
+/// so the coordinate is clamped first.  A box that far out covers so many
+/// cells it's large anyway.
+/// \param x The coordinate, divided by the cell size.
+/// \param nanCell Cell to use if x is NaN.
+/// \return The cell.
+static int toCell(float x, int nanCell)
+{
+  if(x != x)
+    return nanCell;
+  if(x < -kMaxCell)
+    x = -kMaxCell;
+  else if(x > kMaxCell)
+    x = kMaxCell;
+  return (int)floor(x);
+}
+
+/// \param cellSize Size of a grid cell along each axis.
+/// \param tableSize Number of hash table buckets, rounded up to a power of two.
+HashGridBroadphase::HashGridBroadphase(float cellSize, int tableSize) :
+  m_cellSize(cellSize),
+  m_invCellSize(1.0f / cellSize),
+  m_queryCount(0)
+{
+  assert(cellSize > 0.0f);
+
+  int size = 1;
+  while(size < tableSize)
+    size <<= 1;
+  m_table.resize(size);
+}
+
+/// A box with a NaN in it is made to cover every cell, so it's large.
+void HashGridBroadphase::computeRange(const AABB3 &box, CellRange &range) const
+{
+  const int lowest = (int)-kMaxCell, highest = (int)kMaxCell;
+  range.min[0] = toCell(box.min.x * m_invCellSize, lowest);
+  range.min[1] = toCell(box.min.y * m_invCellSize, lowest);
+  range.min[2] = toCell(box.min.z * m_invCellSize, lowest);
+  range.max[0] = toCell(box.max.x * m_invCellSize, highest);
+  range.max[1] = toCell(box.max.y * m_invCellSize, highest);
+  range.max[2] = toCell(box.max.z * m_invCellSize, highest);
+
+  // floats so huge boxes can't overflow the count
+
+  float cells = 1.0f;
+  for(int i = 0; i < 3; i++)
+    cells *= (float)range.max[i] - (float)range.min[i] + 1.0f;
+  range.large = cells > (float)kMaxProxyCells;
+}
+
+int HashGridBroadphase::hashCell(int x, int y, int z) const
+{
+  unsigned h = ((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u) ^
+    ((unsigned)z * 83492791u);
+  return (int)(h & (unsigned)(m_table.size() - 1));
+}
+
+bool HashGridBroadphase::rangeContains(int proxy, int x, int y, int z) const
+{
+  const CellRange &r = m_ranges[proxy];
+  return x >= r.min[0] && x <= r.max[0] &&
+    y >= r.min[1] && y <= r.max[1] &&
+    z >= r.min[2] && z <= r.max[2];
+}
+
+/// Puts the proxy in the buckets of the cells in its range.  Cells that
+/// hash to the same bucket only list it once.
+void HashGridBroadphase::insertProxy(int proxy)
+{
+  const CellRange &r = m_ranges[proxy];
+  if(r.large)
+  {
+    m_largeProxies.push_back(proxy);
+    return;
+  }
+
+  for(int x = r.min[0]; x <= r.max[0]; x++)
+    for(int y = r.min[1]; y <= r.max[1]; y++)
+      for(int z = r.min[2]; z <= r.max[2]; z++)
+      {
+        std::vector<int> &bucket = m_table[hashCell(x, y, z)];
+        if(std::find(bucket.begin(), bucket.end(), proxy) == bucket.end())
+          bucket.push_back(proxy);
+      }
+}
+
+/// Takes the proxy out of the buckets of the cells in its range.
+void HashGridBroadphase::eraseProxy(int proxy)
+{
+  const CellRange &r = m_ranges[proxy];
+  if(r.large)
+  {
+    m_largeProxies.erase(std::find(m_largeProxies.begin(), m_largeProxies.end(), proxy));
+    return;
+  }
+
+  for(int x = r.min[0]; x <= r.max[0]; x++)
+    for(int y = r.min[1]; y <= r.max[1]; y++)
+      for(int z = r.min[2]; z <= r.max[2]; z++)
+      {
+        std::vector<int> &bucket = m_table[hashCell(x, y, z)];
+        std::vector<int>::iterator it = std::find(bucket.begin(), bucket.end(), proxy);
+        if(it != bucket.end())
+        {
+          *it = bucket.back();
+          bucket.pop_back();
+        }
+      }
+}
+
+int HashGridBroadphase::addProxy(GameObject *object, const AABB3 &box)
+{
+  int proxy = Broadphase::addProxy(object, box);
+  if(proxy >= (int)m_ranges.size())
+  {
+    m_ranges.resize(proxy + 1);
+    m_queryMark.resize(proxy + 1, 0);
+  }
+  m_queryMark[proxy] = 0;
+
+  computeRange(box, m_ranges[proxy]);
+  insertProxy(proxy);
+  return proxy;
+}
+
+/// The hash table is only touched if the box has moved into a different
+/// range of cells.
+void HashGridBroadphase::moveProxy(int proxy, const AABB3 &box)
+{
+  Broadphase::moveProxy(proxy, box);
+
+  CellRange range;
+  computeRange(box, range);
+  const CellRange &old = m_ranges[proxy];
+  if(range.large == old.large &&
+    range.min[0] == old.min[0] && range.min[1] == old.min[1] && range.min[2] == old.min[2] &&
+    range.max[0] == old.max[0] && range.max[1] == old.max[1] && range.max[2] == old.max[2])
+    return;
+
+  eraseProxy(proxy);
+  m_ranges[proxy] = range;
+  insertProxy(proxy);
+}
+
+void HashGridBroadphase::removeProxy(int proxy)
+{
+  eraseProxy(proxy);
+  Broadphase::removeProxy(proxy);
+}
+
+/// Objects that share more than one cell would be found in each of them,
+/// so a pair is only listed from the lowest cell the two have in common.
+void HashGridBroadphase::findPairs(PairList &pairs)
+{
+  int n = (int)m_proxies.size();
+  for(int a = 0; a < n; a++)
+  {
+    if(m_proxies[a].object == NULL || m_ranges[a].large)
+      continue;
+
+    const CellRange &ra = m_ranges[a];
+    const AABB3 &boxA = m_proxies[a].box;
+    for(int x = ra.min[0]; x <= ra.max[0]; x++)
+      for(int y = ra.min[1]; y <= ra.max[1]; y++)
+        for(int z = ra.min[2]; z <= ra.max[2]; z++)
+        {
+          const std::vector<int> &bucket = m_table[hashCell(x, y, z)];
+          for(int i = 0; i < (int)bucket.size(); i++)
+          {
+            int b = bucket[i];
+            if(b <= a || !rangeContains(b, x, y, z))
+              continue;
+            const CellRange &rb = m_ranges[b];
+            if(x != std::max(ra.min[0], rb.min[0]) ||
+              y != std::max(ra.min[1], rb.min[1]) ||
+              z != std::max(ra.min[2], rb.min[2]))
+              continue;
+            if(overlap(boxA, m_proxies[b].box))
+            {
+              Pair pair = { m_proxies[a].object, m_proxies[b].object };
+              pairs.push_back(pair);
+            }
+          }
+        }
+  }
+
+  // large proxies against everything, large pairs only once
+
+  for(int i = 0; i < (int)m_largeProxies.size(); i++)
+  {
+    int a = m_largeProxies[i];
+    for(int b = 0; b < n; b++)
+    {
+      if(b == a || m_proxies[b].object == NULL)
+        continue;
+      if(m_ranges[b].large && b < a)
+        continue;
+      if(overlap(m_proxies[a].box, m_proxies[b].box))
+      {
+        Pair pair = { m_proxies[a].object, m_proxies[b].object };
+        pairs.push_back(pair);
+      }
+    }
+  }
+}
+
+void HashGridBroadphase::addRayCell(int x, int y, int z, ObjectList &objects)
+{
+  const std::vector<int> &bucket = m_table[hashCell(x, y, z)];
+  for(int i = 0; i < (int)bucket.size(); i++)
+  {
+    int p = bucket[i];
+    if(m_queryMark[p] != m_queryCount && rangeContains(p, x, y, z))
+    {
+      m_queryMark[p] = m_queryCount;
+      objects.push_back(m_proxies[p].object);
+    }
+  }
+}
+
+/// Walks the cells the segment passes through, in order, using the method
+/// of Amanatides and Woo.  A segment so long it would cross too many cells,
+/// or one that isn't finite, is tested against every object's box instead.
+void HashGridBroadphase::findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+  ObjectList &objects)
+{
+  const float o[3] = { origin.x, origin.y, origin.z };
+  const float d[3] = { delta.x, delta.y, delta.z };
+
+  float cells = 0.0f;
+  for(int i = 0; i < 3; i++)
+    cells += fabs(d[i] * m_invCellSize);
+  if(!(cells <= kMaxRayCells)) // NaNs too
+  {
+    Broadphase::findObjectsOnRay(origin, delta, objects);
+    return;
+  }
+
+  if(++m_queryCount == 0) // wrapped, so clear the old marks
+  {
+    std::fill(m_queryMark.begin(), m_queryMark.end(), 0);
+    m_queryCount = 1;
+  }
+
+  for(int i = 0; i < (int)m_largeProxies.size(); i++)
+    objects.push_back(m_proxies[m_largeProxies[i]].object);
+
+  int cell[3], last[3], step[3];
+  float tMax[3], tDelta[3];
+  int steps = 1;
+
+  for(int i = 0; i < 3; i++)
+  {
+    cell[i] = toCell(o[i] * m_invCellSize, 0);
+    last[i] = toCell((o[i] + d[i]) * m_invCellSize, 0);
+    steps += abs(last[i] - cell[i]);
+
+    // parameter along the segment where it crosses into the next cell on
+    // this axis, and how far apart those crossings are
+
+    if(d[i] > 0.0f)
+    {
+      step[i] = 1;
+      tMax[i] = ((cell[i] + 1) * m_cellSize - o[i]) / d[i];
+      tDelta[i] = m_cellSize / d[i];
+    }
+    else if(d[i] < 0.0f)
+    {
+      step[i] = -1;
+      tMax[i] = (cell[i] * m_cellSize - o[i]) / d[i];
+      tDelta[i] = -m_cellSize / d[i];
+    }
+    else
+    {
+      step[i] = 0;
+      tMax[i] = tDelta[i] = 2.0f; // never crosses
+    }
+  }
+
+  // The step count bounds the walk in case rounding puts a crossing just
+  // past the end
+
+  for(int n = 0; n < steps; n++)
+  {
+    addRayCell(cell[0], cell[1], cell[2], objects);
+
+    int axis = 0;
+    if(tMax[1] < tMax[axis]) axis = 1;
+    if(tMax[2] < tMax[axis]) axis = 2;
+    if(tMax[axis] > 1.0f)
+      break;
+    cell[axis] += step[axis];
+    tMax[axis] += tDelta[axis];
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// SweepAndPruneBroadphase
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int SweepAndPruneBroadphase::addProxy(GameObject *object, const AABB3 &box)
+{
+  int proxy = Broadphase::addProxy(object, box);
+  m_order.push_back(proxy); // sorted into place by the next sort()
+  return proxy;
+}
+
+void SweepAndPruneBroadphase::removeProxy(int proxy)
+{
+  m_order.erase(std::find(m_order.begin(), m_order.end(), proxy));
+  Broadphase::removeProxy(proxy);
+}
+
+void SweepAndPruneBroadphase::sort()
+{
+  for(int i = 1; i < (int)m_order.size(); i++)
+  {
+    int proxy = m_order[i];
+    float x = m_proxies[proxy].box.min.x;
+    int j = i;
+    for(; j > 0 && m_proxies[m_order[j - 1]].box.min.x > x; j--)
+      m_order[j] = m_order[j - 1];
+    m_order[j] = proxy;
+  }
+}
+
+void SweepAndPruneBroadphase::findPairs(PairList &pairs)
+{
+  sort();
+
+  int n = (int)m_order.size();
+  for(int i = 0; i < n; i++)
+  {
+    const Proxy &a = m_proxies[m_order[i]];
+
+    // everything after a that starts before a ends overlaps it in x
+
+    for(int j = i + 1; j < n; j++)
+    {
+      const Proxy &b = m_proxies[m_order[j]];
+      if(b.box.min.x > a.box.max.x)
+        break;
+      if(overlap(a.box, b.box))
+      {
+        Pair pair = { a.object, b.object };
+        pairs.push_back(pair);
+      }
+    }
+  }
+}
+
+void SweepAndPruneBroadphase::findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+  ObjectList &objects)
+{
+  sort();
+
+  AABB3 rayBox;
+  rayBox.empty();
+  rayBox.add(origin);
+  rayBox.add(origin + delta);
+
+  for(int i = 0; i < (int)m_order.size(); i++)
+  {
+    const Proxy &p = m_proxies[m_order[i]];
+    if(p.box.min.x > rayBox.max.x)
+      break;
+    if(overlap(rayBox, p.box))
+      objects.push_back(p.object);
+  }
+}
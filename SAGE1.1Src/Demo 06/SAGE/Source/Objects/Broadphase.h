@@ -0,0 +1,159 @@
+/// \file Broadphase.h
+/// \brief Interface for the Broadphase classes.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Broadphase.h - Finding pairs of objects whose bounding boxes overlap
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BROADPHASE_H_INCLUDED__
+#define __BROADPHASE_H_INCLUDED__
+
+#include <vector>
+#include "Common/AABB3.h"
+#include "Common/vector3.h"
+
+class GameObject;
+
+/// \brief Finds pairs of objects whose bounding boxes overlap.
+///
+/// Each object is given a proxy, which holds a copy of its bounding box and
+/// is kept up to date with moveProxy() as the object moves.  findPairs()
+/// then lists every pair of proxies whose boxes overlap, once each, for the
+/// narrow phase (such as GameObjectManager::interact()) to look at.
+///
+/// This class does it by brute force, testing every pair.  The derived
+/// classes are faster with many objects.
+class Broadphase
+{
+public:
+
+  /// \brief Two objects whose bounding boxes overlap.
+  struct Pair
+  {
+    GameObject *first;  ///< One of the objects
+    GameObject *second; ///< The other object
+  };
+
+  typedef std::vector<Pair> PairList; ///< List of pairs
+  typedef std::vector<GameObject *> ObjectList; ///< List of objects
+
+  Broadphase(); ///< Constructs an empty broadphase.
+  virtual ~Broadphase(); ///< Destroys the broadphase.
+
+  /// \brief Adds an object.
+  virtual int addProxy(GameObject *object, const AABB3 &box);
+
+  /// \brief Updates the box of an object.
+  virtual void moveProxy(int proxy, const AABB3 &box);
+
+  /// \brief Removes an object.
+  virtual void removeProxy(int proxy);
+
+  /// \brief Lists the pairs of objects whose boxes overlap.
+  virtual void findPairs(PairList &pairs);
+
+  /// \brief Lists the objects whose boxes a line segment may pass through.
+  virtual void findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+    ObjectList &objects);
+
+  /// \brief Queries the broadphase for the number of objects in it.
+  /// \return The number of proxies in use.
+  int getProxyCount() const { return (int)(m_proxies.size() - m_freeProxies.size()); }
+
+protected:
+
+  /// \brief An object's entry in the broadphase.
+  struct Proxy
+  {
+    GameObject *object; ///< The object, NULL if the proxy is free
+    AABB3 box; ///< The object's bounding box
+  };
+
+  std::vector<Proxy> m_proxies; ///< Proxies, indexed by handle
+  std::vector<int> m_freeProxies; ///< Handles of free proxies
+
+  static bool overlap(const AABB3 &a, const AABB3 &b); ///< Tests two boxes for overlap.
+
+private:
+
+  // No copying, derived classes keep indices into m_proxies
+
+  Broadphase(const Broadphase &);
+  Broadphase &operator=(const Broadphase &);
+};
+
+/// \brief Broadphase that hashes objects into a uniform grid of cells.
+///
+/// An object is listed in every cell its box touches, and only objects
+/// sharing a cell are tested against each other.  The cells live in a hash
+/// table, so the grid has no bounds.  Moving an object only touches the
+/// table when it crosses into a different set of cells.  Objects that would
+/// cover too many cells are kept in a separate list and tested against
+/// everything.
+///
+/// The cell size should be about the size of the typical object.  Cells
+/// much smaller make objects cover lots of cells; cells much bigger put
+/// lots of objects in each cell.
+class HashGridBroadphase : public Broadphase
+{
+public:
+  HashGridBroadphase(float cellSize, int tableSize = 4096); ///< Constructs an empty grid.
+
+  virtual int addProxy(GameObject *object, const AABB3 &box);
+  virtual void moveProxy(int proxy, const AABB3 &box);
+  virtual void removeProxy(int proxy);
+  virtual void findPairs(PairList &pairs);
+  virtual void findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+    ObjectList &objects);
+
+private:
+
+  /// \brief Range of cells a box touches, inclusive.
+  struct CellRange
+  {
+    int min[3]; ///< Lowest cell on each axis
+    int max[3]; ///< Highest cell on each axis
+    bool large; ///< True if kept in m_largeProxies instead of the table
+  };
+
+  void computeRange(const AABB3 &box, CellRange &range) const;
+  int hashCell(int x, int y, int z) const;
+  void insertProxy(int proxy);
+  void eraseProxy(int proxy);
+  bool rangeContains(int proxy, int x, int y, int z) const;
+  void addRayCell(int x, int y, int z, ObjectList &objects);
+
+  float m_cellSize; ///< Size of a cell along each axis
+  float m_invCellSize; ///< 1 / m_cellSize
+  std::vector< std::vector<int> > m_table; ///< Proxies in each bucket, size is a power of two
+  std::vector<CellRange> m_ranges; ///< Cells each proxy touches
+  std::vector<int> m_largeProxies; ///< Proxies that cover too many cells to hash
+  std::vector<unsigned> m_queryMark; ///< Last ray query each proxy was listed by
+  unsigned m_queryCount; ///< Number of ray queries so far
+};
+
+/// \brief Broadphase that keeps objects sorted along the x axis.
+///
+/// Pairs are found by sweeping along the sorted list, so only objects whose
+/// boxes overlap in x are tested against each other.  Objects don't move far
+/// from one update to the next, so the list is almost sorted each time and
+/// an insertion sort puts it right in close to linear time.
+class SweepAndPruneBroadphase : public Broadphase
+{
+public:
+  virtual int addProxy(GameObject *object, const AABB3 &box);
+  virtual void removeProxy(int proxy);
+  virtual void findPairs(PairList &pairs);
+  virtual void findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+    ObjectList &objects);
+
+private:
+  void sort(); ///< Insertion sorts m_order on the boxes' minimum x.
+
+  std::vector<int> m_order; ///< Proxies in order of minimum x
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __BROADPHASE_H_INCLUDED__
@@ -0,0 +1,88 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// CommandBuffer.cpp - Effects on shared state, recorded to be carried out later
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file CommandBuffer.cpp
+/// \brief Code for the CommandBuffer class.
+
+#include <algorithm>
+
+#include "CommandBuffer.h"
+#include "Particle/ParticleEngine.h"
+
+static void setParticleSystemPosCommand(const CommandBuffer::Args &args)
+{
+  gParticle.setSystemPos((unsigned int)args.i[0], Vector3(args.f[0], args.f[1], args.f[2]));
+}
+
+static void killParticleSystemCommand(const CommandBuffer::Args &args)
+{
+  gParticle.killSystem((unsigned int)args.i[0]);
+}
+
+CommandBuffer::CommandBuffer() :
+  m_key(0)
+{
+}
+
+/// \param func Function that carries out the command.
+/// \param args Copied, and passed to func when the command is carried out.
+void CommandBuffer::record(CommandFunc func, const Args &args)
+{
+  Command command;
+  command.func = func;
+  command.key = m_key;
+  command.args = args;
+  m_commands.push_back(command);
+}
+
+/// \param system Handle of the particle system.
+/// \param position New position of the system.
+void CommandBuffer::setParticleSystemPos(unsigned int system, const Vector3 &position)
+{
+  Args args;
+  args.i[0] = (int)system;
+  args.f[0] = position.x;
+  args.f[1] = position.y;
+  args.f[2] = position.z;
+  record(setParticleSystemPosCommand, args);
+}
+
+/// \param system Handle of the particle system.
+void CommandBuffer::killParticleSystem(unsigned int system)
+{
+  Args args;
+  args.i[0] = (int)system;
+  record(killParticleSystemCommand, args);
+}
+
+void CommandBuffer::clear()
+{
+  m_commands.clear();
+  m_key = 0;
+}
+
+bool CommandBuffer::compareKeys(const Command &a, const Command &b)
+{
+  return a.key < b.key;
+}
+
+/// Commands with the same key come from the same object, so from the same
+/// buffer, and keep the order they were recorded in.
+/// \param buffers The buffers, which are left empty.
+void CommandBuffer::execute(std::vector<CommandBuffer> &buffers)
+{
+  static std::vector<Command> merged; // kept to save allocating every time
+  merged.clear();
+  for(int b = 0; b < (int)buffers.size(); b++)
+    merged.insert(merged.end(), buffers[b].m_commands.begin(), buffers[b].m_commands.end());
+  std::stable_sort(merged.begin(), merged.end(), compareKeys);
+
+  for(int i = 0; i < (int)merged.size(); i++)
+    merged[i].func(merged[i].args);
+
+  for(int b = 0; b < (int)buffers.size(); b++)
+    buffers[b].clear();
+}
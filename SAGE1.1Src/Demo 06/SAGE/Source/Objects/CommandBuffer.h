@@ -0,0 +1,74 @@
+/// \file CommandBuffer.h
+/// \brief Interface for the CommandBuffer class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// CommandBuffer.h - Effects on shared state, recorded to be carried out later
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __COMMANDBUFFER_H_INCLUDED__
+#define __COMMANDBUFFER_H_INCLUDED__
+
+#include <vector>
+#include "Common/vector3.h"
+
+/// \brief A list of effects on shared state, to be carried out later.
+///
+/// Objects updated on worker threads mustn't touch anything but themselves,
+/// so anything else they want done, such as moving a particle system, is
+/// recorded here and carried out afterwards on the main thread.  Each
+/// thread records into its own buffer.  Every command is tagged with a key,
+/// the index of the object that recorded it, and execute() runs the
+/// commands of all the buffers in order of key, so they come out in the
+/// same order whichever thread each object ran on.
+///
+/// A command is a function and a few numbers for it.  Games can record
+/// their own with record().
+class CommandBuffer
+{
+public:
+
+  /// \brief The numbers a command is recorded with.
+  struct Args
+  {
+    int i[2];   ///< Integer arguments
+    float f[4]; ///< Float arguments
+  };
+
+  typedef void (*CommandFunc)(const Args &args); ///< Carries out a command.
+
+  CommandBuffer(); ///< Constructs an empty buffer.
+
+  /// \brief Sets the key commands are tagged with from now on.
+  /// \param key The key, normally the index of the object about to be updated.
+  void setKey(int key) { m_key = key; }
+
+  void record(CommandFunc func, const Args &args); ///< Records a command.
+
+  void setParticleSystemPos(unsigned int system, const Vector3 &position); ///< Records a ParticleEngine::setSystemPos().
+  void killParticleSystem(unsigned int system); ///< Records a ParticleEngine::killSystem().
+
+  bool isEmpty() const { return m_commands.empty(); } ///< Queries the buffer for whether it has any commands.
+  void clear(); ///< Throws away the commands.
+
+  static void execute(std::vector<CommandBuffer> &buffers); ///< Runs and clears the commands of several buffers.
+
+private:
+
+  /// \brief A recorded command.
+  struct Command
+  {
+    CommandFunc func; ///< Function that carries it out
+    int key; ///< Key it was recorded with
+    Args args; ///< Arguments for func
+  };
+
+  static bool compareKeys(const Command &a, const Command &b); ///< Orders commands by key.
+
+  std::vector<Command> m_commands; ///< Commands in the order they were recorded
+  int m_key; ///< Key for new commands
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __COMMANDBUFFER_H_INCLUDED__
@@ -30,10 +30,13 @@
 /// \file GameObject.cpp
 /// \brief Code for the GameObject class.
 
-#include "gameobject.h"
-#include "common/rotationmatrix.h"
-#include "common/MathUtil.h"
-#include "derivedmodels/animatedmodel.h"
+#include "GameObject.h"
+#include "GameObjectManager.h"
+#include "Common/RotationMatrix.h"
+#include "Common/Quaternion.h"
+#include "Common/MathUtil.h"
+#include "DerivedModels/AnimatedModel.h"
+#include "CommandBuffer.h"
 #include <stdlib.h>
 #include <assert.h>
 
@@ -43,33 +46,52 @@
 GameObject::GameObject(Model *m, int parts, int frames):
   m_nNumParts(parts),
   m_nNumFrames(frames),
-  m_fDeltaTime(0.0f),
-  m_fCurFrame(0.0f),
   m_pModel(m),
   m_modelOrient(EulerAngles::kEulerAnglesIdentity),
   m_eaOrient(NULL),
   m_eaAngularVelocity(NULL),
   m_v3Position(NULL),
   m_fSpeed(0.0f),
+  m_fCurFrame(0.0f),
+  m_fDeltaTime(0.0f),
+  m_bBoundsDirty(true),
+  m_boundsPosition(NULL),
+  m_boundsOrient(NULL),
+  m_tickPosition(NULL),
+  m_tickOrient(NULL),
   m_animFreq(1.0f),
   m_lifeState(LS_NEW),
   m_id(0),
   m_className("Object"),
   m_type(0),
   m_manager(NULL),
-  m_vertexBuffer(NULL)
+  m_vertexBuffer(NULL),
+  m_renderVertexBuffer(NULL),
+  m_bAnimationLerp(true),
+  m_animLevel(AL_FULL),
+  m_nAnimSkipped(0),
+  m_fAnimCacheStep(-1.0f),
+  m_nCullPlane(-1),
+  m_nBroadphaseProxy(-1),
+  m_bAnimationPending(false),
+  m_bParallel(false)
 {
   m_eaOrient = new EulerAngles[m_nNumParts];
   m_eaAngularVelocity = new EulerAngles[m_nNumParts];
   m_v3Position = new Vector3[m_nNumParts];
+  m_boundsPosition = new Vector3[m_nNumParts];
+  m_boundsOrient = new EulerAngles[m_nNumParts];
+  m_tickPosition = new Vector3[m_nNumParts];
+  m_tickOrient = new EulerAngles[m_nNumParts];
   for(int i=0; i<m_nNumParts; i++){
     m_eaOrient[i] = EulerAngles::kEulerAnglesIdentity;
     m_eaAngularVelocity[i] = EulerAngles::kEulerAnglesIdentity;
     m_v3Position[i] = Vector3::kZeroVector;
   }
+  saveTickState();
 
   if(frames > 1)
-    m_vertexBuffer = ((AnimatedModel*)m)->getNewVertexBuffer();
+    m_renderVertexBuffer = m_vertexBuffer = ((AnimatedModel*)m)->getNewVertexBuffer();
   
   computeBoundingBox();
 }
@@ -80,6 +102,10 @@ GameObject::~GameObject(void){
   delete [] m_eaOrient;
   delete [] m_eaAngularVelocity;
   delete [] m_v3Position;
+  delete [] m_boundsPosition;
+  delete [] m_boundsOrient;
+  delete [] m_tickPosition;
+  delete [] m_tickOrient;
 
   delete m_vertexBuffer;
 }
@@ -88,6 +114,7 @@ GameObject::~GameObject(void){
 void GameObject::setModel(Model *m)
 {
   m_pModel = m;
+  m_bBoundsDirty = true;
 }
 
 /// \param v Specifies the new position for the object.
@@ -147,6 +174,7 @@ const EulerAngles &GameObject::getPreviousOrientation() const
 void GameObject::setModelOrientation(const EulerAngles &orient)
 {
   m_modelOrient = orient;
+  m_bBoundsDirty = true;
 }
 
 /// \param speed Specifies the new speed of the obectj.
@@ -197,10 +225,22 @@ const Vector3 GameObject::transformObjectToInertial(const Vector3& position) con
   return ret;
 }
 
+/// The box is only recomputed if the object has moved since last time, or
+/// invalidateBoundingBox() was called.  Either way, the cost doesn't depend
+/// on how many vertices the model has.
 void GameObject::computeBoundingBox()
 {
   if(m_pModel == NULL) return;
   if(m_nNumFrames > 1) return;
+  if(!m_bBoundsDirty && !transformChanged()) return;
+
+  for(int i = 0; i < m_nNumParts; ++i)
+  {
+    m_boundsPosition[i] = m_v3Position[i];
+    m_boundsOrient[i] = m_eaOrient[i];
+  }
+  m_bBoundsDirty = false;
+
   Matrix4x3 world, modelOrient, sub;
   world.setupLocalToParent(m_v3Position[0], m_eaOrient[0]);
   modelOrient.setupLocalToParent(Vector3::kZeroVector, m_modelOrient);
@@ -216,6 +256,23 @@ void GameObject::computeBoundingBox()
   }
 }
 
+/// Derived classes move objects by writing m_v3Position and m_eaOrient
+/// directly, so instead of trusting them to say so, we compare against
+/// the transform the box was computed with.
+/// \return true if any part's position or orientation has changed.
+bool GameObject::transformChanged() const
+{
+  for(int i = 0; i < m_nNumParts; ++i)
+  {
+    if(m_v3Position[i] != m_boundsPosition[i])
+      return true;
+    const EulerAngles &a = m_eaOrient[i], &b = m_boundsOrient[i];
+    if(a.heading != b.heading || a.pitch != b.pitch || a.bank != b.bank)
+      return true;
+  }
+  return false;
+}
+
 /// \return The last computed bounding box of the object.
 const AABB3 &GameObject::getBoundingBox() const
 {
@@ -235,17 +292,17 @@ void GameObject::move(float dt)
 void GameObject::render(){
   if(!m_pModel)return;
 
-  gRenderer.instance(m_v3Position[0], m_eaOrient[0]);
+  gRenderer.instance(getRenderPosition(0), getRenderOrientation(0));
   gRenderer.instance(Vector3::kZeroVector, m_modelOrient);
   if(m_nNumParts > 1) //articulated model
     ((ArticulatedModel*)m_pModel)->renderSubmodel(0);
   else if(m_nNumFrames > 1) // animated model
-    ((AnimatedModel*)m_pModel)->render(m_vertexBuffer);
+    ((AnimatedModel*)m_pModel)->render(m_renderVertexBuffer);
   else
     m_pModel->render(); //vanilla model
 
   for(int i=1; i<m_nNumParts; i++){
-    gRenderer.instance(m_v3Position[i], m_eaOrient[i]);
+    gRenderer.instance(getRenderPosition(i), getRenderOrientation(i));
     ((ArticulatedModel*)m_pModel)->renderSubmodel(i);
     gRenderer.instancePop(); // submodel i
   }
@@ -275,18 +332,108 @@ void GameObject::move(float dt, bool savePreviousState){
   Vector3 bDisplacement(0, 0, 20.0f * dt * m_fSpeed);
   RotationMatrix Matrix;
   Matrix.setup(m_eaOrient[0]);
-  Vector3 addend = Matrix.objectToInertial(bDisplacement);
   m_v3Position[0] += Matrix.objectToInertial(bDisplacement);
 
-  //select animation frame, if necessary
+  //select animation frame, if necessary; the model does the interpolation
+  //in updateAnimation(), since it shares buffers and the device with every
+  //object using it
   if(m_nNumFrames > 1)
   {
-    m_fCurFrame += dt * ((AnimatedModel*)m_pModel)->numFramesInAnimation() * m_animFreq;
-    Matrix4x3 world, modelOrient;
-    world.setupLocalToParent(m_v3Position[0], m_eaOrient[0]);
+    AnimatedModel *model = (AnimatedModel*)m_pModel;
+    m_fCurFrame += dt * model->numFramesInAnimation() * m_animFreq;
+    Matrix4x3 modelOrient;
+    m_animationWorld.setupLocalToParent(m_v3Position[0], m_eaOrient[0]);
     modelOrient.setupLocalToParent(Vector3::kZeroVector,m_modelOrient);
-    world = modelOrient * world;
-    ((AnimatedModel*)m_pModel)->selectAnimationFrame(m_fCurFrame, 0, *m_vertexBuffer, m_boundingBox, world); // TODO figure which frame to render based on state
-    world;
+    m_animationWorld = modelOrient * m_animationWorld;
+    m_bAnimationPending = true;
   }
 }
+
+/// The object manager calls this on the main thread after moving the
+/// object, with the frame and transform move() picked.
+void GameObject::updateAnimation()
+{
+  if(!m_bAnimationPending)
+    return;
+  m_bAnimationPending = false;
+
+  AnimatedModel *model = (AnimatedModel*)m_pModel;
+
+  // Whatever the level, the vertices have to be redone if the ones we render
+  // from are gone: the model frees its cached frames when the cache step
+  // changes, and the device takes everything with it when it's lost
+
+  bool interpolate = m_fAnimCacheStep != AnimatedModel::m_fFrameCacheStep ||
+    m_renderVertexBuffer->isEmpty();
+  if(m_animLevel == AL_FULL)
+    interpolate = true;
+  else if(m_animLevel == AL_REDUCED && m_nAnimSkipped + 1 >= GameObjectManager::animationLODInterval)
+    interpolate = true;
+
+  if(interpolate)
+  {
+    float frame = m_fCurFrame;
+    if(!m_bAnimationLerp || (m_animLevel != AL_FULL && !GameObjectManager::animationLODLerp))
+      frame = floorf(frame);
+    m_renderVertexBuffer = model->selectAnimationFrameCached(frame, 0, *m_vertexBuffer, m_boundingBox, m_animationWorld); // TODO figure which frame to render based on state
+    m_fAnimCacheStep = AnimatedModel::m_fFrameCacheStep;
+    m_nAnimSkipped = 0;
+  }
+  else
+  {
+    model->selectBoundingBox(m_fCurFrame, 0, m_boundingBox, m_animationWorld);
+    ++m_nAnimSkipped;
+  }
+}
+
+/// The object manager calls this before each tick.
+void GameObject::saveTickState()
+{
+  for(int i = 0; i < m_nNumParts; i++)
+  {
+    m_tickPosition[i] = m_v3Position[i];
+    m_tickOrient[i] = m_eaOrient[i];
+  }
+}
+
+/// The simulation runs in fixed ticks that don't line up with frames, so
+/// the object is drawn GameObjectManager::renderInterpolation of the way
+/// from where it was at the start of the last tick to where it is now.
+/// \param part Specifies the part number to be queried.
+/// \return The position of the object/part.
+Vector3 GameObject::getRenderPosition(int part) const
+{
+  assert(part >= 0 && part < m_nNumParts);
+  float t = GameObjectManager::renderInterpolation;
+  if(t >= 1.0f)
+    return m_v3Position[part];
+  return m_tickPosition[part] + (m_v3Position[part] - m_tickPosition[part]) * t;
+}
+
+/// \param part Specifies the part number to be queried.
+/// \return The orientation of the object/part.
+/// \see getRenderPosition()
+EulerAngles GameObject::getRenderOrientation(int part) const
+{
+  assert(part >= 0 && part < m_nNumParts);
+  float t = GameObjectManager::renderInterpolation;
+  const EulerAngles &from = m_tickOrient[part], &to = m_eaOrient[part];
+  if(t >= 1.0f || (from.heading == to.heading && from.pitch == to.pitch && from.bank == to.bank))
+    return to;
+
+  // Euler angles wrap, so go through quaternions for the shortest way round
+  Quaternion p, q;
+  p.setToRotateObjectToInertial(from);
+  q.setToRotateObjectToInertial(to);
+  EulerAngles result;
+  result.fromObjectToInertialQuaternion(Quaternion::slerp(p, q, t));
+  return result;
+}
+
+/// Only valid while the object's manager is updating it.
+/// \return The buffer for the thread the object is being updated on.
+CommandBuffer &GameObject::getCommands()
+{
+  assert(m_manager != NULL);
+  return m_manager->getCommandBuffer();
+}
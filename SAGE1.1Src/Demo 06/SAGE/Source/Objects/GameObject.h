@@ -37,11 +37,13 @@
 #include "DerivedModels/ArticulatedModel.h"
 #include "Common/EulerAngles.h"
 #include "Common/AABB3.h"
-#include "Common/Vector3.h"
+#include "Common/vector3.h"
+#include "Common/Matrix4x3.h"
 #include "Common/Renderer.h"
 #include "Graphics/VertexTypes.h"
 
 class GameObjectManager; /// \brief Represents a game entity, usually represented visually by a model.
+class CommandBuffer;
 
 /// Represents a game entity, usually represented visually by a model.  An object has one or more parts.
 /// The first part (part 0) is the primary part, and all other parts are positioned and oriented relative
@@ -52,6 +54,16 @@ class GameObject{
 public:
   friend class GameObjectManager;
 
+  /// \brief How much work an animated object puts into its animation each move.
+  ///
+  /// The object manager picks a level for each animated object before moving it.
+  enum AnimationLevel
+  {
+    AL_FULL = 0,  ///< Vertices are interpolated every move.
+    AL_REDUCED,   ///< Object is far away; vertices are interpolated every few moves.
+    AL_HIDDEN     ///< Object can't be seen; only the frame and bounding box are updated.
+  };
+
   GameObject(Model *m, int parts=1, int frames=1);  ///< Constructs a new object.  Mostly used by derived classes.
   virtual ~GameObject(void);  ///< Destroys the object.
   void setModel(Model* m);  ///< Sets the model for the object.
@@ -62,6 +74,8 @@ public:
   void setOrientation(const EulerAngles &orient, int part=0);  ///< Sets the orientation of the object (or one of its parts).
   const EulerAngles& getOrientation(int part=0) const;  ///< Queries the object (or one of its parts) for its orientation.
   const EulerAngles& getPreviousOrientation() const; ///< Queries the object for its previous orientation.
+  Vector3 getRenderPosition(int part=0) const;  ///< Queries the object (or one of its parts) for its position between the last two ticks.
+  EulerAngles getRenderOrientation(int part=0) const;  ///< Queries the object (or one of its parts) for its orientation between the last two ticks.
   void setModelOrientation(const EulerAngles &orient);  ///< Sets the default orientation of the object's model.
   void setSpeed(float speed);  ///< Sets the object's forward speed.
   void setRotationSpeedHeading(float speed, int part=0);  ///< Sets the rotation speed for the object (or one of its parts) on the heading axis.
@@ -72,6 +86,7 @@ public:
   virtual void killObject() {m_lifeState = LS_DEAD;} ///< Sets the object's m_lifeState variable to LS_DEAD.  The object manager will then remove the object.
   
   virtual void computeBoundingBox();  ///< Updates the object's bounding box.
+  void invalidateBoundingBox() { m_bBoundsDirty = true; }  ///< Makes the next computeBoundingBox() recompute the box even if the object hasn't moved.
   const AABB3 &getBoundingBox() const;  ///< Queries the object for its axially-aligned bounding box.
   
   bool isAlive() const { return m_lifeState == LS_ALIVE; }  ///< Returns true iff the object is fully-grown and alive.
@@ -84,10 +99,16 @@ public:
   const std::string &getClassName() const { return m_className; }  ///< Queries the object for its class name.
   int getType() const { return m_type; }  ///< Queries the object for its type.
   void setClassName(const std::string &className) { m_className = className; }  ///< Sets the object's class name.
+  void setAnimationLerp(bool lerp) { m_bAnimationLerp = lerp; }  ///< Sets whether this object's animation is interpolated between key frames.
+  AnimationLevel getAnimationLevel() const { return m_animLevel; }  ///< Queries the object for the animation level it was last moved at.
 
 protected:
 
   virtual void move(float dt, bool savePreviousState);
+  bool transformChanged() const;  ///< Checks whether any part has moved since the bounding box was computed.
+  void updateAnimation();  ///< Interpolates the animation for the frame the last move() picked.
+  CommandBuffer &getCommands();  ///< Gets the buffer to record effects on anything but this object in.
+  void saveTickState();  ///< Remembers the transforms of the parts at the start of a tick.
 
   // Object stage of life
   enum LifeState ///< Represents the stage of an object's life.
@@ -108,6 +129,11 @@ protected:
   float m_fCurFrame; ///< Current frame.
   float m_fDeltaTime; ///< Time change since last animation, in seconds.
 	AABB3 m_boundingBox; ///< Contains the last computed bounding box.
+  bool m_bBoundsDirty; ///< True if the bounding box must be recomputed whether or not the object has moved.
+  Vector3* m_boundsPosition; ///< Positions of parts when the bounding box was computed.
+  EulerAngles* m_boundsOrient; ///< Orientations of parts when the bounding box was computed.
+  Vector3* m_tickPosition; ///< Positions of parts at the start of the last tick, for rendering between ticks.
+  EulerAngles* m_tickOrient; ///< Orientations of parts at the start of the last tick, for rendering between ticks.
 	float m_animFreq; ///< Number of times an animation cycles per second.
 	
   
@@ -122,6 +148,36 @@ protected:
   GameObjectManager *m_manager; ///< Points to this object's manager (if any).
 
   StandardVertexBuffer *m_vertexBuffer; ///< Dynamic vertex buffer to hold animated model data
+  StandardVertexBuffer *m_renderVertexBuffer; ///< Vertex buffer to render the animated model from; m_vertexBuffer, or one shared through the model's frame cache
+
+  bool m_bAnimationLerp; ///< Whether this object's animation is interpolated between key frames.
+  AnimationLevel m_animLevel; ///< Animation level for the next move, set by the object manager.
+  int m_nAnimSkipped; ///< Number of moves since the vertices were last interpolated.
+  float m_fAnimCacheStep; ///< AnimatedModel::m_fFrameCacheStep when the vertices were last interpolated.
+  int m_nCullPlane; ///< Frustum plane that last culled the object, -1 if none.
+  int m_nBroadphaseProxy; ///< Handle of the object in the manager's broadphase, -1 if none.
+  bool m_bAnimationPending; ///< True if move() has picked a frame that updateAnimation() hasn't done yet.
+  Matrix4x3 m_animationWorld; ///< World transform move() picked the frame at.
+
+  /// \brief Whether the object can be updated on any thread.
+  ///
+  /// Set by derived classes whose process(), move() and computeBoundingBox()
+  /// change nothing but the object itself and record any other effects in
+  /// getCommands().  With GameObjectManager::parallelUpdate on, each phase
+  /// runs every parallel object, on all threads at once, before any object
+  /// that isn't, whatever their order in the manager.  So in a phase:
+  ///   - a parallel object mustn't read any other object, since another
+  ///     parallel one may be changing it on another thread, and a serial one
+  ///     hasn't had its turn yet even if it comes first;
+  ///   - a serial object mustn't read a parallel one, since it sees it after
+  ///     the phase even if the parallel one comes later;
+  ///   - nor can either use shared state like CRandom, which is rand()
+  ///     underneath.
+  /// What other objects did in earlier phases and ticks, such as the
+  /// positions move() left for computeBoundingBox(), is safe to read.  The
+  /// commands are carried out after the phase in the manager's order, the
+  /// same as with parallelUpdate off.
+  bool m_bParallel;
 };
 
 #endif
\ No newline at end of file
@@ -33,11 +33,29 @@
 #include <assert.h>
 #include "GameObject.h"
 #include "GameObjectManager.h"
-#include "common/Renderer.h"
+#include "Common/Renderer.h"
+#include "Common/JobSystem.h"
 
 bool GameObjectManager::renderBB = false;
+bool GameObjectManager::animationLOD = true;
+float GameObjectManager::animationLODDistance = 500.0f;
+int GameObjectManager::animationLODInterval = 4;
+bool GameObjectManager::animationLODLerp = true;
+float GameObjectManager::animationLODMargin = 10.0f;
+int GameObjectManager::animatedFull = 0;
+int GameObjectManager::animatedReduced = 0;
+int GameObjectManager::animatedHidden = 0;
+int GameObjectManager::broadphase = GameObjectManager::BP_HASH_GRID;
+float GameObjectManager::broadphaseCellSize = 50.0f;
+int GameObjectManager::broadphasePairs = 0;
+bool GameObjectManager::parallelUpdate = true;
+int GameObjectManager::parallelBatchSize = 32;
+float GameObjectManager::renderInterpolation = 1.0f;
 
 GameObjectManager::GameObjectManager() :
+  m_broadphase(NULL),
+  m_broadphaseType(-1),
+  m_broadphaseCellSize(0.0f),
   m_numDeadFrames(0),
   m_frameCount(0)
 {
@@ -46,20 +64,21 @@ GameObjectManager::GameObjectManager() :
 GameObjectManager::~GameObjectManager()
 {
   clear();
+  delete m_broadphase;
 }
 
 void GameObjectManager::clear()
 {
-  while(m_objects.begin() != m_objects.end())
-    deleteObject(*(m_objects.begin()));
+  // Deleting from the back doesn't move anything around
+  while(!m_objects.empty())
+    deleteObject(m_objects[m_objects.size() - 1]);
   m_objects.clear();
   m_movableObjects.clear();
   m_processableObjects.clear();
   m_renderableObjects.clear();
-  m_objectIDs.clear();
+  m_objectSlots.clear();
   m_objectNames.clear();
   m_nameToID.clear();
-  m_idToObject.clear();
   m_frameCount = 0;
 }
 
@@ -68,10 +87,14 @@ void GameObjectManager::setNumberOfDeadFrames(unsigned int numFrames)
   m_numDeadFrames = numFrames;
 }
 
+/// The transforms of the objects are saved first, so that they can be drawn
+/// between this tick and the next (see GameObject::getRenderPosition()).
 /// \param dt Specifies the amount of time since last update, in seconds.
 void GameObjectManager::update(float dt)
 {
   updateObjectLifeStates();
+  for(ObjectSetIter it = m_objects.begin(); it != m_objects.end(); ++it)
+    (*it)->saveTickState();
   if(m_frameCount >= m_numDeadFrames)
   {
     process(dt);
@@ -83,21 +106,99 @@ void GameObjectManager::update(float dt)
   ++m_frameCount;
 }
 
+/// Objects whose bounding box is outside the view frustum aren't drawn.
+/// Objects without a model have no bounding box, and are always drawn.
 void GameObjectManager::render()
 {
   for(ObjectSetIter it = m_renderableObjects.begin(); it != m_renderableObjects.end(); ++it)
-    if((*it)->m_lifeState == GameObject::LS_ALIVE)
-      (*it)->render();
+  {
+    GameObject &object = **it;
+    if(object.m_lifeState != GameObject::LS_ALIVE)
+      continue;
+    if(object.m_pModel != NULL &&
+      !gRenderer.isBoxVisible(object.m_boundingBox, NULL, &object.m_nCullPlane))
+      continue;
+    object.render();
+  }
 
   if (renderBB)
     renderBoundingBoxes();
 }
 
+/// The broadphase is brought up to date with the new boxes, and replaced
+/// first if the broadphase settings have changed.  Objects without a model
+/// have no bounding box and aren't put in the broadphase.
 void GameObjectManager::computeBoundingBoxes()
 {
+  if(m_broadphase == NULL || m_broadphaseType != broadphase ||
+    (broadphase == BP_HASH_GRID && m_broadphaseCellSize != broadphaseCellSize))
+  {
+    delete m_broadphase;
+    m_broadphaseType = broadphase;
+    m_broadphaseCellSize = broadphaseCellSize;
+    if(broadphase == BP_HASH_GRID && broadphaseCellSize > 0.0f)
+      m_broadphase = new HashGridBroadphase(broadphaseCellSize);
+    else if(broadphase == BP_SWEEP_AND_PRUNE)
+      m_broadphase = new SweepAndPruneBroadphase();
+    else
+      m_broadphase = new Broadphase();
+
+    // everything goes back in below
+    for(ObjectSetIter it = m_objects.begin(); it != m_objects.end(); ++it)
+      (*it)->m_nBroadphaseProxy = -1;
+  }
+
+  updateObjects(m_objects, UP_BOUNDS, 0.0f);
+
   for(ObjectSetIter it = m_objects.begin(); it != m_objects.end(); ++it)
-    if((*it)->isAlive())
-      (*it)->computeBoundingBox();
+  {
+    GameObject &object = **it;
+    if(!object.isAlive() || object.m_pModel == NULL)
+      continue;
+    if(object.m_nBroadphaseProxy < 0)
+      object.m_nBroadphaseProxy = m_broadphase->addProxy(&object, object.m_boundingBox);
+    else
+      m_broadphase->moveProxy(object.m_nBroadphaseProxy, object.m_boundingBox);
+  }
+}
+
+/// The pairs come from the broadphase, so the boxes are the ones from the
+/// last call to computeBoundingBoxes().  Pairs with an object that has
+/// died since are left out.
+/// \param pairs Filled in with the pairs, each listed once.
+void GameObjectManager::findPairs(Broadphase::PairList &pairs)
+{
+  pairs.clear();
+  if(m_broadphase != NULL)
+    m_broadphase->findPairs(pairs);
+
+  int n = 0;
+  for(int i = 0; i < (int)pairs.size(); i++)
+    if(pairs[i].first->isAlive() && pairs[i].second->isAlive())
+      pairs[n++] = pairs[i];
+  pairs.resize(n);
+
+  broadphasePairs = n;
+}
+
+/// Like findPairs(), this uses the boxes from the last call to
+/// computeBoundingBoxes().  The list may include objects the segment
+/// misses, so test the boxes before doing anything with them.
+/// \param origin Start of the segment.
+/// \param delta Vector from the start of the segment to its end.
+/// \param objects Filled in with the objects, each listed once.
+void GameObjectManager::findObjectsOnRay(const Vector3 &origin, const Vector3 &delta,
+  Broadphase::ObjectList &objects)
+{
+  objects.clear();
+  if(m_broadphase != NULL)
+    m_broadphase->findObjectsOnRay(origin, delta, objects);
+
+  int n = 0;
+  for(int i = 0; i < (int)objects.size(); i++)
+    if(objects[i]->isAlive())
+      objects[n++] = objects[i];
+  objects.resize(n);
 }
 
 void GameObjectManager::renderBoundingBoxes()
@@ -155,13 +256,14 @@ void GameObjectManager::deleteObject(GameObject *object)
 {
   if(object == NULL) return;
   m_nameToID.erase(object->m_name);
-  m_idToObject.erase(object->m_id);
-  m_objectIDs.releaseID(object->m_id);
   m_objectNames.releaseName(object->m_name);
+  if(object->m_nBroadphaseProxy >= 0)
+    m_broadphase->removeProxy(object->m_nBroadphaseProxy);
   m_objects.erase(object);
   m_movableObjects.erase(object);
   m_processableObjects.erase(object);
   m_renderableObjects.erase(object);
+  m_objectSlots.erase(object->m_id);  // after the sets, they look the object up by ID
   object->m_manager = NULL;
   delete object;
 }
@@ -178,15 +280,13 @@ unsigned int GameObjectManager::getObjectID(const std::string &name)
 }
 
 /// \param id Specifies the id of the object.
-/// \return A pointer to the object.
+/// \return A pointer to the object, or NULL if there's no such object.  IDs of
+///     deleted objects are never given to another object, so this is NULL
+///     for them too.
 /// \warning Do not call \c delete on this function's return value.
 GameObject *GameObjectManager::getObjectPointer(unsigned int id)
 {
-  IDToObjectMapIter it = m_idToObject.find(id);
-  if(it == m_idToObject.end())
-    return NULL;
-  else
-    return it->second;
+  return m_objectSlots.find(id);
 }
 
 /// \param name Specifies the name of the object.
@@ -197,15 +297,114 @@ GameObject *GameObjectManager::getObjectPointer(const std::string &name)
   return getObjectPointer(getObjectID(name));
 }
 
+/// Objects being updated on a worker thread can't touch anything but
+/// themselves, so they record everything else here (see GameObject::getCommands()).
+/// The commands are carried out at the end of the update step, in the same
+/// order as if the objects had been updated one at a time.  Commands recorded
+/// outside an update step are carried out at the end of the next one.
+/// \return The buffer for the calling thread.
+CommandBuffer &GameObjectManager::getCommandBuffer()
+{
+  int thread = gJobSystem.getThreadIndex();
+  if(m_commandBuffers.empty())
+    m_commandBuffers.resize(1);
+  assert(thread < (int)m_commandBuffers.size());
+  return m_commandBuffers[thread];
+}
+
+/// Objects with GameObject::m_bParallel set are shared out among gJobSystem's
+/// threads if parallelUpdate is on.  The rest are then updated on this
+/// thread, in order.  Finally, the commands the objects recorded are
+/// carried out, in order of object, so the results are the same as updating
+/// every object here in order, provided the parallel objects keep to
+/// themselves.
+/// \param objects Specifies the objects.  Only live objects are updated.
+/// \param phase Specifies the step to run.
+/// \param dt Specifies the time step passed to the objects.
+void GameObjectManager::updateObjects(ObjectSet &objects, UpdatePhase phase, float dt)
+{
+  int threads = gJobSystem.getThreadCount();
+  if((int)m_commandBuffers.size() < threads || m_commandBuffers.empty())
+    m_commandBuffers.resize(threads > 1 ? threads : 1);
+
+  // Objects spawned during the update are new, and skipped until next frame
+  int count = objects.size();
+  bool parallel = parallelUpdate && threads > 1;
+
+  if(parallel)
+  {
+    UpdateJob job;
+    job.manager = this;
+    job.objects = &objects;
+    job.phase = phase;
+    job.dt = dt;
+    gJobSystem.parallelFor(count, parallelBatchSize, updateJob, &job);
+  }
+
+  // Spawning can grow the array, so go by index rather than iterator
+  for(int i = 0; i < count; i++)
+  {
+    GameObject &object = *objects[i];
+    if(object.m_lifeState != GameObject::LS_ALIVE || (parallel && object.m_bParallel))
+      continue;
+    m_commandBuffers[0].setKey(i);
+    updateObject(object, phase, dt);
+  }
+
+  CommandBuffer::execute(m_commandBuffers);
+}
+
+/// \param context Points to an UpdateJob.
+/// \param begin First index of the batch in the object set.
+/// \param end One past the last index of the batch.
+/// \param thread Index of the thread running the batch.
+void GameObjectManager::updateJob(void *context, int begin, int end, int thread)
+{
+  UpdateJob &job = *(UpdateJob *)context;
+  ObjectSet &objects = *job.objects;
+  CommandBuffer &commands = job.manager->m_commandBuffers[thread];
+
+  for(int i = begin; i < end; i++)
+  {
+    GameObject &object = *objects[i];
+    if(object.m_lifeState != GameObject::LS_ALIVE || !object.m_bParallel)
+      continue;
+    commands.setKey(i);
+    job.manager->updateObject(object, job.phase, job.dt);
+  }
+}
+
+/// \param object Specifies the object.
+/// \param phase Specifies the step to run.
+/// \param dt Specifies the time step passed to the object.
+void GameObjectManager::updateObject(GameObject &object, UpdatePhase phase, float dt)
+{
+  switch(phase)
+  {
+    case UP_PROCESS:
+    {
+      object.process(dt);
+    } break;
+    case UP_MOVE:
+    {
+      if(object.m_nNumFrames > 1)
+        selectAnimationLevel(object);
+      object.move(dt);
+    } break;
+    case UP_BOUNDS:
+    {
+      object.computeBoundingBox();
+    } break;
+  }
+}
+
 /// This function handles any internal processing each object should perform before movement.
 /// Typically, this function won't need to be overridden in a derived class.
 /// \param dt Specifies the amount of time since the last call to process().
 void GameObjectManager::process(float dt)
 {
   // Process live objects (new objects spawned during this loop will be skipped until next frame)
-  for(ObjectSetIter it = m_processableObjects.begin(); it != m_processableObjects.end(); ++it)
-    if((*it)->m_lifeState == GameObject::LS_ALIVE)
-      (*it)->process(dt);
+  updateObjects(m_processableObjects, UP_PROCESS, dt);
 }
 
 /// This function handles all "normal" movement of each object--that is, any movement that
@@ -214,18 +413,59 @@ void GameObjectManager::process(float dt)
 /// \param dt Specifies the amount of time since the last call to render().
 void GameObjectManager::move(float dt)
 {
-  for(ObjectSetIter it = m_movableObjects.begin(); it != m_movableObjects.end(); ++it)
-    if((*it)->m_lifeState == GameObject::LS_ALIVE)
-      (*it)->move(dt);
+  updateObjects(m_movableObjects, UP_MOVE, dt);
+
+  // Animated models share their frame cache and vertex buffers among the
+  // objects using them, so the interpolation is done here, in order
+
+  animatedFull = animatedReduced = animatedHidden = 0;
+  for(int i = 0; i < m_movableObjects.size(); i++)
+  {
+    GameObject &object = *m_movableObjects[i];
+    if(!object.m_bAnimationPending)
+      continue;
+    switch(object.m_animLevel)
+    {
+      case GameObject::AL_FULL: ++animatedFull; break;
+      case GameObject::AL_REDUCED: ++animatedReduced; break;
+      case GameObject::AL_HIDDEN: ++animatedHidden; break;
+    }
+    object.updateAnimation();
+  }
+}
+
+/// Objects the camera can't see, because they're outside the view frustum
+/// or fogged out, only have their frame and bounding box updated.  Objects
+/// farther than animationLODDistance from the camera are at the reduced
+/// level.  The test uses the bounding box from the object's last move and
+/// the camera from the last frame, which is why animationLODMargin is there.
+/// \param object Specifies the animated object about to be moved.
+void GameObjectManager::selectAnimationLevel(GameObject &object)
+{
+  GameObject::AnimationLevel level = GameObject::AL_FULL;
+  const AABB3 &box = object.m_boundingBox;
+
+  if(animationLOD && !box.isEmpty())
+  {
+    Vector3 center = box.center();
+    float radius = (box.max - center).magnitude() + animationLODMargin;
+    if(!gRenderer.getFrustum().isSphereVisible(center, radius))
+      level = GameObject::AL_HIDDEN;
+    else if(animationLODDistance > 0.0f &&
+      center.distance(gRenderer.getCameraPos()) - radius > animationLODDistance)
+      level = GameObject::AL_REDUCED;
+  }
+
+  object.m_animLevel = level;
 }
 
 /// This function handles interactions between objects (such as collisions) and other post-movement
 /// interactions.  This function will almost certainly be overridden for your game; however,
-/// a reasonable default implementation is provided.  The default implementation checks all movable
-/// objects against all objects and calls \c interact on each pair (excepting duplicates, in the
-/// case where both objects are movable).  While this is logically sufficient for many games,
-/// the running time for this is Theta(M*O), which is usually Theta(O^2).  Derived classes should
-/// specialize this for a specific game or game type and optimize it to run more efficiently.
+/// a reasonable default implementation is provided.  The default implementation asks the
+/// broadphase for the pairs of objects whose bounding boxes overlap, and calls \c interact on
+/// each pair with at least one movable object, movable object first.  The broadphase keeps this
+/// well under the Theta(O^2) of testing every pair; see \c broadphase.  Derived classes should
+/// specialize this for a specific game or game type, using \c findPairs to find candidates.
 /// An overriding function should also consider whether immobile objects can interact with each
 /// other (collision is only one kind of interaction) and whether other, more complicated interactions
 /// should take place (such as interactions between more than two objects and interactions between
@@ -234,23 +474,19 @@ void GameObjectManager::move(float dt)
 
 void GameObjectManager::handleInteractions()
 {
-  // Default interaction handler:  Check all movable objects against all objects
-  for(ObjectSetIter mit = m_movableObjects.begin(); mit != m_movableObjects.end(); ++mit)
+  // Default interaction handler:  Check overlapping pairs with a movable
+  // object.  The broadphase lists each pair once, so there are no
+  // duplicates to weed out.
+  findPairs(m_pairs);
+  for(int i = 0; i < (int)m_pairs.size(); i++)
   {
-    if((*mit)->m_lifeState != GameObject::LS_ALIVE)
+    GameObject *obj1 = m_pairs[i].first, *obj2 = m_pairs[i].second;
+    if(!obj1->isAlive() || !obj2->isAlive())
       continue;
-    for(ObjectSetIter oit = m_objects.begin(); oit != m_objects.end(); ++oit)
-      {
-        // Handling duplicate interactions (i.e., preventing interact(o1,o2)
-        // and interact(o2,o1)):  Duplicates only occur between any pair of
-        // movable objects o1 and o2.  (Think about it.) Therefore, if both
-        // objects are movable, only call once.  A simple ID ordering
-        // accomplishes our objective.
-        if((*oit)->m_lifeState != GameObject::LS_ALIVE)
-          continue;
-        if((*mit)->m_id != (*oit)->m_id && ((*mit)->m_id < (*oit)->m_id || m_movableObjects.find(*oit) == m_movableObjects.end()))
-          interact(**mit, **oit);
-      }
+    if(m_movableObjects.contains(obj1))
+      interact(*obj1, *obj2);
+    else if(m_movableObjects.contains(obj2))
+      interact(*obj2, *obj1);
   }
 }
 
@@ -290,6 +526,8 @@ unsigned int GameObjectManager::addObject(GameObject *object, bool canMove, bool
     return object->m_id;
   assert(object->m_manager == NULL);
   object->m_manager = this;
+  object->m_id = m_objectSlots.insert(object);  // before the sets, they look the object up by ID
+  assert(object->m_id != ObjectSlotMap::NULLHANDLE);
   m_objects.insert(object);
   if(canMove)
     m_movableObjects.insert(object);
@@ -297,7 +535,6 @@ unsigned int GameObjectManager::addObject(GameObject *object, bool canMove, bool
     m_processableObjects.insert(object);
   if(canRender)
     m_renderableObjects.insert(object);
-  object->m_id = m_objectIDs.generateID();
   if(name == NULL || name->length() == 0)
     object->m_name = m_objectNames.generateName(object->m_className);  // Generate default name
   else if(m_objectNames.requestName(*name))
@@ -306,9 +543,8 @@ unsigned int GameObjectManager::addObject(GameObject *object, bool canMove, bool
     object->m_name = m_objectNames.generateName(*name);                // Append number to requested name
   // Ensure new object status
   object->m_lifeState = GameObject::LS_NEW;
-  // Add id and name mappings
+  // Add name mapping
   m_nameToID[object->m_name] = object->m_id;
-  m_idToObject[object->m_id] = object;
   return object->m_id;
 }
 
@@ -316,25 +552,26 @@ unsigned int GameObjectManager::addObject(GameObject *object, bool canMove, bool
 /// and objects marked as "dead" are culled from the manager.
 void GameObjectManager::updateObjectLifeStates()
 {
-  // Promote new objects to "fully alive" and cull dead objects
-  for(ObjectSetIter it = m_objects.begin(); it != m_objects.end();)
+  // Promote new objects to "fully alive" and cull dead objects.  Deleting
+  // an object moves the last one into its place (swap and pop), so the
+  // same index is looked at again.
+  for(int i = 0; i < m_objects.size();)
   {
-    switch((*it)->m_lifeState)
+    GameObject *object = m_objects[i];
+    switch(object->m_lifeState)
     {
       case GameObject::LS_DEAD:
       {
-        ObjectSetIter murderDeathKill = it;
-        ++it;
-        deleteObject(*murderDeathKill);
+        deleteObject(object);
       } break;
       case GameObject::LS_NEW:
       {
-        (*it)->m_lifeState = GameObject::LS_ALIVE;
-        ++it;
+        object->m_lifeState = GameObject::LS_ALIVE;
+        ++i;
       } break;
       default:
       {
-       ++it;
+       ++i;
       } break;
     };
   }
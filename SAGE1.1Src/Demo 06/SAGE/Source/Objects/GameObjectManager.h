@@ -35,12 +35,13 @@
 #ifndef __GAMEOBJECTMANAGER_H_INCLUDED__
 #define __GAMEOBJECTMANAGER_H_INCLUDED__
 
-#include <hash_map>
-#include <hash_set>
+#include "Common/Portable.h"
 #include <list>
 #include <string>
-#include "Generators/IDGenerator.h"
 #include "Generators/NameGenerator.h"
+#include "Broadphase.h"
+#include "CommandBuffer.h"
+#include "ObjectSlotMap.h"
 
 class GameObject;
 
@@ -49,6 +50,32 @@ class GameObjectManager
 {
   public:
     static bool renderBB;
+
+    static bool animationLOD; ///< Global flag; specifies whether hidden and distant objects put less work into their animation.
+    static float animationLODDistance; ///< Distance from the camera beyond which objects animate at the reduced level.  Zero or less turns the reduced level off.
+    static int animationLODInterval; ///< Objects at the reduced level interpolate their vertices once every this many moves.
+    static bool animationLODLerp; ///< Whether objects at the reduced level interpolate between key frames.
+    static float animationLODMargin; ///< Added to an object's radius when testing whether it can be seen, since the camera moves after the objects do.
+    static int animatedFull; ///< Number of objects animated at the full level in the last move.
+    static int animatedReduced; ///< Number of objects animated at the reduced level in the last move.
+    static int animatedHidden; ///< Number of objects animated at the hidden level in the last move.
+
+    /// \brief Ways of finding which objects' bounding boxes overlap.
+    enum BroadphaseType
+    {
+      BP_BRUTE_FORCE = 0,  ///< Test every pair of objects.
+      BP_HASH_GRID,        ///< Uniform grid of cells in a hash table, see HashGridBroadphase.
+      BP_SWEEP_AND_PRUNE   ///< Objects sorted along x, see SweepAndPruneBroadphase.
+    };
+
+    static int broadphase; ///< Global setting; the BroadphaseType object managers use.
+    static float broadphaseCellSize; ///< Size of a cell for BP_HASH_GRID.
+    static int broadphasePairs; ///< Number of overlapping pairs found in the last handleInteractions.
+
+    static bool parallelUpdate; ///< Global flag; specifies whether objects that allow it are processed, moved and bounded on all of gJobSystem's threads.
+    static int parallelBatchSize; ///< Number of objects in each batch handed to a thread.
+
+    static float renderInterpolation; ///< How far objects are drawn between the start and end of the last tick, from 0 to 1.
     
     // Nested types
 
@@ -62,7 +89,7 @@ class GameObjectManager
     // State update functions
         
     void setNumberOfDeadFrames(unsigned int numFrames);  ///< Sets the number of frames to skip before processing begins.
-    virtual void update(float dt);  ///< Updates the state of all objects.
+    virtual void update(float dt);  ///< Updates the state of all objects by one tick.
     virtual void render();  ///< Renders all renderable objects.
     
     void computeBoundingBoxes(); ///< Updates all objects' bounding boxes.
@@ -80,28 +107,42 @@ class GameObjectManager
     GameObject *getObjectPointer(unsigned int id);  ///< Queries the manager for an object's pointer.
     GameObject *getObjectPointer(const std::string &name);  ///< Queries the manager for an object's pointer.
 
+    CommandBuffer &getCommandBuffer();  ///< Gets the buffer objects record effects on shared state in.
+
   protected:
     // Nested types
     
-    typedef stdext::hash_set<GameObject *> ObjectSet;  ///< Represents a set of objects.
     typedef ObjectSet::iterator ObjectSetIter;  ///< Set iterator.
     typedef stdext::hash_map<std::string, unsigned int> NameToIDMap;  ///< Maps object names to object IDs.
     typedef NameToIDMap::iterator NameToIDMapIter;  ///< Map iterator.
-    typedef stdext::hash_map<unsigned int, GameObject *> IDToObjectMap;  ///< Maps object IDs to object pointers.
-    typedef IDToObjectMap::iterator IDToObjectMapIter;  ///< 
     
     virtual void process(float dt);  ///< Processes all objects.
     virtual void move(float dt);  ///< Moves all objects.
     virtual void handleInteractions();  ///< Processes interactions (such as collision) between objects and other post-movement processing.
     virtual bool interact(GameObject &obj1, GameObject &obj2);  ///< Processes interactions (such as collision) between two objects.
+    void selectAnimationLevel(GameObject &object);  ///< Picks how much work an animated object puts into its animation.
+    void findPairs(Broadphase::PairList &pairs);  ///< Lists the pairs of live objects whose bounding boxes overlap.
+    void findObjectsOnRay(const Vector3 &origin, const Vector3 &delta, Broadphase::ObjectList &objects);  ///< Lists live objects whose bounding boxes a segment may hit.
 
     virtual unsigned int addObject(GameObject *object, bool canMove, bool canProcess, bool canRender, const std::string *namePtr);  ///< Gives control of an object to the manager.
     virtual void updateObjectLifeStates();  ///< Updates new objects to "alive", and culls dead objects.
 
+    /// \brief Steps of an update that updateObjects() can run.
+    enum UpdatePhase
+    {
+      UP_PROCESS,  ///< GameObject::process()
+      UP_MOVE,     ///< GameObject::move(), after picking the animation level
+      UP_BOUNDS    ///< GameObject::computeBoundingBox()
+    };
+
+    void updateObjects(ObjectSet &objects, UpdatePhase phase, float dt);  ///< Runs a step of the update on a set of live objects.
+    void updateObject(GameObject &object, UpdatePhase phase, float dt);  ///< Runs a step of the update on one object.
+
     /// \brief Contains and owns all managed objects.
     ///
     /// Contains and owns all managed objects.  Created objects are
-    /// deleted from here.
+    /// deleted from here.  This and the other object sets are packed
+    /// arrays, so deleting an object moves another into its place.
     ObjectSet m_objects;
     
     /// \brief Lists all objects that can move.
@@ -126,13 +167,37 @@ class GameObjectManager
     ObjectSet m_renderableObjects;
     
     NameToIDMap m_nameToID;       ///< Maps object names to their IDs.
-    IDToObjectMap m_idToObject;   ///< Maps object IDs to their pointers.
     
-    IDGenerator m_objectIDs;      ///< Generates IDs for the objects.
+    ObjectSlotMap m_objectSlots;  ///< Hands out the objects' IDs and maps them back to the objects.
     NameGenerator m_objectNames;  ///< Generates names for the objects.
     
+    /// \brief Finds overlapping bounding boxes.
+    ///
+    /// Holds every object with a model, and is kept up to date by
+    /// computeBoundingBoxes().  It's replaced when the broadphase setting
+    /// changes.
+    Broadphase *m_broadphase;
+    int m_broadphaseType;  ///< BroadphaseType m_broadphase was created as.
+    float m_broadphaseCellSize;  ///< broadphaseCellSize m_broadphase was created with.
+    Broadphase::PairList m_pairs;  ///< Scratch pair list for handleInteractions().
+
+    std::vector<CommandBuffer> m_commandBuffers;  ///< Command buffer for each of gJobSystem's threads.
+
     unsigned int m_numDeadFrames;  ///< Number of frames to skip processing at creation.
     unsigned int m_frameCount;  ///< Tracks the number of frames processed.
+
+  private:
+
+    /// \brief What updateJob() needs to know.
+    struct UpdateJob
+    {
+      GameObjectManager *manager;  ///< The manager
+      ObjectSet *objects;  ///< Objects to update
+      UpdatePhase phase;  ///< Step to run
+      float dt;  ///< Time step
+    };
+
+    static void updateJob(void *context, int begin, int end, int thread);  ///< Runs a step of the update on a batch of objects, for gJobSystem.
 };
 
 #endif
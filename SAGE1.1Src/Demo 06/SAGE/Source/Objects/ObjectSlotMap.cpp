@@ -0,0 +1,150 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ObjectSlotMap.cpp - Handle-based storage for game objects
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ObjectSlotMap.cpp
+/// \brief Code for the ObjectSlotMap and ObjectSet classes.
+
+#include <assert.h>
+
+#include "ObjectSlotMap.h"
+#include "GameObject.h"
+
+/// Free slots aren't reused until there are at least this many
+static const unsigned int kMinFreeSlots = 1024;
+
+/// Mask for the generation once shifted down
+static const unsigned int kGenerationMask = (1u << (32 - ObjectSlotMap::kIndexBits)) - 1;
+
+/// \brief Makes the handle that follows another in the same slot.
+/// \param handle The old handle, which mustn't be of the last generation.
+/// \return The handle with its generation bumped.
+static unsigned int nextHandle(unsigned int handle)
+{
+  assert((handle >> ObjectSlotMap::kIndexBits) < kGenerationMask);
+  return handle + (1u << ObjectSlotMap::kIndexBits);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ObjectSlotMap
+//
+/////////////////////////////////////////////////////////////////////////////
+
+ObjectSlotMap::ObjectSlotMap()
+{
+}
+
+/// \param object The object.
+/// \return The object's handle, or NULLHANDLE if every slot is in use.
+unsigned int ObjectSlotMap::insert(GameObject *object)
+{
+  assert(object != 0);
+
+  unsigned int index;
+  if(!m_freeSlots.empty() &&
+    (m_freeSlots.size() >= kMinFreeSlots || m_slots.size() >= kMaxSlots))
+  {
+    index = m_freeSlots.front();
+    m_freeSlots.pop_front();
+  }
+  else if(m_slots.size() < kMaxSlots)
+  {
+    index = (unsigned int)m_slots.size();
+    Slot slot;
+    slot.object = 0;
+    slot.handle = (1u << kIndexBits) | index;
+    m_slots.push_back(slot);
+  }
+  else
+    return NULLHANDLE;
+
+  m_slots[index].object = object;
+  return m_slots[index].handle;
+}
+
+/// A slot that has used up its last generation is retired instead of
+/// wrapping back to the first, which would hand out its old handles again.
+/// It keeps the last handle, with no object, so that handle stays stale.
+/// \param handle The object's handle.  Does nothing if it's stale.
+void ObjectSlotMap::erase(unsigned int handle)
+{
+  unsigned int index = getIndex(handle);
+  if(index >= m_slots.size() || m_slots[index].handle != handle ||
+    m_slots[index].object == 0)
+    return;
+
+  m_slots[index].object = 0;
+  if((handle >> kIndexBits) == kGenerationMask)
+    return;
+  m_slots[index].handle = nextHandle(handle);
+  m_freeSlots.push_back(index);
+}
+
+/// The slots keep their generations, so handles from before the clear
+/// stay stale.
+void ObjectSlotMap::clear()
+{
+  for(unsigned int i = 0; i < m_slots.size(); i++)
+    if(m_slots[i].object != 0)
+      erase(m_slots[i].handle);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ObjectSet
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \param object The object, which must have been given a handle.
+/// \return true if the object was added, false if it was already there.
+bool ObjectSet::insert(GameObject *object)
+{
+  if(contains(object))
+    return false;
+
+  unsigned int index = ObjectSlotMap::getIndex(object->getID());
+  if(index >= m_positions.size())
+    m_positions.resize(index + 1, -1);
+  m_positions[index] = (int)m_objects.size();
+  m_objects.push_back(object);
+  return true;
+}
+
+/// The last object takes the removed object's place.
+/// \param object The object.
+/// \return true if the object was removed, false if it wasn't there.
+bool ObjectSet::erase(GameObject *object)
+{
+  if(!contains(object))
+    return false;
+
+  int position = m_positions[ObjectSlotMap::getIndex(object->getID())];
+  GameObject *last = m_objects.back();
+  m_objects[position] = last;
+  m_positions[ObjectSlotMap::getIndex(last->getID())] = position;
+  m_objects.pop_back();
+  m_positions[ObjectSlotMap::getIndex(object->getID())] = -1;
+  return true;
+}
+
+/// \param object The object.
+/// \return true if the object is in the set.
+bool ObjectSet::contains(const GameObject *object) const
+{
+  if(object == 0)
+    return false;
+  unsigned int index = ObjectSlotMap::getIndex(object->getID());
+  if(index >= m_positions.size())
+    return false;
+  int position = m_positions[index];
+  return position >= 0 && m_objects[position] == object;
+}
+
+void ObjectSet::clear()
+{
+  m_objects.clear();
+  m_positions.clear();
+}
@@ -0,0 +1,118 @@
+/// \file ObjectSlotMap.h
+/// \brief Interface for the ObjectSlotMap and ObjectSet classes.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ObjectSlotMap.h - Handle-based storage for game objects
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __OBJECTSLOTMAP_H_INCLUDED__
+#define __OBJECTSLOTMAP_H_INCLUDED__
+
+#include <deque>
+#include <vector>
+
+class GameObject;
+
+/// \brief Maps handles to objects.
+///
+/// A handle is 32 bits, an index into an array of slots in the low bits and
+/// the slot's generation in the high bits.  Freeing a slot bumps its
+/// generation, so a handle to an object that has since been deleted no
+/// longer matches and find() returns NULL for it instead of whatever object
+/// moved into the slot.  Inserting, erasing and finding are constant time.
+///
+/// Freed slots are reused oldest first, and only once there are a fair
+/// number of them, so that a slot goes through its generations slowly.
+/// When a slot has had all 4095, it's retired rather than starting over, so
+/// no handle is ever handed out twice; at 4095 objects a slot, the map runs
+/// out only after billions of deletions.  Handles are never zero, so zero
+/// can be used for "no object".
+class ObjectSlotMap
+{
+public:
+
+  enum
+  {
+    kIndexBits = 20, ///< Bits of a handle that hold the slot index
+    kMaxSlots = 1 << kIndexBits ///< Number of slots there can be
+  };
+
+  static const unsigned int NULLHANDLE = 0; ///< Handle that never refers to an object.
+
+  ObjectSlotMap(); ///< Constructs an empty map.
+
+  unsigned int insert(GameObject *object); ///< Puts an object in a free slot.
+  void erase(unsigned int handle); ///< Frees an object's slot.
+  void clear(); ///< Frees every slot.
+
+  /// \brief Looks up an object.
+  /// \param handle The object's handle.
+  /// \return The object, or NULL if the handle is stale or was never valid.
+  GameObject *find(unsigned int handle) const
+  {
+    unsigned int index = getIndex(handle);
+    if(index >= m_slots.size() || m_slots[index].handle != handle)
+      return 0;
+    return m_slots[index].object;
+  }
+
+  /// \brief Extracts the slot index from a handle.
+  /// \param handle The handle.
+  /// \return The index of the handle's slot.
+  static unsigned int getIndex(unsigned int handle) { return handle & (kMaxSlots - 1); }
+
+  /// \brief Queries the map for the number of slots, used or not.
+  /// \return One more than the highest slot index handed out so far.
+  unsigned int getSlotCount() const { return (unsigned int)m_slots.size(); }
+
+private:
+
+  /// \brief A place for one object.
+  struct Slot
+  {
+    GameObject *object; ///< The object, NULL if the slot is free
+    unsigned int handle; ///< Handle of the object in the slot, or of the next one if free
+  };
+
+  std::vector<Slot> m_slots; ///< Slots, indexed by the low bits of the handle
+  std::deque<unsigned int> m_freeSlots; ///< Indices of free slots, oldest first
+};
+
+/// \brief A set of objects kept in a packed array.
+///
+/// The objects are kept one after another in an array, so going through
+/// the set touches memory in order.  Insert, erase and lookup are constant
+/// time using a second array indexed by the objects' slot in the
+/// ObjectSlotMap, so objects must have their handle (GameObject::getID())
+/// before they're inserted.  Erasing moves the last object into the hole,
+/// so it changes the order of the set, and an object erased while going
+/// through the set by index means the same index has to be looked at again.
+class ObjectSet
+{
+public:
+  typedef std::vector<GameObject *>::iterator iterator; ///< Iterator over the objects
+  typedef std::vector<GameObject *>::const_iterator const_iterator; ///< Const iterator over the objects
+
+  bool insert(GameObject *object); ///< Adds an object.
+  bool erase(GameObject *object); ///< Removes an object.
+  bool contains(const GameObject *object) const; ///< Tests whether an object is in the set.
+  void clear(); ///< Removes every object.
+
+  int size() const { return (int)m_objects.size(); } ///< Queries the set for the number of objects.
+  bool empty() const { return m_objects.empty(); } ///< Queries the set for whether it has no objects.
+  GameObject *operator[](int i) const { return m_objects[i]; } ///< Gets the i-th object.
+
+  iterator begin() { return m_objects.begin(); } ///< Iterator to the first object.
+  iterator end() { return m_objects.end(); } ///< Iterator past the last object.
+  const_iterator begin() const { return m_objects.begin(); } ///< Iterator to the first object.
+  const_iterator end() const { return m_objects.end(); } ///< Iterator past the last object.
+
+private:
+  std::vector<GameObject *> m_objects; ///< The objects, packed
+  std::vector<int> m_positions; ///< Position in m_objects by slot index, -1 if not in the set
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __OBJECTSLOTMAP_H_INCLUDED__
@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// Particle.cpp - Particle fields stored one array per field
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file Particle.cpp
+/// \brief Code for the ParticleArrays class.
+
+#include <string.h>
+
+#include "Particle.h"
+
+/// \brief Allocates a zeroed array.
+/// \param count Number of elements.
+/// \return The array.
+template <class T> static T *newArray(int count)
+{
+  T *a = new T[count];
+  memset(a, 0, sizeof(T) * count);
+  return a;
+}
+
+/// \brief Puts one field's elements in a given order.
+/// \param field The field's array.
+/// \param scratch Room for count elements.
+/// \param order Index of the element to go in each place.
+/// \param count Number of elements to put in order.
+template <class T> static void gatherField(T *field, T *scratch, const int *order, int count)
+{
+  for(int i = 0; i < count; i++)
+    scratch[i] = field[order[i]];
+  memcpy(field, scratch, sizeof(T) * count);
+}
+
+ParticleArrays::ParticleArrays()
+{
+  posX = posY = posZ = NULL;
+  velX = velY = velZ = NULL;
+  lifeleft = NULL;
+  rotation = rotationSpeed = rotationStopTime = NULL;
+  color = NULL;
+  depthKey = NULL;
+  m_scratch = NULL;
+  m_capacity = 0;
+}
+
+ParticleArrays::~ParticleArrays()
+{
+  release();
+}
+
+/// Any particles already there are lost.  The arrays are rounded up to
+/// whole groups of four, plus one more group, so a group starting at any
+/// particle stays inside them.  They start out zeroed.
+/// \param count Number of particles
+void ParticleArrays::allocate(int count)
+{
+  release();
+
+  m_capacity = ((count + 3) & ~3) + 4;
+
+  posX = newArray<float>(m_capacity);
+  posY = newArray<float>(m_capacity);
+  posZ = newArray<float>(m_capacity);
+  velX = newArray<float>(m_capacity);
+  velY = newArray<float>(m_capacity);
+  velZ = newArray<float>(m_capacity);
+  lifeleft = newArray<float>(m_capacity);
+  rotation = newArray<float>(m_capacity);
+  rotationSpeed = newArray<float>(m_capacity);
+  rotationStopTime = newArray<float>(m_capacity);
+  color = newArray<unsigned int>(m_capacity);
+  depthKey = newArray<unsigned int>(m_capacity);
+  m_scratch = newArray<float>(m_capacity);
+}
+
+void ParticleArrays::release()
+{
+  delete[] posX;
+  delete[] posY;
+  delete[] posZ;
+  delete[] velX;
+  delete[] velY;
+  delete[] velZ;
+  delete[] lifeleft;
+  delete[] rotation;
+  delete[] rotationSpeed;
+  delete[] rotationStopTime;
+  delete[] color;
+  delete[] depthKey;
+  delete[] m_scratch;
+
+  posX = posY = posZ = NULL;
+  velX = velY = velZ = NULL;
+  lifeleft = NULL;
+  rotation = rotationSpeed = rotationStopTime = NULL;
+  color = NULL;
+  depthKey = NULL;
+  m_scratch = NULL;
+  m_capacity = 0;
+}
+
+/// The depth keys aren't moved, they are only good until the next sort.
+/// \param order Index of the particle to go in each place, a permutation
+/// of 0 to count - 1.
+/// \param count Number of particles to put in order.
+void ParticleArrays::gather(const int *order, int count)
+{
+  gatherField(posX, m_scratch, order, count);
+  gatherField(posY, m_scratch, order, count);
+  gatherField(posZ, m_scratch, order, count);
+  gatherField(velX, m_scratch, order, count);
+  gatherField(velY, m_scratch, order, count);
+  gatherField(velZ, m_scratch, order, count);
+  gatherField(lifeleft, m_scratch, order, count);
+  gatherField(rotation, m_scratch, order, count);
+  gatherField(rotationSpeed, m_scratch, order, count);
+  gatherField(rotationStopTime, m_scratch, order, count);
+  gatherField(color, (unsigned int *)m_scratch, order, count);
+}
@@ -28,41 +28,51 @@
 */
 
 /// \file Particle.h
-/// \brief Interface for the Particle class.
+/// \brief Interface for the ParticleArrays class.
 
 #ifndef __PARTICLE_H_INCLUDED__
 #define __PARTICLE_H_INCLUDED__
 
-#include "common/Vector3.h"
-
 //-----------------------------------------------------------------------------
 /// \brief Particle information used by ParticleEffect
 ///
-/// Represents a single particle
-class Particle
+/// The particles of an effect, stored as one array per field rather than
+/// one record per particle, so the update can work on four particles at a
+/// time with SSE.  Live particles are packed at the front of the arrays.
+/// Every array has room for a few particles past the end, so a loop can
+/// run over whole groups of four.
+class ParticleArrays
 {
-  friend class ParticleEffect;
-
 public:
-  Vector3 position; ///< Position of the particle
-  Vector3 velocity; ///< Velocity of the particle
-  float drag; ///< Rate at which velocity slows
-  float size; ///< Size of the particle
-  unsigned int color; ///< Color value of the particle
-  float lifeleft; ///< Time in seconds until the particle dies
-  bool birthed; ///< Whether this particle has been created (used)
+  ParticleArrays(); ///< Basic constructor
+  ~ParticleArrays(); ///< Basic destructor
+
+  void allocate(int count); ///< Allocates room for a number of particles
+  void gather(const int *order, int count); ///< Puts particles in a given order
+
+  float *posX; ///< Position of the particle, x coordinate
+  float *posY; ///< Position of the particle, y coordinate
+  float *posZ; ///< Position of the particle, z coordinate
+  float *velX; ///< Velocity of the particle, x coordinate
+  float *velY; ///< Velocity of the particle, y coordinate
+  float *velZ; ///< Velocity of the particle, z coordinate
+  float *lifeleft; ///< Time in seconds until the particle dies
+  float *rotation; ///< Current rotation of the particle
+  float *rotationSpeed; ///< Speed at which the particle rotates (in radians/sec)
+  float *rotationStopTime; ///< Time until rotation stops
+  unsigned int *color; ///< Color value of the particle
+
+  unsigned int *depthKey; ///< Used by the effect class for sorting
 
-  float rotation; ///< Current rotation of the particle
-  float rotationSpeed; ///< Speed at which the particle rotates (in radians/sec)
-  float rotationStopTime; ///< Time until rotation stops
+private:
+  ParticleArrays(const ParticleArrays &); ///< Not copyable
+  ParticleArrays &operator=(const ParticleArrays &); ///< Not copyable
 
-  float uLeft; ///< Texture coords of the particle (top left)
-  float uRight; ///< Texture coords of the particle (top right)
-  float vTop; ///< Texture coords of the particle (bottom left)
-  float vBottom; ///< Texture coords of the particle (bottom right)
+  void release(); ///< Frees the arrays
 
-  float distance; ///< Used by the effect class for sorting
+  float *m_scratch; ///< Room for gather() to build one field in
+  int m_capacity; ///< Length of every array, including the padding
 };
 //-----------------------------------------------------------------------------
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,231 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBatcher.cpp - Draws particle effects in batches sharing a texture and blend
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParticleBatcher.cpp
+/// \brief Code for the ParticleBatcher class.
+
+#include <algorithm>
+
+#include "ParticleBatcher.h"
+#include "ParticleEffect.h"
+#include "Common/Renderer.h"
+
+/// \param ringQuads Number of sprites the vertex ring holds.  A frame's
+/// sprites needn't all fit, the ring just starts over sooner.
+ParticleBatcher::ParticleBatcher(int ringQuads)
+{
+  m_nRingQuads = ringQuads;
+  m_nRingPos = 0;
+  m_nRunStart = 0;
+  m_nLastEffects = 0;
+  m_nLastBatches = 0;
+
+  m_vertBuffer = new LitVertexBuffer(m_nRingQuads * 4, true);
+
+  // the indices never change, and with each draw starting from its own
+  // first vertex, one set does for every draw; make a pattern of
+  //    0---1
+  //    |  /|
+  //    | / |
+  //    |/  |
+  //    2---3
+  // for each sprite
+  int quads = std::min<int>(m_nRingQuads, kMaxDrawQuads);
+  m_indexBuffer = new IndexBuffer(quads * 2);
+  m_indexBuffer->lock();
+  for(int i = 0; i < quads; i++)
+  {
+    int vertOffset = i * 4;
+    int triOffset = i * 2;
+
+    (*m_indexBuffer)[triOffset].index[0]   = vertOffset;
+    (*m_indexBuffer)[triOffset].index[1]   = vertOffset + 1;
+    (*m_indexBuffer)[triOffset].index[2]   = vertOffset + 2;
+
+    (*m_indexBuffer)[triOffset+1].index[0] = vertOffset + 2;
+    (*m_indexBuffer)[triOffset+1].index[1] = vertOffset + 1;
+    (*m_indexBuffer)[triOffset+1].index[2] = vertOffset + 3;
+  }
+  m_indexBuffer->unlock();
+}
+
+ParticleBatcher::~ParticleBatcher()
+{
+  delete m_vertBuffer;
+  delete m_indexBuffer;
+}
+
+/// Effects must be added back to front.  Nothing is drawn until flush().
+/// \param effect The effect, whose particles must already be sorted
+void ParticleBatcher::add(ParticleEffect *effect)
+{
+  if(effect->m_nLiveParticleCount == 0)
+    return;
+
+  int texture = effect->m_def->m_txtParticleTexture;
+  EParticleBlend blend = effect->m_def->m_blend;
+
+  // find the batch it can go in: an additive effect can join any batch
+  // with its texture in the run of additive batches since the last alpha
+  // blended one, an alpha blended effect only the batch just before it
+  int batch = -1;
+  if(blend == eParticleBlendAdditive)
+  {
+    for(int b = m_nRunStart; b < (int)m_batches.size() && batch < 0; b++)
+    {
+      if(m_batches[b].texture == texture)
+        batch = b;
+    }
+  }
+  else if(!m_batches.empty() && m_batches.back().blend == blend &&
+    m_batches.back().texture == texture)
+    batch = (int)m_batches.size() - 1;
+
+  // or start one
+  if(batch < 0)
+  {
+    Batch newBatch;
+    newBatch.texture = texture;
+    newBatch.blend = blend;
+    newBatch.first = 0;
+    newBatch.count = 0;
+    batch = (int)m_batches.size();
+    m_batches.push_back(newBatch);
+  }
+
+  if(blend != eParticleBlendAdditive)
+    m_nRunStart = batch + 1;
+
+  m_batches[batch].count++;
+  m_effects.push_back(effect);
+  m_batchOf.push_back(batch);
+}
+
+/// The states all the batches share are set once, and put back afterwards.
+/// The batches are drawn in the order they were started.
+void ParticleBatcher::flush()
+{
+  m_nLastEffects = (int)m_effects.size();
+  m_nLastBatches = (int)m_batches.size();
+  if(m_effects.empty())
+    return;
+
+  // put the effects together by batch, keeping their order within each
+  int offset = 0;
+  for(int b = 0; b < (int)m_batches.size(); b++)
+  {
+    m_batches[b].first = offset;
+    offset += m_batches[b].count;
+    m_batches[b].count = 0;
+  }
+  m_order.resize(m_effects.size());
+  for(int i = 0; i < (int)m_effects.size(); i++)
+  {
+    Batch &batch = m_batches[m_batchOf[i]];
+    m_order[batch.first + batch.count++] = m_effects[i];
+  }
+
+  // blending and depth writes go through the renderer, which remembers
+  // them, so they're only sent to the device if they change
+  bool blendEnable = gRenderer.getBlendEnable();
+  ESourceBlendMode sourceBlend = gRenderer.getSourceBlendMode();
+  EDestBlendMode destBlend = gRenderer.getDestBlendMode();
+  bool depthWrite = gRenderer.getDepthBufferWrite();
+  gRenderer.setBlendEnable(true);
+  gRenderer.setSourceBlendMode(eSourceBlendModeSrcAlpha);
+  gRenderer.setDepthBufferMode(gRenderer.getDepthBufferRead(), false);
+
+  // the sprites are pre-lit, and their alpha is the texture alpha times
+  // the diffuse alpha
+  unsigned lighting = gRenderer.getRenderState(eRenderStateLighting);
+  unsigned vertexAlpha = gRenderer.getRenderState(eRenderStateVertexAlpha);
+  gRenderer.setRenderState(eRenderStateLighting, 0);
+  gRenderer.setRenderState(eRenderStateVertexAlpha, 1);
+
+  for(int b = 0; b < (int)m_batches.size(); b++)
+    drawBatch(m_batches[b]);
+
+  // restore render states
+  gRenderer.setRenderState(eRenderStateLighting, lighting);
+  gRenderer.setRenderState(eRenderStateVertexAlpha, vertexAlpha);
+  gRenderer.setBlendEnable(blendEnable);
+  gRenderer.setSourceBlendMode(sourceBlend);
+  gRenderer.setDestBlendMode(destBlend);
+  gRenderer.setDepthBufferMode(gRenderer.getDepthBufferRead(), depthWrite);
+
+  m_effects.clear();
+  m_batchOf.clear();
+  m_batches.clear();
+  m_nRunStart = 0;
+}
+
+/// \param effects Address of an int to store the number of effects, or NULL
+/// \param batches Address of an int to store the number of batches, or NULL
+void ParticleBatcher::getLastCounts(int *effects, int *batches)
+{
+  if(effects != NULL)
+    *effects = m_nLastEffects;
+  if(batches != NULL)
+    *batches = m_nLastBatches;
+}
+
+/// Only the blend mode and the texture are set for the batch.  Its sprites
+/// are drawn in one go unless there are too many for 16 bit indices or the
+/// ring, when they're split up as little as possible.
+/// \param batch The batch
+void ParticleBatcher::drawBatch(const Batch &batch)
+{
+  gRenderer.setDestBlendMode(batch.blend == eParticleBlendAdditive ?
+    eDestBlendModeOne : eDestBlendModeInvSrcAlpha);
+
+  gRenderer.selectTexture(batch.texture);
+
+  int most = std::min<int>(m_nRingQuads, kMaxDrawQuads);
+  ParticleEffect **effects = &m_order[batch.first];
+  int first = 0;
+  int quads = 0;
+  for(int i = 0; i < batch.count; i++)
+  {
+    int n = effects[i]->m_nLiveParticleCount;
+    if(quads > 0 && quads + n > most)
+    {
+      drawQuads(effects + first, i - first, quads);
+      first = i;
+      quads = 0;
+    }
+    quads = std::min<int>(quads + n, most);
+  }
+  drawQuads(effects + first, batch.count - first, quads);
+}
+
+/// The sprites go in the ring after the ones already drawn, or back at its
+/// start if there isn't room.  An effect with more particles than fit is
+/// cut short.
+/// \param effects The effects
+/// \param count Number of effects
+/// \param quads Number of sprites to draw, the effects' particles in all
+/// but no more than the ring or a draw can hold
+void ParticleBatcher::drawQuads(ParticleEffect **effects, int count, int quads)
+{
+  if(m_nRingPos + quads > m_nRingQuads)
+    m_nRingPos = 0;
+
+  if(!m_vertBuffer->lock(m_nRingPos * 4, quads * 4))
+    return;
+
+  int written = 0;
+  for(int i = 0; i < count && written < quads; i++)
+  {
+    int n = std::min<int>(effects[i]->m_nLiveParticleCount, quads - written);
+    effects[i]->writeSprites(&(*m_vertBuffer)[written * 4], n);
+    written += n;
+  }
+
+  m_vertBuffer->unlock();
+
+  gRenderer.render(m_vertBuffer, m_nRingPos * 4, quads * 4, m_indexBuffer, 0, quads * 2);
+  m_nRingPos += quads;
+}
@@ -0,0 +1,83 @@
+/// \file ParticleBatcher.h
+/// \brief Interface for the ParticleBatcher class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBatcher.h - Draws particle effects in batches sharing a texture and blend
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PARTICLEBATCHER_H_INCLUDED__
+#define __PARTICLEBATCHER_H_INCLUDED__
+
+#include <vector>
+#include "Graphics/IndexBuffer.h"
+#include "Graphics/VertexTypes.h"
+#include "ParticleDefines.h"
+
+class ParticleEffect;
+
+//-----------------------------------------------------------------------------
+/// \brief Collects the particle effects to be drawn in a frame and draws
+/// those sharing a texture and blend mode together.
+///
+/// Effects are added back to front.  Each batch is one draw: the sprites of
+/// all its effects are written one after the other into a dynamic vertex
+/// buffer used as a ring, and drawn with an index buffer that all the
+/// batches share.  The states common to all particles are set once for
+/// all the batches, leaving at most a blend mode and a texture to change
+/// from one batch to the next.
+///
+/// Batches are drawn in the order they were started, so every effect is
+/// still drawn after the ones behind it that it could overlap.  Additive
+/// effects look the same drawn in any order among themselves, so those
+/// with the same texture make one batch as long as no alpha blended effect
+/// comes between them.  An alpha blended effect joins a batch only if it
+/// comes straight after it with the same texture; since most effects share
+/// a few textures, that still merges most of them.
+class ParticleBatcher
+{
+public:
+  ParticleBatcher(int ringQuads); ///< Makes the buffers
+  ~ParticleBatcher(); ///< Frees the buffers
+
+  void add(ParticleEffect *effect); ///< Adds an effect to be drawn
+  void flush(); ///< Draws the effects added since the last flush
+
+  /// \brief Gets how many effects the last flush drew, in how many batches
+  /// \param effects Address of an int to store the number of effects, or NULL
+  /// \param batches Address of an int to store the number of batches, or NULL
+  void getLastCounts(int *effects, int *batches);
+
+private:
+  /// \brief Effects drawn together
+  struct Batch
+  {
+    int texture; ///< Handle of the effects' texture
+    EParticleBlend blend; ///< Blend mode of the effects
+    int first; ///< Index in m_order of the first effect
+    int count; ///< Number of effects
+  };
+
+  /// Most sprites in one draw, so every index fits in 16 bits
+  enum { kMaxDrawQuads = 0x10000 / 4 };
+
+  LitVertexBuffer *m_vertBuffer; ///< Ring of sprite vertices
+  IndexBuffer *m_indexBuffer; ///< Two triangles for each sprite, shared by all draws
+  int m_nRingQuads; ///< Number of sprites the ring holds
+  int m_nRingPos; ///< Next free sprite in the ring
+
+  std::vector<ParticleEffect*> m_effects; ///< Effects added, in order
+  std::vector<int> m_batchOf; ///< Batch each effect was added to
+  std::vector<Batch> m_batches; ///< Batches, in the order they were started
+  std::vector<ParticleEffect*> m_order; ///< Effects put together by batch
+  int m_nRunStart; ///< First batch after the last alpha blended one, where additive effects may merge
+  int m_nLastEffects; ///< Effects drawn by the last flush
+  int m_nLastBatches; ///< Batches drawn by the last flush
+
+  void drawBatch(const Batch &batch); ///< Writes and draws the effects of a batch
+  void drawQuads(ParticleEffect **effects, int count, int quads); ///< Writes and draws a run of effects in one draw
+};
+//-----------------------------------------------------------------------------
+
+#endif // #ifndef __PARTICLEBATCHER_H_INCLUDED__
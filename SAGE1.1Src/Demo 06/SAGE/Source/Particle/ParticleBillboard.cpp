@@ -0,0 +1,265 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBillboard.cpp - Writes particle sprites into a vertex buffer
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParticleBillboard.cpp
+/// \brief Code for the ParticleBillboard class.
+
+#include <math.h>
+#include <emmintrin.h>
+#include <algorithm>
+
+#include "ParticleBillboard.h"
+#include "Particle.h"
+#include "Common/MathUtil.h"
+#include "Common/Matrix4x3.h"
+#include "Common/Renderer.h"
+
+/// \brief Things writeSprite() needs that are the same for every sprite.
+struct SpriteConstants
+{
+  __m128 xyz; ///< Mask keeping x, y and z and clearing the fourth lane
+  __m128 uvTopRight; ///< Texture coordinates of the upper right corner in the low lanes
+  __m128 uvBottomLeft; ///< Texture coordinates of the bottom left corner in the low lanes
+  __m128 uvBottomRight; ///< Texture coordinates of the bottom right corner in the low lanes
+
+  SpriteConstants()
+  {
+    xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    uvTopRight = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    uvBottomLeft = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+    uvBottomRight = _mm_setr_ps(1.0f, 1.0f, 0.0f, 0.0f);
+  }
+};
+
+/// Writes the four vertices of a sprite, upper left, upper right, bottom
+/// left and bottom right, 96 bytes in all, as six stores of four floats.
+/// Each corner is worked out in a register with the color in its fourth
+/// lane, and the texture coordinates are shuffled in around them.
+/// \param out Where the first vertex goes.
+/// \param pos Center of the sprite, in the low three lanes.
+/// \param right Half the sprite's width along its right axis.
+/// \param up Half the sprite's height along its up axis.
+/// \param color Color of the sprite.
+/// \param k The constants.
+static inline void writeSprite(float *out, __m128 pos, __m128 right, __m128 up,
+  unsigned int color, const SpriteConstants &k)
+{
+  __m128 argb = _mm_castsi128_ps(_mm_shuffle_epi32(_mm_cvtsi32_si128((int)color), _MM_SHUFFLE(0, 1, 1, 1)));
+
+  __m128 top = _mm_add_ps(pos, up);
+  __m128 bottom = _mm_sub_ps(pos, up);
+  __m128 ul = _mm_or_ps(_mm_and_ps(_mm_sub_ps(top, right), k.xyz), argb);
+  __m128 ur = _mm_or_ps(_mm_and_ps(_mm_add_ps(top, right), k.xyz), argb);
+  __m128 bl = _mm_or_ps(_mm_and_ps(_mm_sub_ps(bottom, right), k.xyz), argb);
+  __m128 br = _mm_or_ps(_mm_and_ps(_mm_add_ps(bottom, right), k.xyz), argb);
+
+  // x y z argb | u v x y | z argb u v, twice; the upper left corner's
+  // texture coordinates are both zero
+
+  _mm_storeu_ps(out, ul);
+  _mm_storeu_ps(out + 4, _mm_movelh_ps(_mm_setzero_ps(), ur));
+  _mm_storeu_ps(out + 8, _mm_shuffle_ps(ur, k.uvTopRight, _MM_SHUFFLE(1, 0, 3, 2)));
+  _mm_storeu_ps(out + 12, bl);
+  _mm_storeu_ps(out + 16, _mm_movelh_ps(k.uvBottomLeft, br));
+  _mm_storeu_ps(out + 20, _mm_shuffle_ps(br, k.uvBottomRight, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+/// Sines and cosines of four angles at once.  The angles are brought into
+/// -pi..pi by taking off whole turns, with 2 pi split in two so that the
+/// turns of a large angle come off exactly, then into -pi/2..pi/2 by reflecting
+/// about +/-pi/2, which keeps the sine and flips the sign of the cosine,
+/// and there the Taylor series to x^11 and x^12 are good to about 1e-7.
+/// \param angles Four angles in radians, of any size up to about 1e9.
+/// \param s Where the sines go.
+/// \param c Where the cosines go.
+static inline void sinCos4(__m128 angles, __m128 *s, __m128 *c)
+{
+  const __m128 twoPiHigh = _mm_set1_ps(6.28125f); // few enough bits to multiply exactly
+  const __m128 twoPiLow = _mm_set1_ps(1.9353071795864769e-3f); // the rest of 2 pi
+  const __m128 halfPi = _mm_set1_ps(kPiOver2);
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+
+  __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angles, _mm_set1_ps(k1Over2Pi))));
+  __m128 x = _mm_sub_ps(_mm_sub_ps(angles, _mm_mul_ps(turns, twoPiHigh)), _mm_mul_ps(turns, twoPiLow));
+
+  // past pi/2 either way, x becomes +/-pi - x
+  __m128 sign = _mm_and_ps(x, signBit);
+  __m128 reflect = _mm_cmpgt_ps(_mm_andnot_ps(signBit, x), halfPi);
+  __m128 mirror = _mm_sub_ps(_mm_or_ps(_mm_set1_ps(kPi), sign), x);
+  x = _mm_or_ps(_mm_and_ps(reflect, mirror), _mm_andnot_ps(reflect, x));
+
+  __m128 x2 = _mm_mul_ps(x, x);
+  __m128 sp = _mm_set1_ps(-1.0f / 39916800.0f);
+  sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(1.0f / 362880.0f));
+  sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(-1.0f / 5040.0f));
+  sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(1.0f / 120.0f));
+  sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(-1.0f / 6.0f));
+  sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(1.0f));
+  __m128 cp = _mm_set1_ps(1.0f / 479001600.0f);
+  cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(-1.0f / 3628800.0f));
+  cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(1.0f / 40320.0f));
+  cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(-1.0f / 720.0f));
+  cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(1.0f / 24.0f));
+  cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(-0.5f));
+  cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(1.0f));
+
+  *s = _mm_mul_ps(sp, x);
+  *c = _mm_xor_ps(cp, _mm_and_ps(reflect, signBit));
+}
+
+/// \param v A vector.
+/// \return v in the low three lanes of a register.
+static inline __m128 load(const Vector3 &v)
+{
+  return _mm_setr_ps(v.x, v.y, v.z, 0.0f);
+}
+
+/// The camera's axes are the rows of the world to camera matrix's upper
+/// 3x3 part.  Axis aligned sprites keep their up axis along the given axis
+/// and turn about it to face the camera as well as they can.
+/// \param mode How the sprites are oriented.
+/// \param worldToCamera The renderer's world to camera matrix.
+/// \param size Half the sprite's size.
+/// \param axis Axis of axis aligned sprites, need not be normalized.
+/// \param stretch Seconds of travel a velocity stretched sprite covers.
+ParticleBillboard::ParticleBillboard(EParticleBillboard mode, const Matrix4x3 &worldToCamera,
+  float size, const Vector3 &axis, float stretch)
+{
+  m_mode = mode;
+  m_size = size;
+  m_stretch = stretch;
+
+  m_cameraRight = Vector3(worldToCamera.m11, worldToCamera.m21, worldToCamera.m31);
+  m_cameraUp = Vector3(worldToCamera.m12, worldToCamera.m22, worldToCamera.m32);
+  m_cameraForward = Vector3(worldToCamera.m13, worldToCamera.m23, worldToCamera.m33);
+
+  m_right = m_cameraRight * size;
+  m_up = m_cameraUp * size;
+
+  if(mode == eParticleBillboardAxis && axis.magnitudeSquared() > 0.0f)
+  {
+    Vector3 up = axis;
+    up.normalize();
+    Vector3 right = up.crossProduct(m_cameraForward);
+
+    // looking straight along the axis, any right will do
+    if(right.magnitude() > 0.001f)
+    {
+      right.normalize();
+      m_right = right * size;
+      m_up = up * size;
+    }
+  }
+}
+
+/// \param particles The particles.
+/// \param count Number of particles to write sprites for, the vertex buffer
+/// must have room for four vertices each.
+/// \param rotate Whether the particles rotate.  Only camera facing sprites
+/// do, the others always keep to their axes.
+/// \param vert First vertex to write.
+void ParticleBillboard::write(const ParticleArrays &particles, int count, bool rotate, RenderVertexL *vert) const
+{
+  float *out = (float *)vert;
+
+  if(m_mode == eParticleBillboardVelocity)
+    writeStretched(particles, count, out);
+  else if(m_mode == eParticleBillboardCamera && rotate)
+    writeRotated(particles, count, out);
+  else
+    writeFixed(particles, count, out);
+}
+
+void ParticleBillboard::writeFixed(const ParticleArrays &particles, int count, float *out) const
+{
+  SpriteConstants k;
+  __m128 right = load(m_right);
+  __m128 up = load(m_up);
+
+  for(int i = 0; i < count; i++, out += 24)
+  {
+    __m128 pos = _mm_setr_ps(particles.posX[i], particles.posY[i], particles.posZ[i], 0.0f);
+    writeSprite(out, pos, right, up, particles.color[i], k);
+  }
+}
+
+/// A sprite turned by angle a about the camera's forward vector has
+/// right = cos(a) right0 + sin(a) up0 and up = cos(a) up0 - sin(a) right0,
+/// where right0 and up0 are the unturned axes.  The sines and cosines are
+/// worked out four particles at a time, straight from the rotation array;
+/// the arrays are padded to a multiple of four, so the last load never
+/// runs off the end, and the padding's angles are thrown away.
+void ParticleBillboard::writeRotated(const ParticleArrays &particles, int count, float *out) const
+{
+  SpriteConstants k;
+  __m128 right0 = load(m_right);
+  __m128 up0 = load(m_up);
+
+  for(int i = 0; i < count; i += 4)
+  {
+    __m128 vs4, vc4;
+    sinCos4(_mm_loadu_ps(particles.rotation + i), &vs4, &vc4);
+    float s[4], c[4];
+    _mm_storeu_ps(s, vs4);
+    _mm_storeu_ps(c, vc4);
+
+    int n = std::min<int>(4, count - i);
+    for(int j = 0; j < n; j++, out += 24)
+    {
+      __m128 vs = _mm_set1_ps(s[j]);
+      __m128 vc = _mm_set1_ps(c[j]);
+      __m128 right = _mm_add_ps(_mm_mul_ps(right0, vc), _mm_mul_ps(up0, vs));
+      __m128 up = _mm_sub_ps(_mm_mul_ps(up0, vc), _mm_mul_ps(right0, vs));
+
+      __m128 pos = _mm_setr_ps(particles.posX[i + j], particles.posY[i + j], particles.posZ[i + j], 0.0f);
+      writeSprite(out, pos, right, up, particles.color[i + j], k);
+    }
+  }
+}
+
+/// The sprite's up axis is the particle's velocity as seen on screen, that
+/// is, without the part along the camera's forward vector, and the sprite
+/// is lengthened by the distance that covers in m_stretch seconds.  A
+/// particle moving straight towards or away from the camera gets a plain
+/// camera facing sprite.
+void ParticleBillboard::writeStretched(const ParticleArrays &particles, int count, float *out) const
+{
+  SpriteConstants k;
+  const Vector3 &f = m_cameraForward; // shorthand
+  __m128 cameraRight = load(m_right);
+  __m128 cameraUp = load(m_up);
+
+  for(int i = 0; i < count; i++, out += 24)
+  {
+    float vx = particles.velX[i];
+    float vy = particles.velY[i];
+    float vz = particles.velZ[i];
+    float along = vx*f.x + vy*f.y + vz*f.z;
+    vx -= along*f.x;
+    vy -= along*f.y;
+    vz -= along*f.z;
+    float speedSquared = vx*vx + vy*vy + vz*vz;
+
+    __m128 right = cameraRight;
+    __m128 up = cameraUp;
+    if(speedSquared > 1e-8f)
+    {
+      float speed = sqrtf(speedSquared);
+      float inverse = 1.0f / speed;
+      vx *= inverse;
+      vy *= inverse;
+      vz *= inverse;
+
+      // direction x forward is a unit vector, since the two are perpendicular
+      right = _mm_setr_ps(vy*f.z - vz*f.y, vz*f.x - vx*f.z, vx*f.y - vy*f.x, 0.0f);
+      right = _mm_mul_ps(right, _mm_set1_ps(m_size));
+      up = _mm_mul_ps(_mm_setr_ps(vx, vy, vz, 0.0f), _mm_set1_ps(m_size + 0.5f*m_stretch*speed));
+    }
+
+    __m128 pos = _mm_setr_ps(particles.posX[i], particles.posY[i], particles.posZ[i], 0.0f);
+    writeSprite(out, pos, right, up, particles.color[i], k);
+  }
+}
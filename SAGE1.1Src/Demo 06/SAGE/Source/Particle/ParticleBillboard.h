@@ -0,0 +1,56 @@
+/// \file ParticleBillboard.h
+/// \brief Interface for the ParticleBillboard class.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBillboard.h - Writes particle sprites into a vertex buffer
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PARTICLEBILLBOARD_H_INCLUDED__
+#define __PARTICLEBILLBOARD_H_INCLUDED__
+
+#include "Common/vector3.h"
+#include "ParticleDefines.h"
+
+class Matrix4x3;
+class ParticleArrays;
+struct RenderVertexL;
+
+//-----------------------------------------------------------------------------
+/// \brief Writes the four corners of each particle's sprite into a vertex
+/// buffer.
+///
+/// Everything that is the same for every particle of an effect, the
+/// camera's right, up and forward vectors, the sprite size and the axis of
+/// axis aligned sprites, is worked out once when the billboard is
+/// constructed, leaving little per particle but adding up the corners.
+/// The vertices are written four floats at a time, in order, which suits
+/// the write combined memory a locked dynamic vertex buffer usually is.
+class ParticleBillboard
+{
+public:
+  /// \brief Works out the sprite axes for an effect
+  ParticleBillboard(EParticleBillboard mode, const Matrix4x3 &worldToCamera,
+    float size, const Vector3 &axis, float stretch);
+
+  /// \brief Writes the sprites of the first count particles
+  void write(const ParticleArrays &particles, int count, bool rotate, RenderVertexL *vert) const;
+
+private:
+  void writeFixed(const ParticleArrays &particles, int count, float *out) const; ///< Writes sprites that all have the same axes
+  void writeRotated(const ParticleArrays &particles, int count, float *out) const; ///< Writes camera facing sprites turned by each particle's rotation
+  void writeStretched(const ParticleArrays &particles, int count, float *out) const; ///< Writes sprites stretched along each particle's velocity
+
+  EParticleBillboard m_mode; ///< How the sprites are oriented
+  Vector3 m_right; ///< Half the sprite's width along its right axis
+  Vector3 m_up; ///< Half the sprite's height along its up axis
+  Vector3 m_cameraRight; ///< Camera's right vector, in world space
+  Vector3 m_cameraUp; ///< Camera's up vector, in world space
+  Vector3 m_cameraForward; ///< Camera's forward vector, in world space
+  float m_size; ///< Half the sprite's size
+  float m_stretch; ///< Seconds of travel a velocity stretched sprite covers
+};
+//-----------------------------------------------------------------------------
+
+#endif // #ifndef __PARTICLEBILLBOARD_H_INCLUDED__
@@ -31,8 +31,11 @@
 /// \brief Code for useful functions defined in ParticleDefines.h.
 
 #include "ParticleDefines.h"
-#include "common/renderer.h"
-#include <hash_map>
+#include "Common/Renderer.h"
+#include "Common/JobSystem.h"
+#include <assert.h>
+#include "Common/Portable.h"
+#include <string.h>
 
 typedef stdext::hash_map<std::string, DistributionFunc> Map; ///< Shorthand for the template map used below
 typedef Map::const_iterator MapIter; ///< Shorthand for an iterator for Map
@@ -40,6 +43,59 @@ typedef std::pair<std::string, DistributionFunc> MapPair; ///< Shorthand for tem
 
 const float kPi = 3.1415926538f; ///< Value of pi
 
+/// Most threads with a random number stream of their own, one for every
+/// thread the job system can start, so none ever has to share
+static const int kMaxRandomStreams = JobSystem::kMaxThreads;
+
+/// \brief State of one thread's random number stream, alone on its cache
+/// line so threads drawing numbers at once don't slow each other down.
+struct RandomStream
+{
+  unsigned int state; ///< Xorshift state, never zero
+  char pad[60]; ///< Fills out the cache line
+};
+
+static RandomStream randomStreams[kMaxRandomStreams]; ///< Stream for each of gJobSystem's threads
+
+/// \return The calling thread's stream.
+static RandomStream &getRandomStream()
+{
+  int thread = gJobSystem.getThreadIndex();
+  assert(thread < kMaxRandomStreams);
+  return randomStreams[thread];
+}
+
+/// Effects are stepped on several threads at once, so they can't share
+/// rand()'s state, and they couldn't be repeated if they did.  Each thread
+/// draws from its own xorshift stream instead, which the ParticleEngine
+/// reseeds before every effect it steps.
+/// \return A random value between 0 and 1
+float ParticleUtil::randf()
+{
+  RandomStream &stream = getRandomStream();
+  unsigned int x = stream.state;
+  if(x == 0)
+    x = 0x9e3779b9; // never seeded
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  stream.state = x;
+  return (float)(x >> 8) * (1.0f / 16777215.0f); // top 24 bits
+}
+
+/// The seed is scrambled first, so seeds that differ only a little, such as
+/// consecutive counts, still start streams that look unrelated.
+/// \param seed Any value, zero included
+void ParticleUtil::seedRandom(unsigned int seed)
+{
+  seed ^= seed >> 16;
+  seed *= 0x7feb352d;
+  seed ^= seed >> 15;
+  seed *= 0x846ca68b;
+  seed ^= seed >> 16;
+  getRandomStream().state = seed != 0 ? seed : 0x9e3779b9;
+}
+
 /// Maps a string value to a distribution function pointer
 /// \remark This function uses a hash map to map the string values to the
 /// function pointers, and the map is only initialized once.
@@ -152,3 +208,83 @@ Vector3 ParticleUtil::getRandVecSolidCube()
   return Vector3(x, y, z);
 }
 
+
+/// A least significant digit radix sort, 11 bits at a time, so it takes
+/// time in proportion to count rather than count*log(count), and it's
+/// stable.  A digit that's the same for every key can't change the order,
+/// so its pass is skipped; keys that are close together, such as depths
+/// within one effect, usually share their top digit.
+/// \param keys Key of each index
+/// \param order Set to the indices 0 to count - 1, in order of key
+/// \param scratch Room for count indices
+/// \param count Number of indices to sort
+void ParticleUtil::radixSort(const unsigned int *keys, int *order, int *scratch, int count)
+{
+  const int kDigitBits = 11; // three passes cover 32 bits
+  const int kPasses = 3;
+  const int kBuckets = 1 << kDigitBits;
+  const unsigned int kDigitMask = kBuckets - 1;
+
+  // count every digit's values in one go
+  int counts[kPasses][kBuckets];
+  memset(counts, 0, sizeof(counts));
+  for(int i = 0; i < count; i++)
+  {
+    unsigned int key = keys[i];
+    counts[0][key & kDigitMask]++;
+    counts[1][(key >> kDigitBits) & kDigitMask]++;
+    counts[2][(key >> (2 * kDigitBits)) & kDigitMask]++;
+  }
+
+  int *src = order;
+  int *dest = scratch;
+  for(int i = 0; i < count; i++)
+    src[i] = i;
+
+  for(int pass = 0; pass < kPasses && count > 1; pass++)
+  {
+    int shift = pass * kDigitBits;
+    int *bucket = counts[pass];
+
+    // skip it if every key has the same digit
+    if(bucket[(keys[0] >> shift) & kDigitMask] == count)
+      continue;
+
+    // turn counts into where each digit's run starts
+    int offset = 0;
+    for(int b = 0; b < kBuckets; b++)
+    {
+      int n = bucket[b];
+      bucket[b] = offset;
+      offset += n;
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+      int index = src[i];
+      dest[bucket[(keys[index] >> shift) & kDigitMask]++] = index;
+    }
+
+    int *tmp = src;
+    src = dest;
+    dest = tmp;
+  }
+
+  if(src != order)
+    memcpy(order, src, sizeof(int) * count);
+}
+
+/// The bits of a positive float sort the same way as the float, and
+/// flipping them puts the largest first.  Negative zero has the sign bit
+/// set, which would put it ahead of everything, so adding zero turns it
+/// into positive zero first.  The bits are copied out rather than read
+/// through a pointer cast, which the optimizer is free to get wrong.
+/// \param distanceSquared Squared distance from the camera, not negative
+/// \return The key
+unsigned int ParticleUtil::depthKey(float distanceSquared)
+{
+  float distance = distanceSquared + 0.0f;
+  unsigned int bits;
+  memcpy(&bits, &distance, sizeof(bits));
+  return ~bits;
+}
@@ -34,7 +34,7 @@
 #ifndef __JPARTDEFINES_H_INCLUDED__
 #define __JPARTDEFINES_H_INCLUDED__
 
-#include "common/Vector3.h"
+#include "Common/vector3.h"
 #include <string>
 
 /// \brief Describes a function to be used to get inital particle velocities
@@ -50,6 +50,21 @@ enum EmitDistributionType
   edtSolidCube    ///< Uniform distribution random vector within a cube
 };
 
+/// \brief How particles are blended with what's behind them
+enum EParticleBlend
+{
+  eParticleBlendAlpha,   ///< Blended by alpha, so they must be drawn back to front
+  eParticleBlendAdditive ///< Added on, so the order doesn't matter
+};
+
+/// \brief How particle sprites are turned
+enum EParticleBillboard
+{
+  eParticleBillboardCamera,  ///< Facing the camera, turned by the particle's rotation
+  eParticleBillboardAxis,    ///< Standing along a fixed axis, turned about it to face the camera
+  eParticleBillboardVelocity ///< Stretched along the particle's velocity on screen
+};
+
 //-----------------------------------------------------------------------------
 /// \brief Group of useful functions for the particle engine
 class ParticleUtil
@@ -57,9 +72,11 @@ class ParticleUtil
 public:
 
   //------------------------------------------------------------
-  /// \brief Returns a random value between 0 and 1
-  /// \return A random value between 0 and 1
-  static float randf() { return ((float)rand() / (float)RAND_MAX); }
+  /// \brief Returns a random value between 0 and 1 from the calling thread's stream
+  static float randf();
+
+  /// \brief Restarts the calling thread's random number stream
+  static void seedRandom(unsigned int seed);
 
   /// \brief Particle distribution functions
   //@{
@@ -81,6 +98,12 @@ public:
   /// \brief Returns a uniform distribution random vector within a cube
   static Vector3 getRandVecSolidCube();
   //@}
+
+  /// \brief Sorts indices by key, smallest first, keeping equal keys in order
+  static void radixSort(const unsigned int *keys, int *order, int *scratch, int count);
+
+  /// \brief Returns a radixSort() key that puts the farthest first
+  static unsigned int depthKey(float distanceSquared);
   //------------------------------------------------------------
 };
 //-----------------------------------------------------------------------------
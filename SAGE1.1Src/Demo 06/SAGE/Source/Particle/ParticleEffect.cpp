@@ -30,23 +30,21 @@
 /// \file ParticleEffect.cpp
 /// \brief Code for the ParticleEffect class.
 
+#include <algorithm>
+#include <string.h>
+#include <emmintrin.h>
+
 #include "ParticleEffect.h"
 #include "ParticleEngine.h"
 #include "ParticleDefines.h"
-#include "Particle.h"
-#include "common/Quaternion.h"
-#include "common/RotationMatrix.h"
-#include "directorymanager/directorymanager.h"
-#include "common/RotationMatrix.h"
-#include "common/Renderer.h"
-#include "common/commonstuff.h"
-
-extern LPDIRECT3DDEVICE9 pD3DDevice; ///< Global DirectX device
+#include "ParticleBillboard.h"
+#include "Common/Renderer.h"
+#include "Common/CommonStuff.h"
 
 //-----------------------------------------------------------------------------
 /// \brief Maps strings to property functions
 ///
-/// This class helps the ParticleEffect class by mapping strings (as keys) to
+/// This class helps the ParticleEffectDef class by mapping strings (as keys) to
 /// functions that set properties. This class is a singleton; only one
 /// instance of this class is ever created. Call getInstance to get a pointer
 /// to an instance of this class.
@@ -54,7 +52,7 @@ extern LPDIRECT3DDEVICE9 pD3DDevice; ///< Global DirectX device
 class ParticlePropertyMapper
 {
 private:
-  ParticleEffect::PropertyMap m_propertyMap; ///< Hash map of string/function pointers
+  ParticleEffectDef::PropertyMap m_propertyMap; ///< Hash map of string/function pointers
 
   /// \brief Basic constructor
   ///
@@ -62,19 +60,21 @@ private:
   ParticlePropertyMapper()
   {
     // add supported system properties
-    m_propertyMap.insert(ParticleEffect::PropPair("emit", &ParticleEffect::setEmit));
-    m_propertyMap.insert(ParticleEffect::PropPair("sort", &ParticleEffect::setSort));
-    m_propertyMap.insert(ParticleEffect::PropPair("gravity", &ParticleEffect::setGravity));
-    m_propertyMap.insert(ParticleEffect::PropPair("cycle", &ParticleEffect::setCycle));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("emit", &ParticleEffectDef::setEmit));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("sort", &ParticleEffectDef::setSort));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("blend", &ParticleEffectDef::setBlend));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("billboard", &ParticleEffectDef::setBillboard));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("gravity", &ParticleEffectDef::setGravity));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("cycle", &ParticleEffectDef::setCycle));
 
     // add supported initial particle property values
-    m_propertyMap.insert(ParticleEffect::PropPair("particlelife", &ParticleEffect::setParticleLife));
-    m_propertyMap.insert(ParticleEffect::PropPair("particlespeed", &ParticleEffect::setParticleSpeed));
-    m_propertyMap.insert(ParticleEffect::PropPair("particlecolor", &ParticleEffect::setParticleColor));
-    m_propertyMap.insert(ParticleEffect::PropPair("particlesize", &ParticleEffect::setParticleSize));
-    m_propertyMap.insert(ParticleEffect::PropPair("particledrag", &ParticleEffect::setParticleDrag));
-    m_propertyMap.insert(ParticleEffect::PropPair("particlefade", &ParticleEffect::setParticleFade));
-    m_propertyMap.insert(ParticleEffect::PropPair("particlerotation", &ParticleEffect::setParticleRotation));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particlelife", &ParticleEffectDef::setParticleLife));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particlespeed", &ParticleEffectDef::setParticleSpeed));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particlecolor", &ParticleEffectDef::setParticleColor));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particlesize", &ParticleEffectDef::setParticleSize));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particledrag", &ParticleEffectDef::setParticleDrag));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particlefade", &ParticleEffectDef::setParticleFade));
+    m_propertyMap.insert(ParticleEffectDef::PropPair("particlerotation", &ParticleEffectDef::setParticleRotation));
   }
 
 public:
@@ -90,9 +90,9 @@ public:
   /// \brief Get the function pointer that maps to a string value
   /// \param property String representation to map
   /// \return Function pointer mapped to property
-  ParticleEffect::PropertyFunc getFunction(std::string property)
+  ParticleEffectDef::PropertyFunc getFunction(std::string property)
   {
-    ParticleEffect::PropertyMap::const_iterator iter;
+    ParticleEffectDef::PropertyMap::const_iterator iter;
 
     iter = m_propertyMap.find(property);
 
@@ -106,19 +106,16 @@ public:
 
 
 /// \param effectDef XML tag containing the effect definition
-ParticleEffect::ParticleEffect(TiXmlElement *effectDef)
+/// \param texture Handle of the particles' texture, which the renderer owns
+ParticleEffectDef::ParticleEffectDef(TiXmlElement *effectDef, int texture)
 {
   // assign defaults
   m_nTotalParticleCount = 0;
   m_bCycleParticles = true;
-  m_bIsDead = false;
-  m_IsDying = false;
-  m_nLiveParticleCount = 0;
-  m_fEmitPartial = 1.0f; // start with at least one particle
   m_vecGravity = Vector3::kZeroVector;
-  m_vecPosition = Vector3::kZeroVector;
-  m_txtParticleTexture = NULL;
-  m_UpdateFunc.clear();
+  m_txtParticleTexture = texture;
+  m_bFade = false;
+  m_bRotate = false;
   m_InitFunc.clear();
 
   m_fPILife = 1.0f;
@@ -134,104 +131,26 @@ ParticleEffect::ParticleEffect(TiXmlElement *effectDef)
   // default emit rate is all at once (or at least all in the first .01 secs)
   m_nEmitRate = m_nTotalParticleCount * 100;
   m_sort = false;
-
-  m_vertBuffer = NULL;
-  m_indexBuffer = NULL;
+  m_blend = eParticleBlendAlpha;
+  m_billboard = eParticleBillboardCamera;
+  m_vecBillboardAxis = Vector3(0.0f, 1.0f, 0.0f);
+  m_fBillboardStretch = 0.0f;
 
   // get system data
   effectDef->Attribute("particleCount", &m_nTotalParticleCount);
-  const char *filename = effectDef->Attribute("textureName");
 
   // initialize effect properties from the xml tag
   initProperties(effectDef);
-
-  // allocate memory needed
-  m_Particles = new Particle[m_nTotalParticleCount];
-  m_drawOrder = new int[m_nTotalParticleCount];
-
-  initParticles();
-
-  // create vertex and index buffers, and initialize index buffer. We can
-  // create the index buffer as static since it doesn't change values; this
-  // will increase performance a little.
-  m_vertBuffer = new VertexLBuffer(m_nTotalParticleCount * 4, true);
-  m_indexBuffer = new IndexBuffer(m_nTotalParticleCount * 2);
-  initIndexBuffer();
-  
-  // this should be replaced with the renderer version of loading a texture
-  gDirectoryManager.setDirectory(eDirectoryTextures);
-  D3DXIMAGE_INFO structImageInfo; //image information
-  HRESULT hres=D3DXCreateTextureFromFileEx(pD3DDevice, filename,
-    0,0,1,0,D3DFMT_A8R8G8B8,D3DPOOL_MANAGED,D3DX_FILTER_NONE,
-    D3DX_DEFAULT,0,&structImageInfo,NULL, &m_txtParticleTexture);
 }
 
 
-ParticleEffect::~ParticleEffect()
+ParticleEffectDef::~ParticleEffectDef()
 {
-  if(m_Particles != NULL)
-  {
-    delete[] m_Particles;
-    m_Particles = NULL;
-  }
-
-  if(m_drawOrder != NULL)
-  {
-    delete[] m_drawOrder;
-    m_drawOrder = NULL;
-  }
-
-  if(m_vertBuffer != NULL)
-  {
-    delete m_vertBuffer;
-    m_vertBuffer = NULL;
-  }
-
-  if(m_indexBuffer != NULL)
-  {
-    delete m_indexBuffer;
-    m_indexBuffer = NULL;
-  }
-
-  m_txtParticleTexture->Release();
-  m_txtParticleTexture = NULL;
-}
-
-
-/// The indices in the index buffer will never change, so we set it once and
-/// we're done.
-void ParticleEffect::initIndexBuffer()
-{
-  m_indexBuffer->lock();
-
-  // make a pattern of
-  //    0---1
-  //    |  /|
-  //    | / |
-  //    |/  |
-  //    2---3
-  // for each particle
-
-  for(int i=0; i<m_nTotalParticleCount; i++)
-  {
-    int vertOffset = i * 4;
-    int triOffset = i * 2;
-
-    (*m_indexBuffer)[triOffset].index[0]   = vertOffset;
-    (*m_indexBuffer)[triOffset].index[1]   = vertOffset + 1;
-    (*m_indexBuffer)[triOffset].index[2]   = vertOffset + 2;
-
-    (*m_indexBuffer)[triOffset+1].index[0] = vertOffset + 2;
-    (*m_indexBuffer)[triOffset+1].index[1] = vertOffset + 1;
-    (*m_indexBuffer)[triOffset+1].index[2] = vertOffset + 3;
-  }
-
-  m_indexBuffer->unlock();
 }
 
 
 /// \param effectDef XML tag containing the effect definition
-void ParticleEffect::initProperties(TiXmlElement *effectDef)
+void ParticleEffectDef::initProperties(TiXmlElement *effectDef)
 {
   // get first property tag
   TiXmlElement *prop = effectDef->FirstChildElement();
@@ -246,281 +165,343 @@ void ParticleEffect::initProperties(TiXmlElement *effectDef)
     propFn = mapper->getFunction(property); // get the corresponding function
 
     if(propFn != NULL) // if function pointer is not null, it's a valid tag
-      bool result = (*this.*propFn)(prop); // ugly code needed to call member function
+      (*this.*propFn)(prop); // ugly code needed to call member function
 
     prop = prop->NextSiblingElement();
   }
 }
 
-void ParticleEffect::initParticles()
+
+/// Only the particles are allocated here, everything else comes from the
+/// definition.
+/// \param def The effect's definition, which must outlive the effect
+ParticleEffect::ParticleEffect(const ParticleEffectDef *def)
 {
-  // initialize draw order to straight through
-  for(int i=0; i<m_nTotalParticleCount; i++)
-  {
-    m_drawOrder[i] = i;
-    
-    m_Particles[i].birthed = false;
-    m_Particles[i].size = 1.0f;
+  m_def = def;
+  m_bIsDead = false;
+  m_IsDying = false;
+  m_nLiveParticleCount = 0;
+  m_nBirthedCount = 0;
+  m_nParticleLimit = def->m_nTotalParticleCount;
+  m_fEmitScale = 1.0f;
+  m_fEmitPartial = 1.0f; // start with at least one particle
+  m_vecPosition = Vector3::kZeroVector;
+  m_nCullPlane = -1;
+  m_fMaxSpeedSquared = 0.0f;
+
+  // allocate memory needed
+  m_particles.allocate(def->m_nTotalParticleCount);
+  m_drawOrder = new int[def->m_nTotalParticleCount];
+  m_sortScratch = new int[def->m_nTotalParticleCount];
+}
 
-    m_Particles[i].vTop = m_Particles[i].uLeft = 0.0f;
-    m_Particles[i].vBottom = m_Particles[i].uRight = 1.0f;
 
-    m_Particles[i].rotation = 0.0f;
+ParticleEffect::~ParticleEffect()
+{
+  if(m_drawOrder != NULL)
+  {
+    delete[] m_drawOrder;
+    m_drawOrder = NULL;
+  }
+
+  if(m_sortScratch != NULL)
+  {
+    delete[] m_sortScratch;
+    m_sortScratch = NULL;
   }
 }
 
 void ParticleEffect::start()
 {
-  initParticles();
   m_bIsDead = false;
   m_IsDying = false;
 
   m_nLiveParticleCount = 0;
+  m_nBirthedCount = 0;
   m_fEmitPartial = 1.0f;
 }
 
 
+/// A far away effect can get by with fewer particles.  The scale cuts both
+/// how many particles may be alive at once and how fast they are emitted,
+/// and for an effect that doesn't cycle, how many it emits in all.
+/// Particles already alive beyond the new limit live out their lives.
+/// \param scale Fraction of the definition's particles to use, from 0 to 1
+void ParticleEffect::setLod(float scale)
+{
+  m_nParticleLimit = (int)(m_def->m_nTotalParticleCount * scale + 0.5f);
+  if(m_nParticleLimit < 1)
+    m_nParticleLimit = 1;
+  if(m_nParticleLimit > m_def->m_nTotalParticleCount)
+    m_nParticleLimit = m_def->m_nTotalParticleCount;
+  m_fEmitScale = scale;
+}
+
+
 /// \param elapsedTime Amount of time that has elapsed (in seconds) since last update 
 void ParticleEffect::update(float elapsedTime)
 {
   m_fElapsedTime = elapsedTime; // store time in class composition in case
                                 // other update functions need it
 
-  killParticles();  // cull old particles
-  birthParticles(); // create new particles
+  m_boundingBox.empty();
+  m_fMaxSpeedSquared = 0.0f;
 
-  for(int i=0; i<m_nLiveParticleCount; i++)
-  {
-    Particle *part = &(m_Particles[m_drawOrder[i]]);
-
-    // Here we use v = v + gt - vdt where v is velocity, g is gravity and d is
-    // drag. This is a bad approximation but it works.
-    // We also use p = p + vt, again this is a bad approximation, but fast
-    part->velocity +=
-      (m_vecGravity - part->velocity * part->drag) * m_fElapsedTime;
-    part->position += part->velocity * m_fElapsedTime;
-  }
+  // age, move and cull the particles we already have
+  updateParticles(0, m_fElapsedTime);
 
-  // call additional update functions
-  for(UpdateFuncIter iter = m_UpdateFunc.begin(); iter != m_UpdateFunc.end(); iter++)
+  // if we're not cycling and there are none left
+  if(m_IsDying && m_nLiveParticleCount == 0)
+    m_bIsDead = true; // we're dead
+
+  // create new particles, and move them too, but they start this update
+  // with their whole life ahead of them
+  int firstBorn = m_nLiveParticleCount;
+  birthParticles();
+  updateParticles(firstBorn, 0.0f);
+
+  // grow the box by the farthest a corner of a sprite can be from its
+  // center, half the diagonal, so it holds the sprites at any rotation,
+  // plus the stretch of velocity stretched sprites at the speed of the
+  // fastest one, since gravity can speed them up past their starting speed
+  if(m_nLiveParticleCount > 0)
   {
-    (*this.*(*iter))(); // really ugly looking code to call all relevant update functions
+    float r = m_def->m_fPISize * 0.7072f;
+    if(m_def->m_billboard == eParticleBillboardVelocity)
+      r += 0.5f * m_def->m_fBillboardStretch * sqrt(m_fMaxSpeedSquared);
+    m_boundingBox.min -= Vector3(r, r, r);
+    m_boundingBox.max += Vector3(r, r, r);
   }
 }
 
 
-/// Performs update operations specific to the alpha value of each particle.
-/// Using this function, a live particle's alpha value will be zero at birth,
-/// increase linearly to a value of m_PIFadeMax over a time of m_PIFadeIn secs,
-/// remain at m_PIFadeMax until m_PIFadeOut secs, and then decrease linearly
-/// to a value of 0, reaching 0 when lifeleft reaches 0.
-void ParticleEffect::updateFade()
+/// Everything that happens to a particle in an update happens here, in one
+/// pass over four particles at a time, instead of one pass over all the
+/// particles for each thing.  A particle's life is shortened by age, and if
+/// that leaves it dead it is dropped.  Otherwise we use v = v + gt - vdt
+/// where v is velocity, g is gravity and d is drag, and p = p + vt.  Both
+/// are bad approximations, but fast.
+///
+/// If the effect fades, a particle's alpha value will be zero at birth,
+/// increase linearly to a value of m_PIFadeMax over a time of m_PIFadeIn
+/// secs, remain at m_PIFadeMax until m_PIFadeOut secs, and then decrease
+/// linearly to a value of 0, reaching 0 when lifeleft reaches 0.  If it
+/// rotates, the rotation speed slows linearly from its initial value to
+/// zero at the rotation stop time.
+///
+/// The survivors are packed down over the dead, in the same order, and
+/// added to the bounding box.  Which particles survive only decides where
+/// they're stored, there's no branch on it per particle.
+/// \param begin Index of the first particle to update.  Particles from
+/// there to the last live particle are updated.
+/// \param age Time in seconds to take off each particle's life
+void ParticleEffect::updateParticles(int begin, float age)
 {
-  Particle *part = NULL; // shorthand for the current particle
-  int maxAlpha = (int)(255.0f * m_PIFadeMax); // precalculate max alpha
-
-  for(int i=0; i<m_nLiveParticleCount; i++)
+  ParticleArrays &p = m_particles; // shorthand
+
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 laneIndex = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 vAge = _mm_set1_ps(age);
+  const __m128 dt = _mm_set1_ps(m_fElapsedTime);
+  const __m128 drag = _mm_set1_ps(m_def->m_fPIDragValue);
+  const __m128 gravityX = _mm_set1_ps(m_def->m_vecGravity.x);
+  const __m128 gravityY = _mm_set1_ps(m_def->m_vecGravity.y);
+  const __m128 gravityZ = _mm_set1_ps(m_def->m_vecGravity.z);
+
+  // the divisions are by constants, so they're done once here and the
+  // loop only multiplies
+  const __m128 alphaScale = _mm_set1_ps(255.0f);
+  const __m128 oneOverLife = _mm_set1_ps(1.0f / m_def->m_fPILife);
+  const __m128 fadeIn = _mm_set1_ps(m_def->m_PIFadeIn);
+  const __m128 fadeOut = _mm_set1_ps(m_def->m_PIFadeOut);
+  const __m128 fadeInSlope = _mm_set1_ps(255.0f * m_def->m_PIFadeMax / m_def->m_PIFadeIn);
+  const __m128 fadeOutSlope = _mm_set1_ps(255.0f * m_def->m_PIFadeMax / (1.0f - m_def->m_PIFadeOut));
+  const __m128 maxAlpha = _mm_set1_ps(255.0f * m_def->m_PIFadeMax); // precalculate max alpha
+  const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+
+  const bool rotate = m_def->m_bRotate;
+  const __m128 oneOverRotationStopTime = _mm_set1_ps(1.0f / m_def->m_PIRotationStopTime);
+  const bool stretched = m_def->m_billboard == eParticleBillboardVelocity;
+  __m128 maxSpeedSquared = zero;
+
+  const float huge = 1.0e30f;
+  __m128 boxMinX = _mm_set1_ps(huge), boxMinY = boxMinX, boxMinZ = boxMinX;
+  __m128 boxMaxX = _mm_set1_ps(-huge), boxMaxY = boxMaxX, boxMaxZ = boxMaxX;
+
+  int end = m_nLiveParticleCount;
+  int out = begin; // where the next survivor goes
+
+  for(int i = begin; i < end; i += 4)
   {
-    part = &m_Particles[m_drawOrder[i]];
-    int alpha = 0;
-    float percentLife = 0;
+    // age, and see who's still alive; lanes past the end count as dead
+    __m128 lifeleft = _mm_sub_ps(_mm_loadu_ps(p.lifeleft + i), vAge);
+    __m128 alive = _mm_and_ps(_mm_cmpge_ps(lifeleft, zero),
+      _mm_cmpgt_ps(_mm_set1_ps((float)(end - i)), laneIndex));
+
+    // v = v + (g - vd)t, p = p + vt
+    __m128 velX = _mm_loadu_ps(p.velX + i);
+    __m128 velY = _mm_loadu_ps(p.velY + i);
+    __m128 velZ = _mm_loadu_ps(p.velZ + i);
+    velX = _mm_add_ps(velX, _mm_mul_ps(_mm_sub_ps(gravityX, _mm_mul_ps(velX, drag)), dt));
+    velY = _mm_add_ps(velY, _mm_mul_ps(_mm_sub_ps(gravityY, _mm_mul_ps(velY, drag)), dt));
+    velZ = _mm_add_ps(velZ, _mm_mul_ps(_mm_sub_ps(gravityZ, _mm_mul_ps(velZ, drag)), dt));
+    __m128 posX = _mm_add_ps(_mm_loadu_ps(p.posX + i), _mm_mul_ps(velX, dt));
+    __m128 posY = _mm_add_ps(_mm_loadu_ps(p.posY + i), _mm_mul_ps(velY, dt));
+    __m128 posZ = _mm_add_ps(_mm_loadu_ps(p.posZ + i), _mm_mul_ps(velZ, dt));
+
+    __m128i color = _mm_loadu_si128((const __m128i *)(p.color + i));
+    if(m_def->m_bFade)
+    {
+      // calculate percent of life lived from life left, and the alpha for
+      // fading in, fading out and in between, then pick one
+      __m128 percentLife = _mm_sub_ps(one, _mm_mul_ps(lifeleft, oneOverLife));
+      __m128 alphaIn = _mm_mul_ps(percentLife, fadeInSlope);
+      __m128 alphaOut = _mm_mul_ps(_mm_sub_ps(one, percentLife), fadeOutSlope);
+      __m128 isIn = _mm_cmplt_ps(percentLife, fadeIn);
+      __m128 isOut = _mm_andnot_ps(isIn, _mm_cmpgt_ps(percentLife, fadeOut));
+      __m128 alpha = _mm_or_ps(_mm_and_ps(isIn, alphaIn),
+        _mm_or_ps(_mm_and_ps(isOut, alphaOut), _mm_andnot_ps(_mm_or_ps(isIn, isOut), maxAlpha)));
+      alpha = _mm_min_ps(_mm_max_ps(alpha, zero), alphaScale);
+
+      color = _mm_or_si128(_mm_and_si128(color, rgbMask),
+        _mm_slli_epi32(_mm_cvttps_epi32(alpha), 24));
+    }
 
-    // calculate percent of life lived from life left
-    percentLife = 1.0f - (part->lifeleft / m_fPILife);
+    // particles that don't rotate keep the zeros they were born with, so
+    // their rotation arrays are neither read nor written
+    __m128 rotation = zero, rotationSpeed = zero, rotationStop = zero;
+    if(rotate)
+    {
+      rotation = _mm_loadu_ps(p.rotation + i);
+      rotationSpeed = _mm_loadu_ps(p.rotationSpeed + i);
+      rotationStop = _mm_loadu_ps(p.rotationStopTime + i);
+      __m128 angularSpeed = _mm_mul_ps(rotationSpeed, _mm_mul_ps(rotationStop, oneOverRotationStopTime));
+      rotation = _mm_add_ps(rotation, _mm_mul_ps(angularSpeed, dt));
+      rotationStop = _mm_max_ps(_mm_sub_ps(rotationStop, dt), zero);
+    }
 
-    if(percentLife < m_PIFadeIn) // fade in to max alpha value
+    // only the living count toward the box, and the stretch of the sprites
+    if(stretched)
     {
-      alpha = (int)(255.0f * (percentLife / m_PIFadeIn) * m_PIFadeMax);
+      __m128 speedSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(velX, velX), _mm_mul_ps(velY, velY)),
+        _mm_mul_ps(velZ, velZ));
+      maxSpeedSquared = _mm_max_ps(maxSpeedSquared, _mm_and_ps(alive, speedSquared));
     }
-    else if(percentLife > m_PIFadeOut) // fade out to alpha value of zero
+    boxMinX = _mm_min_ps(boxMinX, _mm_or_ps(_mm_and_ps(alive, posX), _mm_andnot_ps(alive, _mm_set1_ps(huge))));
+    boxMinY = _mm_min_ps(boxMinY, _mm_or_ps(_mm_and_ps(alive, posY), _mm_andnot_ps(alive, _mm_set1_ps(huge))));
+    boxMinZ = _mm_min_ps(boxMinZ, _mm_or_ps(_mm_and_ps(alive, posZ), _mm_andnot_ps(alive, _mm_set1_ps(huge))));
+    boxMaxX = _mm_max_ps(boxMaxX, _mm_or_ps(_mm_and_ps(alive, posX), _mm_andnot_ps(alive, _mm_set1_ps(-huge))));
+    boxMaxY = _mm_max_ps(boxMaxY, _mm_or_ps(_mm_and_ps(alive, posY), _mm_andnot_ps(alive, _mm_set1_ps(-huge))));
+    boxMaxZ = _mm_max_ps(boxMaxZ, _mm_or_ps(_mm_and_ps(alive, posZ), _mm_andnot_ps(alive, _mm_set1_ps(-huge))));
+
+    // Store the survivors at out.  Everything up to i + 3 has been read,
+    // and out never passes i, so nothing is overwritten before it's read.
+    int aliveMask = _mm_movemask_ps(alive);
+    if(aliveMask == 0xF)
     {
-      alpha = (int)(255.0f * ((1.0f - percentLife)/(1.0f - m_PIFadeOut)) * m_PIFadeMax);
+      // all four live, store them as they are
+      _mm_storeu_ps(p.posX + out, posX);
+      _mm_storeu_ps(p.posY + out, posY);
+      _mm_storeu_ps(p.posZ + out, posZ);
+      _mm_storeu_ps(p.velX + out, velX);
+      _mm_storeu_ps(p.velY + out, velY);
+      _mm_storeu_ps(p.velZ + out, velZ);
+      _mm_storeu_ps(p.lifeleft + out, lifeleft);
+      if(rotate)
+      {
+        _mm_storeu_ps(p.rotation + out, rotation);
+        _mm_storeu_ps(p.rotationSpeed + out, rotationSpeed);
+        _mm_storeu_ps(p.rotationStopTime + out, rotationStop);
+      }
+      _mm_storeu_si128((__m128i *)(p.color + out), color);
+      out += 4;
     }
-    else // maintain max alpha value
+    else
     {
-      alpha = maxAlpha;
+      // every lane is written at out, and out only moves past the live ones
+      float lane[10][4];
+      unsigned int laneColor[4];
+      _mm_storeu_ps(lane[0], posX);
+      _mm_storeu_ps(lane[1], posY);
+      _mm_storeu_ps(lane[2], posZ);
+      _mm_storeu_ps(lane[3], velX);
+      _mm_storeu_ps(lane[4], velY);
+      _mm_storeu_ps(lane[5], velZ);
+      _mm_storeu_ps(lane[6], lifeleft);
+      _mm_storeu_ps(lane[7], rotation);
+      _mm_storeu_ps(lane[8], rotationSpeed);
+      _mm_storeu_ps(lane[9], rotationStop);
+      _mm_storeu_si128((__m128i *)laneColor, color);
+
+      for(int k = 0; k < 4; k++)
+      {
+        p.posX[out] = lane[0][k];
+        p.posY[out] = lane[1][k];
+        p.posZ[out] = lane[2][k];
+        p.velX[out] = lane[3][k];
+        p.velY[out] = lane[4][k];
+        p.velZ[out] = lane[5][k];
+        p.lifeleft[out] = lane[6][k];
+        if(rotate)
+        {
+          p.rotation[out] = lane[7][k];
+          p.rotationSpeed[out] = lane[8][k];
+          p.rotationStopTime[out] = lane[9][k];
+        }
+        p.color[out] = laneColor[k];
+        out += (aliveMask >> k) & 1;
+      }
     }
-
-    if(alpha < 0)
-      alpha = 0;
-    else if(alpha > 255)
-      alpha = 255;
-
-    part->color = ((part->color & 0x00FFFFFF) | (alpha << 24));
-
-    part++;
   }
-}
 
+  m_nLiveParticleCount = out;
 
-/// Updates the particles' rotation values based on time elapsed. Current
-/// rotation speed is calculated, then the angle is updated based on time
-/// elapsed and new rotation speed.
-void ParticleEffect::updateRotation()
-{
-  for(int i=0; i<m_nLiveParticleCount; i++)
+  if(out > begin)
   {
-    Particle *part = &m_Particles[m_drawOrder[i]]; // shorthand
-
-    float angularSpeed =
-      part->rotationSpeed * (part->rotationStopTime / m_PIRotationStopTime);
-
-    part->rotation += angularSpeed * m_fElapsedTime;
-
-    part->rotationStopTime -= m_fElapsedTime;
+    float minX[4], minY[4], minZ[4], maxX[4], maxY[4], maxZ[4];
+    _mm_storeu_ps(minX, boxMinX);
+    _mm_storeu_ps(minY, boxMinY);
+    _mm_storeu_ps(minZ, boxMinZ);
+    _mm_storeu_ps(maxX, boxMaxX);
+    _mm_storeu_ps(maxY, boxMaxY);
+    _mm_storeu_ps(maxZ, boxMaxZ);
+    // lanes that never held a survivor are at +/-huge, so they drop out
+    Vector3 boxMin(minX[0], minY[0], minZ[0]), boxMax(maxX[0], maxY[0], maxZ[0]);
+    for(int k = 1; k < 4; k++)
+    {
+      boxMin.x = std::min<float>(boxMin.x, minX[k]);
+      boxMin.y = std::min<float>(boxMin.y, minY[k]);
+      boxMin.z = std::min<float>(boxMin.z, minZ[k]);
+      boxMax.x = std::max<float>(boxMax.x, maxX[k]);
+      boxMax.y = std::max<float>(boxMax.y, maxY[k]);
+      boxMax.z = std::max<float>(boxMax.z, maxZ[k]);
+    }
+    m_boundingBox.add(boxMin);
+    m_boundingBox.add(boxMax);
 
-    if(part->rotationStopTime < 0.0f)
-      part->rotationStopTime = 0.0f;
+    float speedSquared[4];
+    _mm_storeu_ps(speedSquared, maxSpeedSquared);
+    for(int k = 0; k < 4; k++)
+      m_fMaxSpeedSquared = std::max<float>(m_fMaxSpeedSquared, speedSquared[k]);
   }
 }
 
 
-/// Rendering the particles involves looping through every live particle
-/// and writing it's relevant data to a vertex buffer, and then rendering
-/// that vertex buffer.
-void ParticleEffect::render()
+/// The particles should already be sorted, if they're to be.
+/// \param vert Where the first sprite's four vertices go
+/// \param count Number of particles to write sprites for, no more than
+/// are alive
+void ParticleEffect::writeSprites(RenderVertexL *vert, int count)
 {
-  if(m_nLiveParticleCount == 0) // make sure we have something to render
-    return;
-
-  if(m_sort)
-    sort();
-
-  // save render states before starting
-  DWORD lighting;
-  DWORD alphablend;
-  DWORD zwrite;
-  DWORD zenable;
-  DWORD srcblend;
-  DWORD destblend;
-
-  pD3DDevice->GetRenderState(D3DRS_LIGHTING, &lighting);
-  pD3DDevice->GetRenderState(D3DRS_ALPHABLENDENABLE, &alphablend);
-  pD3DDevice->GetRenderState(D3DRS_ZWRITEENABLE, &zwrite);
-  pD3DDevice->GetRenderState(D3DRS_ZENABLE, &zenable);
-  pD3DDevice->GetRenderState(D3DRS_SRCBLEND, &srcblend);
-  pD3DDevice->GetRenderState(D3DRS_DESTBLEND, &destblend);
-
-  // set up particle engine states
-  pD3DDevice->SetRenderState(D3DRS_LIGHTING, FALSE);
-  pD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-  if(m_sort)
-    pD3DDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-  else
-    pD3DDevice->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-  pD3DDevice->SetRenderState(D3DRS_ZENABLE, TRUE);
-  pD3DDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-  pD3DDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-  //pD3DDevice->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
-  //pD3DDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_ZERO);
-  
-  // set texture operations for alpha blending by setting the color
-  // to texture color times diffuse color, and alpha taken entirely from
-  // texture value
-  pD3DDevice->SetTextureStageState(0,D3DTSS_COLOROP,D3DTOP_MODULATE);
-  pD3DDevice->SetTextureStageState(0,D3DTSS_COLORARG1,D3DTA_TEXTURE);
-  pD3DDevice->SetTextureStageState(0,D3DTSS_COLORARG2,D3DTA_DIFFUSE);
-  pD3DDevice->SetTextureStageState(0,D3DTSS_ALPHAOP,D3DTOP_MODULATE);  
-  pD3DDevice->SetTextureStageState(0,D3DTSS_ALPHAARG1,D3DTA_TEXTURE);    
-  pD3DDevice->SetTextureStageState(0,D3DTSS_ALPHAARG2,D3DTA_DIFFUSE);
-  
-  // get camera right and up vectors to figure out how to orient the sprites
-  D3DXMATRIXA16 view;
-  pD3DDevice->GetTransform(D3DTS_VIEW, &view);
-
-  Vector3 vecRight = Vector3(view._11, view._21, view._31);
-  Vector3 vecUp = Vector3(view._12, view._22, view._32);
-  Vector3 vecForward = Vector3(view._13, view._23, view._33);
-
-  // precalculate corners
-  Vector3 ul, ur, bl, br;
-  //ul = -vecRight + vecUp; // upper left
-  //ur = vecRight + vecUp;  // upper right
-  //bl = -vecRight - vecUp; // bottom left
-  //br = vecRight - vecUp;  // bottom right
-
-  pD3DDevice->SetTexture(0, m_txtParticleTexture);
-
-  if(!m_vertBuffer->lock())
-  {
-    return;
-  }
-
-  // shorthand to the current vertex
-  RenderVertexL *vert = &((*m_vertBuffer)[0]);
-
-  // although these values are the same for all particles (except color.alpha),
-  // you could implement some randomness, at which point there would be a
-  // reason to assign to them with every iteration of the loop
-  unsigned int color;
-  float size = m_fPISize/2.0f; // half of m_fPISize in each direction
-  float tTop = 0;
-  float tBottom = 1.0f;
-  float tLeft = 0;
-  float tRight = 1.0f;
-
-  // loop through all live particles to assign proper values to the vertices
-  for (int i=0; i<m_nLiveParticleCount; i++)
-  {
-    Vector3 pos = m_Particles[m_drawOrder[i]].position;
-    color = m_Particles[m_drawOrder[i]].color;
-
-    Vector3 myUp, myRight;
-    Quaternion q;
-    q.setToRotateAboutAxis(vecForward, m_Particles[m_drawOrder[i]].rotation);
-
-    RotationMatrix r;
-    r.fromObjectToInertialQuaternion(q);
-
-    myUp = r.objectToInertial(vecUp);
-    myRight = r.objectToInertial(vecRight);
-
-    ul = -myRight + myUp; // upper left
-    ur = myRight + myUp;  // upper right
-    bl = -myRight - myUp; // bottom left
-    br = myRight - myUp;  // bottom right
-
-    vert->p = pos + ul*size;
-    vert->argb = color;
-    vert->u = tLeft;
-    vert->v = tTop;
-    vert++;
-
-    vert->p = pos + ur*size;
-    vert->argb = color;
-    vert->u = tRight;
-    vert->v = tTop;
-    vert++;
-
-    vert->p = pos + bl*size;
-    vert->argb = color;
-    vert->u = tLeft;
-    vert->v = tBottom;
-    vert++;
-
-    vert->p = pos + br*size;
-    vert->argb = color;
-    vert->u = tRight;
-    vert->v = tBottom;
-    vert++;
-  }
-
-  m_vertBuffer->unlock();
-
-  gRenderer.render(
-    m_vertBuffer,
-    m_nLiveParticleCount * 4,
-    m_indexBuffer,
-    m_nLiveParticleCount * 2);
-
-  // restore render states
-  pD3DDevice->SetRenderState(D3DRS_LIGHTING, lighting);
-  pD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, alphablend);
-  pD3DDevice->SetRenderState(D3DRS_ZWRITEENABLE, zwrite);
-  pD3DDevice->SetRenderState(D3DRS_ZENABLE, zenable);
-  pD3DDevice->SetRenderState(D3DRS_SRCBLEND, srcblend);
-  pD3DDevice->SetRenderState(D3DRS_DESTBLEND, destblend);
-
+  // work out how to orient the sprites from the camera's axes, once for
+  // all the particles (the renderer's copy of the view matrix, rather than
+  // reading it back from the device)
+  ParticleBillboard billboard(m_def->m_billboard, gRenderer.getWorldToCameraMatrix(),
+    m_def->m_fPISize/2.0f, m_def->m_vecBillboardAxis, m_def->m_fBillboardStretch);
+
+  // write the sprites' corners straight into the buffer
+  billboard.write(m_particles, count, m_def->m_bRotate, vert);
 }
 
 
@@ -535,7 +516,7 @@ void ParticleEffect::birthParticles()
 
   // To track partials, we use explicit conversions to get at the partial data.
   // Add to what we have already from last time
-  m_fEmitPartial += (float)m_nEmitRate * m_fElapsedTime;
+  m_fEmitPartial += (float)m_def->m_nEmitRate * m_fEmitScale * m_fElapsedTime;
 
   // Set emit to be the number of complete particles to create
   int emit = (int)(m_fEmitPartial);
@@ -544,9 +525,9 @@ void ParticleEffect::birthParticles()
   if(emit > 0)
     m_fEmitPartial -= (float)emit;
 
-  for(int i=0; i < emit && m_nLiveParticleCount < m_nTotalParticleCount; i++)
+  for(int i=0; i < emit && m_nLiveParticleCount < m_nParticleLimit; i++)
   {
-    int index = m_drawOrder[m_nLiveParticleCount];
+    int index = m_nLiveParticleCount; // live particles are packed at the front
     if(initParticle(index))
       m_nLiveParticleCount++; // success, so add one to our number of live ones
     else
@@ -563,153 +544,95 @@ bool ParticleEffect::initParticle(int i)
   // check bounds on i and current number of particles
   if(
     i < 0 || // no negative i
-    i >= m_nTotalParticleCount || // no i greater than total number of particles
-    m_nLiveParticleCount >= m_nTotalParticleCount) // current number can't exceed max
+    i >= m_def->m_nTotalParticleCount || // no i greater than total number of particles
+    m_nLiveParticleCount >= m_def->m_nTotalParticleCount) // current number can't exceed max
   {
     return false;
   }
 
-  Particle *p = &(m_Particles[i]);
-
-  if(!m_bCycleParticles && p->birthed) // if we're not recycling particles
+  // if we're not recycling particles, each one is only created once
+  if(!m_def->m_bCycleParticles && m_nBirthedCount >= m_nParticleLimit)
   {
     m_IsDying = true;
     return false; // don't reinitialize
   }
-
-  // one time initializations, don't assign these values after the
-  // particle is "birthed".
-  if(!p->birthed)
-  {
-    p->size = m_fPISize;
-    p->drag = m_fPIDragValue;
-    p->color = m_cPIColor;
-    p->birthed = true;
-  }
-
-  p->velocity = (*m_distFunc)() * m_fPISpeed;
-  p->position = m_vecPosition;
-  p->lifeleft = m_fPILife;
+  m_nBirthedCount++;
+
+  // size and drag are the same for every particle, so they aren't stored
+  // per particle
+  ParticleArrays &p = m_particles; // shorthand
+  Vector3 velocity = (*m_def->m_distFunc)() * m_def->m_fPISpeed;
+  p.velX[i] = velocity.x;
+  p.velY[i] = velocity.y;
+  p.velZ[i] = velocity.z;
+  p.posX[i] = m_vecPosition.x;
+  p.posY[i] = m_vecPosition.y;
+  p.posZ[i] = m_vecPosition.z;
+  p.lifeleft[i] = m_def->m_fPILife;
+  p.color[i] = m_def->m_cPIColor;
+  p.rotation[i] = 0.0f;
+  p.rotationSpeed[i] = 0.0f;
+  p.rotationStopTime[i] = 0.0f;
 
   // call all other relevant init functions
-  for(InitFuncIter iter = m_InitFunc.begin(); iter != m_InitFunc.end(); iter++)
+  for(InitFuncIter iter = m_def->m_InitFunc.begin(); iter != m_def->m_InitFunc.end(); iter++)
   {
-    (*this.*(*iter))(p);
+    (*this.*(*iter))(i);
   }
 
   return true;
 }
 
-/// \param p Pointer to particle to initialize
-void ParticleEffect::initParticleRotation(Particle *p)
-{
-  p->rotationSpeed = (ParticleUtil::randf() - 0.5f) * m_PIRotationSpeed * 2.0f;
-  p->rotationStopTime = m_PIRotationStopTime;
-}
-
-
-/// Updates particles ages and removes any particles that have expired
-void ParticleEffect::killParticles()
-{
-  // By starting from the back, we do less work. See ParticleEffect::killParticle
-  // for details.
-  for(int i=m_nLiveParticleCount-1; i>=0; i--)
-  {
-    m_Particles[m_drawOrder[i]].lifeleft -= m_fElapsedTime;
-
-    if(m_Particles[m_drawOrder[i]].lifeleft < 0.0f)
-    {
-      killParticle(i);
-    }
-  }
-
-  // if we're not cycling and there are none left
-  if(m_IsDying && m_nLiveParticleCount == 0)
-    m_bIsDead = true; // we're dead
-}
-
-
-/// Kills a particle by shifting all the particles from index to the last
-/// particle drawn forward one, then putting the killed particle index at the
-/// end of the list
-/// \param index Draw order index of the particle to kill
-/// \return True if the particle was killed, false otherwise
-bool ParticleEffect::killParticle(int index)
+/// \param i Index of the particle to initialize
+void ParticleEffect::initParticleRotation(int i)
 {
-  if(0 <= index && index < m_nTotalParticleCount)
-  {
-    --m_nLiveParticleCount;
-
-    // if index is the last particle being drawn, we're done
-    if(index == m_nLiveParticleCount)
-      return true;
-
-    int tmp = m_drawOrder[index]; 
-
-    for(int i=index; i<m_nLiveParticleCount; i++)
-    {
-      m_drawOrder[i] = m_drawOrder[i+1];
-    }
-
-    m_drawOrder[m_nLiveParticleCount] = tmp;
-
-    return true;
-  }
-  else
-    return false;
+  m_particles.rotationSpeed[i] = (ParticleUtil::randf() - 0.5f) * m_def->m_PIRotationSpeed * 2.0f;
+  m_particles.rotationStopTime[i] = m_def->m_PIRotationStopTime;
 }
 
 
+/// Particles are drawn back to front, so the ones in front blend over the
+/// ones behind.  Each particle gets a key from its squared distance to the
+/// camera that puts the farthest first.  Most frames the particles
+/// are still in order from last frame, which one pass over the keys shows,
+/// and otherwise they're put in order with a radix sort, in time linear in
+/// the number of particles.  Ties keep their order, so the result is the
+/// same as a stable sort on distance.  The particles themselves are then
+/// put in the sorted order, so they start out nearly sorted next frame.
+/// Additive particles look the same in any order and aren't sorted.
 void ParticleEffect::sort()
 {
-  if(!m_sort)
+  if(!m_def->m_sort || m_def->m_blend == eParticleBlendAdditive)
     return;
 
   // get distance to the camera for each particle
   Vector3 camPos = gRenderer.getCameraPos();
-  for(int i=0; i<m_nTotalParticleCount; i++)
+  unsigned int *keys = m_particles.depthKey; // shorthand
+  for(int i=0; i<m_nLiveParticleCount; i++)
   {
     // magnitude squared saves some time since square root is expensive
-    m_Particles[i].distance =
-      (m_Particles[i].position - camPos).magnitudeSquared();
+    float dx = m_particles.posX[i] - camPos.x;
+    float dy = m_particles.posY[i] - camPos.y;
+    float dz = m_particles.posZ[i] - camPos.z;
+    float distance = dx*dx + dy*dy + dz*dz;
+    keys[i] = ParticleUtil::depthKey(distance);
   }
 
-  /****************************************************************************
-  *                                                                           *
-  *  Simple bubble sort here. You could implement a faster sort here but it   *
-  *  may not be worth it. Bubble sort is n*p operations, where p is the       *
-  *  number of elements out of place. Since very few particles will become    *
-  *  out of order from frame to frame, p remains very small. As long as p is  *
-  *  comparable to log(n), bubble sort will perform similarly to a            *
-  *  O(n log(n)) algorithm (eg quicksort or mergesort), but without the       *
-  *  added cpu overhead                                                       *
-  *                                                                           *
-  ****************************************************************************/
-
-  bool swapped;
-  do
-  {
-    swapped = false;
-
-    for(int i=0; i<m_nLiveParticleCount-1; i++)
-    {
-      int next = i+1;
-
-      if(m_Particles[m_drawOrder[i]].distance < m_Particles[m_drawOrder[next]].distance)
-      {
-        swap<int>(m_drawOrder[i], m_drawOrder[next]);
+  // still in order from last frame?
+  int i = 0;
+  while(i < m_nLiveParticleCount - 1 && keys[i] <= keys[i+1])
+    i++;
+  if(i >= m_nLiveParticleCount - 1)
+    return;
 
-        swapped = true;
-      }
-    }
-  }
-  while(swapped);
+  ParticleUtil::radixSort(keys, m_drawOrder, m_sortScratch, m_nLiveParticleCount);
+  m_particles.gather(m_drawOrder, m_nLiveParticleCount);
 }
 
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setEmit(TiXmlElement *prop)
+bool ParticleEffectDef::setEmit(TiXmlElement *prop)
 {
   if(prop->Attribute("rate") != NULL)
     prop->Attribute("rate", &m_nEmitRate);
@@ -722,15 +645,62 @@ bool ParticleEffect::setEmit(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setSort(TiXmlElement *prop)
+bool ParticleEffectDef::setSort(TiXmlElement *prop)
 {
   m_sort = (atoi(prop->Attribute("value")) != 0);
   return true;
 }
 
+/// \param prop XML tag containing the property values, "alpha" (the
+/// default) or "additive"
+/// \return True if the property was set successfully, false otherwise
+bool ParticleEffectDef::setBlend(TiXmlElement *prop)
+{
+  const char *value = prop->Attribute("value");
+  if(value == NULL)
+    return false;
+
+  if(strcmp(value, "additive") == 0)
+    m_blend = eParticleBlendAdditive;
+  else
+    m_blend = eParticleBlendAlpha;
+  return true;
+}
+
+/// \param prop XML tag containing the property values: value "camera" (the
+/// default), "axis" or "velocity"; for axis aligned sprites, the axis; and
+/// for velocity stretched sprites, stretch, the seconds of travel a sprite
+/// covers
+/// \return True if the property was set successfully, false otherwise
+bool ParticleEffectDef::setBillboard(TiXmlElement *prop)
+{
+  const char *value = prop->Attribute("value");
+  if(value == NULL)
+    return false;
+
+  if(strcmp(value, "axis") == 0)
+    m_billboard = eParticleBillboardAxis;
+  else if(strcmp(value, "velocity") == 0)
+    m_billboard = eParticleBillboardVelocity;
+  else
+    m_billboard = eParticleBillboardCamera;
+
+  if(prop->Attribute("axis") != NULL)
+    m_vecBillboardAxis = atovec3(prop->Attribute("axis"));
+
+  if(prop->Attribute("stretch") != NULL)
+  {
+    double tmp;
+    prop->Attribute("stretch", &tmp);
+    m_fBillboardStretch = (float)tmp;
+  }
+
+  return true;
+}
+
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setGravity(TiXmlElement *prop)
+bool ParticleEffectDef::setGravity(TiXmlElement *prop)
 {
   m_vecGravity = atovec3(prop->Attribute("value"));
   return true;
@@ -738,7 +708,7 @@ bool ParticleEffect::setGravity(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setCycle(TiXmlElement *prop)
+bool ParticleEffectDef::setCycle(TiXmlElement *prop)
 {
   m_bCycleParticles = (atoi(prop->Attribute("value")) != 0);
   return true;
@@ -746,7 +716,7 @@ bool ParticleEffect::setCycle(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleLife(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleLife(TiXmlElement *prop)
 {
   m_fPILife = (float)atof(prop->Attribute("value"));
   return true;
@@ -754,7 +724,7 @@ bool ParticleEffect::setParticleLife(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleSpeed(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleSpeed(TiXmlElement *prop)
 {
   m_fPISpeed = (float)atof(prop->Attribute("value"));
   return true;
@@ -762,7 +732,7 @@ bool ParticleEffect::setParticleSpeed(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleColor(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleColor(TiXmlElement *prop)
 {
   m_cPIColor = atocolor(prop->Attribute("value"));
   return true;
@@ -770,7 +740,7 @@ bool ParticleEffect::setParticleColor(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleSize(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleSize(TiXmlElement *prop)
 {
   m_fPISize = (float)atof(prop->Attribute("value"));
   return true;
@@ -778,7 +748,7 @@ bool ParticleEffect::setParticleSize(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleDrag(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleDrag(TiXmlElement *prop)
 {
   m_fPIDragValue = (float)atof(prop->Attribute("value"));
   return true;
@@ -786,7 +756,7 @@ bool ParticleEffect::setParticleDrag(TiXmlElement *prop)
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleFade(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleFade(TiXmlElement *prop)
 {
   if(prop->Attribute("fadein") != NULL)
   {
@@ -809,14 +779,14 @@ bool ParticleEffect::setParticleFade(TiXmlElement *prop)
     m_PIFadeMax = (float)tmp;
   }
 
-  m_UpdateFunc.push_back(&ParticleEffect::updateFade);
+  m_bFade = true;
 
   return true;
 }
 
 /// \param prop XML tag containing the property values
 /// \return True if the property was set successfully, false otherwise
-bool ParticleEffect::setParticleRotation(TiXmlElement *prop)
+bool ParticleEffectDef::setParticleRotation(TiXmlElement *prop)
 {
   if(prop->Attribute("initial") != NULL)
   {
@@ -832,7 +802,7 @@ bool ParticleEffect::setParticleRotation(TiXmlElement *prop)
     m_PIRotationStopTime = (float)tmp;
   }
 
-  m_UpdateFunc.push_back(&ParticleEffect::updateRotation);
+  m_bRotate = true;
   m_InitFunc.push_back(&ParticleEffect::initParticleRotation);
 
   return true;
@@ -36,45 +36,44 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
-#include <hash_map>
-#include <d3dx9.h>
-#include "tinyxml/tinyxml.h"
-#include "common/Vector3.h"
+#include "Common/Portable.h"
+#include "TinyXML/tinyxml.h"
+#include "Common/vector3.h"
+#include "Common/AABB3.h"
 
-#include "graphics/VertexBuffer.h"
-#include "graphics/IndexBuffer.h"
-#include "graphics/VertexTypes.h"
+#include "Particle.h"
+#include "ParticleDefines.h"
 
-class Particle;
 class ParticleEngine;
+class ParticleEffectDef;
+struct RenderVertexL;
 
 //-----------------------------------------------------------------------------
-/// \brief Describes a particle effect
+/// \brief A running copy of a particle effect
+///
+/// Everything that is the same for every copy of an effect, the properties
+/// read from the xml file and the texture, is kept in a ParticleEffectDef
+/// that all the copies share.  An effect itself holds only what changes as
+/// it runs: its particles and a few counts.  It doesn't draw itself, the
+/// ParticleBatcher writes its sprites into a buffer shared with the other
+/// effects.
 /// \remark All the members and methods of this class are private, with the
-/// ParticleSystem and ParticlePropertyMapper being the only friend classes
-/// declared. 
+/// ParticleSystem, ParticleEffectDef and ParticleBatcher being the only
+/// friend classes declared. 
 class ParticleEffect
 {
 private:
 
   friend class ParticleSystem;
-  friend class ParticlePropertyMapper;
-
-  typedef VertexBuffer<RenderVertexL> VertexLBuffer; ///< Shorthand for a lit vertex buffer
-  typedef Vector3 (*DistributionFunc)(); ///< Shorthand for a function that returns a vector
-  typedef void (ParticleEffect::*UpdateFunc)(); ///< Shorthand for a function that updates the particles
-  typedef void (ParticleEffect::*InitFunc)(Particle*); ///< Shorthand for a function that initializes the particles
-  typedef std::vector<UpdateFunc> UpdateFuncArray;
-  typedef UpdateFuncArray::const_iterator UpdateFuncIter;
+  friend class ParticleEffectDef;
+  friend class ParticleBatcher;
+  typedef void (ParticleEffect::*InitFunc)(int); ///< Shorthand for a function that initializes a particle
   typedef std::vector<InitFunc> InitFuncArray;
   typedef InitFuncArray::const_iterator InitFuncIter;
-  typedef bool (ParticleEffect::*PropertyFunc)(TiXmlElement*); ///< Shorthand for a ParticleEffect property function
-  typedef std::pair <std::string, PropertyFunc> PropPair; ///< Shorthand for the hash map elements
-  typedef stdext::hash_map<std::string, PropertyFunc> PropertyMap; ///< Shorthand for the hash map used by the property map class
 
-  ParticleEffect(TiXmlElement *subSysDef); ///< Basic constructor
+  ParticleEffect(const ParticleEffectDef *def); ///< Basic constructor
   ~ParticleEffect();                       ///< Basic destructor
-  void render(); ///< Renders the particles
+  void writeSprites(RenderVertexL *vert, int count); ///< Writes the sprites of the first count particles
 
   //------------------------------------------------------------
   /// \brief Accessors
@@ -90,33 +89,99 @@ private:
   /// \brief Gets the number of live particles in the effect currently
   /// \return Returns the number of live particles in the effect
   int getParticleCount() { return m_nLiveParticleCount; }
+
+  /// \brief Gets the most particles the effect may have at its level of detail
+  /// \return The most particles the effect may have alive at once
+  int getParticleLimit() { return m_nParticleLimit; }
+
+  void setLod(float scale); ///< Scales the effect's particle count and emission rate
   //}@
   //------------------------------------------------------------
   
   //------------------------------------------------------------
-  /// \brief Effect properties
+  /// \brief Effect state
   //{@
-  Particle *m_Particles; ///< Pointer to particle array
-  int *m_drawOrder; ///< Array of indices determining the order to draw in
-  int m_nTotalParticleCount; ///< Max number of particles in the system
+  const ParticleEffectDef *m_def; ///< Properties shared with every copy of the effect
+  ParticleArrays m_particles; ///< The particles, live ones first
+  int *m_drawOrder; ///< Scratch array of indices used for sorting
+  int *m_sortScratch; ///< Second scratch array of indices used for sorting
   int m_nLiveParticleCount; ///< Number of particles that are currently live
-  int m_nEmitRate; ///< Max number of particles to create per second
+  int m_nBirthedCount; ///< Number of particles created since the effect started
+  int m_nParticleLimit; ///< Most particles alive at once at the current level of detail
+  float m_fEmitScale; ///< Fraction of the definition's emission rate used at the current level of detail
   float m_fElapsedTime; ///< Time in seconds since last update called
   float m_fEmitPartial; ///< Partial particle, stores the value until greater than 1
-  bool m_sort; ///< Whether the system should sort the particles back to front
-  bool m_bCycleParticles; ///< True if particles are to be reused after they die
   Vector3 m_vecPosition; ///< System position
-  Vector3 m_vecGravity; ///< System gravity
-  VertexLBuffer *m_vertBuffer; ///< Vertex buffer used to render particles
-  IndexBuffer *m_indexBuffer; ///< Index buffer used to render particles
   bool m_bIsDead; ///< True when all the particles are dead and we aren't cycling
+  AABB3 m_boundingBox; ///< Box around the live particles as of the last update
+  float m_fMaxSpeedSquared; ///< Squared speed of the fastest live particle as of the last update, kept for velocity stretched sprites only
+  int m_nCullPlane; ///< Frustum plane that last culled the effect, -1 if none
   bool m_IsDying; ///< True when all particles have been created
-  int m_textureHandle; ///< Handle to particle texture
-  UpdateFuncArray m_UpdateFunc;
-  InitFuncArray m_InitFunc;
+  //}@
+  //------------------------------------------------------------
+
+  //------------------------------------------------------------
+  /// \brief Maintenance functions
+  //{@
+  void start(); ///< Prepares the effect for starting
 
-  /// \todo Remove DirectX texture interface from ParticleEffect, use renderer
-  LPDIRECT3DTEXTURE9 m_txtParticleTexture; ///< DirectX texture interface
+  void birthParticles(); ///< Creates all particles ready to be "born"
+  bool initParticle(int index); ///< Initializes the particle at the given index
+  void initParticleRotation(int index); ///< Initializes the rotation of the particle at the given index
+
+  void update(float elapsedTime); ///< Updates the particles' values
+  void updateParticles(int begin, float age); ///< Ages, moves, fades and rotates particles, and removes dead ones
+
+  void sort(); ///< Sorts the particles from back to front
+  //}@
+  //------------------------------------------------------------
+};
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+/// \brief The shared, unchanging part of a particle effect
+///
+/// A definition is read from an effect tag of the xml file once, when the
+/// ParticleEngine starts, and is then shared by every ParticleEffect made
+/// from it.  Nothing in it changes after that, so effects running on
+/// different threads can all read it at once.
+/// \remark All the members and methods of this class are private, with the
+/// ParticleEngine, ParticleEffect, ParticlePropertyMapper and ParticleBatcher
+/// being the only friend classes declared.
+class ParticleEffectDef
+{
+private:
+
+  friend class ParticleEngine;
+  friend class ParticleEffect;
+  friend class ParticlePropertyMapper;
+  friend class ParticleBatcher;
+
+  typedef Vector3 (*DistributionFunc)(); ///< Shorthand for a function that returns a vector
+  typedef bool (ParticleEffectDef::*PropertyFunc)(TiXmlElement*); ///< Shorthand for a ParticleEffectDef property function
+  typedef std::pair <std::string, PropertyFunc> PropPair; ///< Shorthand for the hash map elements
+  typedef stdext::hash_map<std::string, PropertyFunc> PropertyMap; ///< Shorthand for the hash map used by the property map class
+
+  ParticleEffectDef(TiXmlElement *effectDef, int texture); ///< Basic constructor
+  ~ParticleEffectDef(); ///< Basic destructor
+
+  //------------------------------------------------------------
+  /// \brief Effect properties
+  //{@
+  int m_nTotalParticleCount; ///< Max number of particles in the system
+  int m_nEmitRate; ///< Max number of particles to create per second
+  bool m_sort; ///< Whether the system should sort the particles back to front
+  EParticleBlend m_blend; ///< How the particles are blended
+  EParticleBillboard m_billboard; ///< How the particle sprites are turned
+  Vector3 m_vecBillboardAxis; ///< Axis of axis aligned sprites
+  float m_fBillboardStretch; ///< Seconds of travel velocity stretched sprites cover
+  bool m_bCycleParticles; ///< True if particles are to be reused after they die
+  Vector3 m_vecGravity; ///< System gravity
+  bool m_bFade; ///< True if the particles fade in and out
+  bool m_bRotate; ///< True if the particles rotate
+  ParticleEffect::InitFuncArray m_InitFunc; ///< Functions that initialize a new particle's optional values
+
+  int m_txtParticleTexture; ///< Handle of the particles' texture in the renderer's cache
   //}@
   //------------------------------------------------------------
 
@@ -140,36 +205,7 @@ private:
   //------------------------------------------------------------
   /// \brief Maintenance functions
   //{@
-  void initIndexBuffer(); ///< Initializes the index buffer
   void initProperties(TiXmlElement *sysDef); ///< Initializes the effect values
-  void initParticles(); ///< Gives all particles an initial default value
-  void start(); ///< Prepares the effect for starting
-
-  void birthParticles(); ///< Creates all particles ready to be "born"
-  bool initParticle(int index); ///< Initializes the particle at the given index
-  void initParticleRotation(Particle *particle);
-
-  void killParticles(); ///< Kills all particles that are too old
-  bool killParticle(int index); ///< Kills the particle at a particular index
-
-  void update(float elapsedTime); ///< Updates the particles' values
-  void updateFade(); ///< Updates the particles alpha values based on lifeleft
-  void updateRotation(); ///< Updates the particles rotation values
-
-  void sort(); ///< Sorts the particles from back to front
-  //}@
-  //------------------------------------------------------------
-
-  //------------------------------------------------------------
-  /// \brief Member accessors
-  //{@
-  /// \brief Sets the effect emit rate
-  /// \param emitRate Rate at which the effect emits particles (per second)
-  void setEmit(int emitRate) { m_nEmitRate = emitRate; }
-
-  /// \brief Sets the effect diffuse color
-  /// \param color Diffuse color of the effect particles
-  void setColor(unsigned int color) { m_cPIColor = color; }
   //}@
   //------------------------------------------------------------
 
@@ -178,6 +214,8 @@ private:
   //{@
   bool setEmit(TiXmlElement *prop); ///< Sets the emit rate
   bool setSort(TiXmlElement *prop); ///< Sets whether to sort
+  bool setBlend(TiXmlElement *prop); ///< Sets the blend mode
+  bool setBillboard(TiXmlElement *prop); ///< Sets how the sprites are turned
   bool setGravity(TiXmlElement *prop); ///< Sets the value of gravity
   bool setCycle(TiXmlElement *prop); ///< Sets whether the effect cycles
 
@@ -32,50 +32,68 @@
 
 #include "ParticleEngine.h"
 #include "ParticleSystem.h"
+#include "ParticleEffect.h"
+#include "ParticleBatcher.h"
 #include "ParticleDefines.h"
 #include "Particle.h"
-#include "tinyxml/tinyxml.h"
-#include "directorymanager/directorymanager.h"
-#include <d3dx9.h>
-#include "common/Renderer.h"
-#include "common/CommonStuff.h"
+#include "TinyXML/tinyxml.h"
+#include "DirectoryManager/DirectoryManager.h"
+#include "Common/Renderer.h"
+#include "Common/CommonStuff.h"
+#include "Common/JobSystem.h"
 #include <list>
+#include <math.h>
 
 ParticleEngine gParticle;
 
-/// \brief Handles comparing two particle systems to find which is closer
-/// to the camera.
-struct myCompare
+bool ParticleEngine::parallelUpdate = true;
+int ParticleEngine::parallelBatchSize = 2;
+
+/// \brief Orders running systems by how readily they should give up their
+/// place to a new system: lowest priority first, then furthest from the
+/// camera, then oldest.
+struct VictimOrder
 {
   typedef ParticleSystem* P;
 
+  Vector3 camPos; ///< Position of the camera
+
   /// \param x First particle system.
   /// \param y Second particle system.
-  /// \return True is x is closer than y, false otherwise.
-  /// \remark In case of a tie, the one with the smaller ID number is 'closer'.
+  /// \return True if x should give up its place before y.
+  /// \remark Handles are handed out in increasing order, so the one with
+  /// the smaller ID number is the older.
   bool operator()(const P& x, const P& y) const
   {
-    float xdist = Vector3::distanceSquared(gRenderer.getCameraPos(), x->getPosition());
-    float ydist = Vector3::distanceSquared(gRenderer.getCameraPos(), y->getPosition());
-
-    if(xdist < ydist)
-      return true;
-    else if(xdist == ydist)
-      return (x->getUID() < y->getUID());
-    else
-      return false;
+    if(x->getPriority() != y->getPriority())
+      return x->getPriority() < y->getPriority();
+
+    float xdist = Vector3::distanceSquared(camPos, x->getPosition());
+    float ydist = Vector3::distanceSquared(camPos, y->getPosition());
+    if(xdist != ydist)
+      return xdist > ydist;
+
+    return x->getUID() < y->getUID();
   }
 };
 
-typedef std::set<ParticleSystem*, myCompare> SystemSortedSet;
-typedef SystemSortedSet::reverse_iterator SystemSortedSetIter;
-
 ParticleEngine::ParticleEngine()
 {
   m_xmlDoc = NULL;
   m_xmlDefs = NULL;
-
-  srand(GetTickCount());
+  m_batcher = NULL;
+
+  srand(getClockMilliseconds());
+  m_nRandomSeed = getClockMilliseconds();
+  m_nUpdateCount = 0;
+
+  m_nParticleBudget = 0;
+  m_fLodNear = 0.0f;
+  m_fLodFar = 0.0f;
+  m_fLodMin = 1.0f;
+  m_nDeniedSpawns = 0;
+  m_nStolenSystems = 0;
+  m_nDegradedSpawns = 0;
 }
 
 ParticleEngine::~ParticleEngine()
@@ -105,42 +123,53 @@ void ParticleEngine::init(std::string defFile)
   m_xmlDefs = m_xmlDoc->FirstChildElement("definitions");
   TiXmlElement* systemDef = m_xmlDefs->FirstChildElement("system");
 
+  // room in the vertex ring for a few frames' worth of a full budget
+  if(m_batcher == NULL)
+    m_batcher = new ParticleBatcher(32768);
+
+  // the particle budget and level of detail distances, all optional; no
+  // budget and no distances means no limits
+  double tmp;
+  m_nParticleBudget = 0;
+  m_xmlDefs->Attribute("budget", &m_nParticleBudget);
+  m_fLodNear = m_xmlDefs->Attribute("lodnear", &tmp) != NULL ? (float)tmp : 0.0f;
+  m_fLodFar = m_xmlDefs->Attribute("lodfar", &tmp) != NULL ? (float)tmp : 0.0f;
+  m_fLodMin = m_xmlDefs->Attribute("lodmin", &tmp) != NULL ? (float)tmp : 1.0f;
+  m_nDeniedSpawns = 0;
+  m_nStolenSystems = 0;
+  m_nDegradedSpawns = 0;
+
   int numSystemTypes = 0;
 
+  // read each definition into a prototype; the systems themselves are made
+  // by createSystem() as they're needed
   while(systemDef != NULL)
   {
-    std::vector<ParticleSystem*> systems;
-
-    m_Systems.push_back(systems);
-    SystemCatalogIter iter = m_Systems.end();
-    iter--;
-    m_TypeMap.insert(NameTypePair(systemDef->Attribute("name"), numSystemTypes));
-
-    int numCopies;
-    int numParticlesThisSystem = 0;
-    systemDef->Attribute("numcopies", &numCopies);
+    m_Systems.push_back(SystemArray());
+    m_Prototypes.push_back(SystemPrototype());
+    SystemPrototype &prototype = m_Prototypes.back();
+
+    prototype.name = systemDef->Attribute("name");
+    prototype.maxCopies = 0;
+    systemDef->Attribute("numcopies", &prototype.maxCopies);
+    prototype.priority = 0;
+    systemDef->Attribute("priority", &prototype.priority);
+    prototype.particleCount = 0;
+    m_TypeMap.insert(NameTypePair(prototype.name, numSystemTypes));
 
     TiXmlElement* effect = systemDef->FirstChildElement("effect");
 
     if(effect == NULL)
       ABORT("Invalid file format found while initializing ParticleEngine: filename %s", defFile);
 
-    // count the number of particles for this system type
     while(effect != NULL)
     {
-      int partCount;
-      effect->Attribute("particleCount", &partCount);
-      numParticlesThisSystem += partCount;
+      int texture = getTexture(effect->Attribute("textureName"));
+      prototype.effects.push_back(new ParticleEffectDef(effect, texture));
+      prototype.particleCount += prototype.effects.back()->m_nTotalParticleCount;
       effect = effect->NextSiblingElement("effect");
     }
 
-    for(int i=0; i<numCopies; i++)
-    {
-      ParticleSystem *sys = new ParticleSystem();
-      iter->push_back(sys);
-      sys->init(systemDef);
-    }
-
     systemDef = systemDef->NextSiblingElement("system");
     numSystemTypes++;
   }
@@ -157,27 +186,112 @@ void ParticleEngine::shutdown()
     m_xmlDefs = NULL;
   }
 
+  delete m_batcher;
+  m_batcher = NULL;
+
   assert(m_UIDMap.empty());
 }
 
 
-void ParticleEngine::updateSystems()
+/// Systems don't share anything, and neither do the effects in a system,
+/// so every effect of every live system is a separate piece of work, and
+/// with parallelUpdate on they are shared out among gJobSystem's threads.
+/// Killing the systems that died touches the engine's maps, so that waits
+/// until all the effects are done and happens here, one system at a time.
+///
+/// Before that, each system's level of detail follows its distance from
+/// the camera, but never above what the budget gave it when it was spawned,
+/// and never so far up that the systems would go over the budget.
+/// \param dt Time to update the systems by, in seconds
+void ParticleEngine::updateSystems(float dt)
 {
-  UIDMapIter iter = m_UIDMap.begin();
-  while(iter != m_UIDMap.end())
+  int reserved = m_nParticleBudget > 0 ? getReservedParticles() : 0;
+
+  m_updateList.clear();
+  for(UIDMapIter iter = m_UIDMap.begin(); iter != m_UIDMap.end(); iter++)
   {
-    ParticleSystem *sys = iter->second;
-    iter++;
+    EffectRef ref;
+    ref.system = iter->second;
+    updateLod(ref.system, reserved);
+    for(ref.effect = 0; ref.effect < ref.system->m_NumEffects; ref.effect++)
+      m_updateList.push_back(ref);
+  }
+
+  int threads = gJobSystem.getThreadCount();
+  m_threadStats.resize(threads > 1 ? threads : 1);
+  for(int i = 0; i < (int)m_threadStats.size(); i++)
+  {
+    m_threadStats[i].updateTime = 0.0f;
+    m_threadStats[i].effects = 0;
+    m_threadStats[i].particles = 0;
+  }
+
+  UpdateJob job;
+  job.engine = this;
+  job.dt = dt;
+  if(parallelUpdate)
+    gJobSystem.parallelFor((int)m_updateList.size(), parallelBatchSize, updateJob, &job);
+  else
+    updateJob(&job, 0, (int)m_updateList.size(), 0);
 
-    sys->update(gRenderer.getTimeStep());
+  m_nUpdateCount++;
 
-    if(sys->isDead())
-    {
+  // a system is dead once all its effects are, which they may have become
+  // on different threads
+
+  for(int i = 0; i < (int)m_updateList.size(); i++)
+  {
+    ParticleSystem *sys = m_updateList[i].system;
+    if(m_updateList[i].effect == sys->m_NumEffects - 1 && sys->isDead())
       killSystem(sys->m_UID);
-    }
   }
 }
 
+/// The thread's random numbers are reseeded from the engine's seed, the
+/// system and effect, and the update count, so each effect gets the same
+/// numbers whichever thread it lands on and in whatever order.
+/// \param ref The effect
+/// \param dt Time to update it by, in seconds
+/// \param stats Statistics of the thread doing the update
+void ParticleEngine::updateEffect(const EffectRef &ref, float dt, ParticleThreadStats &stats)
+{
+  ParticleUtil::seedRandom(m_nRandomSeed ^
+    (ref.system->m_UID * 0x9e3779b1) ^ (ref.effect * 0x85ebca77) ^ (m_nUpdateCount * 0xc2b2ae3d));
+
+  stats.particles += ref.system->updateEffect(ref.effect, dt);
+  stats.effects++;
+}
+
+/// \param context Points to an UpdateJob.
+/// \param begin First index of the batch in the update list.
+/// \param end One past the last index of the batch.
+/// \param thread Index of the thread running the batch.
+void ParticleEngine::updateJob(void *context, int begin, int end, int thread)
+{
+  UpdateJob &job = *(UpdateJob *)context;
+  ParticleEngine &engine = *job.engine;
+  ParticleThreadStats &stats = engine.m_threadStats[thread];
+
+  double start = getClockSeconds();
+
+  for(int i = begin; i < end; i++)
+    engine.updateEffect(engine.m_updateList[i], job.dt, stats);
+
+  stats.updateTime += (float)(getClockSeconds() - start);
+}
+
+/// Systems started after this is called, and the effects in them, get the
+/// same random numbers from run to run, provided they are created and
+/// updated in the same order.  The engine starts out with a seed taken from
+/// the clock.
+/// \param seed The seed
+void ParticleEngine::setRandomSeed(unsigned int seed)
+{
+  m_nRandomSeed = seed;
+  m_nUpdateCount = 0;
+  ParticleUtil::seedRandom(seed);
+}
+
 
 void ParticleEngine::clear()
 {
@@ -195,6 +309,22 @@ void ParticleEngine::clear()
     m_Systems[i].clear();
   }
   m_Systems.clear();
+
+  // the prototypes go too, the next init() reads them again
+  for(int i=0; i<(int)m_Prototypes.size(); i++)
+  {
+    for(int j=0; j<(int)m_Prototypes[i].effects.size(); j++)
+      delete m_Prototypes[i].effects[j];
+  }
+  m_Prototypes.clear();
+  m_TypeMap.clear();
+
+  for(TextureMap::iterator iter = m_Textures.begin(); iter != m_Textures.end(); iter++)
+  {
+    if(iter->second >= 0)
+      gRenderer.freeTexture(iter->second);
+  }
+  m_Textures.clear();
 }
 
 /// Killing a particle system will stop the system from being rendered
@@ -222,42 +352,118 @@ void ParticleEngine::killAll()
     iter++;    
   }
 
+  // the handles are all released, so they mustn't count against the
+  // budget or be updated any more either
+  m_UIDMap.clear();
   m_IDGenerator.clear();
 
 }
 
+/// Games that run their simulation in fixed ticks call this from the tick,
+/// and render() without updating.
+/// \param dt Time to update the systems by, in seconds
+void ParticleEngine::update(float dt)
+{
+  updateSystems(dt);
+}
+
 /// Renders all the particle systems. Passing in false for doUpdate allows
 /// you to render the systems multiple times per frame without updating. This
 /// is useful when a shader requires multiple passes (such as water reflection)
-/// \param doUpdate Whether the systems should be updated before rendering
+///
+/// The systems are drawn back to front.  Each one's squared distance from
+/// the camera is worked out once, into a key that sorts the same way (see
+/// ParticleEffect::sort()), and the keys are put in order with a radix
+/// sort.  Systems the same distance away are drawn newest first.
+/// \param doUpdate Whether the systems should be updated by the renderer's
+/// time step before rendering
 void ParticleEngine::render(bool doUpdate)
 {
-  static SystemSortedSet sortedSystems;
-  sortedSystems.clear();
-
   if(m_UIDMap.size() == 0)
     return;
 
   if(doUpdate)
-    updateSystems();
+    updateSystems(gRenderer.getTimeStep());
 
-  // render all systems
-  for(UIDMapIter iter = m_UIDMap.begin(); iter != m_UIDMap.end(); iter++)
+  int count = (int)m_UIDMap.size();
+  if(count == 0)
+    return;
+
+  m_drawSystems.resize(count);
+  m_drawKeys.resize(count);
+  m_drawOrder.resize(count);
+  m_drawScratch.resize(count);
+
+  Vector3 camPos = gRenderer.getCameraPos();
+  int n = 0;
+  for(UIDMapIter iter = m_UIDMap.begin(); iter != m_UIDMap.end(); iter++, n++)
   {
-    sortedSystems.insert(iter->second);
+    float distance = Vector3::distanceSquared(camPos, iter->second->getPosition());
+    m_drawSystems[n] = iter->second;
+    m_drawKeys[n] = ParticleUtil::depthKey(distance);
   }
 
-  for(SystemSortedSetIter iter = sortedSystems.rbegin(); iter != sortedSystems.rend(); iter++)
+  ParticleUtil::radixSort(&m_drawKeys[0], &m_drawOrder[0], &m_drawScratch[0], count);
+
+  // the map's order is arbitrary, so put any runs of equal keys newest
+  // first; they're rare and short
+  for(int i = 1; i < count; i++)
   {
-    (*iter)->render();
+    for(int j = i; j > 0; j--)
+    {
+      int a = m_drawOrder[j-1];
+      int b = m_drawOrder[j];
+      if(m_drawKeys[a] != m_drawKeys[b] ||
+        m_drawSystems[a]->getUID() > m_drawSystems[b]->getUID())
+        break;
+      m_drawOrder[j-1] = b;
+      m_drawOrder[j] = a;
+    }
   }
+
+  for(int i = 0; i < count; i++)
+    m_drawSystems[m_drawOrder[i]]->render(*m_batcher);
+  m_batcher->flush();
 }
 
 /// \remark Reasons for getting an invalid handle include passing in a bad
-/// effect name and trying to create more than the max number of systems.
+/// effect name and there being no room for the system in the particle
+/// budget.
 /// \param effectName Name of the particle effect to create
 /// \return Handle to the system being created, -1 if invalid
 unsigned int ParticleEngine::createSystem(std::string effectName)
+{
+  return spawnSystem(effectName, NULL);
+}
+
+/// Knowing where the system will be lets it start out at the right level of
+/// detail, and be judged by its distance when it needs room in the budget.
+/// \remark Reasons for getting an invalid handle include passing in a bad
+/// effect name and there being no room for the system in the particle
+/// budget.
+/// \param effectName Name of the particle effect to create
+/// \param pos Position of the system
+/// \return Handle to the system being created, -1 if invalid
+unsigned int ParticleEngine::createSystem(std::string effectName, const Vector3 &pos)
+{
+  return spawnSystem(effectName, &pos);
+}
+
+/// A system finished with earlier is reused if there is one, otherwise a
+/// new one is made from the definition's prototype, up to the numcopies
+/// given in the definition.  With all the copies running, the one that
+/// most readily gives up its place (see VictimOrder) is killed and reused.
+///
+/// Then the system must fit in the particle budget, at the level of detail
+/// its distance calls for.  If it doesn't, running systems of lower
+/// priority are killed to make room, most expendable first.  If even that
+/// wouldn't be enough, the system is cut down to fit, but to no less than
+/// the smallest level of detail; if it can't be, nothing is killed and the
+/// system isn't created.
+/// \param effectName Name of the particle effect to create
+/// \param pos Position of the system, NULL if not known yet
+/// \return Handle to the system being created, -1 if invalid
+unsigned int ParticleEngine::spawnSystem(const std::string &effectName, const Vector3 *pos)
 {
   SystemTypeMap::const_iterator iter = m_TypeMap.find(effectName);
 
@@ -267,21 +473,114 @@ unsigned int ParticleEngine::createSystem(std::string effectName)
     return -1;
   
   catalogIndex = iter->second;
-  
+  const SystemPrototype &prototype = m_Prototypes[catalogIndex];
+
+  VictimOrder order;
+  order.camPos = gRenderer.getCameraPos();
+
+  // find a copy to run the system on
   ParticleSystem *system = NULL;
-  for(int i=0; i< (int)m_Systems[catalogIndex].size(); i++)
+  ParticleSystem *sameKind = NULL; // running copy to take over, if any
+  SystemArray &systems = m_Systems[catalogIndex];
+  for(int i=0; i< (int)systems.size(); i++)
   {
-    if(m_Systems[catalogIndex][i]->isDead())
+    if(systems[i]->isDead())
     {
-      system = m_Systems[catalogIndex][i];
+      system = systems[i];
       break;
     }
+    if(sameKind == NULL || order(systems[i], sameKind))
+      sameKind = systems[i];
   }
 
-  if(system == NULL)
-    return -1;
+  if(system == NULL && (int)systems.size() < prototype.maxCopies)
+  {
+    system = new ParticleSystem();
+    system->init(prototype.name, prototype.effects);
+    system->m_Priority = prototype.priority;
+    systems.push_back(system);
+  }
+
+  if(system != NULL)
+    sameKind = NULL;
+  else if(sameKind == NULL)
+    return -1; // no copies at all
+
+  // how many particles it gets
+  float scale = pos != NULL ? getLodScale(*pos) : 1.0f;
+  int wanted = (int)(prototype.particleCount * scale + 0.5f);
+  float cap = 1.0f; // most it may ever have, if the budget cuts it down
+
+  if(m_nParticleBudget > 0)
+  {
+    int room = m_nParticleBudget - getReservedParticles();
+    if(sameKind != NULL)
+      room += sameKind->getParticleLimit();
+
+    if(room < wanted)
+    {
+      // lower priority systems that could make room
+      m_victims.clear();
+      for(UIDMapIter iter = m_UIDMap.begin(); iter != m_UIDMap.end(); iter++)
+      {
+        if(iter->second->getPriority() < prototype.priority)
+          m_victims.push_back(iter->second);
+      }
+
+      int available = room;
+      for(int i=0; i<(int)m_victims.size(); i++)
+        available += m_victims[i]->getParticleLimit();
+
+      // not enough even with all of them gone, so cut the system down
+      if(available < wanted)
+      {
+        int least = (int)(prototype.particleCount * m_fLodMin + 0.5f);
+        if(available < least || available <= 0)
+        {
+          m_nDeniedSpawns++;
+          return -1;
+        }
+        wanted = available;
+        scale = (float)wanted / (float)prototype.particleCount;
+        cap = scale;
+      }
+
+      // kill them, most expendable first, until there's room; there are
+      // seldom more than a few, and usually only one is needed
+      for(int i=0; i<(int)m_victims.size() && room < wanted; i++)
+      {
+        for(int j=i+1; j<(int)m_victims.size(); j++)
+        {
+          if(order(m_victims[j], m_victims[i]))
+          {
+            ParticleSystem *tmp = m_victims[i];
+            m_victims[i] = m_victims[j];
+            m_victims[j] = tmp;
+          }
+        }
+
+        room += m_victims[i]->getParticleLimit();
+        killSystem(m_victims[i]->m_UID);
+        m_nStolenSystems++;
+      }
+    }
+  }
+
+  if(sameKind != NULL)
+  {
+    killSystem(sameKind->m_UID);
+    m_nStolenSystems++;
+    system = sameKind;
+  }
+
+  if(scale < 1.0f)
+    m_nDegradedSpawns++;
 
   system->start();
+  system->setLod(scale);
+  system->m_fLodCap = cap;
+  if(pos != NULL)
+    system->setPosition(*pos);
   unsigned int uid = m_IDGenerator.generateID();
   system->m_UID = uid;
   m_UIDMap.insert(UIDIndexPair(uid, system));
@@ -289,6 +588,81 @@ unsigned int ParticleEngine::createSystem(std::string effectName)
   return uid; // this value will be used as the handle
 }
 
+/// \return The number of particles the running systems may have at once,
+/// at their current levels of detail
+int ParticleEngine::getReservedParticles()
+{
+  int reserved = 0;
+
+  for(UIDMapIter iter = m_UIDMap.begin(); iter != m_UIDMap.end(); iter++)
+    reserved += iter->second->getParticleLimit();
+
+  return reserved;
+}
+
+/// A system coming closer gets more particles, but only as far as its cap
+/// and the room left in the budget allow.  If the room won't take the whole
+/// step, it gets as much of it as fits, and if rounding still puts it over,
+/// it stays where it was until there's more room.
+/// \param system The system
+/// \param reserved The particles all running systems may have at once,
+/// which is kept up to date as the system's limit changes
+void ParticleEngine::updateLod(ParticleSystem *system, int &reserved)
+{
+  float scale = getLodScale(system->getPosition());
+  if(scale > system->m_fLodCap)
+    scale = system->m_fLodCap;
+
+  if(m_nParticleBudget <= 0)
+  {
+    system->setLod(scale);
+    return;
+  }
+
+  float oldScale = system->getLod();
+  int oldLimit = system->getParticleLimit();
+  system->setLod(scale);
+  int newLimit = system->getParticleLimit();
+
+  if(newLimit > oldLimit && reserved - oldLimit + newLimit > m_nParticleBudget)
+  {
+    int room = m_nParticleBudget - reserved;
+    if(room > 0)
+    {
+      scale = oldScale + (scale - oldScale) * room / (newLimit - oldLimit);
+      system->setLod(scale);
+      newLimit = system->getParticleLimit();
+    }
+    if(room <= 0 || reserved - oldLimit + newLimit > m_nParticleBudget)
+    {
+      system->setLod(oldScale);
+      newLimit = oldLimit;
+    }
+  }
+
+  reserved += newLimit - oldLimit;
+}
+
+/// Systems closer to the camera than m_fLodNear get all their particles,
+/// and from there the fraction falls off linearly to m_fLodMin at m_fLodFar
+/// and beyond.
+/// \param pos Position of a system
+/// \return Fraction of its particles the system gets, from m_fLodMin to 1
+float ParticleEngine::getLodScale(const Vector3 &pos)
+{
+  if(m_fLodFar <= m_fLodNear)
+    return 1.0f;
+
+  float distance = sqrt(Vector3::distanceSquared(gRenderer.getCameraPos(), pos));
+  if(distance <= m_fLodNear)
+    return 1.0f;
+  if(distance >= m_fLodFar)
+    return m_fLodMin;
+
+  float t = (distance - m_fLodNear) / (m_fLodFar - m_fLodNear);
+  return 1.0f + (m_fLodMin - 1.0f) * t;
+}
+
 /// \param uid ID of the system to move
 /// \param pos Position of the system
 void ParticleEngine::setSystemPos(unsigned int uid, Vector3 pos)
@@ -302,6 +676,40 @@ void ParticleEngine::setSystemPos(unsigned int uid, Vector3 pos)
   }
 }
 
+/// \param denied Address of an int to store the number of systems not
+/// created for lack of room in the budget, or NULL
+/// \param stolen Address of an int to store the number of running systems
+/// killed to make room for new ones, or NULL
+/// \param degraded Address of an int to store the number of systems
+/// created with fewer particles than their definitions, whether for
+/// distance or for room, or NULL
+/// \remark The counts start from zero at init().
+void ParticleEngine::getSpawnCounts(int *denied, int *stolen, int *degraded)
+{
+  if(denied != NULL)
+    *denied = m_nDeniedSpawns;
+  if(stolen != NULL)
+    *stolen = m_nStolenSystems;
+  if(degraded != NULL)
+    *degraded = m_nDegradedSpawns;
+}
+
+/// \param effects Address of an int to store the number of effects drawn,
+/// or NULL
+/// \param batches Address of an int to store the number of batches they
+/// were drawn in, each a single draw call unless it was very large, or NULL
+/// \remark Draw calls and state changes are counted by the renderer, see
+/// Renderer::getCallCount().
+void ParticleEngine::getBatchCounts(int *effects, int *batches)
+{
+  if(effects != NULL)
+    *effects = 0;
+  if(batches != NULL)
+    *batches = 0;
+  if(m_batcher != NULL)
+    m_batcher->getLastCounts(effects, batches);
+}
+
 /// \param uid ID of the system
 /// \return The name of the system class
 std::string ParticleEngine::getSystemName(unsigned int uid)
@@ -321,9 +729,15 @@ std::string ParticleEngine::getSystemName(unsigned int uid)
 /// \param numSys Address of an int to store the current number of systems
 /// \param numPart Address of an int to store the current number of particles
 /// in all systems
+/// \param threadStats Address of a vector to store how each thread spent
+/// the last update, or NULL.  Entry 0 is the main thread.
 /// \return The number of particles in all systems
-int ParticleEngine::getPerformanceData(int *numSys, int *numPart)
+int ParticleEngine::getPerformanceData(int *numSys, int *numPart,
+  std::vector<ParticleThreadStats> *threadStats)
 {
+  if(threadStats != NULL)
+    *threadStats = m_threadStats;
+
   if(numSys != NULL)
     *numSys = (int)m_UIDMap.size();
 
@@ -342,6 +756,27 @@ int ParticleEngine::getPerformanceData(int *numSys, int *numPart)
   return parts;
 }
 
+/// Effects with the same texture file share one copy of the texture, which
+/// the engine releases in clear().
+/// \param filename Name of the texture file, in the textures directory
+/// \return Handle of the texture in the renderer's cache, -1 if it couldn't
+/// be loaded
+int ParticleEngine::getTexture(const char *filename)
+{
+  if(filename == NULL)
+    return -1;
+
+  TextureMap::const_iterator iter = m_Textures.find(filename);
+  if(iter != m_Textures.end())
+    return iter->second;
+
+  // sprites are drawn at about their texture size, so no mipmaps
+  int texture = gRenderer.cacheTextureDX(filename, true, false);
+
+  m_Textures.insert(TextureMap::value_type(filename, texture));
+  return texture;
+}
+
 ParticleSystem* ParticleEngine::getSystemFromUID(unsigned int uid)
 {
   UIDMapIter iter;
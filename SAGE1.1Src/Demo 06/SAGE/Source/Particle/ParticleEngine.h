@@ -34,23 +34,43 @@
 #define __PARTICLEENGINE_H_INCLUDED__
 
 #include <string>
-#include <hash_map>
 #include <vector>
-#include <set>
+#include "Common/Portable.h"
 #include "Particle.h"
-#include "common/Vector3.h"
-#include "generators/IDGenerator.h"
+#include "Common/vector3.h"
+#include "Generators/IDGenerator.h"
 
 class ParticleSystem;
+class ParticleEffectDef;
+class ParticleBatcher;
 class TiXmlDocument;
 class TiXmlElement;
-struct IDirect3DDevice9;
+
+/// \brief How one thread spent the last particle update
+struct ParticleThreadStats
+{
+  float updateTime; ///< Seconds spent updating effects
+  int effects; ///< Number of effects updated
+  int particles; ///< Number of particles left alive in them
+};
 
 //-----------------------------------------------------------------------------
 /// \brief Creates, manages, and renders particle systems
 ///
 /// The ParticleEngine uses xml files to create particle systems. The xml files
 /// contain the system definitions, describing the attributes of the system.
+/// Each definition is read once, into a prototype that every system made
+/// from it shares, and systems are only made when they are first needed,
+/// then kept for reuse.  Textures are loaded once per file name.
+///
+/// The running systems share a budget of particles.  A new system that
+/// doesn't fit takes the place of lower priority ones, or if that isn't
+/// enough runs with fewer particles, or failing that isn't created.  Far
+/// away systems run with fewer particles anyway.  The budget, priorities
+/// and distances are all given in the xml file.
+///
+/// The systems are drawn back to front, through a ParticleBatcher that
+/// draws effects sharing a texture and blend mode together.
 class ParticleEngine
 {
   typedef stdext::hash_map<unsigned int, ParticleSystem*> UIDMap;
@@ -65,7 +85,23 @@ class ParticleEngine
   typedef stdext::hash_map<std::string, int> SystemTypeMap;
   typedef std::pair<std::string, int> NameTypePair;
 
+  typedef stdext::hash_map<std::string, int> TextureMap;
+
+  /// \brief What every system made from one definition shares
+  struct SystemPrototype
+  {
+    std::string name; ///< Name of the definition
+    int maxCopies; ///< Most systems of this kind that may be running at once
+    int priority; ///< Systems may take the place of running systems of lower priority
+    int particleCount; ///< Particles in all the effects, at full detail
+    std::vector<ParticleEffectDef*> effects; ///< Definitions of the effects
+  };
+  typedef std::vector<SystemPrototype> PrototypeArray;
+
 public:
+  static bool parallelUpdate; ///< Whether effects are updated on all of gJobSystem's threads
+  static int parallelBatchSize; ///< Number of effects in each batch handed to a thread
+
   ParticleEngine(); ///< Basic constructor
   ~ParticleEngine(); ///< Basic destructor
 
@@ -76,19 +112,32 @@ public:
   void killSystem(unsigned int sysID); ///< Kills a specific system
   void killAll(); ///< Deletes all particle systems
 
+  void update(float dt); ///< Updates all systems by a fixed step
   void render(bool doUpdate=true); ///< Renders all systems
   unsigned int createSystem(std::string effectName); ///< Create a new system
+  unsigned int createSystem(std::string effectName, const Vector3 &pos); ///< Create a new system at a position
 
   void setSystemPos(unsigned int sysID, Vector3 pos); ///< Set a system's position
 
   std::string getSystemName(unsigned int sysID); ///< Get the definition name of a system
 
+  void setRandomSeed(unsigned int seed); ///< Makes the systems' random numbers repeatable
+
   /// \brief Gets the engine performance data
-  int getPerformanceData(int *numSystems, int *numParticles);
+  int getPerformanceData(int *numSystems, int *numParticles,
+    std::vector<ParticleThreadStats> *threadStats = NULL);
+
+  /// \brief Gets how many new systems the particle budget has turned away, made room for, or cut down
+  void getSpawnCounts(int *denied, int *stolen, int *degraded);
+
+  /// \brief Gets how many effects the last render drew, in how many batches
+  void getBatchCounts(int *effects, int *batches);
 
 private:
-  SystemCatalog m_Systems; ///< Catalog of all systems possible
+  SystemCatalog m_Systems; ///< Systems made so far of each kind, running or waiting for reuse
+  PrototypeArray m_Prototypes; ///< Prototype of each kind of system, indexed like m_Systems
   SystemTypeMap m_TypeMap;
+  TextureMap m_Textures; ///< Particle textures by file name
 
   IDGenerator m_IDGenerator; ///< ID generator for the systems
   UIDMap m_UIDMap; ///< Map of UID's to particle systems
@@ -97,8 +146,49 @@ private:
   TiXmlElement* m_xmlDefs; ///< Definition node in the particle xml file
   unsigned int m_nLastTimeUpdated; ///< Time of last engine update
 
-  void updateSystems(); ///< Updates all particle systems
+  /// \brief An effect of a live system, to be updated.
+  struct EffectRef
+  {
+    ParticleSystem *system; ///< The system
+    int effect; ///< Index of the effect in the system
+  };
+
+  /// \brief What updateJob() needs to know.
+  struct UpdateJob
+  {
+    ParticleEngine *engine; ///< The engine
+    float dt; ///< Time step
+  };
+
+  std::vector<EffectRef> m_updateList; ///< Effects of the live systems, kept to save allocating every update
+  std::vector<ParticleThreadStats> m_threadStats; ///< How each thread spent the last update
+  unsigned int m_nRandomSeed; ///< Seed the effects' random numbers come from
+  unsigned int m_nUpdateCount; ///< Number of updates so far, to vary the random numbers from one to the next
+
+  int m_nParticleBudget; ///< Most particles all running systems may have at once, 0 for no limit
+  float m_fLodNear; ///< Distance from the camera beyond which systems get fewer particles
+  float m_fLodFar; ///< Distance from the camera at which systems are down to m_fLodMin of their particles
+  float m_fLodMin; ///< Least fraction of its particles a system is given
+  int m_nDeniedSpawns; ///< Systems not created for lack of room in the budget
+  int m_nStolenSystems; ///< Running systems killed to make room for new ones
+  int m_nDegradedSpawns; ///< Systems created with fewer particles than their definition
+  SystemArray m_victims; ///< Systems that could make room for a new one, kept to save allocating every time
+
+  ParticleBatcher *m_batcher; ///< Draws the visible effects, made by init()
+  SystemArray m_drawSystems; ///< Systems being drawn, kept to save allocating every render
+  std::vector<unsigned int> m_drawKeys; ///< Sort key of each system being drawn
+  std::vector<int> m_drawOrder; ///< Indices of the systems being drawn, back to front
+  std::vector<int> m_drawScratch; ///< Room for sorting m_drawOrder
+
+  void updateSystems(float dt); ///< Updates all particle systems
+  void updateEffect(const EffectRef &ref, float dt, ParticleThreadStats &stats); ///< Updates one effect
+  static void updateJob(void *context, int begin, int end, int thread); ///< Updates a batch of effects, for gJobSystem
   ParticleSystem* getSystemFromUID(unsigned int uid); ///< Finds the index mapped to the uid
+  unsigned int spawnSystem(const std::string &effectName, const Vector3 *pos); ///< Creates a system within the budget
+  int getReservedParticles(); ///< Adds up the particle limits of the running systems
+  float getLodScale(const Vector3 &pos); ///< Works out how much of its particles a system gets
+  void updateLod(ParticleSystem *system, int &reserved); ///< Moves a system's level of detail with its distance, within the budget
+  int getTexture(const char *filename); ///< Loads a texture, or finds it loaded already
 };
 //-----------------------------------------------------------------------------
 
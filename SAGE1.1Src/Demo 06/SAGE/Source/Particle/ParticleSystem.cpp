@@ -33,9 +33,10 @@
 #include "ParticleSystem.h"
 #include "ParticleEngine.h"
 #include "ParticleEffect.h"
+#include "ParticleBatcher.h"
 #include "ParticleDefines.h"
-#include "tinyxml/tinyxml.h"
-#include "common/Renderer.h"
+#include "TinyXML/tinyxml.h"
+#include "Common/Renderer.h"
 
 ParticleSystem::ParticleSystem()
 {
@@ -44,6 +45,9 @@ ParticleSystem::ParticleSystem()
   m_NumEffects = 0;
   m_Position = Vector3::kZeroVector;
   m_Name = "";
+  m_Priority = 0;
+  m_fLod = 1.0f;
+  m_fLodCap = 1.0f;
 }
 
 ParticleSystem::~ParticleSystem()
@@ -51,39 +55,24 @@ ParticleSystem::~ParticleSystem()
   clear();
 }
 
-/// \param sysDef XML tag containing the system definition
-void ParticleSystem::init(TiXmlElement *sysDef)
+/// \param name Name of the system's definition
+/// \param effects Definitions of the system's effects, which must outlive
+/// the system
+void ParticleSystem::init(const std::string &name, const std::vector<ParticleEffectDef*> &effects)
 {
   clear();
-  m_SystemDef = sysDef;
 
-  m_Name = sysDef->Attribute("name");
-
-  // determine the number of effects by counting the xml tags
-  TiXmlElement *effect = sysDef->FirstChildElement("effect");
-
-  while(effect != 0)
-  {
-    ++m_NumEffects;
-    effect = effect->NextSiblingElement("effect");
-  }
+  m_Name = name;
+  m_NumEffects = (int)effects.size();
 
   // create array of effect pointers
   m_Effect = new ParticleEffect*[m_NumEffects];
 
   // create effects
-  effect = sysDef->FirstChildElement("effect");
-  int effectParticleOffset = 0;
   for(int i=0; i<m_NumEffects; i++)
   {
-    int partCount;
-    effect->Attribute("particlecount", &partCount);
-
-    m_Effect[i] = new ParticleEffect(effect);
-    effectParticleOffset += partCount;
+    m_Effect[i] = new ParticleEffect(effects[i]);
     m_Effect[i]->m_bIsDead = true;
-
-    effect = effect->NextSiblingElement("effect");
   }
 }
 
@@ -126,17 +115,34 @@ void ParticleSystem::start()
 void ParticleSystem::update(float elapsedTime)
 {
   for(int i=0; i<m_NumEffects; i++)
-  {
-    m_Effect[i]->setPosition(m_Position);
-    m_Effect[i]->update(elapsedTime);
-  }
+    updateEffect(i, elapsedTime);
+}
+
+/// Effects don't share anything, so different effects can be updated on
+/// different threads at once.
+/// \param effect Index of the effect
+/// \param elapsedTime Time in seconds since the last update call was made
+/// \return The number of particles left alive in the effect
+int ParticleSystem::updateEffect(int effect, float elapsedTime)
+{
+  m_Effect[effect]->setPosition(m_Position);
+  m_Effect[effect]->update(elapsedTime);
+  return m_Effect[effect]->getParticleCount();
 }
 
-void ParticleSystem::render()
+/// Effects outside the view frustum aren't drawn.  The others have their
+/// particles sorted, if they sort, and are added to the batcher in order.
+/// \param batcher Batcher drawing this frame's particles
+void ParticleSystem::render(ParticleBatcher &batcher)
 {
   for(int i=0; i<m_NumEffects; i++)
   {
-    m_Effect[i]->render();
+    ParticleEffect *effect = m_Effect[i];
+    if(effect->m_nLiveParticleCount == 0 ||
+      !gRenderer.isBoxVisible(effect->m_boundingBox, NULL, &effect->m_nCullPlane))
+      continue;
+    effect->sort();
+    batcher.add(effect);
   }
 }
 
@@ -154,6 +160,28 @@ bool ParticleSystem::isDead()
   return true;
 }
 
+/// \return The most particles the system may have alive at once, what it
+/// counts against the ParticleEngine's budget
+int ParticleSystem::getParticleLimit()
+{
+  int retval = 0;
+
+  for(int i=0; i<m_NumEffects; i++)
+  {
+    retval += m_Effect[i]->getParticleLimit();
+  }
+
+  return retval;
+}
+
+/// \param scale Fraction of each effect's particles to use, from 0 to 1
+void ParticleSystem::setLod(float scale)
+{
+  m_fLod = scale;
+  for(int i=0; i<m_NumEffects; i++)
+    m_Effect[i]->setLod(scale);
+}
+
 /// \return The number of particles in the system
 int ParticleSystem::getParticleCount()
 {
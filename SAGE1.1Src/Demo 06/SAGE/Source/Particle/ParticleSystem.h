@@ -37,12 +37,14 @@
 
 #include <stdio.h>
 #include <string>
-#include "common/Vector3.h"
+#include <vector>
+#include "Common/vector3.h"
 
 #include "ParticleDefines.h"
 
 class ParticleEffect;
-class TiXmlElement;
+class ParticleEffectDef;
+class ParticleBatcher;
 
 //-----------------------------------------------------------------------------
 /// \brief Collection of effects that make up a single system.
@@ -57,18 +59,20 @@ class ParticleSystem
 public:
   Vector3 getPosition() { return m_Position; }
   unsigned int getUID() { return m_UID; }
+  int getPriority() { return m_Priority; }
 
 private:
   ParticleSystem();  ///< Basic constructor
   ~ParticleSystem(); ///< Basic destructor
 
-  void init(TiXmlElement *sysDef); ///< Initialize the system
+  void init(const std::string &name, const std::vector<ParticleEffectDef*> &effects); ///< Initialize the system
   void clear(); ///< Clears the system data
   void reset(); ///< Resets the system to initialized state
   void start(); ///< Sets the effects to alive
 
   void update(float elapsedTime); ///< Updates the particles
-  void render(); ///< Renders all effects in this system
+  int updateEffect(int effect, float elapsedTime); ///< Updates the particles of one effect
+  void render(ParticleBatcher &batcher); ///< Hands the visible effects to the batcher to draw
 
   bool isDead(); ///< Tests whether the system is dead (no live particles)
 
@@ -81,13 +85,18 @@ private:
   std::string getName() { return m_Name; }
 
   int getParticleCount(); ///< Returns the number of particles in all effects
+  int getParticleLimit(); ///< Returns the most particles all the effects may have at their level of detail
+  void setLod(float scale); ///< Scales the particle counts and emission rates of all effects
+  float getLod() { return m_fLod; } ///< Returns the scale last given to setLod()
 
   ParticleEffect **m_Effect; ///< Pointer to the effects
   unsigned int m_UID; ///< Unique handle to this system
   int m_NumEffects; ///< Number of effects
   Vector3 m_Position; ///< Position of the system
   std::string m_Name; ///< Name of the system
-  TiXmlElement *m_SystemDef; ///< XML tag containing the system definition
+  int m_Priority; ///< Priority of the system's definition, higher systems may take the place of lower ones
+  float m_fLod; ///< Fraction of its particles the system has now
+  float m_fLodCap; ///< Most of its particles the budget let the system have when it was spawned
 };
 //-----------------------------------------------------------------------------
 
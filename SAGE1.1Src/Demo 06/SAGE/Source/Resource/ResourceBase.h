@@ -54,7 +54,7 @@ public:
   ResourceBase(bool isRegistered);
 
   /// \brief Unregisters the resource with the manager, if necessary.
-  ~ResourceBase();
+  virtual ~ResourceBase();
 
   /// \brief Returns whether the resource is registered with the ResourceManager
   /// \return Whether the resource is registered with the ResourceManager
@@ -32,7 +32,6 @@
 
 #include "ResourceManager.h"
 #include "ResourceBase.h"
-#include <d3d9.h>
 #include <assert.h>
 
 ResourceManager gResourceManager;
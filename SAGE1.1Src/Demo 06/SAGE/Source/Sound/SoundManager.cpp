@@ -35,7 +35,7 @@
 
 #include <stdio.h>
 
-#include "Common/Vector3.h"
+#include "Common/vector3.h"
 #include "Common/EulerAngles.h"
 #include "Common/RotationMatrix.h"
 #include "SoundManager.h"
@@ -48,7 +48,8 @@
 /// cooperative level correctly.
 
 SoundManager::SoundManager()
-    : m_lpDirectSound(NULL),m_bOperational(false)
+    : m_lpDirectSound(NULL),m_lpPrimaryBuffer(NULL),m_lpListener(NULL),
+      m_bOperational(false),m_bSilent(false)
 { //constructor
 
   m_nCount = 0; //no sounds yet
@@ -115,6 +116,28 @@ void SoundManager::init(HWND hwnd,int size)
   m_soundNames.resize(size,"");
 }
 
+/// Initializes the sound manager without DirectSound, for running where
+/// there is no sound hardware or nobody to hear it.  Sounds are loaded by
+/// name only and never play, but handles and instances are handed out
+/// and released just as usual, so the game behaves the same.
+/// \param size Specifies the maximum number of sounds managed by the manager.
+void SoundManager::initSilent(int size)
+{
+  // If already initialized, we're done
+  if(m_bOperational)
+    return;
+
+  m_bOperational = TRUE;
+  m_bSilent = true;
+
+  // Allocate sound arrays
+  m_lpBuffer.resize(size,NULL);
+  m_lpBuffer3D.resize(size,NULL);
+  m_lpGranted.resize(size,NULL);
+  m_nInstanceCount.resize(size,0);
+  m_soundNames.resize(size,"");
+}
+
 /// Frees dynamic memory and resources and shuts down the manager.
 void SoundManager::shutdown()
 {
@@ -136,6 +159,7 @@ void SoundManager::shutdown()
     m_lpDirectSound = NULL;
   }
   m_bOperational = false;
+  m_bSilent = false;
 }
 
 /// Clear the sound manager.
@@ -149,7 +173,7 @@ void SoundManager::clear()
   stop(); //stop all sounds (paranoia)
 
   for(int i=0; i<m_nCount; i++){ //for each sound
-    for(int j=0; j<m_nInstanceCount[i]; j++){ //for each instance
+    for(int j=0; m_lpBuffer[i] && j<m_nInstanceCount[i]; j++){ //for each instance
       m_lpBuffer3D[i][j]->Release();
       m_lpBuffer3D[i][j] = NULL; //probably not needed
       m_lpBuffer[i][j]->Release(); //release the sound
@@ -157,6 +181,8 @@ void SoundManager::clear()
     }
 
     //reclaim memory
+    delete [] m_lpGranted[i];
+    m_lpGranted[i] = NULL;
     delete [] m_lpBuffer3D[i];
     m_lpBuffer3D[i] = NULL;
     delete [] m_lpBuffer[i];
@@ -263,6 +289,17 @@ int SoundManager::load(std::string filename, int instances)
     m_soundNames.resize(size * 2);
   }
 
+  //silent sounds are only a name and instance flags
+  if(m_bSilent)
+  {
+    m_nInstanceCount[m_nCount]=instances;
+    m_lpGranted[m_nCount] = new bool[instances];
+    for(int instance=0; instance < instances; instance++)
+      m_lpGranted[m_nCount][instance] = false;
+    m_soundNames[m_nCount] = filename;
+    return m_nCount++;
+  }
+
   //load sound data from file
   length = loadSound(filename, sound); //load sound from file
   m_nInstanceCount[m_nCount]=instances; //record number of instances
@@ -281,6 +318,7 @@ int SoundManager::load(std::string filename, int instances)
 /// \param looping TRUE if sound is to be looped
 void SoundManager::playNext(int index, bool looping)
 { //play sound
+  if(m_bSilent)return; //nothing to play on
 
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
@@ -313,6 +351,7 @@ void SoundManager::playNext(int index, bool looping)
 /// \param looping Specifies whether the sound will loop.
 void SoundManager::play(int index, int instance, bool looping)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   if(instance < 0 || instance >= m_nInstanceCount[index]) return;
@@ -325,6 +364,7 @@ void SoundManager::play(int index, int instance, bool looping)
 ///\param index index of sound to stop
 void SoundManager::stop(int index)
 { //stop playing sound
+  if(m_bSilent)return; //nothing to play on
 
   if(!m_bOperational)return; //bail if not initialized 
   if(index<0||index>=m_nCount)return; //bail if bad index
@@ -340,6 +380,7 @@ void SoundManager::stop(int index)
 /// Stops a particular instance of a sound.
 void SoundManager::stop(int index, int instance)
 { //stop playing sound
+  if(m_bSilent)return; //nothing to play on
 
   if(!m_bOperational)return; //bail if not initialized 
   if(index<0||index>=m_nCount)return; //bail if bad index
@@ -394,14 +435,14 @@ int SoundManager::requestInstance(int index)
   DWORD status; //status of that instance
 
   //get status of first instance
-  if(m_lpGranted[index][instance] || FAILED(m_lpBuffer[index][instance]->GetStatus(&status)))
+  if(m_lpGranted[index][instance] || getStatus(index, instance, status))
     status = DSBSTATUS_PLAYING; //assume playing if failed
 
   //find next unplayed instance, if any
   while(instance < m_nInstanceCount[index]&&
   (status&DSBSTATUS_PLAYING)){ //while current instance in use
     if(++instance < m_nInstanceCount[index]) //go to next instance
-      if(m_lpGranted[index][instance] || FAILED(m_lpBuffer[index][instance]->GetStatus(&status)))
+      if(m_lpGranted[index][instance] || getStatus(index, instance, status))
         status = DSBSTATUS_PLAYING; //assume playing if failed
   }
 
@@ -439,6 +480,7 @@ void SoundManager::releaseInstance(int index, int instance)
 /// \note Behavior is undefined for values outside of the interval [0.0, 10.0].
 void SoundManager::setRolloff(float rolloffFactor)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   m_lpListener->SetRolloffFactor(rolloffFactor, DS3D_IMMEDIATE);
 }
@@ -449,6 +491,7 @@ void SoundManager::setRolloff(float rolloffFactor)
 /// \param meters Specifies the number of meters in a vector unit.
 void SoundManager::setDopplerUnit(float meters)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational) return;
   m_lpListener->SetDistanceFactor(meters, DS3D_IMMEDIATE);
 }
@@ -457,6 +500,7 @@ void SoundManager::setDopplerUnit(float meters)
 /// \param position Specifies the position of the listener.
 void SoundManager::setListenerPosition(const Vector3 &position)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   m_lpListener->SetPosition(position.x, position.y, position.z,
       DS3D_IMMEDIATE);
@@ -466,6 +510,7 @@ void SoundManager::setListenerPosition(const Vector3 &position)
 /// \param velocity Specifies the velocity of the listener.
 void SoundManager::setListenerVelocity(const Vector3 &velocity)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   m_lpListener->SetVelocity(velocity.x,velocity.y,velocity.z,
       DS3D_IMMEDIATE);
@@ -475,6 +520,7 @@ void SoundManager::setListenerVelocity(const Vector3 &velocity)
 /// \param orientation Specifies the orientation of the listener.
 void SoundManager::setListenerOrientation(const EulerAngles &orientation)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational) return;
   RotationMatrix m;
   m.setup(orientation);
@@ -487,6 +533,7 @@ void SoundManager::setListenerOrientation(const EulerAngles &orientation)
 /// \param position Specifies the position of the sound.
 void SoundManager::setPosition(int index, const Vector3 &position)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   
@@ -503,6 +550,7 @@ void SoundManager::setPosition(int index, const Vector3 &position)
 /// \param position Specifies the position of the sound instance.
 void SoundManager::setPosition(int index, int instance, const Vector3 &position)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   if(instance < 0 || instance >= m_nInstanceCount[index]) return;
@@ -515,6 +563,7 @@ void SoundManager::setPosition(int index, int instance, const Vector3 &position)
 /// \param velocity Specifies the velocity of the sound.
 void SoundManager::setVelocity(int index, const Vector3 &velocity)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   
@@ -531,6 +580,7 @@ void SoundManager::setVelocity(int index, const Vector3 &velocity)
 /// \param velocity Specifies the velocity of the sound instance.
 void SoundManager::setVelocity(int index, int instance, const Vector3 &velocity)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   if(instance < 0 || instance >= m_nInstanceCount[index]) return;
@@ -543,6 +593,7 @@ void SoundManager::setVelocity(int index, int instance, const Vector3 &velocity)
 /// \param instance Specifies the instance of the sound.
 void SoundManager::setToListener(int index, int instance)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   if(instance < 0 || instance >= m_nInstanceCount[index]) return;
@@ -566,6 +617,7 @@ void SoundManager::setToListener(int index, int instance)
 /// \param maxDistance Specifies the maximum distance of the sound in vector units.
 void SoundManager::setDistance(int index, float minDistance, float maxDistance)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   
@@ -588,6 +640,7 @@ void SoundManager::setDistance(int index, float minDistance, float maxDistance)
 /// \param maxDistance Specifies the maximum distance of the sound in vector units.
 void SoundManager::setDistance(int index, int instance, float minDistance, float maxDistance)
 {
+  if(m_bSilent)return; //nothing to play on
   if(!m_bOperational)return; //bail if not initialized
   if(index<0||index>=m_nCount)return; //bail if bad index
   if(instance < 0 || instance >= m_nInstanceCount[index]) return;
@@ -600,6 +653,7 @@ void SoundManager::setDistance(int index, int instance, float minDistance, float
 /// \param volume Specifies the volume for the sound.  This value can range from 0.0 - 1.0
 void SoundManager::setVolume( int index, float volume)
 {
+  if(m_bSilent)return; //nothing to play on
   if(index<0||index>=m_nCount) return; //bail if bad index
 
   int instances = m_nInstanceCount[index];
@@ -619,6 +673,18 @@ void SoundManager::setVolume( int index, float volume)
 }
 
 
+/// Gets the status of a sound instance.  Silent instances are never playing.
+/// \param index Specifies the index of the sound.
+/// \param instance Specifies the instance of the sound.
+/// \param status Set to the DirectSound status flags of the instance.
+/// \return TRUE if the status couldn't be read.
+BOOL SoundManager::getStatus(int index, int instance, DWORD &status)
+{
+  status = 0;
+  if(m_bSilent)return FALSE;
+  return FAILED(m_lpBuffer[index][instance]->GetStatus(&status));
+}
+
 /// Create buffer.
 /// Creates a set of buffers for a sound.  The number of instances is expected
 /// to be set by the calling function.
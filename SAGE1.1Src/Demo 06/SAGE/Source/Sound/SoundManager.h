@@ -70,6 +70,7 @@ public:
   SoundManager(); ///< Constructs a sound manager.
   ~SoundManager(); ///< Frees resources and destroys the manager..
   void init(HWND hwnd,int size = 256); ///< Initializes the sound manager for use with a given window.
+  void initSilent(int size = 256); ///< Initializes the sound manager with no sound device.
   void shutdown(); ///< Shuts down the sound manager, freeing any dynamically-allocated resources.
   void clear(); ///< Clears all sounds from buffers.
   void parseXML(const char* filename); ///< Loads all sound files in an XML
@@ -98,6 +99,8 @@ public:
   void setDistance(int index, int instance, float minDistance, float maxDistance); ///< Sets the minimum and maximum distance for a sound
   void setVolume(int index, float volume); ///< Sets the volume for an individual sound
 
+  bool isSilent() const { return m_bSilent; } ///< Returns true if initialized with initSilent().
+
   static const int NOINSTANCE = -1; ///< Indicates an invalid or nonexistent sound instance
 
 private:
@@ -127,10 +130,12 @@ private:
   
   BOOL m_bOperational; ///< TRUE if DirectSound initialized correctly.
   bool isInit; ///< Holds true iff the sound manager has been initialized.
+  bool m_bSilent; ///< True if there is no DirectSound, and sounds never play.
 
   BOOL createBuffers(int index, SoundManager::SoundBuffer &sound); ///< Create a sound buffer.
   BOOL loadBuffers(int index, SoundManager::SoundBuffer &sound);///< Load a sound buffer.
   int loadSound(std::string filename, SoundManager::SoundBuffer &sound); ///< Load a sound from file.
+  BOOL getStatus(int index, int instance, DWORD &status); ///< Get the status of an instance.
 };
 
 extern SoundManager gSoundManager;
\ No newline at end of file
@@ -31,11 +31,11 @@
 /// \brief Code for the HeightMap class.
 
 #include <math.h>
-#include "heightmap.h"
-#include "common/random.h"
-#include "directorymanager/directorymanager.h"
-#include "common/bitmap.h"
-#include "common/commonstuff.h"
+#include "HeightMap.h"
+#include "Common/Random.h"
+#include "DirectoryManager/DirectoryManager.h"
+#include "Common/Bitmap.h"
+#include "Common/CommonStuff.h"
 
 extern CRandom Random; // Extern the random number generator
 
@@ -31,12 +31,12 @@
 /// \brief Code for the Terrain class.
 
 #include <math.h>
-#include "terrain.h"
-#include "terrainsubmesh.h"
-#include "common/commonstuff.h"
-#include "common/random.h"
-#include "tinyxml/tinyxml.h"
-#include "directorymanager/directorymanager.h"
+#include "Terrain.h"
+#include "TerrainSubmesh.h"
+#include "Common/CommonStuff.h"
+#include "Common/Random.h"
+#include "TinyXML/tinyxml.h"
+#include "DirectoryManager/DirectoryManager.h"
 #include <list>
 
 extern CRandom Random; // random number generator
@@ -124,6 +124,11 @@ m_textureStretch(new float[m_texturesSupported])
   for(int i=0; i<m_nSubmeshRatio; i++)
     m_pSubmeshLODLevel[i] = new int[m_nSubmeshRatio];
 
+  //create submesh culling array
+  m_pSubmeshCullPlane = new int[nNumSubmeshes];
+  for(int i=0; i<nNumSubmeshes; i++)
+    m_pSubmeshCullPlane[i] = -1;
+
   //init submesh structures
   setSubMeshes(); //init submeshes - do this last
 
@@ -157,6 +162,7 @@ Terrain::~Terrain()
   for(int i=0; i<m_nSubmeshRatio; i++)
     delete [] m_pSubmeshLODLevel[i];
   delete [] m_pSubmeshLODLevel;
+  delete [] m_pSubmeshCullPlane;
 }
 
 /// Textures (including height map) specified in this XML are loaded from the
@@ -278,6 +284,13 @@ void Terrain::render()
   // if the global terrain LOD flag was changed
   setCurrentLOD(LOD);
 
+  // nothing to do if the camera can't see any of it, otherwise planes the
+  // whole terrain is inside of needn't be tested for each submesh
+  unsigned planeMask = Frustum::kAllPlanes;
+  if(gRenderer.getFrustumCulling() &&
+    !gRenderer.getFrustum().isBoxVisible(m_boundingBox, &planeMask))
+    return;
+
   for (int a = 0; a < m_nNumberTextures; a++)
     gRenderer.selectTexture(m_terrainTextureIndex[a],a); // Select the texture
 
@@ -325,6 +338,14 @@ void Terrain::render()
       unsigned int lodflag = m_pSubmeshLODLevel[i][j]; //precomputed lod flag
       //decode lodflag into lod
       int lod = (lodflag & LOD_DRAW) - 1; //lod is in last 2 bits
+      int k = i*m_nSubmeshRatio + j;
+
+      //skip submeshes outside the view frustum, unless LOD skips them anyway
+      unsigned mask = planeMask;
+      if(m_bDistanceLOD && !(lodflag & LOD_DRAW))
+        continue;
+      if(!gRenderer.isBoxVisible(m_pSubmesh[0][k]->getBoundingBox(), &mask, &m_pSubmeshCullPlane[k]))
+        continue;
       
       if(m_bDistanceLOD) //if doing distance based lod       
       {
@@ -445,7 +466,10 @@ void Terrain::setSubMeshes()
     for(int i=0; i<m_nSubmeshRatio; i++)
       for(int j=0; j<m_nSubmeshRatio; j++)
         m_pSubmesh[k][i*m_nSubmeshRatio+j]->setMesh(i,j,k,m_vertices);
-  
+
+  m_boundingBox.empty();
+  for(int i=0; i<m_nSubmeshRatio*m_nSubmeshRatio; i++)
+    m_boundingBox.add(m_pSubmesh[0][i]->getBoundingBox());
 }
 
 /// Allows the levels of detail for each submesh to be computed based on
@@ -589,7 +613,7 @@ bool Terrain::isPointWithinBounds(float x, float z)
 /// weight is 1 byte ranging from 0 to 255.
 /// \param outWeight2 Weights 5-8 are returned through this variable.  Each
 /// weight is 1 byte ranging from 0 to 255.
-void Terrain::calculateWeightsAtPoint(float height, DWORD& outWeight1, DWORD& outWeight2)
+void Terrain::calculateWeightsAtPoint(float height, unsigned& outWeight1, unsigned& outWeight2)
 {
 	float* textures = new float[m_texturesSupported];
   int* bTextures = new int[m_texturesSupported];
@@ -33,11 +33,11 @@
 #ifndef __TERRAIN_H_INCLUDED__
 #define __TERRAIN_H_INCLUDED__
 
-#include "common/renderer.h"
+#include "Common/Renderer.h"
 #include "HeightMap.h"
-#include "graphics/effect.h"
-#include "terrainsubmesh.h"
-#include "common/vector3.h"
+#include "Graphics/Effect.h"
+#include "TerrainSubmesh.h"
+#include "Common/vector3.h"
 #include "TerrainVertex.h"
 
 /// \class Terrain
@@ -127,6 +127,8 @@ private:
   int m_nCameraSubmeshRow; ///< Subgrid row for camera position
   int m_nCameraSubmeshCol; ///< Subgrid column for camera position
   int **m_pSubmeshLODLevel; ///< LOD level for each submesh
+  int *m_pSubmeshCullPlane; ///< Frustum plane that last culled each submesh
+  AABB3 m_boundingBox; ///< Box around the whole terrain
   Effect* m_effect; ///< Effect object allows for pixel/vertex shaders
 
     /// \name Texture Distortion
@@ -135,7 +137,7 @@ private:
   void clearTextureDistortion(); ///< Turns off texture distortion
   //@}
   /// \brief Calculates the blending weights of textures based on a height
-  void calculateWeightsAtPoint(float height, DWORD& outWeight1, DWORD& outWeight2);  
+  void calculateWeightsAtPoint(float height, unsigned& outWeight1, unsigned& outWeight2);  
   /// \brief Returns the row and column of the location (x, z)
   void getSubmeshIndex(float x, float z,int& row, int& col);  
   void initMeshVertices(); ///< Sets mesh vertices to a grid 
@@ -30,7 +30,7 @@
 /// \file TerrainSubmesh.cpp
 /// \brief Code for the TerrainSubmesh class.
 
-#include "terrainsubmesh.h"
+#include "TerrainSubmesh.h"
 
 /// Creates a vertex buffer, an index buffer, and an array of vertices.
 /// \param vertsPerSide Vertices per side
@@ -72,10 +72,14 @@ void TerrainSubmesh::setMesh(int row, int col, int lod, TerrainVertex *v)
 {   
   // copy vertices passed in into the m_vertices array
   int nTopLeft = row * m_nSide * m_nParentVerticesPerSide + col * m_nSide;
+  m_boundingBox.empty();
   for(int i=0; i<m_nVPS; i++)
     for(int j=0; j<m_nVPS; j++)
+    {
       m_vertices[i*m_nVPS + j] = 
         v[ nTopLeft + (i<<lod) * m_nParentVerticesPerSide + (j<<lod)];
+      m_boundingBox.add(m_vertices[i*m_nVPS + j].p);
+    }
     
   // make sure the vertex buffer gets refilled next render
   m_lastLodCrack = -1;
@@ -33,10 +33,11 @@
 #ifndef __TERRAINSUBMESH_H_INCLUDED__
 #define __TERRAINSUBMESH_H_INCLUDED__
 
-#include "graphics/VertexBuffer.h"
-#include "graphics/IndexBuffer.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/IndexBuffer.h"
 #include "Common/Renderer.h"
-#include "graphics/VertexTypes.h"
+#include "Common/AABB3.h"
+#include "Graphics/VertexTypes.h"
 #include "TerrainVertex.h"
 
 const unsigned int LOD0 = 0x01;
@@ -65,6 +66,10 @@ public:
   /// \brief Renders the submesh
   void render(unsigned int lodcrack = 0);
 
+  /// \brief Gets the bounding box of the submesh
+  /// \return The box around the submesh's vertices in world space
+  const AABB3 &getBoundingBox() const { return m_boundingBox; }
+
 private:
   int m_nSide; ///< Number of quads per side
   int m_nReducedSide; ///< Number of quads per side after lod
@@ -80,6 +85,7 @@ private:
   VertexBuffer<TerrainVertex> *m_vertexBuffer; ///<Holds all the vertices to be rendered
   TerrainVertex* m_vertices; ///< Vertices before cracks have been smoothed
   IndexBuffer *m_triangles; ///< Static index buffer used to render submesh
+  AABB3 m_boundingBox; ///< Box around the vertices, for frustum culling
   
 
 };
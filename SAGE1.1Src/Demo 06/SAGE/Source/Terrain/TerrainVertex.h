@@ -41,12 +41,12 @@ struct TerrainVertex
   Vector3 p;  
   Vector3 n;
 	
-  DWORD Weights1;
-  DWORD Weights2;	
+  unsigned Weights1;
+  unsigned Weights2;	
 
   float u,v;	
 
-  static const DWORD FVF = D3DFVF_XYZ |D3DFVF_TEX1|D3DFVF_NORMAL |D3DFVF_DIFFUSE|D3DFVF_SPECULAR;
+  static const unsigned FVF = kVertexFormatXYZ | kVertexFormatTex1 | kVertexFormatNormal | kVertexFormatDiffuse | kVertexFormatSpecular;
 };
 
 #endif
\ No newline at end of file
@@ -36,6 +36,7 @@ distribution.
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include "Common/Portable.h"
 
 // Help out windows:
 #if defined( _DEBUG ) && !defined( DEBUG )
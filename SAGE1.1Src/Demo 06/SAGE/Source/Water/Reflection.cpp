@@ -30,8 +30,8 @@
 /// \file Reflection.cpp
 /// \brief Code for the Reflection class.
 
-#include "reflection.h"
-#include "common/renderer.h"
+#include "Reflection.h"
+#include "Common/Renderer.h"
 
 /// Creates a render target texture of the specified size
 /// \param width Width of the render target texture
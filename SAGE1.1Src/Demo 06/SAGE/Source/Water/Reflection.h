@@ -33,9 +33,9 @@
 #ifndef H_REFLECTION_H
 #define H_REFLECTION_H
 
-#include "common/eulerangles.h"
-#include "common/vector3.h"
-#include "common/plane.h"
+#include "Common/EulerAngles.h"
+#include "Common/vector3.h"
+#include "Common/plane.h"
 
 //-----------------------------------------------------------------------------
 /// \brief Controls rendering planar reflections.
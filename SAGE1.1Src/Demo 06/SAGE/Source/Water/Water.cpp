@@ -31,8 +31,8 @@
 /// \brief Code for the Water class.
 
 #include "Water.h"
-#include "directorymanager/directorymanager.h"
-#include "tinyxml/tinyxml.h"
+#include "DirectoryManager/DirectoryManager.h"
+#include "TinyXML/tinyxml.h"
 
 bool Water::m_bReflection = true;
 
@@ -33,12 +33,12 @@
 #ifndef __WATER_H_INCLUDED__
 #define __WATER_H_INCLUDED__
 
-#include "graphics/vertexbuffer.h"
-#include "graphics/vertextypes.h"
-#include "graphics/indexbuffer.h"
-#include "graphics/effect.h"
-#include "water/reflection.h"
-#include "common/vector2.h"
+#include "Graphics/VertexBuffer.h"
+#include "Graphics/VertexTypes.h"
+#include "Graphics/IndexBuffer.h"
+#include "Graphics/Effect.h"
+#include "Water/Reflection.h"
+#include "Common/vector2.h"
 
 /// \brief Custom vertex for rendering the water.
 //
@@ -47,7 +47,7 @@
 struct RenderVertexWater
 {
 	Vector3 p; // vertex position
-  static const DWORD FVF = D3DFVF_XYZ;
+  static const unsigned FVF = kVertexFormatXYZ;
 };
 
 /// Specifies what shape the water mesh will be.  A wedge is good for
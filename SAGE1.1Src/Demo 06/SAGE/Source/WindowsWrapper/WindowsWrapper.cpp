@@ -34,13 +34,16 @@
 #include <assert.h>
 
 #include "WindowsWrapper.h"
-#include "common/Renderer.h"
+#include "Common/Renderer.h"
+#include "Graphics/D3D9RenderBackend.h"
+#include "Graphics/NullRenderBackend.h"
 #include "Resource/ResourceManager.h"
-#include "particle/ParticleEngine.h"
-#include "input/Input.h"
+#include "Particle/ParticleEngine.h"
+#include "Input/Input.h"
 #include "Console/Console.h"
-#include "directorymanager/directorymanager.h"
+#include "DirectoryManager/DirectoryManager.h"
 #include "Sound/SoundManager.h"
+#include "Common/JobSystem.h"
 
 /// \brief WindowsWrapper global instance.
 //
@@ -77,6 +80,7 @@ void WindowsWrapper::Shutdown()
   gInput.shutdown();
   gConsole.shutdown();	
   gRenderer.shutdown();
+  gJobSystem.shutdown();
 
   destroyAppWindow();
 
@@ -99,6 +103,8 @@ void WindowsWrapper::Initiate(bool shaderDebugging, const char* loadingTexture)
 
 	gDirectoryManager.initiate(directory,"directories.xml");
 
+  gJobSystem.initiate();
+
 	createAppWindow("Ned 3D");
   
 	// Create the main application window
@@ -117,7 +123,7 @@ void WindowsWrapper::Initiate(bool shaderDebugging, const char* loadingTexture)
     "Full screen or windowed",MB_ICONQUESTION|MB_YESNO)==IDNO;
 
   //set last param to true for windowed mode
-	gRenderer.init(mode, shaderDebugging, bWindowed); 
+	gRenderer.init(new D3D9RenderBackend(shaderDebugging, bWindowed), mode); 
 
   // load loading texture if one is specified
   // then display it
@@ -147,6 +153,38 @@ void WindowsWrapper::Initiate(bool shaderDebugging, const char* loadingTexture)
 	return;
 }
 
+/// WindowsWrapper InitiateHeadless
+/// Initiates the engine objects the way Initiate does, but with no window,
+/// no graphics device, no sound device and no questions asked.  The
+/// renderer runs at a fixed 60 frames per second of game time, and the
+/// particles get the same random numbers every run.
+/// \param inputScript Name of a file of scripted key presses, see
+/// Input::initiateScripted.  NULL for no input at all.
+void WindowsWrapper::InitiateHeadless(const char* inputScript)
+{
+  char directory[2048];
+  GetCurrentDirectory(2048, directory);
+
+  gDirectoryManager.initiate(directory,"directories.xml");
+
+  gJobSystem.initiate();
+
+  VideoMode mode;
+  mode.xRes = 1024;
+  mode.yRes = 768;
+  mode.bitsPerPixel = 24;
+  mode.refreshHz = kRefreshRateDefault;
+
+  gRenderer.init(new NullRenderBackend(1.0f / 60.0f), mode);
+
+  gConsole.initiate();
+  gInput.initiateScripted(inputScript);
+  gParticle.init("particle.xml");
+  gParticle.setRandomSeed(0);
+  gDirectoryManager.setDirectory(eDirectoryXML);
+  gSoundManager.initSilent();
+}
+
 /// WindowsWrapper RunProgram.
 /// Calls Initiate on the game.  Repetitively calls main on the game until
 /// quitFlag is true.  Calls Shutdown on the game when finished.
@@ -459,3 +497,34 @@ void WindowsWrapper::WinMainWrap(HINSTANCE hInstance, GameBase* pGame, const cha
   return;
 }
 
+/// WindowsWrapper HeadlessWrap
+/// Runs the game for a fixed number of frames without a window, for servers
+/// and automated tests.  Drawing calls are counted rather than drawn (see
+/// Renderer::getCallTotal), sounds are silent, and input comes from a
+/// script, so a run with the same script plays out the same way every time.
+/// \param pGame Pointer to an object derived from GameBase.
+/// \param frames Number of frames to run, fewer if the game quits first.
+/// \param inputScript Name of a file of scripted key presses, see
+/// Input::initiateScripted.  NULL for no input at all.
+void WindowsWrapper::HeadlessWrap(GameBase* pGame, int frames, const char* inputScript)
+{
+  m_pGame = pGame;
+  gGameBase = pGame;
+  hInstApp = NULL;
+
+  InitiateHeadless(inputScript);
+
+  if (m_pGame != NULL && m_pGame->initiate())
+  {
+    for(int i = 0; i < 2; ++i)
+      gRenderer.flipPages();
+
+    for(int frame = 0; frame < frames && !quitFlag; ++frame)
+      if (m_pGame->main() == false) break;
+
+    m_pGame->shutdown();
+  }
+
+  Shutdown();
+}
+
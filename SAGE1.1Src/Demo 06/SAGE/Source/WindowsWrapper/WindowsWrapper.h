@@ -88,6 +88,7 @@ public:
   bool isQuiting() {return quitFlag;} ///< Returns true if application is about to quit
 
   void WinMainWrap(HINSTANCE hInstance, GameBase* pGame, const char* loadingTexture, bool shaderDebugging = false); ///< Runs the entire program, This should be called from the global winmain function
+  void HeadlessWrap(GameBase* pGame, int frames, const char* inputScript = NULL); ///< Runs the program for a number of frames with no window, graphics or sound
   static LRESULT CALLBACK WindowProc(HWND hWnd,UINT message,WPARAM wParam,LPARAM lParam); ///< Callback method used to process windows messages
 
   void	idle(); ///< Perform per-frame tasks such as windows message processing.
@@ -109,6 +110,7 @@ private:
   GameBase* m_pGame; ///< Saves a pointer to the object derived from GameBase that was passed into WinMainWrap.
 
   void Initiate(bool shaderDebugging, const char* loadingTexture); ///< Creates the window and initiates the game engine
+  void InitiateHeadless(const char* inputScript); ///< Initiates the game engine with no window
   void RunProgram(); ///< Runs the game by interfaces the Game object passed into winmain	
   void Shutdown(); ///< Shutdown the window	
   void createAppWindow(const char *title); ///< Create the main application window
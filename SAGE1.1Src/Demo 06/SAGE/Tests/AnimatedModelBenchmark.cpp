@@ -0,0 +1,139 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// AnimatedModelBenchmark.cpp - Times interpolating the crow's frames
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file AnimatedModelBenchmark.cpp
+/// \brief Loads the crow from the game's models, and prints how long
+/// interpolating its key frames takes a vertex, compressed and not.
+///
+/// Usage: AnimatedModelBenchmark [passes].  Each pass steps through every
+/// frame of the animation a tenth of a frame at a time, on the null
+/// backend, and the best of five tries is taken.  The compressed frames are
+/// also checked against the full ones, and must be no slower than them, give
+/// or take kTimingSlack for the clock.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+#include <string>
+#include "Common/Portable.h"
+#include "Common/Renderer.h"
+#include "Common/TriMesh.h"
+#include "DerivedModels/AnimatedModel.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Graphics/VertexBuffer.h"
+#include "Check.h"
+
+/// Number of key frames in the crow
+static const int kFrameCount = 5;
+
+/// How much slower than the full frames the compressed ones may time, for
+/// noise in the clock
+static const double kTimingSlack = 1.1;
+
+/// \brief Loads the crow, compressed or not
+static AnimatedModel *loadCrow(bool compressed)
+{
+  std::string names[kFrameCount];
+  std::list<const char *> frames;
+  for(int i = 0; i < kFrameCount; i++)
+  {
+    char name[16];
+    sprintf(name, "/crow%02d.s3d", i);
+    names[i] = std::string(MODEL_DIR) + name;
+    frames.push_back(names[i].c_str());
+  }
+
+  AnimatedModel::m_bCompressFrames = compressed;
+  AnimatedModel *model = new AnimatedModel(kFrameCount);
+  model->importS3d(frames, false);
+  return model;
+}
+
+/// \brief Counts the vertices in a model's parts
+static int countVertices(AnimatedModel *model)
+{
+  int count = 0;
+  for(int i = 0; i < model->getPartCount(); i++)
+    count += model->getPartMesh(i)->getVertexCount();
+  return count;
+}
+
+/// \brief Times interpolating every frame of the model's animation.
+/// \return Nanoseconds a vertex, the best of five tries
+static double time(AnimatedModel *model, StandardVertexBuffer &vb, int passes)
+{
+  double best = 1.0e30;
+  for(int t = 0; t < 5; t++)
+  {
+    double start = getClockSeconds();
+    for(int pass = 0; pass < passes; pass++)
+      for(int step = 0; step < kFrameCount * 10; step++)
+        model->selectAnimationFrame(step * 0.1f, 0, vb);
+    double seconds = getClockSeconds() - start;
+    if(seconds < best)
+      best = seconds;
+  }
+  return best * 1.0e9 / ((double)passes * kFrameCount * 10 * countVertices(model));
+}
+
+/// \brief Checks a frame of the compressed model against the same frame of
+/// the full one.  Positions and normals must be within the quantization
+/// error, and texture coordinates the same.
+static bool sameFrame(AnimatedModel *full, AnimatedModel *compressed,
+  StandardVertexBuffer &fullVb, StandardVertexBuffer &compressedVb, float frame, int count)
+{
+  full->selectAnimationFrame(frame, 0, fullVb);
+  compressed->selectAnimationFrame(frame, 0, compressedVb);
+
+  bool ok = true;
+  fullVb.lock();
+  compressedVb.lock();
+  for(int i = 0; i < count; i++)
+  {
+    const RenderVertex &a = fullVb[i];
+    const RenderVertex &b = compressedVb[i];
+    ok = ok && (a.p - b.p).magnitude() < 1.0e-3f && (a.n - b.n).magnitude() < 1.0e-4f &&
+      a.u == b.u && a.v == b.v;
+  }
+  compressedVb.unlock();
+  fullVb.unlock();
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  int passes = argc > 1 ? atoi(argv[1]) : 2000;
+
+  VideoMode mode = { 640, 480, 32, 60 };
+  gRenderer.init(new NullRenderBackend(1.0f / 60.0f), mode);
+
+  // don't leave compiled models in the source tree
+  Model::m_bUseCompiledCache = false;
+
+  AnimatedModel *full = loadCrow(false);
+  AnimatedModel *compressed = loadCrow(true);
+  StandardVertexBuffer *vb = compressed->getNewVertexBuffer();
+  StandardVertexBuffer *fullVb = full->getNewVertexBuffer();
+
+  int count = countVertices(compressed);
+  printf("crow, %d vertices, %d passes, best of 5\n\n", count, passes);
+  printf("%-12s %12s\n", "frames", "ns/vertex");
+  double fullTime = time(full, *vb, passes);
+  double compressedTime = time(compressed, *vb, passes);
+  printf("%-12s %12.2f\n", "full", fullTime);
+  printf("%-12s %12.2f\n", "compressed", compressedTime);
+  CHECK(compressedTime <= fullTime * kTimingSlack);
+
+  for(int step = 0; step < kFrameCount * 4; step++)
+    CHECK(sameFrame(full, compressed, *fullVb, *vb, step * 0.25f, count));
+
+  delete fullVb;
+  delete vb;
+  delete compressed;
+  delete full;
+  gRenderer.shutdown();
+  return checkResult();
+}
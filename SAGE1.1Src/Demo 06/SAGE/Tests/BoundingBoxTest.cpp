@@ -0,0 +1,210 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// BoundingBoxTest.cpp - Checks the bounds kept with meshes and objects
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file BoundingBoxTest.cpp
+/// \brief Loads some of the game's models and checks that the box each
+/// part gives under a transform, from its hull or its local box, holds
+/// every transformed vertex, and that the hull's box is as tight as the
+/// vertices'.  Then checks that a GameObject only recomputes its box when
+/// it has moved or been told to.
+
+#include <math.h>
+#include <stdio.h>
+#include "Common/AABB3.h"
+#include "Common/EditTriMesh.h"
+#include "Common/EulerAngles.h"
+#include "Common/MathUtil.h"
+#include "Common/Matrix4x3.h"
+#include "Common/Model.h"
+#include "Common/Random.h"
+#include "Common/Renderer.h"
+#include "Common/TriMesh.h"
+#include "Objects/GameObject.h"
+#include "Check.h"
+
+/// Models to check, from the game's model directory
+static const char *kModels[] =
+{
+  "plane2.1.s3d", "crow00.s3d", "cylo1.s3d", "windmill.s3d",
+};
+
+/// Number of random transforms to try each part under
+static const int kTransforms = 50;
+
+static CRandom gRandom; ///< Source of the transforms
+
+/// \brief Makes a random rotation and translation with some scale
+static Matrix4x3 randomMatrix()
+{
+  Matrix4x3 r, s;
+  r.setupLocalToParent(Vector3(gRandom.getFloat(-1000.0f, 1000.0f),
+    gRandom.getFloat(-1000.0f, 1000.0f), gRandom.getFloat(-1000.0f, 1000.0f)),
+    EulerAngles(gRandom.getFloat(-3.0f, 3.0f), gRandom.getFloat(-1.5f, 1.5f),
+    gRandom.getFloat(-3.0f, 3.0f)));
+  s.setupScale(Vector3(gRandom.getFloat(0.5f, 2.0f), gRandom.getFloat(0.5f, 2.0f),
+    gRandom.getFloat(0.5f, 2.0f)));
+  return s * r;
+}
+
+/// \brief Tests two boxes for being the same to within a little of their
+/// size.  The hull is built with some slop, so a vertex a hair outside it
+/// isn't one of its corners.
+static bool sameBox(const AABB3 &a, const AABB3 &b)
+{
+  float tolerance = 1.0e-5f * (a.size().x + a.size().y + a.size().z + 1.0f);
+  return fabsf(a.min.x - b.min.x) <= tolerance && fabsf(a.max.x - b.max.x) <= tolerance &&
+    fabsf(a.min.y - b.min.y) <= tolerance && fabsf(a.max.y - b.max.y) <= tolerance &&
+    fabsf(a.min.z - b.min.z) <= tolerance && fabsf(a.max.z - b.max.z) <= tolerance;
+}
+
+/// \brief Tests whether a box holds another
+static bool holds(const AABB3 &outer, const AABB3 &inner)
+{
+  return outer.contains(inner.min) && outer.contains(inner.max);
+}
+
+/// \brief Checks a mesh's box under random transforms against the box of
+/// its transformed vertices, which it must hold
+/// \param exact Whether the box must also be as tight as the vertices',
+/// which it is when it comes from the hull
+static void checkMesh(const TriMesh &mesh, bool exact)
+{
+  bool ok = true;
+  for(int t = 0; t < kTransforms; t++)
+  {
+    Matrix4x3 m = randomMatrix();
+    AABB3 vertices;
+    vertices.empty();
+    for(int i = 0; i < mesh.getVertexCount(); i++)
+      vertices.add(mesh.getVertexList()[i].p * m);
+
+    AABB3 box = mesh.getBoundingBox(m);
+    ok = ok && holds(box, vertices) && (!exact || sameBox(box, vertices));
+  }
+  CHECK(ok);
+}
+
+/// \brief Makes a ball with every vertex on its hull, too many to keep
+static void makeBall(TriMesh &mesh)
+{
+  const int rings = 12, segments = 16;
+  EditTriMesh edit;
+  edit.setPartCount(1);
+  edit.setMaterialCount(1);
+  edit.setVertexCount(rings * segments);
+  for(int r = 0; r < rings; r++)
+    for(int s = 0; s < segments; s++)
+    {
+      float pitch = kPi * (r + 0.5f) / rings - kPiOver2;
+      float heading = k2Pi * s / segments;
+      edit.vertex(r * segments + s).p = Vector3(cosf(pitch) * sinf(heading),
+        sinf(pitch), cosf(pitch) * cosf(heading)) * 10.0f;
+    }
+  edit.setTriCount((rings - 1) * segments * 2);
+  for(int r = 0; r < rings - 1; r++)
+    for(int s = 0; s < segments; s++)
+    {
+      int a = r * segments + s, b = r * segments + (s + 1) % segments;
+      EditTriMesh::Tri &t0 = edit.tri((r * segments + s) * 2);
+      EditTriMesh::Tri &t1 = edit.tri((r * segments + s) * 2 + 1);
+      t0.v[0].index = a;
+      t0.v[1].index = b;
+      t0.v[2].index = a + segments;
+      t1.v[0].index = b;
+      t1.v[1].index = b + segments;
+      t1.v[2].index = a + segments;
+    }
+  mesh.fromEditMesh(edit);
+}
+
+/// \brief Checks that an object's box is only recomputed when it should be.
+/// Moving the model's vertices behind the object's back shows whether it
+/// was.
+static void checkDirtyFlag()
+{
+  char filename[256];
+  sprintf(filename, "%s/plane2.1.s3d", MODEL_DIR);
+  Model model(Model::NoBuffers);
+  model.importS3d(filename, false);
+
+  GameObject object(&model);
+  object.setPosition(Vector3(100.0f, 20.0f, -50.0f));
+  object.computeBoundingBox();
+  AABB3 before = object.getBoundingBox();
+
+  Vector3 shift(0.0f, 5.0f, 0.0f);
+  for(int i = 0; i < model.getPartCount(); i++)
+    model.getPartMesh(i)->moveVertices(shift);
+
+  // it hasn't moved, so the old box stays
+
+  object.computeBoundingBox();
+  CHECK(sameBox(object.getBoundingBox(), before));
+
+  // told to, it sees the moved vertices
+
+  object.invalidateBoundingBox();
+  object.computeBoundingBox();
+  AABB3 moved = before;
+  moved.min += shift;
+  moved.max += shift;
+  CHECK(sameBox(object.getBoundingBox(), moved));
+
+  // moving it, turning it or turning its model all recompute it
+
+  object.setPosition(Vector3(0.0f, 0.0f, 0.0f));
+  object.computeBoundingBox();
+  CHECK(sameBox(object.getBoundingBox(), model.getBoundingBox()));
+
+  EulerAngles turn(kPiOver2, 0.0f, 0.0f);
+  Matrix4x3 m;
+  m.setupLocalToParent(Vector3::kZeroVector, turn);
+  object.setOrientation(turn);
+  object.computeBoundingBox();
+  CHECK(sameBox(object.getBoundingBox(), model.getBoundingBox(m)));
+
+  object.setOrientation(EulerAngles::kEulerAnglesIdentity);
+  object.setModelOrientation(turn);
+  object.computeBoundingBox();
+  CHECK(sameBox(object.getBoundingBox(), model.getBoundingBox(m)));
+}
+
+int main()
+{
+  gRandom.seed(1);
+
+  // don't leave compiled models in the source tree
+  Model::m_bUseCompiledCache = false;
+
+  for(int i = 0; i < (int)(sizeof(kModels) / sizeof(kModels[0])); i++)
+  {
+    char filename[256];
+    sprintf(filename, "%s/%s", MODEL_DIR, kModels[i]);
+    Model model(Model::NoBuffers);
+    model.importS3d(filename, false);
+    CHECK(model.isValid());
+    int hulls = 0;
+    for(int p = 0; p < model.getPartCount(); p++)
+    {
+      const TriMesh &mesh = *model.getPartMesh(p);
+      checkMesh(mesh, mesh.getHullCount() > 0);
+      if(mesh.getHullCount() > 0)
+        hulls++;
+    }
+    printf("%-14s %3d parts, %3d with hulls\n", kModels[i], model.getPartCount(), hulls);
+  }
+
+  // too many hull points, so the box comes from the local box
+
+  TriMesh ball;
+  makeBall(ball);
+  CHECK(ball.getHullCount() == 0);
+  checkMesh(ball, false);
+
+  checkDirtyFlag();
+
+  return checkResult();
+}
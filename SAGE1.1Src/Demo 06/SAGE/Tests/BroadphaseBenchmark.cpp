@@ -0,0 +1,237 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// BroadphaseBenchmark.cpp - Times and checks the broadphases
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file BroadphaseBenchmark.cpp
+/// \brief Moves boxes about in each kind of broadphase, printing how long
+/// finding the pairs takes and checking that all three find the same ones.
+///
+/// Usage: BroadphaseBenchmark [objects [frames]].  The boxes are scattered
+/// through a cube and drift a little each frame, the way objects in the game
+/// do, with a few big ones among them.  Each frame the pairs every kind of
+/// broadphase finds are checked against the brute force ones, and some
+/// segments are checked to list every box they hit.  Boxes that are huge or
+/// have a NaN in them are put in at the end, to see that nothing breaks.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "Common/Portable.h"
+#include "Common/Random.h"
+#include "Objects/Broadphase.h"
+#include "Check.h"
+
+/// Size of the cube the boxes are in
+static const float kWorldSize = 1000.0f;
+
+/// Size of a typical box, and of a hash grid cell
+static const float kBoxSize = 10.0f;
+
+/// Segments checked each frame
+static const int kRaysPerFrame = 4;
+
+/// \brief Orders a pair's objects by address, so that pairs can be compared
+static Broadphase::Pair normalize(Broadphase::Pair pair)
+{
+  if(pair.second < pair.first)
+    std::swap(pair.first, pair.second);
+  return pair;
+}
+
+/// \brief Orders pairs by the addresses of their objects
+static bool lessPair(const Broadphase::Pair &a, const Broadphase::Pair &b)
+{
+  if(a.first != b.first)
+    return a.first < b.first;
+  return a.second < b.second;
+}
+
+/// \brief Tests two pairs for the same objects
+static bool equalPair(const Broadphase::Pair &a, const Broadphase::Pair &b)
+{
+  return a.first == b.first && a.second == b.second;
+}
+
+/// \brief Finds the pairs, normalized and sorted, timing it.
+/// \param seconds The time taken is added to this
+static Broadphase::PairList findPairs(Broadphase &broadphase, double &seconds)
+{
+  Broadphase::PairList pairs;
+  double start = getClockSeconds();
+  broadphase.findPairs(pairs);
+  seconds += getClockSeconds() - start;
+
+  for(int i = 0; i < (int)pairs.size(); i++)
+    pairs[i] = normalize(pairs[i]);
+  std::sort(pairs.begin(), pairs.end(), lessPair);
+  return pairs;
+}
+
+/// \brief Checks a broadphase found the brute force pairs, each once
+static bool samePairs(const Broadphase::PairList &pairs, const Broadphase::PairList &expected)
+{
+  if(pairs.size() != expected.size())
+    return false;
+  for(int i = 0; i < (int)pairs.size(); i++)
+    if(!equalPair(pairs[i], expected[i]))
+      return false;
+  return true;
+}
+
+/// \brief Checks a segment lists every object whose box it hits, once each
+static bool rayFindsHits(Broadphase &broadphase, const std::vector<AABB3> &boxes,
+  GameObject **objects, const Vector3 &origin, const Vector3 &delta)
+{
+  Broadphase::ObjectList found;
+  broadphase.findObjectsOnRay(origin, delta, found);
+  std::sort(found.begin(), found.end());
+  if(std::adjacent_find(found.begin(), found.end()) != found.end())
+    return false;
+
+  for(int i = 0; i < (int)boxes.size(); i++)
+    if(boxes[i].rayIntersect(origin, delta) <= 1.0f &&
+      !std::binary_search(found.begin(), found.end(), objects[i]))
+      return false;
+  return true;
+}
+
+/// \brief Makes a box of about the typical size somewhere in the world
+static AABB3 randomBox(CRandom &random)
+{
+  // one in fifty is big, covering lots of cells
+  float size = random.getInt(0, 50) == 0 ? kBoxSize * 20.0f : kBoxSize;
+  Vector3 min(random.getFloat(0.0f, kWorldSize), random.getFloat(0.0f, kWorldSize),
+    random.getFloat(0.0f, kWorldSize));
+  AABB3 box;
+  box.min = min;
+  box.max = min + Vector3(random.getFloat(0.5f, 1.0f), random.getFloat(0.5f, 1.0f),
+    random.getFloat(0.5f, 1.0f)) * size;
+  return box;
+}
+
+int main(int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi(argv[1]) : 5000;
+  int frames = argc > 2 ? atoi(argv[2]) : 100;
+
+  CRandom random;
+  random.seed(1);
+
+  // the broadphases only keep the pointers, so any distinct addresses will do
+  std::vector<char> storage(count + 2);
+  std::vector<GameObject *> objects(count + 2);
+  for(int i = 0; i < count + 2; i++)
+    objects[i] = (GameObject *)&storage[i];
+
+  Broadphase bruteForce;
+  HashGridBroadphase hashGrid(kBoxSize);
+  SweepAndPruneBroadphase sweepAndPrune;
+  Broadphase *broadphases[3] = { &bruteForce, &hashGrid, &sweepAndPrune };
+  const char *names[3] = { "brute force", "hash grid", "sweep and prune" };
+  double seconds[3] = { 0.0, 0.0, 0.0 };
+
+  std::vector<AABB3> boxes(count);
+  std::vector<Vector3> velocities(count);
+  std::vector<int> proxies[3];
+  for(int i = 0; i < count; i++)
+  {
+    boxes[i] = randomBox(random);
+    velocities[i] = Vector3(random.getFloat(-1.0f, 1.0f), random.getFloat(-1.0f, 1.0f),
+      random.getFloat(-1.0f, 1.0f));
+    for(int b = 0; b < 3; b++)
+      proxies[b].push_back(broadphases[b]->addProxy(objects[i], boxes[i]));
+  }
+
+  double pairCount = 0.0;
+  bool pairsMatch[3] = { true, true, true };
+  bool raysMatch[3] = { true, true, true };
+  for(int frame = 0; frame < frames; frame++)
+  {
+    for(int i = 0; i < count; i++)
+    {
+      boxes[i].min += velocities[i];
+      boxes[i].max += velocities[i];
+      for(int b = 0; b < 3; b++)
+        broadphases[b]->moveProxy(proxies[b][i], boxes[i]);
+    }
+
+    // now and then an object dies and another takes its place
+    int replaced = random.getInt(0, count);
+    boxes[replaced] = randomBox(random);
+    for(int b = 0; b < 3; b++)
+    {
+      broadphases[b]->removeProxy(proxies[b][replaced]);
+      proxies[b][replaced] = broadphases[b]->addProxy(objects[replaced], boxes[replaced]);
+    }
+
+    Broadphase::PairList expected = findPairs(bruteForce, seconds[0]);
+    pairCount += (double)expected.size();
+    for(int b = 1; b < 3; b++)
+      if(!samePairs(findPairs(*broadphases[b], seconds[b]), expected))
+        pairsMatch[b] = false;
+
+    for(int r = 0; r < kRaysPerFrame; r++)
+    {
+      Vector3 origin(random.getFloat(0.0f, kWorldSize), random.getFloat(0.0f, kWorldSize),
+        random.getFloat(0.0f, kWorldSize));
+      Vector3 delta(random.getFloat(-200.0f, 200.0f), random.getFloat(-200.0f, 200.0f),
+        random.getFloat(-200.0f, 200.0f));
+      for(int b = 1; b < 3; b++)
+        if(!rayFindsHits(*broadphases[b], boxes, &objects[0], origin, delta))
+          raysMatch[b] = false;
+    }
+  }
+
+  printf("%d objects, %d frames, %.0f pairs a frame\n\n", count, frames, pairCount / frames);
+  printf("%-16s %12s %10s\n", "broadphase", "ms/frame", "speedup");
+  for(int b = 0; b < 3; b++)
+    printf("%-16s %12.3f %10.1f\n", names[b], seconds[b] * 1000.0 / frames,
+      seconds[0] / seconds[b]);
+
+  CHECK(pairsMatch[1]);
+  CHECK(pairsMatch[2]);
+  CHECK(raysMatch[1]);
+  CHECK(raysMatch[2]);
+
+  // a huge box touches everything, which the others must still agree on
+  AABB3 huge;
+  huge.min = Vector3(-1.0e30f, -1.0e30f, -1.0e30f);
+  huge.max = Vector3(1.0e30f, 1.0e30f, 1.0e30f);
+  for(int b = 0; b < 3; b++)
+    broadphases[b]->addProxy(objects[count], huge);
+  Broadphase::PairList expected = findPairs(bruteForce, seconds[0]);
+  CHECK((int)expected.size() >= count);
+  for(int b = 1; b < 3; b++)
+    CHECK(samePairs(findPairs(*broadphases[b], seconds[b]), expected));
+
+  // a NaN box and endless or NaN segments only have to not break anything
+  const float nan = sqrtf(-1.0f);
+  AABB3 broken;
+  broken.min = Vector3(nan, 0.0f, 0.0f);
+  broken.max = Vector3(1.0f, nan, 1.0f);
+  for(int b = 0; b < 3; b++)
+  {
+    int proxy = broadphases[b]->addProxy(objects[count + 1], broken);
+    broadphases[b]->moveProxy(proxy, huge);
+    broadphases[b]->moveProxy(proxy, broken);
+    Broadphase::PairList pairs;
+    broadphases[b]->findPairs(pairs);
+
+    Broadphase::ObjectList found;
+    broadphases[b]->findObjectsOnRay(Vector3(0.0f, 0.0f, 0.0f),
+      Vector3(1.0e30f, 1.0e30f, 1.0e30f), found);
+    CHECK(std::find(found.begin(), found.end(), objects[count]) != found.end());
+    found.clear();
+    broadphases[b]->findObjectsOnRay(Vector3(1.0e20f, 0.0f, 0.0f),
+      Vector3(1.0f, 0.0f, 0.0f), found);
+    found.clear();
+    broadphases[b]->findObjectsOnRay(Vector3(nan, 0.0f, 0.0f), Vector3(1.0f, nan, 0.0f), found);
+    broadphases[b]->removeProxy(proxy);
+  }
+
+  return checkResult();
+}
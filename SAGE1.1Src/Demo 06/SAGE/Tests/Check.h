@@ -0,0 +1,31 @@
+/// \file Check.h
+/// \brief A check macro for the engine tests.
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Check.h - A check macro for the engine tests
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CHECK_H_INCLUDED__
+#define __CHECK_H_INCLUDED__
+
+#include <stdio.h>
+
+/// Number of checks that have failed
+static int gChecksFailed = 0;
+
+/// \brief Checks a condition, printing it and where it is if it's false.
+/// The test keeps going, so one run shows every failure.
+#define CHECK(x) \
+  do { if(!(x)) { printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #x); gChecksFailed++; } } while(0)
+
+/// \brief What a test's main() returns: 0 if every check passed
+inline int checkResult()
+{
+  if(gChecksFailed > 0)
+    printf("%d checks failed\n", gChecksFailed);
+  return gChecksFailed > 0 ? 1 : 0;
+}
+
+#endif // #ifndef __CHECK_H_INCLUDED__
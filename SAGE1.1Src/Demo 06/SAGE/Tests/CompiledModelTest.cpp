@@ -0,0 +1,197 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// CompiledModelTest.cpp - Checks that bad compiled models are rebuilt
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file CompiledModelTest.cpp
+/// \brief Imports the plane from the game's models, so that a compiled
+/// model (.s3c) is written, then checks that changing the S3D, even in the
+/// same second, gets it rebuilt.  Then damages the compiled model in
+/// different ways and checks that each one is turned down, that importing
+/// the S3D again falls back to the source, and that it comes out the same
+/// as before with a good compiled model written over the bad one.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include "Common/Model.h"
+#include "Common/Renderer.h"
+#include "Common/TriMesh.h"
+#include "Check.h"
+
+/// Where the compiled model's version is, from the start of the file
+static const long kVersionOffset = 4;
+
+/// Where the time of the S3D the compiled model was built from is
+static const long kSourceTimeOffset = 36;
+
+/// Where the first part's triangle list offset is: after the 40 byte header
+/// and the part's texture name and vertex offset and count
+static const long kTriOffsetOffset = 40 + kMaxTextureNameChars + 8;
+
+/// \brief Copies a file
+/// \return true if it was copied
+static bool copyFile(const char *from, const char *to)
+{
+  FILE *in = fopen(from, "rb");
+  if(in == NULL)
+    return false;
+  FILE *out = fopen(to, "wb");
+  if(out == NULL)
+  {
+    fclose(in);
+    return false;
+  }
+  char buffer[4096];
+  size_t count;
+  while((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    fwrite(buffer, 1, count, out);
+  fclose(in);
+  return fclose(out) == 0;
+}
+
+/// \brief Reads an int from a file
+static int readInt(const char *filename, long offset)
+{
+  int value = 0;
+  FILE *f = fopen(filename, "rb");
+  if(f == NULL)
+    return 0;
+  fseek(f, offset, SEEK_SET);
+  fread(&value, sizeof(value), 1, f);
+  fclose(f);
+  return value;
+}
+
+/// \brief Gets a file's modification time
+static time_t getTime(const char *filename)
+{
+  struct stat s;
+  return stat(filename, &s) == 0 ? s.st_mtime : 0;
+}
+
+/// \brief Sets a file's modification time
+static void setTime(const char *filename, time_t time)
+{
+  struct utimbuf times = { time, time };
+  utime(filename, &times);
+}
+
+/// \brief Writes over some bytes of a file
+static void patchFile(const char *filename, long offset, const void *bytes, size_t count)
+{
+  FILE *f = fopen(filename, "r+b");
+  if(f == NULL)
+    return;
+  fseek(f, offset, SEEK_SET);
+  fwrite(bytes, 1, count, f);
+  fclose(f);
+}
+
+/// \brief Tests two models for the same parts, to the byte
+static bool sameModel(Model &a, Model &b)
+{
+  if(a.getPartCount() != b.getPartCount())
+    return false;
+  for(int i = 0; i < a.getPartCount(); i++)
+  {
+    const TriMesh *ma = a.getPartMesh(i);
+    const TriMesh *mb = b.getPartMesh(i);
+    if(ma->getVertexCount() != mb->getVertexCount() || ma->getTriCount() != mb->getTriCount() ||
+      memcmp(ma->getVertexList(), mb->getVertexList(), ma->getVertexCount() * sizeof(RenderVertex)) != 0 ||
+      memcmp(ma->getTriList(), mb->getTriList(), ma->getTriCount() * sizeof(RenderTri)) != 0 ||
+      strcmp(a.getPartTexture(i)->name, b.getPartTexture(i)->name) != 0)
+      return false;
+  }
+  return true;
+}
+
+/// \brief Checks that a damaged compiled model is turned down, and that
+/// importing the S3D rebuilds it
+/// \param original The model as imported from the S3D
+static void checkRebuilt(Model &original)
+{
+  Model rejected(Model::NoBuffers);
+  CHECK(!rejected.importCompiled("model.s3c"));
+
+  Model fallback(Model::NoBuffers);
+  fallback.importS3d("model.s3d", false);
+  CHECK(fallback.isValid());
+  CHECK(sameModel(fallback, original));
+
+  Model rebuilt(Model::NoBuffers);
+  CHECK(rebuilt.importCompiled("model.s3c"));
+  CHECK(sameModel(rebuilt, original));
+}
+
+int main()
+{
+  if(!copyFile(MODEL_DIR "/plane2.1.s3d", "model.s3d"))
+  {
+    printf("can't copy %s\n", MODEL_DIR "/plane2.1.s3d");
+    return 1;
+  }
+  remove("model.s3c");
+
+  // the first import writes the compiled model, which the second uses
+
+  Model original(Model::NoBuffers);
+  original.importS3d("model.s3d", false);
+  CHECK(original.isValid());
+
+  Model compiled(Model::NoBuffers);
+  CHECK(compiled.importCompiled("model.s3c"));
+  CHECK(sameModel(compiled, original));
+
+  // a different S3D saved in the same second the compiled model was
+  // written, which is no newer than it
+
+  Model::m_bUseCompiledCache = false;
+  Model silo(Model::NoBuffers);
+  silo.importS3d(MODEL_DIR "/cylo1.s3d", false);
+  Model::m_bUseCompiledCache = true;
+
+  time_t time = getTime("model.s3d");
+  copyFile(MODEL_DIR "/cylo1.s3d", "model.s3d");
+  setTime("model.s3d", time);
+  Model changed(Model::NoBuffers);
+  changed.importS3d("model.s3d", false);
+  CHECK(sameModel(changed, silo));
+
+  copyFile(MODEL_DIR "/plane2.1.s3d", "model.s3d");
+  setTime("model.s3d", time);
+  Model changedBack(Model::NoBuffers);
+  changedBack.importS3d("model.s3d", false);
+  CHECK(sameModel(changedBack, original));
+
+  // the same S3D touched, so it's rebuilt with the new time
+
+  setTime("model.s3d", time + 10);
+  Model touched(Model::NoBuffers);
+  touched.importS3d("model.s3d", false);
+  CHECK(sameModel(touched, original));
+  CHECK((unsigned)readInt("model.s3c", kSourceTimeOffset) == (unsigned)(time + 10));
+
+  // a triangle that uses a vertex past the end of its part
+
+  unsigned short badIndex = 0xFFFF;
+  patchFile("model.s3c", readInt("model.s3c", kTriOffsetOffset) + 2, &badIndex, sizeof(badIndex));
+  checkRebuilt(original);
+
+  // a file from another version
+
+  int version = readInt("model.s3c", kVersionOffset) + 1;
+  patchFile("model.s3c", kVersionOffset, &version, sizeof(version));
+  checkRebuilt(original);
+
+  // cut short
+
+  FILE *f = fopen("model.s3c", "wb");
+  fwrite("S3DC", 1, 4, f);
+  fclose(f);
+  checkRebuilt(original);
+
+  return checkResult();
+}
@@ -0,0 +1,206 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// EditTriMeshTest.cpp - Checks welding and splitting vertices on UV seams
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file EditTriMeshTest.cpp
+/// \brief Builds meshes out of separate triangles, with coincident
+/// vertices, texture seams, edges folded just inside and just outside the
+/// edge angle tolerance, vertices just inside and outside the distance
+/// tolerance, and vertices far from the origin or not numbers at all.
+/// Checks that weldVertices() removes the vertices it should, and that it
+/// and copyUvsIntoVertices() leave every triangle where it was, facing the
+/// way it was, with the same UVs.
+
+#include <math.h>
+#include <vector>
+#include "Common/EditTriMesh.h"
+#include "Common/MathUtil.h"
+#include "Check.h"
+
+/// \brief Adds a triangle with vertices of its own
+static void addTri(EditTriMesh &mesh, const Vector3 &a, const Vector3 &b, const Vector3 &c,
+  float u0 = 0.0f, float v0 = 0.0f, float u1 = 1.0f, float v1 = 0.0f, float u2 = 0.0f, float v2 = 1.0f)
+{
+  EditTriMesh::Tri t;
+  t.part = 0;
+  t.material = 0;
+  const Vector3 *p[3] = { &a, &b, &c };
+  const float uv[6] = { u0, v0, u1, v1, u2, v2 };
+  for(int j = 0; j < 3; j++)
+  {
+    t.v[j].index = mesh.addVertex();
+    mesh.vertex(t.v[j].index).p = *p[j];
+    t.v[j].u = uv[j * 2];
+    t.v[j].v = uv[j * 2 + 1];
+  }
+  mesh.addTri(t);
+}
+
+/// \brief Adds a unit square out of two triangles facing up, with the
+/// corners on the diagonal doubled up.  One of them is on a texture seam.
+static void addSquare(EditTriMesh &mesh, const Vector3 &origin, float size = 1.0f)
+{
+  Vector3 p0 = origin, p1 = origin + Vector3(size, 0.0f, 0.0f);
+  Vector3 p2 = origin + Vector3(size, 0.0f, size), p3 = origin + Vector3(0.0f, 0.0f, size);
+  addTri(mesh, p0, p3, p2, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+  addTri(mesh, p0, p2, p1, 0.0f, 0.0f, 0.5f, 0.5f, 1.0f, 0.0f);
+}
+
+/// \brief Adds two triangles either side of an edge, with the edge's
+/// vertices doubled up with the same UVs, and the second one folded up by
+/// an angle
+static void addHinge(EditTriMesh &mesh, const Vector3 &origin, float degrees)
+{
+  float angle = degToRad(degrees);
+  Vector3 a = origin, b = origin + Vector3(1.0f, 0.0f, 0.0f);
+  addTri(mesh, a, origin + Vector3(0.5f, 0.0f, 1.0f), b);
+  addTri(mesh, b, origin + Vector3(0.5f, sinf(angle), -cosf(angle)), a,
+    0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f);
+}
+
+/// \brief Adds two triangles facing up that meet at a corner, the second
+/// one's corner moved off the first's by a distance
+static void addCorner(EditTriMesh &mesh, const Vector3 &origin, float distance)
+{
+  addTri(mesh, origin, origin + Vector3(0.0f, 0.0f, 1.0f), origin + Vector3(1.0f, 0.0f, 0.0f));
+  addTri(mesh, origin + Vector3(distance, 0.0f, 0.0f), origin + Vector3(0.0f, 0.0f, -1.0f),
+    origin + Vector3(-1.0f, 0.0f, 0.0f));
+}
+
+/// \brief Tests whether a float is a NaN
+static bool isNan(float x)
+{
+  return x != x;
+}
+
+/// \brief What a triangle looked like before the mesh was optimized
+struct TriShape
+{
+  Vector3 p[3]; ///< Corners
+  float uv[6]; ///< UVs of the corners
+  Vector3 normal; ///< Surface normal
+};
+
+/// \brief Remembers what the triangles look like
+static std::vector<TriShape> getShapes(EditTriMesh &mesh)
+{
+  mesh.computeTriNormals();
+  std::vector<TriShape> shapes(mesh.triCount());
+  for(int i = 0; i < mesh.triCount(); i++)
+  {
+    const EditTriMesh::Tri &t = mesh.tri(i);
+    for(int j = 0; j < 3; j++)
+    {
+      shapes[i].p[j] = mesh.vertex(t.v[j].index).p;
+      shapes[i].uv[j * 2] = t.v[j].u;
+      shapes[i].uv[j * 2 + 1] = t.v[j].v;
+    }
+    shapes[i].normal = t.normal;
+  }
+  return shapes;
+}
+
+/// \brief Checks that every triangle is still there, in order, with its
+/// corners within a distance of where they were, facing the same way, and
+/// with the same UVs, both in the triangle and in the vertices once they've
+/// been copied there
+static void checkShapes(EditTriMesh &mesh, const std::vector<TriShape> &before,
+  float tolerance, bool vertexUvs)
+{
+  std::vector<TriShape> after = getShapes(mesh);
+  CHECK(after.size() == before.size());
+  if(after.size() != before.size())
+    return;
+
+  bool ok = true;
+  for(int i = 0; i < (int)after.size(); i++)
+  {
+    const TriShape &a = after[i], &b = before[i];
+    bool hasNan = false;
+    for(int j = 0; j < 3; j++)
+    {
+      const Vector3 &p = a.p[j], &q = b.p[j];
+      if(isNan(q.x) || isNan(q.y) || isNan(q.z))
+      {
+        hasNan = true;
+        ok = ok && (isNan(p.x) || isNan(p.y) || isNan(p.z));
+      }
+      else
+        ok = ok && (p - q).magnitude() <= tolerance;
+    }
+    for(int j = 0; j < 6; j++)
+      ok = ok && a.uv[j] == b.uv[j];
+    if(!hasNan)
+      ok = ok && a.normal * b.normal > 0.99999f;
+
+    if(vertexUvs)
+    {
+      const EditTriMesh::Tri &t = mesh.tri(i);
+      for(int j = 0; j < 3; j++)
+        ok = ok && mesh.vertex(t.v[j].index).u == t.v[j].u && mesh.vertex(t.v[j].index).v == t.v[j].v;
+    }
+  }
+  CHECK(ok);
+}
+
+int main()
+{
+  EditTriMesh::OptimizationParameters opt;
+  float tolerance = opt.coincidentVertexTolerance;
+
+  // the cases well apart from each other, each with its own count of
+  // vertices that should go
+
+  EditTriMesh mesh;
+  mesh.setPartCount(1);
+  mesh.setMaterialCount(1);
+  addSquare(mesh, Vector3(0.0f, 0.0f, 0.0f)); // 2
+  addHinge(mesh, Vector3(10.0f, 0.0f, 0.0f), 75.0f); // 2
+  addHinge(mesh, Vector3(20.0f, 0.0f, 0.0f), 85.0f); // 0
+  addCorner(mesh, Vector3(30.0f, 0.0f, 0.0f), tolerance * 0.5f); // 1
+  addCorner(mesh, Vector3(40.0f, 0.0f, 0.0f), tolerance * 2.0f); // 0
+
+  // a triangle with a corner that isn't a number, which must not be
+  // welded to the square's corner at the origin
+  float nan = sqrtf(-1.0f);
+  addTri(mesh, Vector3(nan, nan, nan), Vector3(60.0f, 0.0f, 0.0f), Vector3(60.0f, 0.0f, 1.0f)); // 0
+
+  // the hinges really are folded by those angles
+  mesh.computeTriNormals();
+  CHECK(fabsf(mesh.tri(2).normal * mesh.tri(3).normal - cosf(degToRad(75.0f))) < 1.0e-5f);
+  CHECK(fabsf(mesh.tri(4).normal * mesh.tri(5).normal - cosf(degToRad(85.0f))) < 1.0e-5f);
+
+  std::vector<TriShape> before = getShapes(mesh);
+  int vertexCount = mesh.vertexCount();
+  CHECK(mesh.weldVertices(opt) == 5);
+  CHECK(mesh.vertexCount() == vertexCount - 5);
+  checkShapes(mesh, before, tolerance, false);
+
+  // the square's seam corner is split back apart, and nothing else
+
+  vertexCount = mesh.vertexCount();
+  mesh.copyUvsIntoVertices();
+  CHECK(mesh.vertexCount() == vertexCount + 1);
+  checkShapes(mesh, before, tolerance, true);
+
+  // far from the origin, with the smallest cells, which is past where the
+  // cells fit in an int.  Any farther, and the normals overflow.
+
+  EditTriMesh far;
+  far.setPartCount(1);
+  far.setMaterialCount(1);
+  addSquare(far, Vector3(3.0e6f, 0.0f, -3.0e6f));
+  addSquare(far, Vector3(-1.0e12f, 1.0e12f, 1.0e12f), 1.0e6f);
+  addSquare(far, Vector3(1.0e15f, -1.0e15f, 0.0f), 1.0e9f);
+  opt.coincidentVertexTolerance = 0.0f;
+
+  before = getShapes(far);
+  vertexCount = far.vertexCount();
+  CHECK(far.weldVertices(opt) == 6);
+  CHECK(far.vertexCount() == vertexCount - 6);
+  checkShapes(far, before, 0.0f, false);
+
+  return checkResult();
+}
@@ -0,0 +1,180 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// FixedStepTest.cpp - Checks the simulation ticks the same at any frame rate
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file FixedStepTest.cpp
+/// \brief Drives GameBase::advance() with steady, jittered and stalled
+/// frame times that add up to the same total, and checks that every run
+/// ticks the same number of times and ends in the same state, bit for bit.
+/// Then checks that a stall longer than the most ticks a frame may run
+/// drops the rest, and counts them.
+///
+/// The tick rate is 64 Hz and the frame times are whole 1024ths of a
+/// second, so the time carried from frame to frame is exact.  At 60 Hz the
+/// sums round differently frame by frame, and a run can be a tick out.
+
+#include <vector>
+#include "Game/GameBase.h"
+#include "Check.h"
+
+/// Ticks a second
+static const float kTickRate = 64.0f;
+
+/// Smallest step of the frame times, in seconds
+static const float kUnit = 1.0f / 1024.0f;
+
+/// Units to a tick
+static const int kUnitsPerTick = 16;
+
+/// Units all the runs take, some way into the last tick
+static const int kTotalUnits = 640 * kUnitsPerTick + 5;
+
+/// \brief A game whose simulation is a damped spring, which comes out
+/// differently if its ticks are any different
+class SpringGame : public GameBase
+{
+public:
+  double x; ///< Position
+  double v; ///< Velocity
+  bool badTick; ///< True if a tick was ever given the wrong length
+
+  SpringGame() : x(1.0), v(0.0), badTick(false)
+  {
+    setTickRate(kTickRate);
+  }
+
+  void tick(float dt)
+  {
+    badTick = badTick || dt != getTickLength();
+    v += (-40.0 * x - 0.5 * v) * dt;
+    x += v * dt;
+  }
+
+  /// \brief Queries the game for the ticks dropped to keep up
+  int getTicksDropped() const {return m_nTicksDropped;}
+};
+
+/// \brief What a run ended up with
+struct RunResult
+{
+  unsigned int ticks; ///< Ticks run
+  int dropped; ///< Ticks dropped
+  int mostTicks; ///< Most ticks a frame ran
+  double x, v; ///< State of the spring
+  float interpolation; ///< Fraction of a tick left over
+  bool badTick; ///< True if a tick was given the wrong length
+};
+
+/// \brief Runs a game through a list of frame times
+/// \param frames Frame times, in units.
+static RunResult run(const std::vector<int> &frames)
+{
+  SpringGame game;
+  RunResult result;
+  result.mostTicks = 0;
+  for(int i = 0; i < (int)frames.size(); i++)
+  {
+    int ticks = game.advance(frames[i] * kUnit);
+    if(ticks > result.mostTicks)
+      result.mostTicks = ticks;
+  }
+  result.ticks = game.getTickCount();
+  result.dropped = game.getTicksDropped();
+  result.x = game.x;
+  result.v = game.v;
+  result.interpolation = game.getInterpolation();
+  result.badTick = game.badTick;
+  return result;
+}
+
+/// \brief Tests two runs for ending up the same
+static bool sameResult(const RunResult &a, const RunResult &b)
+{
+  return a.ticks == b.ticks && a.dropped == b.dropped && a.x == b.x && a.v == b.v &&
+    a.interpolation == b.interpolation;
+}
+
+/// \brief Adds frames of a length, and one shorter if need be, up to the
+/// total
+static void fill(std::vector<int> &frames, int total, int length)
+{
+  int sum = 0;
+  for(int i = 0; i < (int)frames.size(); i++)
+    sum += frames[i];
+  while(sum < total)
+  {
+    int n = length < total - sum ? length : total - sum;
+    frames.push_back(n);
+    sum += n;
+  }
+}
+
+int main()
+{
+  // a tick every frame
+
+  std::vector<int> steady;
+  fill(steady, kTotalUnits, kUnitsPerTick);
+  RunResult expected = run(steady);
+  CHECK(expected.ticks == kTotalUnits / kUnitsPerTick);
+  CHECK(expected.dropped == 0);
+  CHECK(expected.mostTicks == 1);
+  CHECK(expected.interpolation == 5.0f / kUnitsPerTick);
+  CHECK(!expected.badTick);
+
+  // frames from half a tick to one and a half, so some run none and some
+  // run two
+
+  std::vector<int> jittered;
+  unsigned int random = 12345;
+  for(int sum = 0; sum < kTotalUnits - 2 * kUnitsPerTick; sum += jittered.back())
+  {
+    random = random * 1664525u + 1013904223u;
+    jittered.push_back(kUnitsPerTick / 2 + (int)((random >> 16) % (kUnitsPerTick + 1)));
+  }
+  fill(jittered, kTotalUnits, kUnitsPerTick);
+  RunResult result = run(jittered);
+  CHECK(sameResult(result, expected));
+  CHECK(result.mostTicks == 2);
+  CHECK(!result.badTick);
+
+  // steady frames with a stall every so often, of four ticks and a bit,
+  // which with the time carried over is up to the five a frame may run
+
+  std::vector<int> stalled;
+  for(int sum = 0; sum < kTotalUnits - 5 * kUnitsPerTick; sum += stalled.back())
+    stalled.push_back(stalled.size() % 40 == 39 ? 4 * kUnitsPerTick + 7 : kUnitsPerTick);
+  fill(stalled, kTotalUnits, kUnitsPerTick);
+  result = run(stalled);
+  CHECK(sameResult(result, expected));
+  CHECK(result.mostTicks == 5);
+  CHECK(!result.badTick);
+
+  // a stall too long to catch up on: it runs the most ticks it may, drops
+  // the rest, and keeps the fraction
+
+  SpringGame game;
+  game.setMaxTicksPerFrame(5);
+  CHECK(game.advance((20 * kUnitsPerTick + 3) * kUnit) == 5);
+  CHECK(game.getTickCount() == 5);
+  CHECK(game.getTicksDropped() == 15);
+  CHECK(game.getInterpolation() == 3.0f / kUnitsPerTick);
+
+  // and the next frame carries on from there
+
+  CHECK(game.advance((kUnitsPerTick - 3) * kUnit) == 1);
+  CHECK(game.getTickCount() == 6);
+  CHECK(game.getTicksDropped() == 15);
+  CHECK(game.getInterpolation() == 0.0f);
+
+  // the same stall with no limit to speak of drops nothing
+
+  SpringGame unlimited;
+  unlimited.setMaxTicksPerFrame(100);
+  CHECK(unlimited.advance((20 * kUnitsPerTick + 3) * kUnit) == 20);
+  CHECK(unlimited.getTicksDropped() == 0);
+
+  return checkResult();
+}
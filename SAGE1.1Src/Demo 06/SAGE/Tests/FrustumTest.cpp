@@ -0,0 +1,200 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// FrustumTest.cpp - Checks the view frustum's planes and culling
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file FrustumTest.cpp
+/// \brief Sets up a frustum from a known camera and checks the planes it
+/// pulls out, which boxes and spheres it culls, and what it does with the
+/// plane masks and last planes.
+
+#include <math.h>
+#include "Common/AABB3.h"
+#include "Common/Frustum.h"
+#include "Common/Matrix4x3.h"
+#include "Check.h"
+
+/// How close two floats have to be to count as the same
+static const float kTolerance = 1.0e-5f;
+
+/// Near and far clipping distances
+static const float kNear = 1.0f, kFar = 100.0f;
+
+/// \brief Tests a plane for the given values.  The far plane comes from
+/// the difference of two nearly equal matrix entries, so d is only
+/// checked relative to its size.
+static bool planeIs(const Plane &p, float a, float b, float c, float d)
+{
+  return fabsf(p.a - a) < kTolerance && fabsf(p.b - b) < kTolerance &&
+    fabsf(p.c - c) < kTolerance && fabsf(p.d - d) < kTolerance * (1.0f + fabsf(d));
+}
+
+/// \brief Makes a box from its corners
+static AABB3 makeBox(float x0, float y0, float z0, float x1, float y1, float z1)
+{
+  AABB3 box;
+  box.min = Vector3(x0, y0, z0);
+  box.max = Vector3(x1, y1, z1);
+  return box;
+}
+
+/// \brief Sets up a frustum for a camera at a point looking down +z, with a
+/// 90 degree field of view both ways, the way the renderer's clip matrix is.
+static void setupFrustum(Frustum &frustum, const Vector3 &cameraPos)
+{
+  const float q = kFar / (kFar - kNear);
+  const float proj[16] =
+  {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, q, 1.0f,
+    0.0f, 0.0f, -q * kNear, 0.0f
+  };
+
+  Matrix4x3 worldToCamera;
+  worldToCamera.setupTranslation(-cameraPos);
+  frustum.setup(worldToCamera, proj);
+}
+
+int main()
+{
+  const float h = sqrtf(0.5f);
+
+  // an empty frustum has no planes, so it sees everything
+
+  Frustum frustum;
+  CHECK(frustum.getPlaneMask() == 0);
+  CHECK(frustum.isBoxVisible(makeBox(0.0f, 0.0f, -50.0f, 1.0f, 1.0f, -49.0f)));
+
+  // planes, from the camera at the origin and then moved back 10
+
+  setupFrustum(frustum, Vector3(0.0f, 0.0f, 0.0f));
+  CHECK(frustum.getPlaneMask() == (1 << Frustum::kUser) - 1);
+  CHECK(planeIs(frustum.getPlane(Frustum::kLeft), h, 0.0f, h, 0.0f));
+  CHECK(planeIs(frustum.getPlane(Frustum::kRight), -h, 0.0f, h, 0.0f));
+  CHECK(planeIs(frustum.getPlane(Frustum::kBottom), 0.0f, h, h, 0.0f));
+  CHECK(planeIs(frustum.getPlane(Frustum::kTop), 0.0f, -h, h, 0.0f));
+  CHECK(planeIs(frustum.getPlane(Frustum::kNear), 0.0f, 0.0f, 1.0f, -kNear));
+  CHECK(planeIs(frustum.getPlane(Frustum::kFar), 0.0f, 0.0f, -1.0f, kFar));
+
+  setupFrustum(frustum, Vector3(0.0f, 0.0f, -10.0f));
+  CHECK(planeIs(frustum.getPlane(Frustum::kLeft), h, 0.0f, h, 10.0f * h));
+  CHECK(planeIs(frustum.getPlane(Frustum::kNear), 0.0f, 0.0f, 1.0f, 10.0f - kNear));
+  CHECK(planeIs(frustum.getPlane(Frustum::kFar), 0.0f, 0.0f, -1.0f, kFar - 10.0f));
+
+  setupFrustum(frustum, Vector3(0.0f, 0.0f, 0.0f));
+
+  // boxes, entirely in, straddling, and out past each plane
+
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 10.0f, 1.0f, 1.0f, 12.0f)));
+  CHECK(frustum.isBoxVisible(makeBox(-20.0f, -1.0f, 10.0f, -5.0f, 1.0f, 12.0f)));
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 90.0f, 1.0f, 1.0f, 110.0f)));
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, -5.0f, 1.0f, 1.0f, 5.0f)));
+  CHECK(!frustum.isBoxVisible(makeBox(-30.0f, -1.0f, 10.0f, -20.0f, 1.0f, 12.0f)));
+  CHECK(!frustum.isBoxVisible(makeBox(20.0f, -1.0f, 10.0f, 30.0f, 1.0f, 12.0f)));
+  CHECK(!frustum.isBoxVisible(makeBox(-1.0f, -30.0f, 10.0f, 1.0f, -20.0f, 12.0f)));
+  CHECK(!frustum.isBoxVisible(makeBox(-1.0f, 20.0f, 10.0f, 1.0f, 30.0f, 12.0f)));
+  CHECK(!frustum.isBoxVisible(makeBox(-0.1f, -0.1f, 0.1f, 0.1f, 0.1f, 0.5f)));
+  CHECK(!frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 101.0f, 1.0f, 1.0f, 102.0f)));
+  CHECK(!frustum.isBoxVisible(makeBox(-1.0f, -1.0f, -12.0f, 1.0f, 1.0f, -10.0f)));
+
+  // outside near the top left corner, but not entirely behind either plane,
+  // so the test lets it through
+  CHECK(frustum.isBoxVisible(makeBox(-12.0f, 9.0f, 10.0f, -9.0f, 12.0f, 10.5f)));
+
+  // spheres the same
+
+  CHECK(frustum.isSphereVisible(Vector3(0.0f, 0.0f, 50.0f), 1.0f));
+  CHECK(frustum.isSphereVisible(Vector3(0.0f, 0.0f, 100.5f), 1.0f));
+  CHECK(!frustum.isSphereVisible(Vector3(0.0f, 0.0f, 102.0f), 1.0f));
+  CHECK(!frustum.isSphereVisible(Vector3(-20.0f, 0.0f, 10.0f), 5.0f));
+  CHECK(frustum.isSphereVisible(Vector3(-20.0f, 0.0f, 10.0f), 8.0f));
+
+  // plane masks: planes the box is entirely inside of are cleared, and the
+  // mask is left alone when the box is culled
+
+  unsigned mask = Frustum::kAllPlanes;
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 10.0f, 1.0f, 1.0f, 12.0f), &mask));
+  CHECK(mask == 0);
+
+  mask = Frustum::kAllPlanes;
+  CHECK(frustum.isBoxVisible(makeBox(-20.0f, -1.0f, 10.0f, -5.0f, 1.0f, 12.0f), &mask));
+  CHECK(mask == (1 << Frustum::kLeft));
+
+  mask = Frustum::kAllPlanes;
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 90.0f, 1.0f, 1.0f, 110.0f), &mask));
+  CHECK(mask == (1 << Frustum::kFar));
+
+  mask = Frustum::kAllPlanes;
+  CHECK(!frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 101.0f, 1.0f, 1.0f, 102.0f), &mask));
+  CHECK(mask == Frustum::kAllPlanes);
+
+  // a child given its parent's mask only tests the planes left in it, so a
+  // box past the far plane gets through if the far plane was cleared
+  mask = ~(1u << Frustum::kFar);
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 101.0f, 1.0f, 1.0f, 102.0f), &mask));
+  CHECK(mask == 0);
+  mask = 0;
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, -1.0f, -12.0f, 1.0f, 1.0f, -10.0f), &mask));
+  mask = 1 << Frustum::kLeft;
+  CHECK(frustum.isBoxVisible(makeBox(-20.0f, -1.0f, 10.0f, -5.0f, 1.0f, 12.0f), &mask));
+  CHECK(mask == (1 << Frustum::kLeft));
+
+  // last planes: the plane that culls a box is remembered, and tried first
+  // the next time
+
+  AABB3 leftAndFar = makeBox(-501.0f, -1.0f, 200.0f, -500.0f, 1.0f, 201.0f);
+  int lastPlane = -1;
+  CHECK(!frustum.isBoxVisible(makeBox(-1.0f, -1.0f, 101.0f, 1.0f, 1.0f, 102.0f), 0, &lastPlane));
+  CHECK(lastPlane == Frustum::kFar);
+  lastPlane = -1;
+  CHECK(!frustum.isBoxVisible(leftAndFar, 0, &lastPlane));
+  CHECK(lastPlane == Frustum::kLeft);
+  lastPlane = Frustum::kFar;
+  CHECK(!frustum.isBoxVisible(leftAndFar, 0, &lastPlane));
+  CHECK(lastPlane == Frustum::kFar);
+
+  // a last plane the mask leaves out isn't tested
+  mask = ~(1u << Frustum::kFar);
+  lastPlane = Frustum::kFar;
+  CHECK(!frustum.isBoxVisible(leftAndFar, &mask, &lastPlane));
+  CHECK(lastPlane == Frustum::kLeft);
+
+  // a visible box leaves the last plane alone, and still clears it from
+  // the mask if the box is inside it
+  mask = Frustum::kAllPlanes;
+  lastPlane = Frustum::kNear;
+  CHECK(frustum.isBoxVisible(makeBox(-20.0f, -1.0f, 10.0f, -5.0f, 1.0f, 12.0f), &mask, &lastPlane));
+  CHECK(lastPlane == Frustum::kNear);
+  CHECK(mask == (1 << Frustum::kLeft));
+
+  lastPlane = -1;
+  CHECK(!frustum.isSphereVisible(Vector3(-500.0f, 0.0f, 200.0f), 1.0f, 0, &lastPlane));
+  CHECK(lastPlane == Frustum::kLeft);
+  lastPlane = Frustum::kFar;
+  CHECK(!frustum.isSphereVisible(Vector3(-500.0f, 0.0f, 200.0f), 1.0f, 0, &lastPlane));
+  CHECK(lastPlane == Frustum::kFar);
+
+  // the user plane, such as the water plane, culls too until it's cleared;
+  // it's normalized, and kept when the camera moves
+
+  AABB3 underwater = makeBox(-1.0f, -3.0f, 10.0f, 1.0f, -2.0f, 12.0f);
+  frustum.setUserPlane(Plane(0.0f, 2.0f, 0.0f, 0.0f));
+  CHECK(frustum.getPlaneMask() == Frustum::kAllPlanes);
+  CHECK(planeIs(frustum.getPlane(Frustum::kUser), 0.0f, 1.0f, 0.0f, 0.0f));
+  setupFrustum(frustum, Vector3(0.0f, 0.0f, -1.0f));
+  CHECK(frustum.getPlaneMask() == Frustum::kAllPlanes);
+  lastPlane = -1;
+  CHECK(!frustum.isBoxVisible(underwater, 0, &lastPlane));
+  CHECK(lastPlane == Frustum::kUser);
+  mask = Frustum::kAllPlanes;
+  CHECK(frustum.isBoxVisible(makeBox(-1.0f, 1.0f, 10.0f, 1.0f, 2.0f, 12.0f), &mask));
+  CHECK(mask == 0);
+
+  frustum.clearUserPlane();
+  CHECK(frustum.getPlaneMask() == (1 << Frustum::kUser) - 1);
+  CHECK(frustum.isBoxVisible(underwater, 0, &lastPlane));
+
+  return checkResult();
+}
@@ -0,0 +1,166 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// Matrix4x3Benchmark.cpp - Times the batch transforms against operator*
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file Matrix4x3Benchmark.cpp
+/// \brief Prints how long each of the batch operations beside Matrix4x3
+/// takes, against calling operator* in a loop, the way the engine did
+/// before.
+///
+/// Usage: Matrix4x3Benchmark [count [passes]].  Each operation is run over
+/// arrays of count items, passes times, and the best of five tries is
+/// taken, since a single try is at the mercy of whatever else the machine
+/// is doing.  The default count keeps everything in the cache, which is
+/// how the engine uses them: a model's vertices or a skeleton's bones at a
+/// time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Common/EulerAngles.h"
+#include "Common/Matrix4x3.h"
+#include "Common/Portable.h"
+#include "Common/vector3.h"
+
+/// \brief A vertex as the strided transforms see it
+struct Vertex
+{
+  Vector3 p; ///< Position
+  Vector3 n; ///< Normal
+  float u, v; ///< Texture coordinates
+};
+
+/// \brief The arrays the operations work on
+struct Arrays
+{
+  std::vector<Vector3> in; ///< Points or directions
+  std::vector<Vector3> out; ///< Results
+  std::vector<Vertex> vertices; ///< Vertices to transform in place
+  std::vector<Matrix4x3> a; ///< Matrices
+  std::vector<Matrix4x3> out4x3; ///< Results
+  Matrix4x3 m; ///< The matrix everything is transformed by
+};
+
+/// \brief One way of doing one of the operations, run over the arrays once
+typedef void (*Operation)(Arrays &arrays);
+
+static void pointsLoop(Arrays &x)
+{
+  for(int i = 0; i < (int)x.in.size(); i++)
+    x.out[i] = x.in[i] * x.m;
+}
+
+static void pointsBatch(Arrays &x)
+{
+  transformPoints(&x.out[0], &x.in[0], (int)x.in.size(), x.m);
+}
+
+static void vectorsLoop(Arrays &x)
+{
+  const Matrix4x3 &m = x.m;
+  for(int i = 0; i < (int)x.in.size(); i++)
+  {
+    const Vector3 &p = x.in[i];
+    x.out[i] = Vector3(
+      p.x*m.m11 + p.y*m.m21 + p.z*m.m31,
+      p.x*m.m12 + p.y*m.m22 + p.z*m.m32,
+      p.x*m.m13 + p.y*m.m23 + p.z*m.m33);
+  }
+}
+
+static void vectorsBatch(Arrays &x)
+{
+  transformVectors(&x.out[0], &x.in[0], (int)x.in.size(), x.m);
+}
+
+static void stridedLoop(Arrays &x)
+{
+  for(int i = 0; i < (int)x.vertices.size(); i++)
+    x.vertices[i].p = x.vertices[i].p * x.m;
+}
+
+static void stridedBatch(Arrays &x)
+{
+  transformPoints(&x.vertices[0].p, sizeof(Vertex), &x.vertices[0].p, sizeof(Vertex),
+    (int)x.vertices.size(), x.m);
+}
+
+static void concatenateLoop(Arrays &x)
+{
+  for(int i = 0; i < (int)x.a.size(); i++)
+    x.out4x3[i] = x.a[i] * x.m;
+}
+
+static void concatenateBatch(Arrays &x)
+{
+  concatenate(&x.out4x3[0], &x.a[0], x.m, (int)x.a.size());
+}
+
+/// \brief Times an operation
+/// \return Nanoseconds an item, the best of five tries
+static double time(Operation operation, Arrays &arrays, int count, int passes)
+{
+  double best = 1.0e30;
+  for(int t = 0; t < 5; t++)
+  {
+    double start = getClockSeconds();
+    for(int pass = 0; pass < passes; pass++)
+      operation(arrays);
+    double seconds = getClockSeconds() - start;
+    if(seconds < best)
+      best = seconds;
+  }
+  return best * 1.0e9 / ((double)count * passes);
+}
+
+int main(int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi(argv[1]) : 4096;
+  int passes = argc > 2 ? atoi(argv[2]) : 2000;
+
+  // a rotation with a little scale, so the strided points stay in range
+  // however many times they're transformed in place
+  Arrays arrays;
+  arrays.m.setupLocalToParent(Vector3(0.0f, 0.0f, 0.0f), EulerAngles(0.3f, 0.2f, 0.1f));
+  arrays.in.resize(count);
+  arrays.out.resize(count);
+  arrays.vertices.resize(count);
+  arrays.a.resize(count);
+  arrays.out4x3.resize(count);
+  for(int i = 0; i < count; i++)
+  {
+    arrays.in[i] = Vector3((float)i, (float)(i % 7), (float)(i % 13));
+    arrays.vertices[i].p = arrays.in[i];
+    arrays.a[i].setupLocalToParent(arrays.in[i], EulerAngles((float)i, 0.5f, 0.25f));
+  }
+
+  struct
+  {
+    const char *name;
+    Operation loop, batch;
+  } operations[] =
+  {
+    { "transformPoints", pointsLoop, pointsBatch },
+    { "transformVectors", vectorsLoop, vectorsBatch },
+    { "strided points", stridedLoop, stridedBatch },
+    { "concatenate", concatenateLoop, concatenateBatch },
+  };
+
+  printf("%d items, %d passes, best of 5\n\n", count, passes);
+  printf("%-18s %12s %12s %10s\n", "operation", "loop ns", "batch ns", "speedup");
+  for(int i = 0; i < 4; i++)
+  {
+    double loop = time(operations[i].loop, arrays, count, passes);
+    double batch = time(operations[i].batch, arrays, count, passes);
+    printf("%-18s %12.2f %12.2f %10.2f\n", operations[i].name, loop, batch, loop / batch);
+  }
+
+  // use the results, so none of the work can be thrown away
+  float sum = 0.0f;
+  for(int i = 0; i < count; i++)
+    sum += arrays.out[i].x + arrays.vertices[i].p.y + arrays.out4x3[i].tz;
+  printf("\nchecksum %g\n", sum);
+  return 0;
+}
@@ -0,0 +1,209 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// Matrix4x3Test.cpp - Checks the batch transforms against operator*
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file Matrix4x3Test.cpp
+/// \brief Runs transformPoints(), transformVectors() and concatenate() on
+/// random input, contiguous and strided, in place and not, and checks each
+/// result is the same to the bit as operator* and that nothing outside the
+/// output is written.
+
+#include <string.h>
+#include <vector>
+#include "Common/EulerAngles.h"
+#include "Common/Matrix4x3.h"
+#include "Common/Random.h"
+#include "Common/vector3.h"
+#include "Check.h"
+
+/// A value the functions never write, to see if they wrote past the end
+static const float kGuard = -12345.0f;
+
+/// \brief A vertex with the position and normal in the middle of it
+struct Vertex
+{
+  float pad; ///< Must not be written
+  Vector3 p; ///< Position
+  Vector3 n; ///< Normal
+  float uv[2]; ///< Must not be written
+};
+
+static CRandom gRandom; ///< Source of the test input
+
+/// \brief Makes a random point
+static Vector3 randomVector()
+{
+  return Vector3(gRandom.getFloat(-100.0f, 100.0f), gRandom.getFloat(-100.0f, 100.0f),
+    gRandom.getFloat(-100.0f, 100.0f));
+}
+
+/// \brief Makes a random rigid body transform with some scale
+static Matrix4x3 randomMatrix()
+{
+  Matrix4x3 r, s;
+  r.setupLocalToParent(randomVector(), EulerAngles(gRandom.getFloat(-3.0f, 3.0f),
+    gRandom.getFloat(-1.5f, 1.5f), gRandom.getFloat(-3.0f, 3.0f)));
+  s.setupScale(Vector3(gRandom.getFloat(0.5f, 2.0f), gRandom.getFloat(0.5f, 2.0f),
+    gRandom.getFloat(0.5f, 2.0f)));
+  return s * r;
+}
+
+/// \brief Multiplies a direction by the linear part of a matrix, the way
+/// operator* does a point
+static Vector3 times3x3(const Vector3 &p, const Matrix4x3 &m)
+{
+  return Vector3(
+    p.x*m.m11 + p.y*m.m21 + p.z*m.m31,
+    p.x*m.m12 + p.y*m.m22 + p.z*m.m32,
+    p.x*m.m13 + p.y*m.m23 + p.z*m.m33);
+}
+
+/// \brief Tests two vectors for being the same to the bit
+static bool same(const Vector3 &a, const Vector3 &b)
+{
+  return memcmp(&a, &b, sizeof(Vector3)) == 0;
+}
+
+/// \brief Tests two matrices for being the same to the bit
+static bool same(const Matrix4x3 &a, const Matrix4x3 &b)
+{
+  return memcmp(&a, &b, sizeof(Matrix4x3)) == 0;
+}
+
+/// \brief Checks the contiguous transforms of count points, into another
+/// array and in place.  The arrays are one longer than needed, with a guard
+/// at the end.
+static void checkArrays(int count)
+{
+  Matrix4x3 m = randomMatrix();
+  std::vector<Vector3> in(count + 1), out(count + 1), place(count + 1);
+  for(int i = 0; i < count; i++)
+    in[i] = randomVector();
+
+  for(int point = 0; point < 2; point++)
+  {
+    Vector3 guard(kGuard, kGuard, kGuard);
+    out[count] = guard;
+    place = in;
+    place[count] = guard;
+
+    if(point)
+    {
+      transformPoints(&out[0], &in[0], count, m);
+      transformPoints(&place[0], &place[0], count, m);
+    }
+    else
+    {
+      transformVectors(&out[0], &in[0], count, m);
+      transformVectors(&place[0], &place[0], count, m);
+    }
+
+    bool ok = true;
+    for(int i = 0; i < count; i++)
+    {
+      Vector3 expected = point ? in[i] * m : times3x3(in[i], m);
+      ok = ok && same(out[i], expected) && same(place[i], expected);
+    }
+    CHECK(ok);
+    CHECK(same(out[count], guard) && same(place[count], guard));
+  }
+}
+
+/// \brief Checks the strided transforms of count vertices, from the middle
+/// of a vertex to a packed array, and in place within the vertex
+static void checkStrided(int count)
+{
+  Matrix4x3 m = randomMatrix();
+  std::vector<Vertex> in(count), place(count);
+  std::vector<Vector3> out(count + 1);
+  for(int i = 0; i < count; i++)
+  {
+    in[i].pad = kGuard;
+    in[i].p = randomVector();
+    in[i].n = randomVector();
+    in[i].uv[0] = in[i].uv[1] = kGuard;
+  }
+  place = in;
+  out[count] = Vector3(kGuard, kGuard, kGuard);
+
+  if(count > 0)
+  {
+    transformPoints(&out[0], sizeof(Vector3), &in[0].p, sizeof(Vertex), count, m);
+    transformPoints(&place[0].p, sizeof(Vertex), &place[0].p, sizeof(Vertex), count, m);
+    transformVectors(&place[0].n, sizeof(Vertex), &place[0].n, sizeof(Vertex), count, m);
+  }
+
+  bool ok = true;
+  for(int i = 0; i < count; i++)
+  {
+    ok = ok && same(out[i], in[i].p * m) && same(place[i].p, in[i].p * m) &&
+      same(place[i].n, times3x3(in[i].n, m)) &&
+      place[i].pad == kGuard && place[i].uv[0] == kGuard && place[i].uv[1] == kGuard;
+  }
+  CHECK(ok);
+  CHECK(same(out[count], Vector3(kGuard, kGuard, kGuard)));
+}
+
+/// \brief Checks both kinds of concatenation of count matrices, into
+/// another array and in place
+static void checkConcatenate(int count)
+{
+  std::vector<Matrix4x3> a(count + 1), b(count + 1), out(count + 1), place(count + 1);
+  Matrix4x3 parent = randomMatrix();
+  for(int i = 0; i < count; i++)
+  {
+    a[i] = randomMatrix();
+    b[i] = randomMatrix();
+  }
+
+  Matrix4x3 guard;
+  memset(&guard, 0, sizeof(guard));
+  guard.m11 = guard.tz = kGuard;
+
+  for(int one = 0; one < 2; one++)
+  {
+    out[count] = guard;
+    place = a;
+    place[count] = guard;
+
+    if(one)
+    {
+      concatenate(&out[0], &a[0], parent, count);
+      concatenate(&place[0], &place[0], parent, count);
+    }
+    else
+    {
+      concatenate(&out[0], &a[0], &b[0], count);
+      concatenate(&place[0], &place[0], &b[0], count);
+    }
+
+    bool ok = true;
+    for(int i = 0; i < count; i++)
+    {
+      Matrix4x3 expected = a[i] * (one ? parent : b[i]);
+      ok = ok && same(out[i], expected) && same(place[i], expected);
+    }
+    CHECK(ok);
+    CHECK(same(out[count], guard) && same(place[count], guard));
+  }
+}
+
+int main()
+{
+  gRandom.seed(1);
+
+  // every leftover count after the groups of four, and some big ones
+  for(int count = 0; count <= 13; count++)
+  {
+    checkArrays(count);
+    checkStrided(count);
+    checkConcatenate(count);
+  }
+  checkArrays(1001);
+  checkStrided(1001);
+  checkConcatenate(1001);
+
+  return checkResult();
+}
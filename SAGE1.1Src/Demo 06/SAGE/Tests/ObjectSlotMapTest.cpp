@@ -0,0 +1,56 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ObjectSlotMapTest.cpp - Checks that object handles are never reused
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ObjectSlotMapTest.cpp
+/// \brief Runs slots of an ObjectSlotMap through all their generations,
+/// checking that no handle comes back and that stale ones find nothing.
+
+#include <algorithm>
+#include <vector>
+#include "Objects/ObjectSlotMap.h"
+#include "Check.h"
+
+int main()
+{
+  ObjectSlotMap map;
+  GameObject *object = (GameObject *)&map; // only ever compared, never used
+
+  // enough slots that freed ones get reused
+  const int kSlots = 1100;
+  std::vector<unsigned int> handles;
+  for(int i = 0; i < kSlots; i++)
+    handles.push_back(map.insert(object));
+  for(int i = 0; i < kSlots; i++)
+    map.erase(handles[i]);
+
+  // keep putting one object in and taking it out, until slot 0 has
+  // been through every generation and more
+  std::vector<unsigned int> slot0;
+  slot0.push_back(handles[0]);
+  bool stale = true;
+  for(int i = 0; i < kSlots * 4200; i++)
+  {
+    unsigned int handle = map.insert(object);
+    CHECK(handle != ObjectSlotMap::NULLHANDLE);
+    if(ObjectSlotMap::getIndex(handle) == 0)
+      slot0.push_back(handle);
+    map.erase(handle);
+    stale = stale && map.find(handle) == 0;
+  }
+  CHECK(stale);
+
+  // slot 0 had 4095 handles and was then retired, and none came back
+  CHECK(slot0.size() == 4095);
+  std::sort(slot0.begin(), slot0.end());
+  CHECK(std::unique(slot0.begin(), slot0.end()) == slot0.end());
+  for(int i = 0; i < (int)slot0.size(); i++)
+    CHECK(map.find(slot0[i]) == 0);
+
+  // and the retired slots were made up for with new ones
+  CHECK(map.getSlotCount() > (unsigned int)kSlots);
+
+  return checkResult();
+}
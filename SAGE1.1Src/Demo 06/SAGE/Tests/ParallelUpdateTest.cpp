@@ -0,0 +1,200 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParallelUpdateTest.cpp - Checks updating objects in parallel changes nothing
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParallelUpdateTest.cpp
+/// \brief Runs the same objects through the object manager for a number of
+/// ticks, one at a time and then in parallel on different numbers of
+/// threads, and checks that they end up in the same places with the same
+/// bounding boxes, and that the commands they recorded were carried out in
+/// the same order.  Some of the objects are parallel and some aren't, and
+/// some die along the way, which moves others around in the manager's sets.
+
+#include <stdio.h>
+#include <vector>
+#include "Common/EulerAngles.h"
+#include "Common/JobSystem.h"
+#include "Common/Model.h"
+#include "Objects/CommandBuffer.h"
+#include "Objects/GameObject.h"
+#include "Objects/GameObjectManager.h"
+#include "Check.h"
+
+/// Number of objects to start with
+static const int kObjects = 200;
+
+/// Number of ticks to run
+static const int kTicks = 100;
+
+/// Length of a tick, in seconds
+static const float kTickSeconds = 1.0f / 60.0f;
+
+/// \brief A command carried out, as the object recorded it
+struct LoggedCommand
+{
+  int object; ///< ID of the object that recorded it
+  int phase; ///< 0 if recorded in process(), 1 in move()
+  float f[3]; ///< Where the object was
+
+  bool operator==(const LoggedCommand &x) const
+  {
+    return object == x.object && phase == x.phase &&
+      f[0] == x.f[0] && f[1] == x.f[1] && f[2] == x.f[2];
+  }
+};
+
+static std::vector<LoggedCommand> gLog; ///< Commands carried out so far
+
+/// \brief Carries out a command by logging it
+static void logCommand(const CommandBuffer::Args &args)
+{
+  LoggedCommand c;
+  c.object = args.i[0];
+  c.phase = args.i[1];
+  for(int i = 0; i < 3; i++)
+    c.f[i] = args.f[i];
+  gLog.push_back(c);
+}
+
+/// \brief An object that wanders about on its own random numbers, records
+/// a command each process and move, and dies after a while.  It keeps to
+/// itself, so it can be parallel.  CRandom is rand() underneath, which all
+/// the objects would share, so it has a generator of its own.
+class Wanderer : public GameObject
+{
+public:
+  Wanderer(Model *model, unsigned int seed, bool parallel) : GameObject(model), m_nRandom(seed * 2654435761u)
+  {
+    m_nTicksLeft = kTicks / 4 + (int)(random(0.0f, 1.0f) * kTicks * 2);
+    m_bParallel = parallel;
+    setPosition(Vector3(random(-500.0f, 500.0f), 0.0f, random(-500.0f, 500.0f)));
+  }
+
+  void process(float dt)
+  {
+    if(--m_nTicksLeft <= 0)
+      killObject();
+    m_eaAngularVelocity[0].heading = random(-2.0f, 2.0f);
+    m_eaAngularVelocity[0].pitch = random(-0.5f, 0.5f);
+    setSpeed(random(0.0f, 5.0f));
+    record(0);
+  }
+
+  void move(float dt)
+  {
+    GameObject::move(dt);
+    record(1);
+  }
+
+private:
+  /// \brief Gets a random number from the object's own generator
+  float random(float minVal, float maxVal)
+  {
+    m_nRandom = m_nRandom * 1664525u + 1013904223u;
+    return minVal + (m_nRandom >> 8) * (1.0f / 16777216.0f) * (maxVal - minVal);
+  }
+
+  /// \brief Records where the object is, to be logged
+  void record(int phase)
+  {
+    CommandBuffer::Args args;
+    args.i[0] = (int)getID();
+    args.i[1] = phase;
+    args.f[0] = getPosition().x;
+    args.f[1] = getPosition().y;
+    args.f[2] = getPosition().z;
+    getCommands().record(logCommand, args);
+  }
+
+  unsigned int m_nRandom; ///< State of the object's own random numbers
+  int m_nTicksLeft; ///< Ticks until it dies
+};
+
+/// \brief Where an object ended up
+struct ObjectState
+{
+  unsigned int id; ///< Its ID
+  Vector3 position; ///< Its position
+  EulerAngles orient; ///< Its orientation
+  AABB3 box; ///< Its bounding box
+
+  bool operator==(const ObjectState &x) const
+  {
+    return id == x.id && position == x.position &&
+      orient.heading == x.orient.heading && orient.pitch == x.orient.pitch &&
+      orient.bank == x.orient.bank && box.min == x.box.min && box.max == x.box.max;
+  }
+};
+
+/// \brief Runs the objects for kTicks ticks.
+/// \param model The model the objects use.
+/// \param parallel Whether to update them in parallel.
+/// \param threads Number of threads for gJobSystem.
+/// \param states Returns where the live objects ended up, in ID order.
+/// \param log Returns the commands carried out.
+static void run(Model *model, bool parallel, int threads,
+  std::vector<ObjectState> &states, std::vector<LoggedCommand> &log)
+{
+  gJobSystem.initiate(threads);
+  GameObjectManager::parallelUpdate = parallel;
+  gLog.clear();
+
+  std::vector<unsigned int> ids;
+  GameObjectManager manager;
+  for(int i = 0; i < kObjects; i++)
+    ids.push_back(manager.addObject(new Wanderer(model, i + 1, i % 3 != 0)));
+  for(int t = 0; t < kTicks; t++)
+    manager.update(kTickSeconds);
+
+  states.clear();
+  for(int i = 0; i < (int)ids.size(); i++)
+  {
+    GameObject *object = manager.getObjectPointer(ids[i]);
+    if(object == NULL)
+      continue;
+    ObjectState state;
+    state.id = ids[i];
+    state.position = object->getPosition();
+    state.orient = object->getOrientation();
+    state.box = object->getBoundingBox();
+    states.push_back(state);
+  }
+  log = gLog;
+
+  gJobSystem.shutdown();
+}
+
+int main()
+{
+  // don't leave compiled models in the source tree
+  Model::m_bUseCompiledCache = false;
+
+  Model model(Model::NoBuffers);
+  model.importS3d(MODEL_DIR "/plane2.1.s3d", false);
+  CHECK(model.isValid());
+
+  // small batches, so the objects are spread over every thread
+  GameObjectManager::parallelBatchSize = 4;
+
+  std::vector<ObjectState> serialStates;
+  std::vector<LoggedCommand> serialLog;
+  run(&model, false, 4, serialStates, serialLog);
+
+  // some have died and some are still going
+  printf("%d objects left, %d commands\n", (int)serialStates.size(), (int)serialLog.size());
+  CHECK(serialStates.size() > 0 && (int)serialStates.size() < kObjects);
+
+  const int threadCounts[] = { 1, 2, 4, 7 };
+  for(int i = 0; i < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); i++)
+  {
+    std::vector<ObjectState> states;
+    std::vector<LoggedCommand> log;
+    run(&model, true, threadCounts[i], states, log);
+    CHECK(states == serialStates);
+    CHECK(log == serialLog);
+  }
+
+  return checkResult();
+}
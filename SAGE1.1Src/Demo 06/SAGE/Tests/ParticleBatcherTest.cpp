@@ -0,0 +1,180 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBatcherTest.cpp - Counts the draws and states particles take
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParticleBatcherTest.cpp
+/// \brief Draws particle effects on the null backend, checking that the
+/// batches keep them back to front and how many draws and states they take.
+
+#include <stdio.h>
+#include <vector>
+#include "Common/Renderer.h"
+#include "Common/EulerAngles.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Particle/ParticleEngine.h"
+#include "Check.h"
+
+/// \brief A null backend that records the blend mode of every draw
+class RecordingBackend : public NullRenderBackend
+{
+public:
+  std::vector<unsigned> draws; ///< Destination blend of each draw
+  int states; ///< setState() calls
+  int textures; ///< selectTexture() calls
+  unsigned destBlend; ///< Destination blend last set
+
+  RecordingBackend() : NullRenderBackend(1.0f / 60.0f) { reset(); destBlend = 0; }
+
+  void reset() { draws.clear(); states = 0; textures = 0; }
+
+  void setState(ERenderState state, unsigned value)
+  {
+    states++;
+    if(state == eRenderStateDestBlend)
+      destBlend = value;
+  }
+  void selectTexture(int, Texture *) { textures++; }
+  void drawIndexed(Buffer *, unsigned, int, Buffer *, int, int, int, int) { draws.push_back(destBlend); }
+};
+
+/// An effect that keeps plenty of particles alive near its system
+static const char *kEffect =
+  "    <effect name=\"e\" particleCount=\"20\" textureName=\"%s\">\n"
+  "      <emit rate=\"10000\" shape=\"solidsphere\" />\n"
+  "      <particlelife value=\"100\" />\n"
+  "      <particlespeed value=\"0.1\" />\n"
+  "      <particlesize value=\"1\" />\n"
+  "      <blend value=\"%s\" />\n"
+  "    </effect>\n";
+
+/// \brief Writes a definition file of systems of one effect each, and the
+/// textures they use
+static void writeDefinitions(const char *filename)
+{
+  static const char *systems[][3] =
+  {
+    { "alpha", "a.png", "alpha" },
+    { "alpha2", "b.png", "alpha" },
+    { "add", "a.png", "additive" },
+    { "add2", "b.png", "additive" },
+  };
+
+  FILE *f = fopen(filename, "w");
+  fprintf(f, "<?xml version=\"1.0\" ?>\n<definitions>\n");
+  for(int i = 0; i < 4; i++)
+  {
+    fprintf(f, "  <system name=\"%s\" numcopies=\"10\">\n", systems[i][0]);
+    fprintf(f, kEffect, systems[i][1], systems[i][2]);
+    fprintf(f, "  </system>\n");
+  }
+  fprintf(f, "</definitions>\n");
+  fclose(f);
+
+  fclose(fopen("a.png", "w"));
+  fclose(fopen("b.png", "w"));
+}
+
+/// \brief Starts systems at increasing distances down the z axis, the
+/// first the furthest, draws a frame, and records the blend of each draw
+/// \param backend The backend
+/// \param names Names of the systems, back to front, ending with NULL
+static void drawFrame(RecordingBackend *backend, const char **names)
+{
+  gParticle.killAll();
+  int n = 0;
+  while(names[n] != NULL)
+    n++;
+  for(int i = 0; i < n; i++)
+    gParticle.createSystem(names[i], Vector3(0.0f, 0.0f, (float)(n - i) * 100.0f));
+  gParticle.update(0.1f);
+
+  backend->reset();
+  gRenderer.beginScene();
+  gParticle.render(false);
+  gRenderer.endScene();
+  gRenderer.flipPages();
+}
+
+/// \brief Checks the blend of each draw
+/// \param backend The backend
+/// \param blends Destination blends expected, ending with -1
+static bool drawsAre(RecordingBackend *backend, const int *blends)
+{
+  int n = 0;
+  while(blends[n] >= 0)
+    n++;
+  if((int)backend->draws.size() != n)
+    return false;
+  for(int i = 0; i < n; i++)
+  {
+    if((int)backend->draws[i] != blends[i])
+      return false;
+  }
+  return true;
+}
+
+int main()
+{
+  VideoMode mode = { 640, 480, 32, 60 };
+  RecordingBackend *backend = new RecordingBackend;
+  gRenderer.init(backend, mode);
+  gRenderer.setCamera(Vector3::kZeroVector, EulerAngles::kEulerAnglesIdentity);
+
+  writeDefinitions("batchtest.xml");
+  gParticle.init("batchtest.xml");
+
+  const int A = eDestBlendModeInvSrcAlpha;
+  const int D = eDestBlendModeOne;
+
+  // an additive effect behind an alpha blended one is drawn first
+  {
+    const char *names[] = { "add", "alpha", NULL };
+    const int blends[] = { D, A, -1 };
+    drawFrame(backend, names);
+    CHECK(drawsAre(backend, blends));
+  }
+
+  // additive effects with the same texture merge across other additive
+  // batches, but not across an alpha blended effect
+  {
+    const char *names[] = { "add", "add2", "add", "alpha", "add", NULL };
+    const int blends[] = { D, D, A, D, -1 };
+    drawFrame(backend, names);
+    CHECK(drawsAre(backend, blends));
+    int effects, batches;
+    gParticle.getBatchCounts(&effects, &batches);
+    CHECK(effects == 5);
+    CHECK(batches == 4);
+    CHECK(backend->textures == 4);
+  }
+
+  // alpha blended effects merge only with the batch straight before them
+  {
+    const char *names[] = { "alpha", "alpha", "alpha2", "alpha", NULL };
+    const int blends[] = { A, A, A, -1 };
+    drawFrame(backend, names);
+    CHECK(drawsAre(backend, blends));
+    CHECK(backend->textures == 3);
+  }
+
+  // the states shared by all the batches are set once, and put back
+  {
+    const char *names[] = { "alpha", "alpha", "alpha", NULL };
+    drawFrame(backend, names);
+    CHECK(backend->draws.size() == 1);
+    CHECK(backend->textures == 1);
+
+    // blend enable, depth write, lighting, vertex alpha and the blend
+    // mode, each set and put back
+    CHECK(backend->states <= 10);
+    CHECK(gRenderer.getRenderState(eRenderStateLighting) == 1);
+    CHECK(gRenderer.getRenderState(eRenderStateVertexAlpha) == 0);
+    CHECK(gRenderer.getRenderState(eRenderStateDepthWrite) == 1);
+  }
+
+  gParticle.shutdown();
+  gRenderer.shutdown();
+  return checkResult();
+}
@@ -0,0 +1,158 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBenchmark.cpp - Times the particle effects in particle.xml
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParticleBenchmark.cpp
+/// \brief Runs copies of every system in the game's particle.xml on the
+/// null backend, and prints how many live particles each kind updates and
+/// draws a millisecond.
+///
+/// Usage: ParticleBenchmark [frames [copies [threads]]].  Each kind of
+/// system is run on its own for the given number of frames at 60 a second,
+/// after a second to fill up, with the given number of copies running all
+/// the time; copies that die are started again.  The budget and level of
+/// detail are taken out of the definitions, so every copy runs in full.
+/// With more than one thread the effects are updated in parallel.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Common/Renderer.h"
+#include "Common/EulerAngles.h"
+#include "Common/JobSystem.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Particle/ParticleEngine.h"
+#include "TinyXML/tinyxml.h"
+
+/// Seconds a frame
+static const float kFrameTime = 1.0f / 60.0f;
+
+/// \brief Copies the definitions without the budget and level of detail,
+/// and with room for the given number of copies of each system
+/// \return The names of the systems, empty if the file couldn't be read
+static std::vector<std::string> writeDefinitions(const char *from, const char *to, int copies)
+{
+  std::vector<std::string> names;
+
+  TiXmlDocument doc(from);
+  if(!doc.LoadFile())
+    return names;
+  TiXmlElement *defs = doc.FirstChildElement("definitions");
+  if(defs == NULL)
+    return names;
+
+  defs->RemoveAttribute("budget");
+  defs->RemoveAttribute("lodnear");
+  defs->RemoveAttribute("lodfar");
+  defs->RemoveAttribute("lodmin");
+  for(TiXmlElement *system = defs->FirstChildElement("system"); system != NULL;
+    system = system->NextSiblingElement("system"))
+  {
+    system->SetAttribute("numcopies", copies);
+    names.push_back(system->Attribute("name"));
+  }
+
+  doc.SaveFile(to);
+  return names;
+}
+
+/// \brief What running one or more kinds of system took
+struct Timing
+{
+  double particles; ///< Live particles, added up over the frames
+  double updateSeconds; ///< Time spent updating
+  double renderSeconds; ///< Time spent sorting and writing sprites
+};
+
+/// \brief Keeps copies of the named systems running for some frames
+/// \param names Names of the systems to run
+/// \param copies How many of each to keep running
+/// \param frames Frames to time, after a second to fill up
+static Timing run(const std::vector<std::string> &names, int copies, int frames)
+{
+  Timing t = { 0.0, 0.0, 0.0 };
+  std::vector<unsigned int> uids(names.size() * copies, (unsigned int)-1);
+
+  gParticle.killAll();
+  for(int frame = -60; frame < frames; frame++)
+  {
+    // start any that aren't running, spread out in front of the camera
+    for(int i = 0; i < (int)uids.size(); i++)
+    {
+      if(gParticle.getSystemName(uids[i]).empty())
+      {
+        Vector3 pos((float)(i % 16) * 20.0f - 150.0f, 0.0f, 100.0f + (float)(i / 16) * 20.0f);
+        uids[i] = gParticle.createSystem(names[i / copies], pos);
+      }
+    }
+
+    double start = getClockSeconds();
+    gParticle.update(kFrameTime);
+    double updated = getClockSeconds();
+    gRenderer.beginScene();
+    gParticle.render(false);
+    gRenderer.endScene();
+    double rendered = getClockSeconds();
+    gRenderer.flipPages();
+
+    if(frame >= 0)
+    {
+      t.particles += gParticle.getPerformanceData(NULL, NULL);
+      t.updateSeconds += updated - start;
+      t.renderSeconds += rendered - updated;
+    }
+  }
+
+  return t;
+}
+
+/// \brief Prints a line of the table
+static void print(const char *name, const Timing &t, int frames)
+{
+  printf("%-20s %10.0f %12.0f %12.0f %10.1f\n", name, t.particles / frames,
+    t.particles / (t.updateSeconds * 1000.0), t.particles / (t.renderSeconds * 1000.0),
+    t.updateSeconds * 1.0e9 / t.particles);
+}
+
+int main(int argc, char *argv[])
+{
+  int frames = argc > 1 ? atoi(argv[1]) : 600;
+  int copies = argc > 2 ? atoi(argv[2]) : 20;
+  int threads = argc > 3 ? atoi(argv[3]) : 1;
+
+  VideoMode mode = { 640, 480, 32, 60 };
+  gRenderer.init(new NullRenderBackend(kFrameTime), mode);
+  gRenderer.setCamera(Vector3::kZeroVector, EulerAngles::kEulerAnglesIdentity);
+
+  if(threads > 1)
+    gJobSystem.initiate(threads);
+  ParticleEngine::parallelUpdate = threads > 1;
+
+  std::vector<std::string> names = writeDefinitions(PARTICLE_XML, "benchmark.xml", copies);
+  if(names.empty())
+  {
+    printf("can't read %s\n", PARTICLE_XML);
+    return 1;
+  }
+  gParticle.init("benchmark.xml");
+  gParticle.setRandomSeed(1);
+
+  printf("%d frames, %d copies of each system, %d thread%s\n\n", frames, copies,
+    threads, threads > 1 ? "s" : "");
+  printf("%-20s %10s %12s %12s %10s\n", "system", "particles", "updated/ms", "drawn/ms", "ns/update");
+
+  for(int i = 0; i < (int)names.size(); i++)
+  {
+    std::vector<std::string> one(1, names[i]);
+    print(names[i].c_str(), run(one, copies, frames), frames);
+  }
+  print("all together", run(names, copies, frames), frames);
+
+  gParticle.shutdown();
+  if(threads > 1)
+    gJobSystem.shutdown();
+  gRenderer.shutdown();
+  return 0;
+}
@@ -0,0 +1,103 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleBudgetTest.cpp - Keeps particle systems within their budget
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParticleBudgetTest.cpp
+/// \brief Runs particle systems on the null backend, checking that
+/// distance level of detail never takes them over the particle budget.
+
+#include <stdio.h>
+#include "Common/Renderer.h"
+#include "Common/EulerAngles.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Particle/ParticleEngine.h"
+#include "Check.h"
+
+/// \brief Writes a definition file with a budget of 100 particles and one
+/// system of 80, which near the camera gets all of them and from 1100
+/// away a quarter
+static void writeDefinitions(const char *filename)
+{
+  FILE *f = fopen(filename, "w");
+  fprintf(f,
+    "<?xml version=\"1.0\" ?>\n"
+    "<definitions budget=\"100\" lodnear=\"100\" lodfar=\"1100\" lodmin=\"0.25\">\n"
+    "  <system name=\"big\" numcopies=\"4\">\n"
+    "    <effect name=\"e\" particleCount=\"80\" textureName=\"p.png\">\n"
+    "      <emit rate=\"100000\" shape=\"solidsphere\" />\n"
+    "      <particlelife value=\"100\" />\n"
+    "      <particlespeed value=\"0.1\" />\n"
+    "      <particlesize value=\"1\" />\n"
+    "    </effect>\n"
+    "  </system>\n"
+    "</definitions>\n");
+  fclose(f);
+
+  fclose(fopen("p.png", "w"));
+}
+
+/// \brief Runs the systems long enough to fill up to their limits
+/// \return The number of live particles
+static int run()
+{
+  int systems, particles;
+  for(int i = 0; i < 10; i++)
+    gParticle.update(0.1f);
+  gParticle.getPerformanceData(&systems, &particles);
+  return particles;
+}
+
+int main()
+{
+  VideoMode mode = { 640, 480, 32, 60 };
+  gRenderer.init(new NullRenderBackend(1.0f / 60.0f), mode);
+  gRenderer.setCamera(Vector3::kZeroVector, EulerAngles::kEulerAnglesIdentity);
+
+  writeDefinitions("budgettest.xml");
+  gParticle.init("budgettest.xml");
+
+  const Vector3 nearPos(0.0f, 0.0f, 10.0f);
+  const Vector3 farPos(0.0f, 0.0f, 2000.0f);
+  int denied, stolen, degraded;
+
+  // a system cut down to fit stays cut down, close as it is
+  {
+    gParticle.createSystem("big", nearPos);
+    CHECK(gParticle.createSystem("big", nearPos) != (unsigned)-1);
+    gParticle.getSpawnCounts(&denied, &stolen, &degraded);
+    CHECK(degraded == 1);
+    CHECK(run() == 100);
+    gParticle.killAll();
+  }
+
+  // a far system that comes closer only grows into the room there is
+  {
+    unsigned int farSystem = gParticle.createSystem("big", farPos);
+    unsigned int nearSystem = gParticle.createSystem("big", nearPos);
+    CHECK(run() == 100);
+
+    gParticle.setSystemPos(farSystem, nearPos);
+    CHECK(run() == 100);
+
+    // and the rest of the way once there's room
+    gParticle.killSystem(nearSystem);
+    gParticle.update(0.1f);
+    CHECK(run() == 80);
+    gParticle.killAll();
+  }
+
+  // a system that was far when spawned grows as it comes closer
+  {
+    unsigned int system = gParticle.createSystem("big", farPos);
+    CHECK(run() == 20);
+    gParticle.setSystemPos(system, nearPos);
+    CHECK(run() == 80);
+    gParticle.killAll();
+  }
+
+  gParticle.shutdown();
+  gRenderer.shutdown();
+  return checkResult();
+}
@@ -0,0 +1,184 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// ParticleDeterminismTest.cpp - Checks seeded particles repeat on any thread
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file ParticleDeterminismTest.cpp
+/// \brief Runs copies of every system in the game's particle.xml from the
+/// same random seed, updated one effect at a time and then in parallel on
+/// different numbers of threads, up to all JobSystem::kMaxThreads, on a
+/// null backend that hashes every sprite vertex drawn.  Each run must draw
+/// the same number of particles and the same vertices, bit for bit, every
+/// frame.
+
+#include <stdio.h>
+#include <vector>
+#include "Common/Renderer.h"
+#include "Common/EulerAngles.h"
+#include "Common/JobSystem.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Particle/ParticleEngine.h"
+#include "TinyXML/tinyxml.h"
+#include "Check.h"
+
+/// Seconds a frame
+static const float kFrameTime = 1.0f / 60.0f;
+
+/// Frames to run
+static const int kFrames = 120;
+
+/// Copies of each system to run
+static const int kCopies = 3;
+
+/// \brief A null backend that hashes the vertices of every draw
+class HashingBackend : public NullRenderBackend
+{
+public:
+  unsigned int hash; ///< FNV-1a hash of the vertices drawn so far
+
+  HashingBackend() : NullRenderBackend(kFrameTime), hash(2166136261u) {}
+
+  void drawIndexed(Buffer *vertices, unsigned, int stride, Buffer *, int baseVertex,
+    int vertexCount, int, int)
+  {
+    const unsigned char *p = (const unsigned char *)
+      lockBuffer(vertices, baseVertex * stride, vertexCount * stride, eLockNormal);
+    for(int i = 0; i < vertexCount * stride; i++)
+      hash = (hash ^ p[i]) * 16777619u;
+    unlockBuffer(vertices);
+  }
+};
+
+/// \brief Copies the definitions without the budget and level of detail,
+/// and with room for kCopies of each system
+/// \return The names of the systems, empty if the file couldn't be read
+static std::vector<std::string> writeDefinitions(const char *from, const char *to)
+{
+  std::vector<std::string> names;
+
+  TiXmlDocument doc(from);
+  if(!doc.LoadFile())
+    return names;
+  TiXmlElement *defs = doc.FirstChildElement("definitions");
+  if(defs == NULL)
+    return names;
+
+  defs->RemoveAttribute("budget");
+  defs->RemoveAttribute("lodnear");
+  defs->RemoveAttribute("lodfar");
+  defs->RemoveAttribute("lodmin");
+  for(TiXmlElement *system = defs->FirstChildElement("system"); system != NULL;
+    system = system->NextSiblingElement("system"))
+  {
+    system->SetAttribute("numcopies", kCopies);
+    names.push_back(system->Attribute("name"));
+  }
+
+  doc.SaveFile(to);
+  return names;
+}
+
+/// \brief What a run drew each frame
+struct Frame
+{
+  int particles; ///< Live particles after the update
+  unsigned int hash; ///< Hash of the vertices drawn
+};
+
+/// \brief Runs kCopies of every system from a seed, starting copies again
+/// as they die, and records what each frame drew.
+/// \param backend The backend, to read the hash from.
+/// \param names Names of the systems.
+/// \param parallel Whether to update the effects in parallel.
+/// \param threads Number of threads for gJobSystem.
+/// \param seed The random seed.
+static std::vector<Frame> run(HashingBackend *backend, const std::vector<std::string> &names,
+  bool parallel, int threads, unsigned int seed = 1234)
+{
+  gJobSystem.initiate(threads);
+  ParticleEngine::parallelUpdate = parallel;
+  gParticle.killAll();
+  gParticle.setRandomSeed(seed);
+
+  std::vector<Frame> frames;
+  std::vector<unsigned int> uids(names.size() * kCopies, (unsigned int)-1);
+  for(int frame = 0; frame < kFrames; frame++)
+  {
+    for(int i = 0; i < (int)uids.size(); i++)
+    {
+      if(gParticle.getSystemName(uids[i]).empty())
+      {
+        Vector3 pos((float)(i % 8) * 20.0f - 70.0f, 0.0f, 100.0f + (float)(i / 8) * 20.0f);
+        uids[i] = gParticle.createSystem(names[i / kCopies], pos);
+      }
+    }
+
+    gParticle.update(kFrameTime);
+    backend->hash = 2166136261u;
+    gRenderer.beginScene();
+    gParticle.render(false);
+    gRenderer.endScene();
+    gRenderer.flipPages();
+
+    Frame f;
+    f.particles = gParticle.getPerformanceData(NULL, NULL);
+    f.hash = backend->hash;
+    frames.push_back(f);
+  }
+
+  gJobSystem.shutdown();
+  return frames;
+}
+
+/// \brief Tests two runs for drawing the same thing every frame
+static bool sameFrames(const std::vector<Frame> &a, const std::vector<Frame> &b)
+{
+  if(a.size() != b.size())
+    return false;
+  for(int i = 0; i < (int)a.size(); i++)
+    if(a[i].particles != b[i].particles || a[i].hash != b[i].hash)
+      return false;
+  return true;
+}
+
+int main()
+{
+  VideoMode mode = { 640, 480, 32, 60 };
+  HashingBackend *backend = new HashingBackend;
+  gRenderer.init(backend, mode);
+  gRenderer.setCamera(Vector3::kZeroVector, EulerAngles::kEulerAnglesIdentity);
+
+  std::vector<std::string> names = writeDefinitions(PARTICLE_XML, "determinism.xml");
+  CHECK(!names.empty());
+  if(names.empty())
+    return checkResult();
+  gParticle.init("determinism.xml");
+
+  // small batches, so the effects are spread over every thread
+  ParticleEngine::parallelBatchSize = 2;
+
+  std::vector<Frame> serial = run(backend, names, false, 1);
+  printf("%d systems, %d particles in the last frame\n", (int)names.size() * kCopies,
+    serial.back().particles);
+  CHECK(serial.back().particles > 0);
+
+  // the same run again gives the same, so the seed is all there is to it
+  CHECK(sameFrames(run(backend, names, false, 1), serial));
+
+  // the last asks for more threads than there can be, so every random
+  // stream is used
+  const int threadCounts[] = { 1, 2, 4, 7, JobSystem::kMaxThreads * 2 };
+  for(int i = 0; i < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); i++)
+  {
+    CHECK(sameFrames(run(backend, names, false, threadCounts[i]), serial));
+    CHECK(sameFrames(run(backend, names, true, threadCounts[i]), serial));
+  }
+
+  // and a different seed doesn't
+  CHECK(!sameFrames(run(backend, names, false, 1, 4321), serial));
+
+  gParticle.shutdown();
+  gRenderer.shutdown();
+  return checkResult();
+}
@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// RadixSortTest.cpp - Checks the particle radix sort against a bubble sort
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file RadixSortTest.cpp
+/// \brief Sorts keys with ParticleUtil::radixSort() and a bubble sort,
+/// which is stable and too simple to be wrong, and checks they agree.
+
+#include <stdlib.h>
+#include <vector>
+#include "Particle/ParticleDefines.h"
+#include "Check.h"
+
+/// \brief Stable sort of indices by key, smallest first
+static void bubbleSort(const std::vector<unsigned> &keys, std::vector<int> &order)
+{
+  int count = (int)keys.size();
+  order.resize(count);
+  for(int i = 0; i < count; i++)
+    order[i] = i;
+  for(int i = 0; i < count; i++)
+  {
+    for(int j = count - 1; j > i; j--)
+    {
+      if(keys[order[j]] < keys[order[j - 1]])
+      {
+        int tmp = order[j];
+        order[j] = order[j - 1];
+        order[j - 1] = tmp;
+      }
+    }
+  }
+}
+
+/// \return True if the radix sort of the keys gives the same order as
+/// the bubble sort
+static bool sortsSame(const std::vector<unsigned> &keys)
+{
+  int count = (int)keys.size();
+  std::vector<int> expected;
+  bubbleSort(keys, expected);
+
+  std::vector<int> order(count + 1), scratch(count + 1);
+  ParticleUtil::radixSort(count > 0 ? &keys[0] : NULL, &order[0], &scratch[0], count);
+  for(int i = 0; i < count; i++)
+  {
+    if(order[i] != expected[i])
+      return false;
+  }
+  return true;
+}
+
+/// \return A random 32-bit number, from three calls to rand(), which may
+/// give as few as 15 bits
+static unsigned random32()
+{
+  return ((unsigned)rand() << 30) ^ ((unsigned)rand() << 15) ^ (unsigned)rand();
+}
+
+int main()
+{
+  srand(1);
+  std::vector<unsigned> keys;
+
+  // nothing and one
+  CHECK(sortsSame(keys));
+  keys.push_back(7);
+  CHECK(sortsSame(keys));
+
+  // random keys across all 32 bits, so every pass runs
+  for(int trial = 0; trial < 20; trial++)
+  {
+    keys.resize(1 + rand() % 500);
+    for(int i = 0; i < (int)keys.size(); i++)
+      keys[i] = random32();
+    CHECK(sortsSame(keys));
+  }
+
+  // lots of ties, in one digit and across all three
+  for(int trial = 0; trial < 20; trial++)
+  {
+    keys.resize(1 + rand() % 500);
+    for(int i = 0; i < (int)keys.size(); i++)
+      keys[i] = trial % 2 == 0 ? rand() % 8 : (unsigned)(rand() % 4) * 0x40100801u;
+    CHECK(sortsSame(keys));
+  }
+
+  // all the same, which skips every pass
+  keys.assign(300, 0x12345678u);
+  CHECK(sortsSame(keys));
+
+  // already sorted, and backwards
+  keys.resize(400);
+  for(int i = 0; i < 400; i++)
+    keys[i] = (unsigned)i * 0x00A00B07u;
+  CHECK(sortsSame(keys));
+  for(int i = 0; i < 400; i++)
+    keys[i] = (unsigned)(400 - i) * 0x00A00B07u;
+  CHECK(sortsSame(keys));
+
+  // depth keys put the farthest first, and negative zero ties with zero
+  // rather than going ahead of everything
+  {
+    const float distances[] = { 4.0f, 0.0f, -0.0f, 1.0e20f, 0.25f, 4.0f, 1.0e-30f };
+    const int expected[] = { 3, 0, 5, 4, 6, 1, 2 };
+    const int count = sizeof(distances) / sizeof(distances[0]);
+    keys.resize(count);
+    for(int i = 0; i < count; i++)
+      keys[i] = ParticleUtil::depthKey(distances[i]);
+    CHECK(keys[1] == keys[2]);
+    CHECK(sortsSame(keys));
+
+    int order[count], scratch[count];
+    ParticleUtil::radixSort(&keys[0], order, scratch, count);
+    bool same = true;
+    for(int i = 0; i < count; i++)
+      same = same && order[i] == expected[i];
+    CHECK(same);
+  }
+
+  return checkResult();
+}
@@ -0,0 +1,90 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// RendererTest.cpp - Runs the renderer on the null backend
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file RendererTest.cpp
+/// \brief Checks that the renderer only passes on what changes, and counts
+/// what it passes on.
+
+#include "Common/Renderer.h"
+#include "Graphics/NullRenderBackend.h"
+#include "Graphics/VertexTypes.h"
+#include "Graphics/IndexBuffer.h"
+#include "Check.h"
+
+/// \brief A null backend that counts the calls made on it
+class CountingBackend : public NullRenderBackend
+{
+public:
+  int states; ///< setState() calls
+  int textures; ///< selectTexture() calls
+  int draws; ///< drawIndexed() calls
+
+  CountingBackend() : NullRenderBackend(1.0f / 60.0f) { states = textures = draws = 0; }
+
+  void setState(ERenderState, unsigned) { states++; }
+  void selectTexture(int, Texture *) { textures++; }
+  void drawIndexed(Buffer *, unsigned, int, Buffer *, int, int, int, int) { draws++; }
+};
+
+int main()
+{
+  VideoMode mode = { 640, 480, 32, 60 };
+  CountingBackend *backend = new CountingBackend;
+  gRenderer.init(backend, mode);
+
+  CHECK(gRenderer.isHeadless());
+  CHECK(gRenderer.getBackend() == backend);
+  CHECK(gRenderer.getVideoModeCount() == 1);
+
+  // a state is only sent if it changes, and the renderer remembers it
+
+  gRenderer.flipPages();
+  backend->states = 0;
+  gRenderer.setBlendEnable(false);
+  gRenderer.setBlendEnable(false);
+  gRenderer.setRenderState(eRenderStateLighting, 0);
+  gRenderer.setRenderState(eRenderStateLighting, 0);
+  CHECK(backend->states == 2);
+  CHECK(gRenderer.getRenderState(eRenderStateBlendEnable) == 0);
+  CHECK(gRenderer.getRenderState(eRenderStateLighting) == 0);
+  gRenderer.flipPages();
+  CHECK(gRenderer.getCallCount(eRenderCallState) == 2);
+
+  // buffers live in memory and draw through the backend
+
+  LitVertexBuffer vb(4, true);
+  IndexBuffer ib(2);
+  CHECK(vb.lock());
+  for(int i = 0; i < 4; i++)
+    vb[i].p = Vector3((float)(i & 1), (float)(i >> 1), 0.0f);
+  vb.unlock();
+  CHECK(ib.lock());
+  ib[0].index[0] = 0; ib[0].index[1] = 1; ib[0].index[2] = 2;
+  ib[1].index[0] = 2; ib[1].index[1] = 1; ib[1].index[2] = 3;
+  ib.unlock();
+
+  backend->textures = 0;
+  gRenderer.beginScene();
+  gRenderer.selectTexture(-1);
+  gRenderer.render(&vb, &ib);
+  gRenderer.endScene();
+  gRenderer.flipPages();
+
+  CHECK(backend->draws == 1);
+  CHECK(backend->textures == 1);
+  CHECK(gRenderer.getCallCount(eRenderCallDraw) >= 1);
+  CHECK(gRenderer.getCallCount(eRenderCallState) == 0);
+  CHECK(gRenderer.getCallCount(eRenderCallTexture) == 1);
+
+  // the clock runs a fixed time a frame
+  long before = gRenderer.getTime();
+  gRenderer.flipPages();
+  CHECK(gRenderer.getTime() - before == 16 || gRenderer.getTime() - before == 17);
+
+  gRenderer.shutdown();
+  CHECK(gRenderer.getBackend() == NULL);
+  return checkResult();
+}
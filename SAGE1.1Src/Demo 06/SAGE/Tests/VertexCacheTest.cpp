@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// VertexCacheTest.cpp - Checks the triangle reordering for the vertex cache
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/// \file VertexCacheTest.cpp
+/// \brief Loads the crow, the plane and the silos from the game's models,
+/// and prints how well each uses the post-transform vertex cache before and
+/// after EditTriMesh::optimizeTriOrder(), as the average cache miss ratio
+/// (ACMR, vertices transformed a triangle) and the average transform to
+/// vertex ratio (ATVR, vertices transformed a vertex used).
+///
+/// Each part and material is measured on its own, the way Model splits
+/// them.  The reordering must keep every triangle and its winding, must not
+/// make any model worse, and must bring each one's ATVR under kMaxAtvr.
+/// The parts of the model Model::importS3d() builds must come out the same
+/// as reordering them here, so the loader is known to use it.
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "Common/EditTriMesh.h"
+#include "Common/Model.h"
+#include "Common/Renderer.h"
+#include "Common/TriMesh.h"
+#include "Check.h"
+
+/// Models to measure, from the game's model directory
+static const char *kModels[] =
+{
+  "crow00.s3d", "crow01.s3d", "crow02.s3d", "crow03.s3d", "crow04.s3d",
+  "plane2.1.s3d",
+  "cylo1.s3d", "cylo2.s3d", "cylo3.s3d", "cylo4.s3d",
+};
+
+/// FIFO cache sizes to measure with
+static const int kCacheSizes[] = { 16, 32 };
+
+/// Worst ATVR allowed after reordering, with a 16 vertex cache.  The models
+/// come in at 1.06 to 1.15; 1 is perfect.
+static const float kMaxAtvr = 1.2f;
+
+/// \brief Vertex cache misses over some meshes
+struct CacheStats
+{
+  int tris; ///< Triangles
+  int misses; ///< Vertices transformed
+  int used; ///< Vertices used
+
+  CacheStats() : tris(0), misses(0), used(0) {}
+
+  /// \brief Adds a mesh, measured with a cache of the given size
+  void add(const EditTriMesh &mesh, int cacheSize)
+  {
+    float acmr, atvr;
+    mesh.computeVertexCacheStats(cacheSize, &acmr, &atvr);
+    if(mesh.triCount() < 1)
+      return;
+    int meshMisses = (int)(acmr * mesh.triCount() + 0.5f);
+    tris += mesh.triCount();
+    misses += meshMisses;
+    used += (int)(meshMisses / atvr + 0.5f);
+  }
+
+  float acmr() const { return tris > 0 ? (float)misses / tris : 0.0f; }
+  float atvr() const { return used > 0 ? (float)misses / used : 0.0f; }
+};
+
+/// \brief A triangle's vertex indices, rotated so the smallest is first,
+/// which keeps the winding
+struct TriKey
+{
+  int v[3];
+
+  bool operator<(const TriKey &x) const
+  {
+    return std::lexicographical_compare(v, v + 3, x.v, x.v + 3);
+  }
+  bool operator==(const TriKey &x) const
+  {
+    return v[0] == x.v[0] && v[1] == x.v[1] && v[2] == x.v[2];
+  }
+};
+
+/// \brief Lists a mesh's triangles, sorted
+static std::vector<TriKey> sortedTris(const EditTriMesh &mesh)
+{
+  std::vector<TriKey> keys(mesh.triCount());
+  for(int i = 0; i < mesh.triCount(); i++)
+  {
+    const EditTriMesh::Tri &t = mesh.tri(i);
+    int first = 0;
+    for(int j = 1; j < 3; j++)
+      if(t.v[j].index < t.v[first].index)
+        first = j;
+    for(int j = 0; j < 3; j++)
+      keys[i].v[j] = t.v[(first + j) % 3].index;
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+/// \brief Copies a finished part's triangle list into an edit mesh, so it
+/// can be measured.  Only the vertex indices are copied.
+static void copyTris(const TriMesh &part, EditTriMesh &result)
+{
+  result.empty();
+  result.setVertexCount(part.getVertexCount());
+  result.setTriCount(part.getTriCount());
+  const RenderTri *tris = part.getTriList();
+  for(int i = 0; i < part.getTriCount(); i++)
+    for(int j = 0; j < 3; j++)
+      result.tri(i).v[j].index = tris[i].index[j];
+}
+
+/// \brief Measures a model, and checks the reordering
+static void checkModel(const char *name)
+{
+  char filename[256], error[256];
+  sprintf(filename, "%s/%s", MODEL_DIR, name);
+
+  const int sizeCount = sizeof(kCacheSizes) / sizeof(kCacheSizes[0]);
+  CacheStats before[sizeCount], after[sizeCount], loaded[sizeCount];
+
+  // split it the way Model does, and reorder each piece
+
+  EditTriMesh mesh;
+  if(!mesh.importS3d(filename, error, sizeof(error), false))
+  {
+    printf("can't load %s.  %s.\n", filename, error);
+    CHECK(false);
+    return;
+  }
+  mesh.optimizeForRendering();
+
+  bool sameTris = true;
+  EditTriMesh piece;
+  for(int p = 0; p < mesh.partCount(); p++)
+    for(int m = 0; m < mesh.materialCount(); m++)
+    {
+      mesh.extractOnePartOneMaterial(p, m, &piece);
+      if(piece.triCount() < 1)
+        continue;
+      piece.copyUvsIntoVertices();
+
+      EditTriMesh reordered(piece);
+      reordered.optimizeTriOrder();
+      sameTris = sameTris && sortedTris(piece) == sortedTris(reordered);
+
+      for(int c = 0; c < sizeCount; c++)
+      {
+        before[c].add(piece, kCacheSizes[c]);
+        after[c].add(reordered, kCacheSizes[c]);
+      }
+    }
+  CHECK(sameTris);
+
+  // and what the game gets
+
+  Model model(Model::NoBuffers);
+  model.importS3d(filename, false);
+  CHECK(model.isValid());
+  for(int i = 0; i < model.getPartCount(); i++)
+  {
+    copyTris(*model.getPartMesh(i), piece);
+    for(int c = 0; c < sizeCount; c++)
+      loaded[c].add(piece, kCacheSizes[c]);
+  }
+
+  for(int c = 0; c < sizeCount; c++)
+  {
+    printf("%-14s %6d %6d %10.3f %8.3f %10.3f %8.3f\n", name, before[c].tris, kCacheSizes[c],
+      before[c].acmr(), after[c].acmr(), before[c].atvr(), after[c].atvr());
+    CHECK(after[c].misses <= before[c].misses);
+    CHECK(loaded[c].tris == after[c].tris && loaded[c].misses == after[c].misses);
+  }
+  CHECK(after[0].atvr() < kMaxAtvr);
+}
+
+int main()
+{
+  // don't leave compiled models in the source tree
+  Model::m_bUseCompiledCache = false;
+
+  printf("%-14s %6s %6s %10s %8s %10s %8s\n", "model", "tris", "cache",
+    "ACMR was", "now", "ATVR was", "now");
+  for(int i = 0; i < (int)(sizeof(kModels) / sizeof(kModels[0])); i++)
+    checkModel(kModels[i]);
+
+  return checkResult();
+}